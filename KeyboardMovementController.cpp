@@ -5,6 +5,7 @@
 namespace prx {
 
 	void KeyboardMovementController::moveInPlaneXZ(GLFWwindow* window, float dt, PrxGameObject& gameObject) {
+		auto& transform = gameObject.transform();
 		glm::vec3 rotate{ 0 };
 
 		if (glfwGetKey(window, keys.lookRight) == GLFW_PRESS) rotate.y += 1.f;
@@ -18,15 +19,15 @@ namespace prx {
 		if (glm::dot(rotate, rotate) > std::numeric_limits<float>::epsilon()) {
 			// update independent of frame rate (via dt)
 			//	normalize rotate so the game object doesn't rotate faster diagonally
-			gameObject.transform.rotation += lookSpeed * dt * glm::normalize(rotate);
+			transform.rotation += lookSpeed * dt * glm::normalize(rotate);
 		}
 
 		// Not necessary, but for now, limit game objects from being able to go upside down
 		//	Pitch limited to roughly +/- 85 degrees off x axis
-		gameObject.transform.rotation.x = glm::clamp(gameObject.transform.rotation.x, -1.5f, 1.5f);
-		gameObject.transform.rotation.y = glm::mod(gameObject.transform.rotation.y, glm::two_pi<float>()); // prevents repeat spinning causing an overflow
+		transform.rotation.x = glm::clamp(transform.rotation.x, -1.5f, 1.5f);
+		transform.rotation.y = glm::mod(transform.rotation.y, glm::two_pi<float>()); // prevents repeat spinning causing an overflow
 
-		float yaw = gameObject.transform.rotation.y;
+		float yaw = transform.rotation.y;
 		const glm::vec3 forwardDir{ sin(yaw), 0.f, cos(yaw) };
 		const glm::vec3 rightDir{ forwardDir.z, 0.f, -forwardDir.x };
 		const glm::vec3 upDir{ 0.f, -1.f, 0.f };
@@ -46,13 +47,14 @@ namespace prx {
 		if (glm::dot(moveDir, moveDir) > std::numeric_limits<float>::epsilon()) {
 			// update independent of frame rate (via dt)
 			//	normalize moveDir so the game object doesn't translate faster diagonally
-			gameObject.transform.translation += moveSpeed * dt * glm::normalize(moveDir);
+			transform.translation += moveSpeed * dt * glm::normalize(moveDir);
 		}
 	}
 
 
 	void KeyboardMovementController::handleMouseLook(GLFWwindow* window, float dt, PrxGameObject& gameObject) {
 		if (glfwGetInputMode(window, GLFW_CURSOR) == GLFW_CURSOR_NORMAL) return; // do not do anything if cursor mode is normal
+		auto& transform = gameObject.transform();
 
 		glm::vec3 rotate{ 0 };
 
@@ -62,13 +64,13 @@ namespace prx {
 		if (glm::dot(rotate, rotate) > std::numeric_limits<float>::epsilon()) {
 			// update independent of frame rate (via dt)
 			//	normalize rotate so the game object doesn't rotate faster diagonally
-			gameObject.transform.rotation += mouseLookSpeed * dt * glm::normalize(rotate);
+			transform.rotation += mouseLookSpeed * dt * glm::normalize(rotate);
 		}
 
 		// Not necessary, but for now, limit game objects from being able to go upside down
 		//	Pitch limited to roughly +/- 85 degrees off x axis
-		gameObject.transform.rotation.x = glm::clamp(gameObject.transform.rotation.x, -1.5f, 1.5f);
-		gameObject.transform.rotation.y = glm::mod(gameObject.transform.rotation.y, glm::two_pi<float>()); // prevents repeat spinning causing an overflow
+		transform.rotation.x = glm::clamp(transform.rotation.x, -1.5f, 1.5f);
+		transform.rotation.y = glm::mod(transform.rotation.y, glm::two_pi<float>()); // prevents repeat spinning causing an overflow
 	}
 
 	void KeyboardMovementController::toggleMouseCursor(GLFWwindow* window) {
@@ -0,0 +1,81 @@
+#pragma once
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm.hpp"
+
+// std
+#include <cfloat>
+
+namespace prx {
+
+	// Axis aligned bounding box. Default constructed it is empty (min > max), so growing it by
+	//	points or other boxes works without a special first case
+	struct PrxAabb {
+		glm::vec3 min{ FLT_MAX };
+		glm::vec3 max{ -FLT_MAX };
+
+		static PrxAabb merge(const PrxAabb& a, const PrxAabb& b) {
+			return PrxAabb{ glm::min(a.min, b.min), glm::max(a.max, b.max) };
+		}
+
+		void grow(const glm::vec3& point) {
+			min = glm::min(min, point);
+			max = glm::max(max, point);
+		}
+		void grow(const PrxAabb& other) {
+			min = glm::min(min, other.min);
+			max = glm::max(max, other.max);
+		}
+
+		bool isEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+		glm::vec3 center() const { return (min + max) * .5f; }
+		glm::vec3 extent() const { return max - min; }
+
+		// the cost metric for tree building: a ray hits a box with odds proportional to this
+		float surfaceArea() const {
+			glm::vec3 e = max - min;
+			return 2.f * (e.x * e.y + e.y * e.z + e.z * e.x);
+		}
+
+		bool contains(const PrxAabb& other) const {
+			return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z
+				&& other.max.x <= max.x && other.max.y <= max.y && other.max.z <= max.z;
+		}
+
+		bool overlaps(const PrxAabb& other) const {
+			return min.x <= other.max.x && other.min.x <= max.x
+				&& min.y <= other.max.y && other.min.y <= max.y
+				&& min.z <= other.max.z && other.min.z <= max.z;
+		}
+
+		bool overlapsSphere(const glm::vec3& center, float radius) const {
+			glm::vec3 closest = glm::clamp(center, min, max);
+			glm::vec3 offset = closest - center;
+			return glm::dot(offset, offset) <= radius * radius;
+		}
+
+		// Slab test. invDirection is 1 / direction per axis (infinities are fine).
+		//	Returns true when the ray enters the box before maxDistance, with the entry in tEnter
+		bool intersectsRay(const glm::vec3& origin, const glm::vec3& invDirection, float maxDistance, float& tEnter) const {
+			glm::vec3 t0 = (min - origin) * invDirection;
+			glm::vec3 t1 = (max - origin) * invDirection;
+			glm::vec3 tNear = glm::min(t0, t1);
+			glm::vec3 tFar = glm::max(t0, t1);
+			tEnter = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.f));
+			float tExit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, maxDistance));
+			return tEnter <= tExit;
+		}
+
+		// world space box around this one after a transform, from the absolute matrix (Arvo)
+		PrxAabb transformed(const glm::mat4& transform) const {
+			glm::vec3 c = glm::vec3(transform * glm::vec4(center(), 1.f));
+			glm::vec3 halfSize = (max - min) * .5f;
+			glm::vec3 e = glm::abs(glm::vec3(transform[0])) * halfSize.x
+				+ glm::abs(glm::vec3(transform[1])) * halfSize.y
+				+ glm::abs(glm::vec3(transform[2])) * halfSize.z;
+			return PrxAabb{ c - e, c + e };
+		}
+	};
+}
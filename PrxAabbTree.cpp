@@ -0,0 +1,308 @@
+#include "PrxAabbTree.hpp"
+
+// std
+#include <algorithm>
+
+namespace prx {
+
+	int32_t PrxAabbTree::createProxy(const PrxAabb& aabb, uint32_t userData) {
+		int32_t proxyId = allocateNode();
+		Node& node = nodes[proxyId];
+		node.aabb = PrxAabb{ aabb.min - glm::vec3{ margin }, aabb.max + glm::vec3{ margin } };
+		node.userData = userData;
+		node.height = 0;
+
+		insertLeaf(proxyId);
+		proxyCount++;
+		return proxyId;
+	}
+
+	void PrxAabbTree::destroyProxy(int32_t proxyId) {
+		assert(proxyId >= 0 && proxyId < static_cast<int32_t>(nodes.size()) && nodes[proxyId].isLeaf()
+			&& nodes[proxyId].height == 0 && "Not a proxy of this tree");
+
+		removeLeaf(proxyId);
+		freeNode(proxyId);
+		proxyCount--;
+	}
+
+	bool PrxAabbTree::moveProxy(int32_t proxyId, const PrxAabb& aabb) {
+		assert(proxyId >= 0 && proxyId < static_cast<int32_t>(nodes.size()) && nodes[proxyId].isLeaf()
+			&& nodes[proxyId].height == 0 && "Not a proxy of this tree");
+
+		PrxAabb fatAabb{ aabb.min - glm::vec3{ margin }, aabb.max + glm::vec3{ margin } };
+		const PrxAabb& treeAabb = nodes[proxyId].aabb;
+		if (treeAabb.contains(aabb)) {
+			// still inside the old fat box. Only reinsert if the object shrank so much that the
+			//	old box would keep producing false hits
+			PrxAabb hugeAabb{ fatAabb.min - glm::vec3{ 4.f * margin }, fatAabb.max + glm::vec3{ 4.f * margin } };
+			if (hugeAabb.contains(treeAabb)) {
+				return false;
+			}
+		}
+
+		removeLeaf(proxyId);
+		nodes[proxyId].aabb = fatAabb;
+		insertLeaf(proxyId);
+		return true;
+	}
+
+	int32_t PrxAabbTree::allocateNode() {
+		if (freeList == NULL_NODE) {
+			nodes.emplace_back();
+			return static_cast<int32_t>(nodes.size() - 1);
+		}
+
+		int32_t nodeId = freeList;
+		freeList = nodes[nodeId].parent;
+		nodes[nodeId] = Node{};
+		return nodeId;
+	}
+
+	void PrxAabbTree::freeNode(int32_t nodeId) {
+		nodes[nodeId].parent = freeList;
+		nodes[nodeId].height = -1;
+		freeList = nodeId;
+	}
+
+	void PrxAabbTree::insertLeaf(int32_t leaf) {
+		if (root == NULL_NODE) {
+			root = leaf;
+			nodes[root].parent = NULL_NODE;
+			return;
+		}
+
+		// Walk down to the best sibling (Catto's branch and bound lite): at each node, either pair
+		//	the leaf with the whole node, or descend into the child whose box grows the least.
+		//	Everything above pays for the growth too, which is the inheritance cost
+		const PrxAabb leafAabb = nodes[leaf].aabb;
+		int32_t index = root;
+		while (!nodes[index].isLeaf()) {
+			const Node& node = nodes[index];
+			float area = node.aabb.surfaceArea();
+			float combinedArea = PrxAabb::merge(node.aabb, leafAabb).surfaceArea();
+
+			// cost of a new parent for this node and the leaf, and of pushing the leaf further down
+			float cost = 2.f * combinedArea;
+			float inheritanceCost = 2.f * (combinedArea - area);
+
+			auto descendCost = [&](int32_t childId) {
+				const Node& child = nodes[childId];
+				float grownArea = PrxAabb::merge(leafAabb, child.aabb).surfaceArea();
+				if (child.isLeaf()) {
+					return grownArea + inheritanceCost;
+				}
+				return grownArea - child.aabb.surfaceArea() + inheritanceCost;
+			};
+			float cost1 = descendCost(node.child1);
+			float cost2 = descendCost(node.child2);
+
+			if (cost < cost1 && cost < cost2) break;
+			index = cost1 < cost2 ? node.child1 : node.child2;
+		}
+		const int32_t sibling = index;
+
+		// new parent for the sibling and the leaf. Note: allocating can move the nodes
+		const int32_t oldParent = nodes[sibling].parent;
+		const int32_t newParent = allocateNode();
+		Node& parent = nodes[newParent];
+		parent.parent = oldParent;
+		parent.aabb = PrxAabb::merge(leafAabb, nodes[sibling].aabb);
+		parent.height = nodes[sibling].height + 1;
+		parent.child1 = sibling;
+		parent.child2 = leaf;
+
+		if (oldParent != NULL_NODE) {
+			if (nodes[oldParent].child1 == sibling) {
+				nodes[oldParent].child1 = newParent;
+			}
+			else {
+				nodes[oldParent].child2 = newParent;
+			}
+		}
+		else {
+			root = newParent;
+		}
+		nodes[sibling].parent = newParent;
+		nodes[leaf].parent = newParent;
+
+		refitUpwards(newParent);
+	}
+
+	void PrxAabbTree::removeLeaf(int32_t leaf) {
+		if (leaf == root) {
+			root = NULL_NODE;
+			return;
+		}
+
+		// the leaf's parent goes away, and the sibling takes its place
+		const int32_t parent = nodes[leaf].parent;
+		const int32_t grandParent = nodes[parent].parent;
+		const int32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+		if (grandParent != NULL_NODE) {
+			if (nodes[grandParent].child1 == parent) {
+				nodes[grandParent].child1 = sibling;
+			}
+			else {
+				nodes[grandParent].child2 = sibling;
+			}
+			nodes[sibling].parent = grandParent;
+			freeNode(parent);
+			refitUpwards(grandParent);
+		}
+		else {
+			root = sibling;
+			nodes[sibling].parent = NULL_NODE;
+			freeNode(parent);
+		}
+	}
+
+	void PrxAabbTree::refitUpwards(int32_t nodeId) {
+		while (nodeId != NULL_NODE) {
+			nodeId = balance(nodeId);
+
+			Node& node = nodes[nodeId];
+			const Node& child1 = nodes[node.child1];
+			const Node& child2 = nodes[node.child2];
+			node.height = 1 + std::max(child1.height, child2.height);
+			node.aabb = PrxAabb::merge(child1.aabb, child2.aabb);
+
+			nodeId = node.parent;
+		}
+	}
+
+	int32_t PrxAabbTree::balance(int32_t iA) {
+		Node& A = nodes[iA];
+		if (A.isLeaf() || A.height < 2) {
+			return iA;
+		}
+
+		const int32_t iB = A.child1;
+		const int32_t iC = A.child2;
+		Node& B = nodes[iB];
+		Node& C = nodes[iC];
+
+		// hooks the rotated subtree's new root up to A's old parent
+		auto replaceInParent = [&](int32_t newRoot) {
+			Node& newRootNode = nodes[newRoot];
+			newRootNode.parent = A.parent;
+			A.parent = newRoot;
+			if (newRootNode.parent != NULL_NODE) {
+				Node& parent = nodes[newRootNode.parent];
+				if (parent.child1 == iA) {
+					parent.child1 = newRoot;
+				}
+				else {
+					assert(parent.child2 == iA && "Tree links are broken");
+					parent.child2 = newRoot;
+				}
+			}
+			else {
+				root = newRoot;
+			}
+		};
+
+		int32_t balanceFactor = C.height - B.height;
+
+		// rotate C up: C takes A's place, A becomes C's child and adopts the shorter of C's children
+		if (balanceFactor > 1) {
+			const int32_t iF = C.child1;
+			const int32_t iG = C.child2;
+			Node& F = nodes[iF];
+			Node& G = nodes[iG];
+
+			C.child1 = iA;
+			replaceInParent(iC);
+
+			// the taller grandchild stays with C
+			if (F.height > G.height) {
+				C.child2 = iF;
+				A.child2 = iG;
+				G.parent = iA;
+				A.aabb = PrxAabb::merge(B.aabb, G.aabb);
+				C.aabb = PrxAabb::merge(A.aabb, F.aabb);
+				A.height = 1 + std::max(B.height, G.height);
+				C.height = 1 + std::max(A.height, F.height);
+			}
+			else {
+				C.child2 = iG;
+				A.child2 = iF;
+				F.parent = iA;
+				A.aabb = PrxAabb::merge(B.aabb, F.aabb);
+				C.aabb = PrxAabb::merge(A.aabb, G.aabb);
+				A.height = 1 + std::max(B.height, F.height);
+				C.height = 1 + std::max(A.height, G.height);
+			}
+			return iC;
+		}
+
+		// rotate B up, mirrored
+		if (balanceFactor < -1) {
+			const int32_t iD = B.child1;
+			const int32_t iE = B.child2;
+			Node& D = nodes[iD];
+			Node& E = nodes[iE];
+
+			B.child1 = iA;
+			replaceInParent(iB);
+
+			if (D.height > E.height) {
+				B.child2 = iD;
+				A.child1 = iE;
+				E.parent = iA;
+				A.aabb = PrxAabb::merge(C.aabb, E.aabb);
+				B.aabb = PrxAabb::merge(A.aabb, D.aabb);
+				A.height = 1 + std::max(C.height, E.height);
+				B.height = 1 + std::max(A.height, D.height);
+			}
+			else {
+				B.child2 = iE;
+				A.child1 = iD;
+				D.parent = iA;
+				A.aabb = PrxAabb::merge(C.aabb, D.aabb);
+				B.aabb = PrxAabb::merge(A.aabb, E.aabb);
+				A.height = 1 + std::max(C.height, D.height);
+				B.height = 1 + std::max(A.height, E.height);
+			}
+			return iB;
+		}
+
+		return iA;
+	}
+
+	void PrxAabbTree::validate() const {
+		if (root != NULL_NODE) {
+			assert(nodes[root].parent == NULL_NODE && "Root has a parent");
+			validateStructure(root);
+		}
+
+		// every node is either in the tree or on the free list
+		int32_t freeCount = 0;
+		for (int32_t nodeId = freeList; nodeId != NULL_NODE; nodeId = nodes[nodeId].parent) {
+			assert(nodes[nodeId].height == -1 && "Free node is still in use");
+			freeCount++;
+		}
+		int32_t usedCount = proxyCount > 0 ? 2 * proxyCount - 1 : 0;
+		assert(usedCount + freeCount == static_cast<int32_t>(nodes.size()) && "Nodes leaked");
+		(void)usedCount;
+		(void)freeCount;
+	}
+
+	int32_t PrxAabbTree::validateStructure(int32_t nodeId) const {
+		const Node& node = nodes[nodeId];
+		if (node.isLeaf()) {
+			assert(node.child2 == NULL_NODE && node.height == 0 && "Malformed leaf");
+			return 0;
+		}
+
+		const Node& child1 = nodes[node.child1];
+		const Node& child2 = nodes[node.child2];
+		assert(child1.parent == nodeId && child2.parent == nodeId && "Child doesn't point back to its parent");
+		assert(node.aabb.contains(child1.aabb) && node.aabb.contains(child2.aabb) && "Box doesn't cover its children");
+
+		int32_t height = 1 + std::max(validateStructure(node.child1), validateStructure(node.child2));
+		assert(height == node.height && "Stored height is wrong");
+		return height;
+	}
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include "PrxAabb.hpp"
+#include "PrxFrustum.hpp"
+
+// std
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace prx {
+
+	// Dynamic AABB tree (in the style of Box2D's b2DynamicTree), for scenes where objects come, go
+	//	and move every frame. Every leaf is a proxy holding a "fat" box: the object's box grown by a
+	//	margin, so small movements don't touch the tree at all. Leaves are inserted next to the
+	//	sibling that grows the tree's surface area the least, and the tree is kept balanced with
+	//	AVL style rotations on the way back up.
+	//
+	// Queries walk the tree with an explicit stack and hand every hit's user data to a callback.
+	//	Note: queries reuse one stack, so don't query the same tree from several threads at once
+	class PrxAabbTree
+	{
+	public:
+		static constexpr int32_t NULL_NODE = -1;
+		static constexpr float DEFAULT_MARGIN = .1f;
+
+		explicit PrxAabbTree(float margin = DEFAULT_MARGIN) : margin{ margin } {}
+
+		// returns the proxy id, which stays the same until the proxy is destroyed
+		int32_t createProxy(const PrxAabb& aabb, uint32_t userData);
+		void destroyProxy(int32_t proxyId);
+		// Returns true if the proxy had to be reinserted, i.e. the box left its fat box
+		bool moveProxy(int32_t proxyId, const PrxAabb& aabb);
+
+		uint32_t getUserData(int32_t proxyId) const { return nodes[proxyId].userData; }
+		const PrxAabb& getFatAabb(int32_t proxyId) const { return nodes[proxyId].aabb; }
+
+		int32_t getProxyCount() const { return proxyCount; }
+		// 0 for a single leaf, -1 when empty
+		int32_t getHeight() const { return root == NULL_NODE ? -1 : nodes[root].height; }
+		// checks parents, heights and boxes of the whole tree (asserts)
+		void validate() const;
+
+		// callback(uint32_t userData) -> bool, return false to stop the query
+		template<typename Callback>
+		void queryOverlap(const PrxAabb& aabb, Callback&& callback) const;
+		template<typename Callback>
+		void querySphere(const glm::vec3& center, float radius, Callback&& callback) const;
+		// Subtrees entirely inside the frustum are reported without testing their boxes
+		template<typename Callback>
+		void queryFrustum(const PrxFrustum& frustum, Callback&& callback) const;
+		// callback(uint32_t userData, float maxDistance) -> float, the new max distance.
+		//	Return the hit distance to clip the ray, maxDistance to keep going, or 0 to stop.
+		//	Boxes are visited in tree order, not nearest first
+		template<typename Callback>
+		void queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Callback&& callback) const;
+
+	private:
+		struct Node {
+			PrxAabb aabb;
+			int32_t parent = NULL_NODE; // next free node while on the free list
+			int32_t child1 = NULL_NODE;
+			int32_t child2 = NULL_NODE;
+			int32_t height = 0; // leaves are 0, free nodes -1
+			uint32_t userData = 0;
+
+			bool isLeaf() const { return child1 == NULL_NODE; }
+		};
+
+		int32_t allocateNode();
+		void freeNode(int32_t nodeId);
+
+		void insertLeaf(int32_t leaf);
+		void removeLeaf(int32_t leaf);
+		// rotates the subtree at nodeId if its children differ in height by more than one,
+		//	returns the subtree's new root
+		int32_t balance(int32_t nodeId);
+		// refits boxes and heights from nodeId up to the root, balancing as it goes
+		void refitUpwards(int32_t nodeId);
+
+		int32_t validateStructure(int32_t nodeId) const;
+
+		std::vector<Node> nodes;
+		int32_t root = NULL_NODE;
+		int32_t freeList = NULL_NODE;
+		int32_t proxyCount = 0;
+		float margin;
+
+		mutable std::vector<int32_t> queryStack;
+	};
+
+	template<typename Callback>
+	void PrxAabbTree::queryOverlap(const PrxAabb& aabb, Callback&& callback) const {
+		if (root == NULL_NODE) return;
+		queryStack.clear();
+		queryStack.push_back(root);
+		while (!queryStack.empty()) {
+			const Node& node = nodes[queryStack.back()];
+			queryStack.pop_back();
+			if (!node.aabb.overlaps(aabb)) continue;
+
+			if (node.isLeaf()) {
+				if (!callback(node.userData)) return;
+			}
+			else {
+				queryStack.push_back(node.child1);
+				queryStack.push_back(node.child2);
+			}
+		}
+	}
+
+	template<typename Callback>
+	void PrxAabbTree::querySphere(const glm::vec3& center, float radius, Callback&& callback) const {
+		if (root == NULL_NODE) return;
+		queryStack.clear();
+		queryStack.push_back(root);
+		while (!queryStack.empty()) {
+			const Node& node = nodes[queryStack.back()];
+			queryStack.pop_back();
+			if (!node.aabb.overlapsSphere(center, radius)) continue;
+
+			if (node.isLeaf()) {
+				if (!callback(node.userData)) return;
+			}
+			else {
+				queryStack.push_back(node.child1);
+				queryStack.push_back(node.child2);
+			}
+		}
+	}
+
+	template<typename Callback>
+	void PrxAabbTree::queryFrustum(const PrxFrustum& frustum, Callback&& callback) const {
+		if (root == NULL_NODE) return;
+		queryStack.clear();
+		// the sign bit marks subtrees already known to be inside, so they skip the plane tests
+		queryStack.push_back(root);
+		while (!queryStack.empty()) {
+			int32_t entry = queryStack.back();
+			queryStack.pop_back();
+			bool inside = entry < 0;
+			const Node& node = nodes[inside ? ~entry : entry];
+
+			if (!inside) {
+				auto containment = frustum.classifyAabb(node.aabb.min, node.aabb.max);
+				if (containment == PrxFrustum::CONTAINMENT_OUTSIDE) continue;
+				inside = containment == PrxFrustum::CONTAINMENT_INSIDE;
+			}
+
+			if (node.isLeaf()) {
+				if (!callback(node.userData)) return;
+			}
+			else {
+				queryStack.push_back(inside ? ~node.child1 : node.child1);
+				queryStack.push_back(inside ? ~node.child2 : node.child2);
+			}
+		}
+	}
+
+	template<typename Callback>
+	void PrxAabbTree::queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Callback&& callback) const {
+		if (root == NULL_NODE) return;
+		const glm::vec3 invDirection = 1.f / direction;
+		queryStack.clear();
+		queryStack.push_back(root);
+		while (!queryStack.empty()) {
+			const Node& node = nodes[queryStack.back()];
+			queryStack.pop_back();
+			float tEnter;
+			if (!node.aabb.intersectsRay(origin, invDirection, maxDistance, tEnter)) continue;
+
+			if (node.isLeaf()) {
+				maxDistance = callback(node.userData, maxDistance);
+				if (maxDistance <= 0.f) return;
+			}
+			else {
+				queryStack.push_back(node.child1);
+				queryStack.push_back(node.child2);
+			}
+		}
+	}
+}
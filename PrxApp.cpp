@@ -2,11 +2,15 @@
 #include "KeyboardMovementController.hpp"
 #include "PrxCamera.hpp"
 #include "PrxBuffer.hpp"
+#include "PrxPathTracer.hpp"
 
 #include "systems/SimpleRenderSystem.hpp"
+#include "systems/GpuDrivenRenderSystem.hpp"
+#include "systems/CullingSystem.hpp"
 #include "systems/PointLightSystem.hpp"
 
 #include "PrxTexture.hpp"
+#include "PrxUploadContext.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS 
@@ -16,29 +20,33 @@
 
 // std
 #include <stdexcept>
+#include <algorithm>
 #include <array>
+#include <iomanip>
 #include <iostream>
 #include <chrono>
+#include <string>
+#include <thread>
 
 namespace prx {
 
 	PrxApp::PrxApp() {
+        // evicted textures can't keep their slot, it would be sampled after they're gone.
+        //  The cache only releases them once no frame in flight can still be sampling them
+        textureCache.setEvictionCallback([this](PrxTexture& texture) {
+            textureTable.unregisterTexture(texture);
+        });
+
         globalPool =
             PrxDescriptorPool::Builder(prxDevice)
             .setMaxSets(PrxSwapChain::MAX_FRAMES_IN_FLIGHT)
             .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, PrxSwapChain::MAX_FRAMES_IN_FLIGHT)
             .build();
 
-        // consider moving this to another file
-        framePools.resize(PrxSwapChain::MAX_FRAMES_IN_FLIGHT);
-        auto framePoolBuilder = PrxDescriptorPool::Builder(prxDevice)
-            .setMaxSets(1000)
-            .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000)
-            .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1000)
-            .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
-
-        for (int i = 0; i < framePools.size(); i++) {
-            framePools[i] = framePoolBuilder.build();
+        // one growable allocator per frame in flight, recycled when that frame comes around again
+        frameAllocators.resize(PrxSwapChain::MAX_FRAMES_IN_FLIGHT);
+        for (int i = 0; i < frameAllocators.size(); i++) {
+            frameAllocators[i] = std::make_unique<PrxDescriptorAllocator>(prxDevice);
         }
 
 		loadGameObjects();
@@ -61,14 +69,14 @@ namespace prx {
             uboBuffers[i]->map();
         }
         
-        auto globalSetLayout = PrxDescriptorSetLayout::Builder(prxDevice)
+        auto& globalSetLayout = PrxDescriptorSetLayout::Builder(prxDevice)
             .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
-            .build();
+            .build(descriptorLayoutCache);
 
         std::vector<VkDescriptorSet> globalDescriptorSets(PrxSwapChain::MAX_FRAMES_IN_FLIGHT);
         for (int i = 0; i < globalDescriptorSets.size(); i++) {
             auto bufferInfo = uboBuffers[i]->descriptorInfo();
-            PrxDescriptorWriter(*globalSetLayout, *globalPool)
+            PrxDescriptorWriter(globalSetLayout, *globalPool)
                 .writeBuffer(0, &bufferInfo)
                 .build(globalDescriptorSets[i]);
         }
@@ -78,17 +86,31 @@ namespace prx {
 
 		SimpleRenderSystem simpleRenderSystem{ prxDevice, 
             prxRenderer.getSwapChainRenderPass(), 
-            globalSetLayout->getDescriptorSetLayout()};
+            globalSetLayout.getDescriptorSetLayout(),
+            descriptorLayoutCache,
+            textureTable};
+        
+        std::unique_ptr<GpuDrivenRenderSystem> gpuDrivenRenderSystem;
+        if (USE_GPU_DRIVEN_RENDERING && prxDevice.supportsGpuDrivenRendering) {
+            gpuDrivenRenderSystem = std::make_unique<GpuDrivenRenderSystem>(prxDevice,
+                prxRenderer.getSwapChainRenderPass(),
+                globalSetLayout.getDescriptorSetLayout(),
+                descriptorLayoutCache,
+                textureTable);
+        }
         
         PointLightSystem pointLightSystem{ prxDevice,
             prxRenderer.getSwapChainRenderPass(),
-            globalSetLayout->getDescriptorSetLayout()};
+            globalSetLayout.getDescriptorSetLayout()};
+
+        CullingSystem cullingSystem{};
+        // cull and descriptor stats go into the window title, refreshed about once a second
+        float statsTimer = 0.f;
 
         PrxCamera camera{};
         camera.setViewTarget(glm::vec3(-1.f, -2.f, 2.f), glm::vec3(0.f, 0.f, 2.5f));
 
-        auto& viewerObject = gameObjectManager.createGameObject();
-        viewerObject.transform.translation.z = -2.5f;
+        auto viewerObject = createViewerObject();
         KeyboardMovementController cameraController{};
         glfwGetCursorPos(prxWindow.getGLFWwindow(), &cameraController.mouse.xPos, &cameraController.mouse.yPos);
 
@@ -97,6 +119,9 @@ namespace prx {
 			glfwPollEvents(); // Note: while resizing the window, this does not draw on Windows or Linux likely due to blocking on glfwPollEvents()
 							  //	Come up with a solution to draw while resizing
 
+            // gives game objects whatever assets finished loading
+            assetLoader.update();
+
             // handle timing
             auto newTime = std::chrono::high_resolution_clock::now();
             float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
@@ -106,10 +131,7 @@ namespace prx {
             //  Note: arrow keys currently allow for rotation!
             cameraController.moveInPlaneXZ(prxWindow.getGLFWwindow(), frameTime, viewerObject);
             cameraController.toggleMouseCursor(prxWindow.getGLFWwindow());
-            camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
-
-            float aspect = prxRenderer.getAspectRatio();
-            camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 1000.f);
+            updateCamera(camera, viewerObject, prxRenderer.getAspectRatio());
 
             // handle camera rotation
             auto newMouseX = 0.;
@@ -125,14 +147,14 @@ namespace prx {
             
 			if (auto commandBuffer = prxRenderer.beginFrame()) {
                 int frameIndex = prxRenderer.getFrameIndex();
-                framePools[frameIndex]->resetPool();
+                frameAllocators[frameIndex]->reset();
                 FrameInfo frameInfo{ frameIndex,
                     frameTime,
                     commandBuffer,
                     camera,
                     globalDescriptorSets[frameIndex],
-                    *framePools[frameIndex],
-                    gameObjectManager.gameObjects};
+                    *frameAllocators[frameIndex],
+                    gameObjectManager};
                 
                 // update objects
                 GlobalUbo ubo{};
@@ -149,15 +171,54 @@ namespace prx {
                 //  and updates take place BEFORE each draw call.
                 gameObjectManager.updateBuffer(frameIndex);
 
+                // anything streamed in during this frame goes out ahead of the frame's own submission.
+                //  Also recycles staging ring space from uploads that have finished (no-op otherwise)
+                prxDevice.getUploadContext().submit();
+
+                // the GPU builds its draw list before the render pass starts,
+                //  otherwise only what the CPU finds on screen gets drawn
+                if (gpuDrivenRenderSystem) {
+                    gpuDrivenRenderSystem->cull(frameInfo);
+                }
+                else {
+                    cullingSystem.cull(frameInfo);
+                }
+
+                statsTimer += frameTime;
+                if (statsTimer >= 1.f) {
+                    statsTimer = 0.f;
+                    std::string title = "Hello, Vulkan!";
+                    if (!gpuDrivenRenderSystem) {
+                        const auto& stats = cullingSystem.getStats();
+                        title += " | visible " + std::to_string(stats.visible) + " / " + std::to_string(stats.tested);
+                    }
+                    // sets this frame slot used last time around, and the most it ever needed
+                    const auto& descriptorStats = frameAllocators[frameIndex]->getStats();
+                    title += " | descriptor sets " + std::to_string(descriptorStats.lastFrameSets)
+                        + " (peak " + std::to_string(descriptorStats.highWaterSets)
+                        + ", " + std::to_string(descriptorStats.poolCount) + " pools, "
+                        + std::to_string(descriptorStats.setsPerPool) + " sets per new pool)";
+                    glfwSetWindowTitle(prxWindow.getGLFWwindow(), title.c_str());
+                }
+
                 // render
 				prxRenderer.beginSwapChainRenderPass(commandBuffer);
 
                 // order matters! Render solids first, then semi-transparents
-				simpleRenderSystem.renderGameObjects(frameInfo);
+                if (gpuDrivenRenderSystem) {
+                    gpuDrivenRenderSystem->render(frameInfo);
+                }
+                else {
+                    simpleRenderSystem.renderGameObjects(frameInfo, cullingSystem.getVisibleObjects());
+                }
                 pointLightSystem.render(frameInfo);
 				
                 prxRenderer.endSwapChainRenderPass(commandBuffer);
 				prxRenderer.endFrame();
+
+                // textures nothing uses anymore are evicted over the budget, and released a few frames later
+                textureCache.trim();
+                textureCache.nextFrame();
 			}
 		}
 
@@ -166,37 +227,110 @@ namespace prx {
         
 	}
 
-	// load models used in the program
-	void PrxApp::loadGameObjects() {
-        std::shared_ptr<PrxTexture> marbleTexture =
-            PrxTexture::makeTextureFromFile(prxDevice, "textures/missing.png");
-        std::shared_ptr<PrxTexture> libertyTexture =
-            PrxTexture::makeTextureFromFile(prxDevice, "textures/texture.jpg");
+    void PrxApp::renderReference(const std::string& outputPath, uint32_t samplesPerPixel) {
+        PrxPathTracer::Settings settings{};
+        settings.width = WIDTH;
+        settings.height = HEIGHT;
+        PrxCamera camera{};
+        auto viewerObject = createViewerObject();
+        updateCamera(camera, viewerObject, static_cast<float>(WIDTH) / HEIGHT);
+
+        // the tracer's TLAS reads the transforms from the object buffer's CPU copy
+        gameObjectManager.updateBuffer(0);
+
+        std::cout << "Path tracing " << settings.width << "x" << settings.height << ", "
+            << samplesPerPixel << " samples per pixel" << std::endl;
+
+        // throughput per thread count, on the first pass of a fresh image each time
+        const uint32_t coreCount = std::max(1u, std::thread::hardware_concurrency());
+        for (uint32_t threadCount = 1; ; threadCount = std::min(threadCount * 2, coreCount)) {
+            settings.threadCount = threadCount;
+            PrxPathTracer tracer{ settings };
+            tracer.setScene(gameObjectManager);
+            tracer.setCamera(camera);
+            tracer.renderPass();
+            std::cout << "  " << std::setw(3) << threadCount << " threads: " << std::fixed << std::setprecision(3)
+                << tracer.getStats().samplesPerSecond * 1e-6 << " Msamples/s" << std::endl;
+            if (threadCount == coreCount) break;
+        }
 
-       std::shared_ptr<PrxModel> flatVaseModel = PrxModel::createModelFromFile(prxDevice, "models/flat_vase.obj");
+        settings.threadCount = 0;
+        PrxPathTracer tracer{ settings };
+        tracer.setScene(gameObjectManager);
+        tracer.setCamera(camera);
+        auto startTime = std::chrono::high_resolution_clock::now();
+        tracer.render(samplesPerPixel);
+        auto endTime = std::chrono::high_resolution_clock::now();
+        tracer.writeImage(outputPath);
+        std::cout << "  wrote " << outputPath << " (" << std::fixed << std::setprecision(2)
+            << std::chrono::duration<double>(endTime - startTime).count() << " s)" << std::endl;
+
+        vkDeviceWaitIdle(prxDevice.device());
+    }
 
-        auto& flatVase = gameObjectManager.createGameObject();
-        flatVase.model = flatVaseModel;
-        flatVase.transform.translation = { .5f, .5f, 0.f };
-        flatVase.transform.scale = { 3.f, 1.5f, 3.f };
-        flatVase.diffuseMap = libertyTexture;
+    PrxGameObject PrxApp::createViewerObject() {
+        auto viewerObject = gameObjectManager.createGameObject();
+        viewerObject.transform().translation.z = -2.5f;
+        return viewerObject;
+    }
 
-        std::shared_ptr<PrxModel> smoothVaseModel = PrxModel::createModelFromFile(prxDevice, "models/smooth_vase.obj");
+    void PrxApp::attachMaterials(PrxGameObject gameObject, const PrxAssetHandle<PrxModel>& model) {
+        // Note: a copy per game object, so one object's materials can change without the others'
+        assetLoader.whenResident<PrxModel>(model, [this, gameObject](const std::shared_ptr<PrxModel>& loadedModel) mutable {
+            if (!gameObject.isValid()) return;
+            MaterialComponent component{};
+            for (const PrxModel::MtlData& material : loadedModel->getMaterials()) {
+                component.materials.push_back(std::make_shared<PrxMaterial>(prxDevice, material.name,
+                    material.diffuse, material.specular, material.ambient, material.emission,
+                    material.transmittance, material.ior, material.shininess, material.opacity));
+            }
+            gameObject.addComponent<MaterialComponent>(std::move(component));
+        });
+    }
 
-        auto& smoothVase = gameObjectManager.createGameObject();
-        smoothVase.model = smoothVaseModel;
-        smoothVase.transform.translation = { -.5f, .5f, 0.f };
-        smoothVase.transform.scale = { 3.f, 1.5f, 3.f };
-        smoothVase.diffuseMap = libertyTexture;
+    void PrxApp::updateCamera(PrxCamera& camera, const PrxGameObject& viewerObject, float aspect) {
+        camera.setViewYXZ(viewerObject.getTransform().translation, viewerObject.getTransform().rotation);
+        camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 1000.f);
+    }
 
-        //std::shared_ptr<PrxModel> quad = PrxModel::createModelFromFile(prxDevice, "models/quad.obj");
-        std::shared_ptr<PrxModel> quad = PrxModel::createModelFromFile(prxDevice, "models/quad.obj");
-        
-        auto& floor = gameObjectManager.createGameObject();
-        floor.model = quad;
-        floor.transform.translation = { 0.f, .5f, 0.f }; // move the floor down a tad
-        floor.transform.scale = { 3.f, 1.f, 3.f }; // scale by 3x, 1y, 3z
-        floor.diffuseMap = marbleTexture;
+	// load models used in the program
+	void PrxApp::loadGameObjects() {
+        // every file starts loading on the worker threads right away, the game objects below only
+        //  hold handles and get their components once the assets are on the GPU
+        auto startTime = std::chrono::high_resolution_clock::now();
+        PrxAssetHandle<PrxTexture> marbleTexture = assetLoader.loadTexture("textures/missing.png");
+        PrxAssetHandle<PrxTexture> libertyTexture = assetLoader.loadTexture("textures/texture.jpg");
+        PrxAssetHandle<PrxModel> flatVaseModel = assetLoader.loadModel("models/flat_vase.obj");
+        PrxAssetHandle<PrxModel> smoothVaseModel = assetLoader.loadModel("models/smooth_vase.obj");
+        PrxAssetHandle<PrxModel> quad = assetLoader.loadModel("models/quad.obj");
+
+        // textures have to be in the table before anything draws with them
+        for (const auto& texture : { marbleTexture, libertyTexture }) {
+            assetLoader.whenResident<PrxTexture>(texture, [this](const std::shared_ptr<PrxTexture>& loadedTexture) {
+                textureTable.registerTexture(*loadedTexture);
+            });
+        }
+
+        auto flatVase = gameObjectManager.createGameObject();
+        assetLoader.attach<ModelComponent>(flatVase, flatVaseModel);
+        attachMaterials(flatVase, flatVaseModel);
+        flatVase.transform().translation = { .5f, .5f, 0.f };
+        flatVase.transform().scale = { 3.f, 1.5f, 3.f };
+        assetLoader.attach<DiffuseMapComponent>(flatVase, libertyTexture);
+
+        auto smoothVase = gameObjectManager.createGameObject();
+        assetLoader.attach<ModelComponent>(smoothVase, smoothVaseModel);
+        attachMaterials(smoothVase, smoothVaseModel);
+        smoothVase.transform().translation = { -.5f, .5f, 0.f };
+        smoothVase.transform().scale = { 3.f, 1.5f, 3.f };
+        assetLoader.attach<DiffuseMapComponent>(smoothVase, libertyTexture);
+
+        auto floor = gameObjectManager.createGameObject();
+        assetLoader.attach<ModelComponent>(floor, quad);
+        attachMaterials(floor, quad);
+        floor.transform().translation = { 0.f, .5f, 0.f }; // move the floor down a tad
+        floor.transform().scale = { 3.f, 1.f, 3.f }; // scale by 3x, 1y, 3z
+        assetLoader.attach<DiffuseMapComponent>(floor, marbleTexture);
         
         std::vector<glm::vec3> lightColors{
             {1.f, .1f, .1f},
@@ -208,25 +342,43 @@ namespace prx {
         };
 
         for (int i = 0; i < lightColors.size(); i++) {
-            auto& pointLight = gameObjectManager.makePointLight(0.2f);
-            pointLight.color = lightColors[i];
+            auto pointLight = gameObjectManager.makePointLight(0.2f, 1.f, lightColors[i]);
 
             // divide circle into equal size slices, then rotate each point light around the circumference
             //  Effectively makes a "ring" of lights
             auto rotateLight = glm::rotate(glm::mat4(1.f),
                 (i * glm::two_pi<float>()) / lightColors.size(),
                 {0.f, -1.f, 0.f});
-            pointLight.transform.translation = glm::vec3(rotateLight * glm::vec4(-1.f, -1.f, -1.f, 1.f));
+            pointLight.transform().translation = glm::vec3(rotateLight * glm::vec4(-1.f, -1.f, -1.f, 1.f));
             
         }
+
+        // Note: the scene is small enough to wait for, bigger ones can skip this and let update()
+        //  fill the game objects in over the first frames
+        assetLoader.finish();
+        // whatever the load left unused over the budget
+        textureCache.trim();
+        auto endTime = std::chrono::high_resolution_clock::now();
+        std::cout << "Loaded assets in " << std::chrono::duration<double, std::milli>(endTime - startTime).count()
+            << " ms" << std::endl;
+
+        const PrxTextureCache::Stats& textureStats = textureCache.getStats();
+        std::cout << "Texture cache: " << textureStats.entryCount << " textures ("
+            << textureStats.residentBytes / (1024 * 1024) << " MB), "
+            << textureStats.pathHits + textureStats.contentHits << " hits, "
+            << textureStats.misses << " misses" << std::endl;
+
+        const PrxGeometryArena::Stats geometryStats = prxDevice.getGeometryArena().getStats();
+        std::cout << "Geometry arena: " << geometryStats.vertexCount << " vertices at " << geometryStats.vertexSize << " B ("
+            << uint64_t{ geometryStats.vertexCount } * geometryStats.vertexSize / 1024 << " KB, "
+            << uint64_t{ geometryStats.vertexCount } * PrxVertexLayout::full().getVertexSize() / 1024 << " KB unquantized), "
+            << geometryStats.indexCount << " indices (" << geometryStats.shortIndexCount << " of them 16 bit, "
+            << geometryStats.indexBytes / 1024 << " KB)" << std::endl;
 	}
 
     // don't use this yet, its untested and not done
     void PrxApp::unloadGameObjects() {
-        /*std::unordered_map<unsigned int, PrxGameObject>::iterator it;
-
-        for (auto const& obj : gameObjects) {
-            obj.second.~PrxGameObject();
-        }*/
+        // Note: destroyGameObject() now handles removing a single object; unloading everything
+        //  still needs the GPU to be idle first since models and textures are freed with them
     }
 }
\ No newline at end of file
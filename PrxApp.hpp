@@ -1,14 +1,20 @@
 #pragma once
 
 // prx
+#include "PrxCamera.hpp"
 #include "PrxGameObject.hpp"
 #include "PrxWindow.hpp"
 #include "PrxDevice.hpp"
 #include "PrxRenderer.hpp"
 #include "PrxDescriptors.hpp"
+#include "PrxBindlessTextureTable.hpp"
+#include "PrxTextureCache.hpp"
+#include "PrxAssetLoader.hpp"
 
 // std
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace prx {
@@ -18,6 +24,9 @@ namespace prx {
 	public:
 		static constexpr int WIDTH = 800;
 		static constexpr int HEIGHT = 600;
+		// cull and build the draw list on the GPU (GpuDrivenRenderSystem) when the device supports it,
+		//	instead of SimpleRenderSystem's CPU draw loop
+		static constexpr bool USE_GPU_DRIVEN_RENDERING = false;
 
 		PrxApp();
 		~PrxApp();
@@ -27,25 +36,44 @@ namespace prx {
 		void operator=(const PrxApp&) = delete;
 
 		void run();
+		// Renders the scene run() starts with (same game objects, point lights and starting camera)
+		//	with PrxPathTracer instead of drawing frames, and writes it to outputPath (.png or .exr).
+		//	The first pass is timed with 1, 2, 4... threads up to one per core, printing samples/s for each.
+		//	Note: the window and device still come up, the models live in the geometry arena
+		void renderReference(const std::string& outputPath, uint32_t samplesPerPixel);
 
 		//std::vector<std::unique_ptr<PrxBuffer>>& getUboBuffers() { return uboBuffers; }
 
 	private:
 		void loadGameObjects();
 		void unloadGameObjects();
+		// the camera's game object, where run() starts it
+		PrxGameObject createViewerObject();
+		// fills a MaterialComponent from the model's own materials once it is resident
+		void attachMaterials(PrxGameObject gameObject, const PrxAssetHandle<PrxModel>& model);
+		static void updateCamera(PrxCamera& camera, const PrxGameObject& viewerObject, float aspect);
 
 		PrxWindow prxWindow{ WIDTH, HEIGHT, "Hello, Vulkan!" };
 		PrxDevice prxDevice{ prxWindow };
 		PrxRenderer prxRenderer{ prxWindow, prxDevice };
 
+		// layouts are shared by every system that asks for the same bindings
+		PrxDescriptorLayoutCache descriptorLayoutCache{ prxDevice };
+		// every texture a system samples is registered here once and then selected by index
+		PrxBindlessTextureTable textureTable{ prxDevice };
+		// every texture loaded from a file, each image is only decoded and uploaded once
+		PrxTextureCache textureCache{ prxDevice };
+
 		// Any descriptors that should be shared by multiple systems can use this pool
 		// Notes: Order of Declaration matters
 		//		  If a given system's lifespan is temporary and using this pool, be sure to 
 		//			free the respective descriptors in the given system's destructor.
 		std::unique_ptr<PrxDescriptorPool> globalPool;
 		std::vector<std::unique_ptr<PrxBuffer>> uboBuffers;
-		std::vector<std::unique_ptr<PrxDescriptorPool>> framePools;
+		std::vector<std::unique_ptr<PrxDescriptorAllocator>> frameAllocators;
 		PrxGameObjectManager gameObjectManager{ prxDevice };
+		// models and textures load on worker threads, and turn up in game objects once resident
+		PrxAssetLoader assetLoader{ prxDevice, textureCache };
 
 	};
 }
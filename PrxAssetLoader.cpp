@@ -0,0 +1,266 @@
+#include "PrxAssetLoader.hpp"
+#include "PrxParallel.hpp"
+
+// std
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+namespace prx {
+
+	namespace {
+		// hands the asset to the handle's state and runs whatever was waiting on it
+		template<typename State, typename T>
+		void publishAsset(State& state, std::shared_ptr<T> asset) {
+			state.asset = std::move(asset);
+			// moved out first, a callback may add more callbacks (or loads)
+			auto callbacks = std::move(state.onResident);
+			state.onResident.clear();
+			for (auto& callback : callbacks) {
+				callback(state.asset);
+			}
+		}
+	}
+
+	PrxAssetLoader::PrxAssetLoader(PrxDevice& device, PrxTextureCache& textureCache, uint32_t workerCount)
+		: prxDevice{ device }, textureCache{ textureCache } {
+		if (workerCount == 0) {
+			// the main thread is busy with the uploads (and everything else), leave it its core
+			uint32_t coreCount = std::thread::hardware_concurrency();
+			workerCount = std::max(coreCount, 2u) - 1;
+		}
+
+		workers.reserve(workerCount);
+		for (uint32_t i = 0; i < workerCount; i++) {
+			workers.emplace_back([this]() { workerLoop(); });
+		}
+	}
+
+	PrxAssetLoader::~PrxAssetLoader() {
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			stopping = true;
+		}
+		jobAvailable.notify_all();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+
+		// assets that are still uploading get destroyed with their jobs, the copies into them have to land first
+		if (!uploading.empty()) {
+			prxDevice.getUploadContext().wait(uploading.back()->ticket);
+		}
+	}
+
+	PrxAssetHandle<PrxModel> PrxAssetLoader::loadModel(const std::string& filepath) {
+		auto& state = models[filepath];
+		if (state == nullptr) {
+			state = std::make_shared<PrxAssetHandle<PrxModel>::State>();
+			state->filepath = filepath;
+
+			auto job = std::make_unique<Job>();
+			job->filepath = filepath;
+			job->modelState = state;
+			enqueue(std::move(job));
+		}
+		return PrxAssetHandle<PrxModel>{ state };
+	}
+
+	PrxAssetHandle<PrxTexture> PrxAssetLoader::loadTexture(const std::string& filepath) {
+		auto it = textures.find(filepath);
+		if (it != textures.end()) {
+			return PrxAssetHandle<PrxTexture>{ it->second };
+		}
+
+		auto state = std::make_shared<PrxAssetHandle<PrxTexture>::State>();
+		state->filepath = filepath;
+		state->asset = textureCache.find(filepath);
+		if (state->asset == nullptr) {
+			textures[filepath] = state;
+
+			auto job = std::make_unique<Job>();
+			job->filepath = filepath;
+			job->textureState = state;
+			enqueue(std::move(job));
+		}
+		return PrxAssetHandle<PrxTexture>{ state };
+	}
+
+	void PrxAssetLoader::enqueue(std::unique_ptr<Job> job) {
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			queued.push_back(std::move(job));
+		}
+		jobAvailable.notify_one();
+	}
+
+	void PrxAssetLoader::workerLoop() {
+		// the pool already has a thread per core, so imports on it don't start threads of their own
+		PrxParallel::markWorkerThread();
+
+		for (;;) {
+			std::unique_ptr<Job> job;
+			{
+				std::unique_lock<std::mutex> lock{ mutex };
+				jobAvailable.wait(lock, [this]() { return stopping || !queued.empty(); });
+				if (stopping) return;
+
+				job = std::move(queued.front());
+				queued.pop_front();
+				runningCount++;
+			}
+
+			try {
+				load(*job);
+			}
+			catch (...) {
+				// rethrown on the main thread by update()
+				job->error = std::current_exception();
+			}
+
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				loaded.push_back(std::move(job));
+				runningCount--;
+			}
+			jobDone.notify_all();
+		}
+	}
+
+	void PrxAssetLoader::load(Job& job) {
+		if (job.modelState != nullptr) {
+			job.model = PrxModel::loadFromFile(prxDevice, job.filepath);
+		}
+		else {
+			job.image = PrxTexture::ImageData::loadFromFile(job.filepath);
+		}
+	}
+
+	void PrxAssetLoader::create(Job& job) {
+		// the data is dropped right after, the upload context already copied it into staging memory
+		if (job.modelState != nullptr) {
+			job.createdModel = std::make_shared<PrxModel>(prxDevice, job.model);
+			job.model = PrxModel::LoadedData{};
+
+			// Note: materials often point at files that didn't ship with the model, those just draw untextured
+			for (const std::string& textureFilePath : job.createdModel->getMaterialTextureFilePaths()) {
+				PrxAssetHandle<PrxTexture> texture{};
+				if (!textureFilePath.empty()) {
+					if (std::filesystem::exists(textureFilePath)) {
+						texture = loadTexture(textureFilePath);
+					}
+					else {
+						std::cout << "missing material texture: " << textureFilePath << std::endl;
+					}
+				}
+				job.materialTextures.push_back(texture);
+			}
+		}
+		else {
+			// no upload at all if the same image is already cached under another path
+			job.createdTexture = textureCache.insert(job.filepath, job.image);
+			job.image = PrxTexture::ImageData{};
+		}
+	}
+
+	bool PrxAssetLoader::isReady(Job& job) {
+		if (!prxDevice.getUploadContext().isComplete(job.ticket)) return false;
+		for (const auto& texture : job.materialTextures) {
+			if (texture.isValid() && !texture.isResident()) return false;
+		}
+		return true;
+	}
+
+	void PrxAssetLoader::publish(Job& job) {
+		if (job.modelState != nullptr) {
+			for (uint32_t i = 0; i < job.materialTextures.size(); i++) {
+				if (job.materialTextures[i].isValid()) {
+					job.createdModel->setMaterialTexture(i, job.materialTextures[i].get());
+				}
+			}
+			publishAsset(*job.modelState, std::move(job.createdModel));
+		}
+		else {
+			textures.erase(job.filepath);
+			publishAsset(*job.textureState, std::move(job.createdTexture));
+		}
+	}
+
+	void PrxAssetLoader::update() {
+		std::vector<std::unique_ptr<Job>> finished;
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			finished.swap(loaded);
+		}
+
+		// Note: a failed job doesn't hold up the others, they still get created and submitted and
+		//	the first error is rethrown at the end
+		std::exception_ptr error{};
+		size_t createdCount = 0;
+		for (auto& job : finished) {
+			if (!job->error) {
+				try {
+					create(*job);
+				}
+				catch (...) {
+					job->error = std::current_exception();
+				}
+			}
+			if (job->error) {
+				if (!error) {
+					error = job->error;
+				}
+				continue;
+			}
+			finished[createdCount++] = std::move(job);
+		}
+		finished.resize(createdCount);
+
+		PrxUploadContext& uploadContext = prxDevice.getUploadContext();
+		if (!finished.empty()) {
+			// every asset that finished loading since the last update goes out in one submission
+			const PrxUploadContext::Ticket ticket = uploadContext.submit();
+			for (auto& job : finished) {
+				job->ticket = ticket;
+				uploading.push_back(std::move(job));
+			}
+		}
+
+		// Note: publishing can run callbacks that start more loads, but those only touch the queue
+		size_t pendingCount = 0;
+		for (size_t i = 0; i < uploading.size(); i++) {
+			if (isReady(*uploading[i])) {
+				publish(*uploading[i]);
+			}
+			else {
+				uploading[pendingCount++] = std::move(uploading[i]);
+			}
+		}
+		uploading.resize(pendingCount);
+
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	void PrxAssetLoader::finish() {
+		// loads can start more loads (a model's textures, or callbacks), so go until nothing is left
+		while (!isIdle()) {
+			{
+				std::unique_lock<std::mutex> lock{ mutex };
+				jobDone.wait(lock, [this]() { return queued.empty() && runningCount == 0; });
+			}
+			update();
+
+			if (!uploading.empty()) {
+				prxDevice.getUploadContext().wait(uploading.back()->ticket);
+				update();
+			}
+		}
+	}
+
+	bool PrxAssetLoader::isIdle() const {
+		std::lock_guard<std::mutex> lock{ mutex };
+		return queued.empty() && runningCount == 0 && loaded.empty() && uploading.empty();
+	}
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "PrxDevice.hpp"
+#include "PrxGameObject.hpp"
+#include "PrxModel.hpp"
+#include "PrxTexture.hpp"
+#include "PrxTextureCache.hpp"
+#include "PrxUploadContext.hpp"
+
+// std
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace prx {
+
+	// Shared handle to an asset that may still be loading. Cheap to copy, every copy sees the asset
+	//	once it is resident (uploaded, and the upload has landed on the GPU).
+	//	Note: only read it on the main thread, that is where PrxAssetLoader publishes assets
+	template<typename T>
+	class PrxAssetHandle
+	{
+	public:
+		PrxAssetHandle() = default;
+
+		bool isValid() const { return state != nullptr; }
+		bool isResident() const { return state != nullptr && state->asset != nullptr; }
+		// null until resident
+		const std::shared_ptr<T>& get() const { return state->asset; }
+		const std::string& getFilepath() const { return state->filepath; }
+
+	private:
+		struct State {
+			std::string filepath;
+			std::shared_ptr<T> asset{};
+			std::vector<std::function<void(const std::shared_ptr<T>&)>> onResident;
+		};
+
+		explicit PrxAssetHandle(std::shared_ptr<State> state) : state{ std::move(state) } {}
+
+		std::shared_ptr<State> state;
+
+		friend class PrxAssetLoader;
+	};
+
+	// Loads models and textures on a pool of worker threads: file I/O, decoding (Assimp, tinyobj,
+	//	stb_image) and vertex processing (bounds, BLAS, mesh cache) all happen off the main thread.
+	//	Everything Vulkan, creating the buffers and images and recording their uploads, stays on
+	//	the thread that calls update()/finish(), which batches every load that finished since the
+	//	last call into one upload submission.
+	//
+	// Loads hand back handles right away, so game objects can be set up before their assets are
+	//	resident: attach() adds the component once the asset is there.
+	//	Loading the same file twice returns the same handle (the same texture, for textures, which
+	//	go through a PrxTextureCache).
+	class PrxAssetLoader
+	{
+	public:
+		// 0 for one worker per core, minus the main thread
+		PrxAssetLoader(PrxDevice& device, PrxTextureCache& textureCache, uint32_t workerCount = 0);
+		~PrxAssetLoader();
+
+		// do not allow for copying
+		PrxAssetLoader(const PrxAssetLoader&) = delete;
+		PrxAssetLoader& operator=(const PrxAssetLoader&) = delete;
+
+		// through PrxModel::loadFromFile, so the mesh cache is used (or written) as usual.
+		//	The model's material textures are loaded too, it is resident once they are
+		PrxAssetHandle<PrxModel> loadModel(const std::string& filepath);
+		// resident right away if the texture cache already has it
+		PrxAssetHandle<PrxTexture> loadTexture(const std::string& filepath);
+
+		// Runs on the main thread (in update()/finish()) once the asset is resident, or right away
+		//	if it already is
+		template<typename T>
+		void whenResident(const PrxAssetHandle<T>& handle, std::function<void(const std::shared_ptr<T>&)> callback);
+		// Adds Component{ asset } to the game object once the asset is resident, unless the game
+		//	object was destroyed in the meantime. e.g. attach<ModelComponent>(gameObject, model)
+		template<typename Component, typename T>
+		void attach(PrxGameObject gameObject, const PrxAssetHandle<T>& handle);
+
+		// Main thread, once a frame. Creates the GPU side of every load the workers finished, submits
+		//	their uploads together, and publishes the assets whose uploads have landed.
+		//	Rethrows the first error a load ran into, once everything else is submitted
+		void update();
+		// blocks until everything requested so far is resident
+		void finish();
+
+		bool isIdle() const;
+
+	private:
+		struct Job {
+			std::string filepath;
+			std::exception_ptr error{};
+
+			// worker side, whichever of the two states is set says what the job loads
+			PrxModel::LoadedData model{};
+			PrxTexture::ImageData image{};
+
+			std::shared_ptr<PrxAssetHandle<PrxModel>::State> modelState;
+			std::shared_ptr<PrxAssetHandle<PrxTexture>::State> textureState;
+
+			// created on the main thread, published once ticket has landed
+			std::shared_ptr<PrxModel> createdModel;
+			std::shared_ptr<PrxTexture> createdTexture;
+			PrxUploadContext::Ticket ticket = 0;
+			// per material of createdModel, empty handles for materials without a texture
+			std::vector<PrxAssetHandle<PrxTexture>> materialTextures;
+		};
+
+		void enqueue(std::unique_ptr<Job> job);
+		void workerLoop();
+		void load(Job& job);
+		// the GPU side of one loaded job
+		void create(Job& job);
+		bool isReady(Job& job);
+		void publish(Job& job);
+
+		PrxDevice& prxDevice;
+		PrxTextureCache& textureCache;
+
+		std::vector<std::thread> workers;
+		mutable std::mutex mutex;
+		std::condition_variable jobAvailable;
+		std::condition_variable jobDone;
+		std::deque<std::unique_ptr<Job>> queued; // waiting for a worker
+		std::vector<std::unique_ptr<Job>> loaded; // done on the worker, waiting for update()
+		uint32_t runningCount = 0;
+		bool stopping = false;
+
+		// main thread only from here
+		std::vector<std::unique_ptr<Job>> uploading; // created, waiting for the upload to land
+		std::unordered_map<std::string, std::shared_ptr<PrxAssetHandle<PrxModel>::State>> models;
+		// only while loading, the texture cache takes over once they are resident
+		std::unordered_map<std::string, std::shared_ptr<PrxAssetHandle<PrxTexture>::State>> textures;
+	};
+
+	template<typename T>
+	void PrxAssetLoader::whenResident(const PrxAssetHandle<T>& handle, std::function<void(const std::shared_ptr<T>&)> callback) {
+		assert(handle.isValid() && "Waiting on an empty asset handle");
+		if (handle.isResident()) {
+			callback(handle.get());
+			return;
+		}
+		handle.state->onResident.push_back(std::move(callback));
+	}
+
+	template<typename Component, typename T>
+	void PrxAssetLoader::attach(PrxGameObject gameObject, const PrxAssetHandle<T>& handle) {
+		whenResident<T>(handle, [gameObject](const std::shared_ptr<T>& asset) mutable {
+			if (gameObject.isValid()) {
+				gameObject.addComponent<Component>(asset);
+			}
+		});
+	}
+}
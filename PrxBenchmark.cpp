@@ -0,0 +1,400 @@
+#include "PrxBenchmark.hpp"
+#include "PrxAabbTree.hpp"
+#include "PrxBvh.hpp"
+#include "PrxCamera.hpp"
+#include "PrxFrustum.hpp"
+#include "PrxGameObject.hpp"
+#include "PrxRay.hpp"
+#include "PrxTlas.hpp"
+#include "PrxTransformBatch.hpp"
+
+// libs
+#include <glm/gtc/constants.hpp>
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace prx {
+
+	namespace {
+		constexpr int RUNS = 3; // best of
+
+		template<typename Func>
+		double bestMilliseconds(Func&& func) {
+			double best = 1e30;
+			for (int run = 0; run < RUNS; run++) {
+				auto startTime = std::chrono::high_resolution_clock::now();
+				func();
+				auto endTime = std::chrono::high_resolution_clock::now();
+				best = std::min(best, std::chrono::duration<double, std::milli>(endTime - startTime).count());
+			}
+			return best;
+		}
+
+		constexpr size_t QUERY_COUNT = 100; // of each kind
+
+		struct QueryResult {
+			double treeMilliseconds = 0.0; // per query
+			double linearMilliseconds = 0.0;
+			size_t treeHits = 0; // over all queries, the tree reports fat boxes so it may find a few more
+			size_t linearHits = 0;
+			size_t missed = 0;
+		};
+
+		// treeQuery(query, callback) runs query number 'query' on the tree, calling callback(userData)
+		//	for every hit. linearTest(query, box) is the same test on a single box
+		template<typename TreeQuery, typename LinearTest>
+		QueryResult compareQueries(const std::vector<PrxAabb>& boxes, TreeQuery&& treeQuery, LinearTest&& linearTest) {
+			QueryResult result{};
+			result.treeMilliseconds = bestMilliseconds([&]() {
+				result.treeHits = 0;
+				for (size_t query = 0; query < QUERY_COUNT; query++) {
+					treeQuery(query, [&](uint32_t) { result.treeHits++; });
+				}
+			}) / QUERY_COUNT;
+			result.linearMilliseconds = bestMilliseconds([&]() {
+				result.linearHits = 0;
+				for (size_t query = 0; query < QUERY_COUNT; query++) {
+					for (const PrxAabb& box : boxes) {
+						result.linearHits += linearTest(query, box) ? 1 : 0;
+					}
+				}
+			}) / QUERY_COUNT;
+
+			// brute force cross check, every box the scan finds has to be reported by the tree
+			std::vector<size_t> reportedBy(boxes.size(), SIZE_MAX);
+			for (size_t query = 0; query < QUERY_COUNT; query++) {
+				treeQuery(query, [&](uint32_t userData) { reportedBy[userData] = query; });
+				for (size_t i = 0; i < boxes.size(); i++) {
+					if (linearTest(query, boxes[i]) && reportedBy[i] != query) {
+						result.missed++;
+					}
+				}
+			}
+			return result;
+		}
+
+		void reportBvh(const std::string& name, const PrxBvh& bvh, double buildMilliseconds) {
+			const PrxBvh::BuildStats& stats = bvh.getBuildStats();
+			std::cout << name << ": " << bvh.getTriangles().size() << " triangles, " << std::fixed << std::setprecision(2)
+				<< buildMilliseconds << " ms, SAH cost " << stats.sahCost << ", " << stats.nodeCount << " nodes, "
+				<< stats.leafCount << " leaves, depth " << stats.maxDepth << " (limit " << PrxBvh::MAX_TRAVERSAL_DEPTH
+				<< "), " << stats.medianSplitCount << " median splits" << std::endl;
+		}
+
+		void report(const char* name, const QueryResult& result) {
+			std::cout << "    " << std::left << std::setw(8) << name << std::right << std::fixed << std::setprecision(4)
+				<< " tree " << std::setw(9) << result.treeMilliseconds << " ms  linear " << std::setw(9) << result.linearMilliseconds
+				<< " ms (" << std::setprecision(1) << result.linearMilliseconds / result.treeMilliseconds << "x)  hits "
+				<< result.treeHits / QUERY_COUNT << " / " << result.linearHits / QUERY_COUNT << " per query  missed "
+				<< result.missed << std::endl;
+		}
+	}
+
+	void runTransformBenchmark() {
+		std::cout << "computeTransformBatch: " << getTransformBatchPath() << std::endl;
+
+		for (size_t objectCount : { size_t{ 10'000 }, size_t{ 1'000'000 } }) {
+			std::mt19937 random{ 1234 };
+			std::uniform_real_distribution<float> angle{ -glm::two_pi<float>(), glm::two_pi<float>() };
+			std::uniform_real_distribution<float> scale{ .1f, 5.f };
+			std::uniform_real_distribution<float> offset{ -100.f, 100.f };
+
+			std::vector<TransformComponent> transforms(objectCount);
+			for (TransformComponent& transform : transforms) {
+				transform.translation = { offset(random), offset(random), offset(random) };
+				transform.scale = { scale(random), scale(random), scale(random) };
+				transform.rotation = { angle(random), angle(random), angle(random) };
+			}
+
+			// shuffled slots, the dirty objects of a frame are scattered over the object buffer too
+			std::vector<PrxEntity> entities(objectCount);
+			std::iota(entities.begin(), entities.end(), PrxEntity{ 0 });
+			std::shuffle(entities.begin(), entities.end(), random);
+
+			std::vector<GameObjectBufferData> expected(objectCount);
+			const double perObjectMilliseconds = bestMilliseconds([&]() {
+				for (size_t i = 0; i < objectCount; i++) {
+					GameObjectBufferData& data = expected[PrxRegistry::getIndex(entities[i])];
+					data.modelMatrix = transforms[i].mat4();
+					data.normalMatrix = glm::mat4{ transforms[i].normalMatrix() };
+				}
+			});
+
+			std::vector<GameObjectBufferData> batched(objectCount);
+			const double batchMilliseconds = bestMilliseconds([&]() {
+				computeTransformBatch(transforms.data(), entities.data(), objectCount, batched.data());
+			});
+
+			// Note: relative to the value for anything above 1, the translations are up to 100
+			float maxError = 0.f;
+			for (size_t i = 0; i < objectCount; i++) {
+				for (int column = 0; column < 4; column++) {
+					for (int row = 0; row < 4; row++) {
+						const float model = expected[i].modelMatrix[column][row];
+						const float normal = expected[i].normalMatrix[column][row];
+						maxError = std::max(maxError, std::abs(batched[i].modelMatrix[column][row] - model) / std::max(1.f, std::abs(model)));
+						maxError = std::max(maxError, std::abs(batched[i].normalMatrix[column][row] - normal) / std::max(1.f, std::abs(normal)));
+					}
+				}
+			}
+
+			std::cout << "  " << std::setw(7) << objectCount << " objects: per object " << std::fixed << std::setprecision(3)
+				<< perObjectMilliseconds << " ms, batch " << batchMilliseconds << " ms ("
+				<< std::setprecision(1) << perObjectMilliseconds / batchMilliseconds << "x), max error "
+				<< std::scientific << std::setprecision(2) << maxError << std::defaultfloat << std::endl;
+		}
+	}
+
+	void runAabbTreeBenchmark() {
+		for (size_t objectCount : { size_t{ 10'000 }, size_t{ 100'000 }, size_t{ 1'000'000 } }) {
+			// the world grows with the object count, so every query finds about as much at every size
+			const float worldSize = 2.5f * std::cbrt(static_cast<float>(objectCount));
+			std::mt19937 random{ 1234 };
+			std::uniform_real_distribution<float> position{ -worldSize, worldSize };
+			std::uniform_real_distribution<float> halfSize{ .1f, 2.f };
+			std::uniform_real_distribution<float> angle{ -glm::pi<float>(), glm::pi<float>() };
+			std::uniform_real_distribution<float> unit{ -1.f, 1.f };
+			auto randomPoint = [&]() { return glm::vec3{ position(random), position(random), position(random) }; };
+
+			std::vector<PrxAabb> boxes(objectCount);
+			for (PrxAabb& box : boxes) {
+				glm::vec3 center = randomPoint();
+				glm::vec3 extent{ halfSize(random), halfSize(random), halfSize(random) };
+				box = PrxAabb{ center - extent, center + extent };
+			}
+
+			PrxAabbTree tree{};
+			auto startTime = std::chrono::high_resolution_clock::now();
+			for (size_t i = 0; i < objectCount; i++) {
+				tree.createProxy(boxes[i], static_cast<uint32_t>(i));
+			}
+			auto endTime = std::chrono::high_resolution_clock::now();
+			std::cout << "  " << std::setw(7) << objectCount << " objects: built in " << std::fixed << std::setprecision(2)
+				<< std::chrono::duration<double, std::milli>(endTime - startTime).count() << " ms, height "
+				<< tree.getHeight() << std::endl;
+
+			// cameras like the app's (50 degrees, 100 units deep), point light sized spheres,
+			//	trigger sized boxes and 100 unit rays, all from random points
+			std::vector<PrxFrustum> frustums(QUERY_COUNT);
+			for (PrxFrustum& frustum : frustums) {
+				PrxCamera camera{};
+				camera.setPerspectiveProjection(glm::radians(50.f), 16.f / 9.f, .1f, 100.f);
+				camera.setViewYXZ(randomPoint(), glm::vec3{ angle(random), angle(random), 0.f });
+				frustum = PrxFrustum::fromMatrix(camera.getProjection() * camera.getView());
+			}
+			std::vector<glm::vec3> centers(QUERY_COUNT);
+			for (glm::vec3& center : centers) center = randomPoint();
+			std::vector<PrxAabb> regions(QUERY_COUNT);
+			for (PrxAabb& region : regions) {
+				glm::vec3 center = randomPoint();
+				region = PrxAabb{ center - glm::vec3{ 5.f }, center + glm::vec3{ 5.f } };
+			}
+			std::vector<PrxRay> rays(QUERY_COUNT);
+			std::vector<glm::vec3> invDirections(QUERY_COUNT);
+			for (size_t i = 0; i < QUERY_COUNT; i++) {
+				rays[i].origin = randomPoint();
+				rays[i].direction = glm::normalize(glm::vec3{ unit(random), unit(random), unit(random) });
+				invDirections[i] = 1.f / rays[i].direction;
+			}
+			constexpr float SPHERE_RADIUS = 10.f;
+			constexpr float RAY_LENGTH = 100.f;
+
+			report("frustum", compareQueries(boxes,
+				[&](size_t query, auto&& callback) {
+					tree.queryFrustum(frustums[query], [&](uint32_t userData) { callback(userData); return true; });
+				},
+				[&](size_t query, const PrxAabb& box) { return frustums[query].intersectsAabb(box.min, box.max); }));
+			report("sphere", compareQueries(boxes,
+				[&](size_t query, auto&& callback) {
+					tree.querySphere(centers[query], SPHERE_RADIUS, [&](uint32_t userData) { callback(userData); return true; });
+				},
+				[&](size_t query, const PrxAabb& box) { return box.overlapsSphere(centers[query], SPHERE_RADIUS); }));
+			report("box", compareQueries(boxes,
+				[&](size_t query, auto&& callback) {
+					tree.queryOverlap(regions[query], [&](uint32_t userData) { callback(userData); return true; });
+				},
+				[&](size_t query, const PrxAabb& box) { return box.overlaps(regions[query]); }));
+			report("ray", compareQueries(boxes,
+				[&](size_t query, auto&& callback) {
+					tree.queryRay(rays[query].origin, rays[query].direction, RAY_LENGTH,
+						[&](uint32_t userData, float maxDistance) { callback(userData); return maxDistance; });
+				},
+				[&](size_t query, const PrxAabb& box) {
+					float tEnter;
+					return box.intersectsRay(rays[query].origin, invDirections[query], RAY_LENGTH, tEnter);
+				}));
+		}
+	}
+
+	void runBvhBenchmark(const std::string& modelDirectory) {
+		std::vector<std::filesystem::path> modelPaths;
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(modelDirectory)) {
+			if (entry.is_regular_file() && entry.path().extension() == ".obj") {
+				modelPaths.push_back(entry.path());
+			}
+		}
+		if (modelPaths.empty()) {
+			throw std::runtime_error("No .obj models in " + modelDirectory + "!");
+		}
+		std::sort(modelPaths.begin(), modelPaths.end());
+
+		for (const std::filesystem::path& modelPath : modelPaths) {
+			// Note: the tinyobj loader, ModelData wants a device for its materials
+			PrxModel::OldModelData data{};
+			data.loadModel(modelPath.string());
+			const std::vector<PrxBvh::Triangle> triangles = PrxBvh::gatherTriangles(data);
+
+			PrxBvh bvh{};
+			const double buildMilliseconds = bestMilliseconds([&]() { bvh.build(triangles); });
+			reportBvh(modelPath.string(), bvh, buildMilliseconds);
+		}
+
+		// every triangle half the size of the one before, all in one corner. The biggest one always
+		//	gets its own side, so SAH peels off one triangle per level
+		std::vector<PrxBvh::Triangle> nested;
+		for (int i = 0; i < 2 * static_cast<int>(PrxBvh::MAX_TRAVERSAL_DEPTH); i++) {
+			const float size = std::ldexp(1.f, -i);
+			nested.push_back(PrxBvh::Triangle{ { size * .5f, 0.f, 0.f }, { size, 0.f, 0.f }, { size * .5f, size, 0.f } });
+		}
+		PrxBvh bvh{};
+		const double buildMilliseconds = bestMilliseconds([&]() { bvh.build(nested); });
+		reportBvh("nested triangles", bvh, buildMilliseconds);
+	}
+
+	void runTlasBenchmark() {
+		constexpr uint32_t INSTANCE_COUNT = 100'000;
+		constexpr size_t RAY_COUNT = 100;
+		constexpr float TARGET_MILLISECONDS = 1.f;
+
+		std::mt19937 random{ 1234 };
+		std::uniform_real_distribution<float> unit{ -1.f, 1.f };
+		auto randomPoint = [&](float size) { return glm::vec3{ unit(random), unit(random), unit(random) } * size; };
+
+		// a cube and a rock of random triangles
+		std::vector<PrxBvh::Triangle> cube;
+		for (int axis = 0; axis < 3; axis++) {
+			for (float side : { -.5f, .5f }) {
+				glm::vec3 corners[4];
+				for (int i = 0; i < 4; i++) {
+					corners[i][axis] = side;
+					corners[i][(axis + 1) % 3] = (i & 1) ? .5f : -.5f;
+					corners[i][(axis + 2) % 3] = (i & 2) ? .5f : -.5f;
+				}
+				cube.push_back(PrxBvh::Triangle{ corners[0], corners[1], corners[3] });
+				cube.push_back(PrxBvh::Triangle{ corners[0], corners[3], corners[2] });
+			}
+		}
+		std::vector<PrxBvh::Triangle> rock;
+		for (int i = 0; i < 200; i++) {
+			glm::vec3 center = randomPoint(.5f);
+			rock.push_back(PrxBvh::Triangle{ center, center + randomPoint(.2f), center + randomPoint(.2f) });
+		}
+		const PrxBvh cubeBlas{ cube };
+		const PrxBvh rockBlas{ rock };
+		const std::vector<const PrxBvh*> blases{ &cubeBlas, &rockBlas };
+
+		// the same world density as a busy scene, with a few units between neighbours
+		const float worldSize = 2.5f * std::cbrt(static_cast<float>(INSTANCE_COUNT));
+		std::vector<TransformComponent> transforms(INSTANCE_COUNT);
+		std::vector<glm::vec3> velocities(INSTANCE_COUNT);
+		std::vector<PrxTlasInstance> instances(INSTANCE_COUNT);
+		for (uint32_t i = 0; i < INSTANCE_COUNT; i++) {
+			transforms[i].translation = randomPoint(worldSize);
+			transforms[i].rotation = randomPoint(glm::pi<float>());
+			transforms[i].scale = glm::vec3{ 1.f + .5f * unit(random) };
+			velocities[i] = randomPoint(.05f);
+
+			PrxTlasInstance& instance = instances[i];
+			instance.setTransform(transforms[i].mat4());
+			instance.instanceCustomIndex = i;
+			instance.mask = 0xFF;
+			instance.accelerationStructureReference = i % 3 == 0 ? 1 : 0;
+		}
+
+		std::cout << INSTANCE_COUNT << " instances of " << blases.size() << " BLASes, target "
+			<< std::fixed << std::setprecision(2) << TARGET_MILLISECONDS << " ms" << std::endl;
+
+		PrxTlas tlas{};
+		double rebuildMilliseconds = 1e30;
+		for (int run = 0; run < RUNS; run++) {
+			tlas.build(instances, blases);
+			rebuildMilliseconds = std::min(rebuildMilliseconds, tlas.getStats().updateMilliseconds);
+		}
+		std::cout << "  rebuild: " << rebuildMilliseconds << " ms, " << tlas.getStats().nodeCount << " nodes" << std::endl;
+
+		// every frame sets all transforms again like update() does, moved objects get new ones
+		uint32_t frame = 0;
+		std::vector<glm::mat4> matrices(INSTANCE_COUNT);
+		for (uint32_t i = 0; i < INSTANCE_COUNT; i++) {
+			matrices[i] = tlas.getInstances()[i].getTransform();
+		}
+		for (uint32_t movingEvery : { 1u, 100u }) {
+			double refitMilliseconds = 1e30;
+			double tlasMilliseconds = 1e30;
+			bool refitted = true;
+			for (int run = 0; run < RUNS; run++) {
+				frame++;
+				for (uint32_t i = 0; i < INSTANCE_COUNT; i += movingEvery) {
+					transforms[i].translation += velocities[i];
+					transforms[i].rotation.y += .01f;
+					matrices[i] = transforms[i].mat4();
+				}
+
+				auto startTime = std::chrono::high_resolution_clock::now();
+				std::vector<PrxTlasInstance>& tlasInstances = tlas.getInstances();
+				for (uint32_t i = 0; i < INSTANCE_COUNT; i++) {
+					tlasInstances[i].setTransform(matrices[i]);
+				}
+				tlas.refit();
+				auto endTime = std::chrono::high_resolution_clock::now();
+				refitMilliseconds = std::min(refitMilliseconds, std::chrono::duration<double, std::milli>(endTime - startTime).count());
+				tlasMilliseconds = std::min(tlasMilliseconds, tlas.getStats().updateMilliseconds);
+				refitted = refitted && tlas.getStats().refitted;
+			}
+			std::cout << "  refit, " << (movingEvery == 1 ? "every instance" : "1% of instances") << " moved: "
+				<< refitMilliseconds << " ms, " << tlasMilliseconds << " ms of it in refit()"
+				<< (refitted ? "" : " (some runs rebuilt)") << std::endl;
+		}
+
+		// brute force cross check of the refitted tree
+		size_t hitCount = 0;
+		size_t mismatches = 0;
+		for (size_t i = 0; i < RAY_COUNT; i++) {
+			PrxRay ray{};
+			ray.origin = randomPoint(worldSize);
+			ray.direction = glm::normalize(randomPoint(1.f));
+
+			PrxHit hit{};
+			tlas.intersect(ray, hit);
+
+			PrxHit expected{};
+			for (const PrxTlasInstance& instance : tlas.getInstances()) {
+				const glm::mat4 toObject = instance.getInverseTransform();
+				PrxRay objectRay = ray;
+				objectRay.origin = glm::vec3(toObject * glm::vec4(ray.origin, 1.f));
+				objectRay.direction = glm::vec3(toObject * glm::vec4(ray.direction, 0.f));
+				blases[instance.accelerationStructureReference]->intersect(objectRay, expected);
+			}
+			hitCount += hit.isHit() ? 1 : 0;
+			if (hit.isHit() != expected.isHit()
+				|| (expected.isHit() && std::abs(hit.t - expected.t) > 1e-4f * std::max(1.f, expected.t))) {
+				mismatches++;
+			}
+		}
+		std::cout << "  " << RAY_COUNT << " rays against every instance: " << hitCount << " hits, "
+			<< mismatches << " mismatches" << std::endl;
+	}
+}
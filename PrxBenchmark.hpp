@@ -0,0 +1,38 @@
+#pragma once
+
+// std
+#include <string>
+
+namespace prx {
+
+	// Device-free benchmarks of the CPU side scene code, next to the ray benchmark (PrxRayBenchmark.hpp).
+	//	Every timing is the best of a few runs, and every fast path is checked against the plain
+	//	version it replaces.
+
+	// Times computeTransformBatch against TransformComponent::mat4() / normalMatrix() one object at a
+	//	time, for 10k and 1M random transforms written to scattered slots (like the dirty objects of
+	//	PrxGameObjectManager), and prints the largest difference between the two.
+	//	Run with: VulkanRTX --transform-benchmark
+	void runTransformBenchmark();
+
+	// Fills a PrxAabbTree with 10k, 100k and 1M random boxes (spread so the density stays the same)
+	//	and times frustum, sphere, box and ray queries against testing every box, printing the
+	//	build time, the time per query of both and the hit counts. The linear scan is also the
+	//	reference: a box it finds that the tree didn't report is printed as missed.
+	//	Run with: VulkanRTX --aabb-tree-benchmark
+	void runAabbTreeBenchmark();
+
+	// Builds a PrxBvh over every .obj model under modelDirectory (no device needed) and prints the
+	//	build time and getBuildStats(): SAH cost, node and leaf counts, depth and how many nodes had
+	//	to fall back to median splits to stay under MAX_TRAVERSAL_DEPTH. Ends with a worst case
+	//	mesh (nested triangles, each half the last) that SAH alone would build deeper than that.
+	//	Run with: VulkanRTX --bvh-benchmark [models]
+	void runBvhBenchmark(const std::string& modelDirectory);
+
+	// Places 100k instances of two small BLASes at random and times PrxTlas rebuilds and refits
+	//	(what update() runs when objects come and go, and when they only moved), once with every
+	//	instance moving and once with 1% of them. The refitted tree is then checked with rays
+	//	against intersecting every instance.
+	//	Run with: VulkanRTX --tlas-benchmark
+	void runTlasBenchmark();
+}
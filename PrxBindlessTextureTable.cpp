@@ -0,0 +1,104 @@
+#include "PrxBindlessTextureTable.hpp"
+#include "PrxUploadContext.hpp"
+
+// std
+#include <algorithm>
+#include <stdexcept>
+
+namespace prx {
+
+	PrxBindlessTextureTable::PrxBindlessTextureTable(PrxDevice& device, uint32_t maxTextures)
+		: prxDevice{ device } {
+		// a combined image sampler counts against both the sampler and the sampled image limits
+		const auto& limits = prxDevice.descriptorIndexingProperties;
+		capacity = std::min({ maxTextures,
+			limits.maxDescriptorSetUpdateAfterBindSampledImages,
+			limits.maxDescriptorSetUpdateAfterBindSamplers,
+			limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+			limits.maxPerStageDescriptorUpdateAfterBindSamplers });
+
+		setLayout = PrxDescriptorSetLayout::Builder(prxDevice)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, capacity)
+			.setBindingFlags(0, VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
+				| VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+				| VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT)
+			.setLayoutFlags(VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT)
+			.build();
+
+		pool = PrxDescriptorPool::Builder(prxDevice)
+			.setMaxSets(1)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, capacity)
+			.setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+			.build();
+
+		if (!pool->allocateDescriptorSet(setLayout->getDescriptorSetLayout(), descriptorSet)) {
+			throw std::runtime_error("failed to allocate bindless texture descriptor set!");
+		}
+
+		// slot 0 is never left unwritten, so a draw without a texture samples white instead of
+		//	whatever happened to be registered first (or nothing at all)
+		static uint8_t whitePixel[4] = { 255, 255, 255, 255 };
+		PrxTexture::ImageData white{};
+		white.width = 1;
+		white.height = 1;
+		white.pixels = decltype(white.pixels){ whitePixel, [](void*) {} };
+		defaultTexture = std::make_unique<PrxTexture>(prxDevice, white);
+		prxDevice.getUploadContext().flush();
+
+		writeSlot(DEFAULT_INDEX, *defaultTexture);
+		slots.emplace(defaultTexture.get(), DEFAULT_INDEX);
+		nextSlot = DEFAULT_INDEX + 1;
+	}
+
+	uint32_t PrxBindlessTextureTable::registerTexture(const PrxTexture& texture) {
+		auto it = slots.find(&texture);
+		if (it != slots.end()) {
+			return it->second;
+		}
+
+		uint32_t slot;
+		if (!freeSlots.empty()) {
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else if (nextSlot < capacity) {
+			slot = nextSlot++;
+		}
+		else {
+			throw std::runtime_error("bindless texture table is full!");
+		}
+
+		writeSlot(slot, texture);
+		slots.emplace(&texture, slot);
+		return slot;
+	}
+
+	void PrxBindlessTextureTable::unregisterTexture(const PrxTexture& texture) {
+		auto it = slots.find(&texture);
+		if (it == slots.end() || it->second == DEFAULT_INDEX) return;
+
+		// the stale descriptor is left in place; PARTIALLY_BOUND makes that fine as long as nothing indexes it
+		freeSlots.push_back(it->second);
+		slots.erase(it);
+	}
+
+	uint32_t PrxBindlessTextureTable::getIndex(const PrxTexture& texture) const {
+		auto it = slots.find(&texture);
+		return it != slots.end() ? it->second : INVALID_INDEX;
+	}
+
+	void PrxBindlessTextureTable::writeSlot(uint32_t slot, const PrxTexture& texture) {
+		VkDescriptorImageInfo imageInfo = texture.getImageInfo();
+
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = descriptorSet;
+		write.dstBinding = 0;
+		write.dstArrayElement = slot;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write.descriptorCount = 1;
+		write.pImageInfo = &imageInfo;
+
+		vkUpdateDescriptorSets(prxDevice.device(), 1, &write, 0, nullptr);
+	}
+}
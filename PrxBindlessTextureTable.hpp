@@ -0,0 +1,66 @@
+#pragma once
+
+#include "PrxDevice.hpp"
+#include "PrxDescriptors.hpp"
+#include "PrxTexture.hpp"
+
+// std
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace prx {
+
+	// One descriptor set holding a large, partially bound array of combined image samplers.
+	//	A texture is written into the array once, on registerTexture(), and keeps that slot until
+	//	it is unregistered. Shaders pick the texture by index (push constant or per-instance data),
+	//	so switching textures between draws costs no descriptor allocation, update or bind.
+	//	The set is bound as
+	//		layout(set = N, binding = 0) uniform sampler2D textures[];
+	// Note: slots are written with UPDATE_AFTER_BIND, so textures can be registered while
+	//	frames that use the set are still in flight.
+	//	Slot DEFAULT_INDEX always holds a 1x1 white texture made by the table itself, draws
+	//	without a texture of their own use it (the surface color is then left as it is)
+	class PrxBindlessTextureTable
+	{
+	public:
+		static constexpr uint32_t MAX_TEXTURES = 4096;
+		static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+		static constexpr uint32_t DEFAULT_INDEX = 0;
+
+		PrxBindlessTextureTable(PrxDevice& device, uint32_t maxTextures = MAX_TEXTURES);
+
+		// do not allow for copying
+		PrxBindlessTextureTable(const PrxBindlessTextureTable&) = delete;
+		PrxBindlessTextureTable& operator=(const PrxBindlessTextureTable&) = delete;
+
+		// returns the texture's slot, writing it into the table the first time it is seen
+		uint32_t registerTexture(const PrxTexture& texture);
+		// frees the slot for reuse. Only call this once no submitted frame samples the texture anymore
+		//	(and before the texture itself is destroyed). The default texture keeps its slot
+		void unregisterTexture(const PrxTexture& texture);
+		uint32_t getIndex(const PrxTexture& texture) const;
+
+		VkDescriptorSetLayout getDescriptorSetLayout() const { return setLayout->getDescriptorSetLayout(); }
+		VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+
+		uint32_t getCapacity() const { return capacity; }
+		uint32_t getTextureCount() const { return static_cast<uint32_t>(slots.size()); }
+
+	private:
+		void writeSlot(uint32_t slot, const PrxTexture& texture);
+
+		PrxDevice& prxDevice;
+		uint32_t capacity;
+
+		std::unique_ptr<PrxDescriptorSetLayout> setLayout;
+		std::unique_ptr<PrxDescriptorPool> pool;
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		std::unique_ptr<PrxTexture> defaultTexture;
+
+		std::unordered_map<const PrxTexture*, uint32_t> slots;
+		std::vector<uint32_t> freeSlots;
+		uint32_t nextSlot = 0; // slots past this one have never been handed out
+	};
+}
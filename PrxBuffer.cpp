@@ -43,18 +43,22 @@ namespace prx {
         memoryPropertyFlags{ memoryPropertyFlags } {
         alignmentSize = getAlignment(instanceSize, minOffsetAlignment);
         bufferSize = alignmentSize * instanceCount;
-        device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, memory);
+        device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, allocation);
     }
 
     PrxBuffer::~PrxBuffer() {
         unmap();
         vkDestroyBuffer(prxDevice.device(), buffer, nullptr);
-        vkFreeMemory(prxDevice.device(), memory, nullptr);
+        prxDevice.freeAllocation(allocation);
     }
 
     /**
      * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
      *
+     * @note Host visible memory blocks are persistently mapped by the device's memory allocator,
+     * so this only points into the existing mapping (many buffers share one VkDeviceMemory and
+     * it can't be mapped more than once).
+     *
      * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
      * buffer range.
      * @param offset (Optional) Byte offset from beginning
@@ -62,20 +66,21 @@ namespace prx {
      * @return VkResult of the buffer mapping call
      */
     VkResult PrxBuffer::map(VkDeviceSize size, VkDeviceSize offset) {
-        assert(buffer && memory && "Called map on buffer before create");
-        return vkMapMemory(prxDevice.device(), memory, offset, size, 0, &mapped);
+        assert(buffer && allocation.isValid() && "Called map on buffer before create");
+        if (allocation.mapped == nullptr) {
+            return VK_ERROR_MEMORY_MAP_FAILED;
+        }
+        mapped = static_cast<char*>(allocation.mapped) + offset;
+        return VK_SUCCESS;
     }
 
     /**
      * Unmap a mapped memory range
      *
-     * @note Does not return a result as vkUnmapMemory can't fail
+     * @note The underlying block stays mapped until the allocator releases it
      */
     void PrxBuffer::unmap() {
-        if (mapped) {
-            vkUnmapMemory(prxDevice.device(), memory);
-            mapped = nullptr;
-        }
+        mapped = nullptr;
     }
 
     /**
@@ -112,14 +117,33 @@ namespace prx {
      * @return VkResult of the flush call
      */
     VkResult PrxBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
+        VkMappedMemoryRange mappedRange =
+            prxDevice.getMemoryAllocator().getMappedRange(allocation, size, offset);
         return vkFlushMappedMemoryRanges(prxDevice.device(), 1, &mappedRange);
     }
 
+    /**
+     * Flush several memory ranges of the buffer with a single call
+     *
+     * @note Only required for non-coherent memory. Each range is widened to nonCoherentAtomSize
+     *
+     * @param ranges Byte ranges relative to the start of the buffer
+     *
+     * @return VkResult of the flush call
+     */
+    VkResult PrxBuffer::flushRanges(const std::vector<Range>& ranges) {
+        if (ranges.empty()) return VK_SUCCESS;
+
+        std::vector<VkMappedMemoryRange> mappedRanges;
+        mappedRanges.reserve(ranges.size());
+        for (const Range& range : ranges) {
+            mappedRanges.push_back(
+                prxDevice.getMemoryAllocator().getMappedRange(allocation, range.size, range.offset));
+        }
+        return vkFlushMappedMemoryRanges(
+            prxDevice.device(), static_cast<uint32_t>(mappedRanges.size()), mappedRanges.data());
+    }
+
     /**
      * Invalidate a memory range of the buffer to make it visible to the host
      *
@@ -132,11 +156,8 @@ namespace prx {
      * @return VkResult of the invalidate call
      */
     VkResult PrxBuffer::invalidate(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
+        VkMappedMemoryRange mappedRange =
+            prxDevice.getMemoryAllocator().getMappedRange(allocation, size, offset);
         return vkInvalidateMappedMemoryRanges(prxDevice.device(), 1, &mappedRange);
     }
 
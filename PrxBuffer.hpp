@@ -2,12 +2,21 @@
 
 #include "PrxDevice.hpp"
 
+// std
+#include <vector>
+
 // Credit to Brenden Galea for coding this file.
 
 namespace prx {
 
     class PrxBuffer {
     public:
+        // byte range relative to the start of the buffer
+        struct Range {
+            VkDeviceSize offset;
+            VkDeviceSize size;
+        };
+
         PrxBuffer(
             PrxDevice& device,
             VkDeviceSize instanceSize,
@@ -25,6 +34,7 @@ namespace prx {
 
         void writeToBuffer(void* data, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
         VkResult flush(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+        VkResult flushRanges(const std::vector<Range>& ranges);
         VkDescriptorBufferInfo descriptorInfo(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
         VkResult invalidate(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 
@@ -41,6 +51,7 @@ namespace prx {
         VkBufferUsageFlags getUsageFlags() const { return usageFlags; }
         VkMemoryPropertyFlags getMemoryPropertyFlags() const { return memoryPropertyFlags; }
         VkDeviceSize getBufferSize() const { return bufferSize; }
+        const PrxAllocation& getAllocation() const { return allocation; }
 
     private:
         static VkDeviceSize getAlignment(VkDeviceSize instanceSize, VkDeviceSize minOffsetAlignment);
@@ -48,7 +59,7 @@ namespace prx {
         PrxDevice& prxDevice;
         void* mapped = nullptr;
         VkBuffer buffer = VK_NULL_HANDLE;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
+        PrxAllocation allocation{};
 
         VkDeviceSize bufferSize;
         uint32_t instanceCount;
@@ -0,0 +1,407 @@
+#include "PrxBvh.hpp"
+#include "PrxParallel.hpp"
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cfloat>
+#include <chrono>
+#include <future>
+#include <numeric>
+
+namespace prx {
+
+	// shared by every thread of one build
+	struct PrxBvh::BuildContext {
+		const BuildSettings& settings;
+		std::vector<PrxAabb> triangleBounds;
+		std::vector<glm::vec3> centroids;
+		uint32_t* indices; // partitioned in place, each subtree owns its own range
+		uint32_t parallelDepth; // no new threads below this depth, there are enough by then
+		std::atomic<uint32_t> maxDepth{ 0 };
+		std::atomic<uint32_t> medianSplitCount{ 0 };
+	};
+
+	namespace {
+		uint32_t ceilLog2(uint32_t value) {
+			uint32_t log = 0;
+			while (log < 32 && (1ull << log) < value) {
+				log++;
+			}
+			return log;
+		}
+	}
+
+	std::vector<PrxBvh::Triangle> PrxBvh::gatherTriangles(const PrxModel::ModelData& data) {
+		return gatherTriangles(data.vertices, data.indices, data.meshes);
+	}
+
+	std::vector<PrxBvh::Triangle> PrxBvh::gatherTriangles(const PrxModel::OldModelData& data) {
+		return gatherTriangles(data.vertices, data.indices, {});
+	}
+
+	std::vector<PrxBvh::Triangle> PrxBvh::gatherTriangles(const std::vector<PrxModel::Vertex>& vertices,
+		const std::vector<uint32_t>& indices, const std::vector<PrxModel::MeshEntryData>& meshes) {
+		return gatherTriangles(vertices.data(), vertices.size(), indices.data(), indices.size(), meshes.data(), meshes.size());
+	}
+
+	std::vector<PrxBvh::Triangle> PrxBvh::gatherTriangles(const PrxModel::Vertex* vertices, size_t vertexCount,
+		const uint32_t* indices, size_t indexCount, const PrxModel::MeshEntryData* meshes, size_t meshCount) {
+
+		std::vector<Triangle> triangles;
+		auto addTriangles = [&](uint32_t baseVertex, uint32_t baseIndex, uint32_t meshIndexCount) {
+			assert(baseIndex + meshIndexCount <= indexCount && "Mesh indices out of range");
+			for (uint32_t i = 0; i + 2 < meshIndexCount; i += 3) {
+				const uint32_t* triangle = &indices[baseIndex + i];
+				assert(baseVertex + std::max({ triangle[0], triangle[1], triangle[2] }) < vertexCount
+					&& "Index out of range");
+				triangles.push_back(Triangle{
+					vertices[baseVertex + triangle[0]].position,
+					vertices[baseVertex + triangle[1]].position,
+					vertices[baseVertex + triangle[2]].position });
+			}
+		};
+
+		if (meshCount == 0) {
+			triangles.reserve(indexCount / 3);
+			addTriangles(0, 0, static_cast<uint32_t>(indexCount));
+		}
+		else {
+			for (size_t i = 0; i < meshCount; i++) {
+				addTriangles(meshes[i].baseVertex, meshes[i].baseIndex, meshes[i].numIndices);
+			}
+		}
+		return triangles;
+	}
+
+	std::vector<uint32_t> PrxBvh::gatherTriangleMaterials(const std::vector<PrxModel::MeshEntryData>& meshes) {
+		std::vector<uint32_t> materials;
+		for (const PrxModel::MeshEntryData& mesh : meshes) {
+			materials.insert(materials.end(), mesh.numIndices / 3, mesh.matIntex);
+		}
+		return materials;
+	}
+
+	PrxBvh::PrxBvh(std::vector<Triangle> triangles) {
+		build(std::move(triangles), BuildSettings{});
+	}
+
+	PrxBvh::PrxBvh(std::vector<Triangle> triangles, const BuildSettings& settings) {
+		build(std::move(triangles), settings);
+	}
+
+	void PrxBvh::build(std::vector<Triangle> triangles) {
+		build(std::move(triangles), BuildSettings{});
+	}
+
+	void PrxBvh::build(std::vector<Triangle> input, const BuildSettings& settings) {
+		assert(settings.binCount >= 2 && settings.binCount <= MAX_BIN_COUNT && "Unsupported BVH bin count");
+		assert(settings.maxLeafSize >= 1 && settings.maxLeafSize <= MAX_LEAF_SIZE && "Unsupported BVH leaf size");
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		nodes.clear();
+		triangles.clear();
+		buildStats = BuildStats{};
+		const uint32_t triangleCount = static_cast<uint32_t>(input.size());
+		triangleIndices.resize(triangleCount);
+		std::iota(triangleIndices.begin(), triangleIndices.end(), 0u);
+		if (triangleCount == 0) return;
+
+		// a thread per split down to about one per core (just the one on a loader worker, see PrxParallel)
+		uint32_t threadCount = PrxParallel::getThreadCount();
+		uint32_t parallelDepth = 0;
+		while ((1u << parallelDepth) < threadCount) {
+			parallelDepth++;
+		}
+
+		BuildContext context{ settings, {}, {}, triangleIndices.data(), parallelDepth };
+		context.triangleBounds.resize(triangleCount);
+		context.centroids.resize(triangleCount);
+		for (uint32_t i = 0; i < triangleCount; i++) {
+			PrxAabb bounds{};
+			bounds.grow(input[i].v0);
+			bounds.grow(input[i].v1);
+			bounds.grow(input[i].v2);
+			context.triangleBounds[i] = bounds;
+			context.centroids[i] = bounds.center();
+		}
+
+		nodes.reserve(2 * triangleCount / std::max(1u, settings.maxLeafSize / 2) + 1);
+		buildRange(context, 0, triangleCount, 0, nodes);
+
+		// leaves point at ranges of triangleIndices, so lay the triangles out the same way
+		triangles.resize(triangleCount);
+		for (uint32_t i = 0; i < triangleCount; i++) {
+			triangles[i] = input[triangleIndices[i]];
+		}
+
+		auto endTime = std::chrono::high_resolution_clock::now();
+		buildStats.buildMilliseconds = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+		buildStats.sahCost = computeSahCost(settings.traversalCost, settings.intersectionCost);
+		buildStats.nodeCount = static_cast<uint32_t>(nodes.size());
+		buildStats.leafCount = static_cast<uint32_t>(std::count_if(nodes.begin(), nodes.end(),
+			[](const Node& node) { return node.isLeaf(); }));
+		buildStats.maxDepth = context.maxDepth.load();
+		buildStats.medianSplitCount = context.medianSplitCount.load();
+		assert(buildStats.maxDepth < MAX_TRAVERSAL_DEPTH && "BVH too deep to traverse");
+	}
+
+	void PrxBvh::buildRange(BuildContext& context, uint32_t begin, uint32_t end, uint32_t depth, std::vector<Node>& out) {
+		const BuildSettings& settings = context.settings;
+		uint32_t* indices = context.indices;
+		const uint32_t count = end - begin;
+
+		uint32_t maxDepth = context.maxDepth.load(std::memory_order_relaxed);
+		while (depth > maxDepth && !context.maxDepth.compare_exchange_weak(maxDepth, depth, std::memory_order_relaxed)) {}
+
+		PrxAabb bounds{};
+		PrxAabb centroidBounds{};
+		for (uint32_t i = begin; i < end; i++) {
+			bounds.grow(context.triangleBounds[indices[i]]);
+			centroidBounds.grow(context.centroids[indices[i]]);
+		}
+
+		// Note: out can reallocate while the children are built, so the node is only ever
+		//	touched through its index
+		const uint32_t nodeIndex = static_cast<uint32_t>(out.size());
+		out.push_back(Node{ bounds.min, begin, bounds.max, static_cast<uint16_t>(0), static_cast<uint16_t>(0) });
+		auto makeLeaf = [&]() {
+			out[nodeIndex].offset = begin;
+			out[nodeIndex].triangleCount = static_cast<uint16_t>(count);
+		};
+
+		if (count == 1) {
+			makeLeaf();
+			return;
+		}
+
+		// SAH splits can be very lopsided (a few big triangles next to a dense cluster), and every
+		//	traversal stack only holds MAX_TRAVERSAL_DEPTH entries. Once halving the rest would only
+		//	just fit under that, split at the centroid median instead, which is sure to end in time
+		if (depth + 1 + ceilLog2(count) >= MAX_TRAVERSAL_DEPTH) {
+			if (count <= settings.maxLeafSize) {
+				makeLeaf();
+				return;
+			}
+
+			int axis = 0;
+			const glm::vec3 extent = centroidBounds.extent();
+			if (extent.y > extent[axis]) axis = 1;
+			if (extent.z > extent[axis]) axis = 2;
+			const uint32_t mid = begin + count / 2;
+			std::nth_element(indices + begin, indices + mid, indices + end, [&](uint32_t a, uint32_t b) {
+				return context.centroids[a][axis] < context.centroids[b][axis];
+			});
+			out[nodeIndex].splitAxis = static_cast<uint16_t>(axis);
+			context.medianSplitCount.fetch_add(1, std::memory_order_relaxed);
+			buildChildren(context, nodeIndex, begin, mid, end, depth, out);
+			return;
+		}
+
+		// Binned SAH: drop every centroid into one of binCount slabs per axis, then sweep the
+		//	binCount - 1 planes between them and keep the one with the lowest SAH cost.
+		//	Cost here is area * count per side, scaled into real units once the best one is known
+		struct Bin {
+			PrxAabb bounds{};
+			uint32_t count = 0;
+		};
+		const uint32_t binCount = settings.binCount;
+		float bestCost = FLT_MAX;
+		int bestAxis = -1;
+		uint32_t bestSplit = 0; // bins below this go left
+
+		// one pass fills the bins of all three axes, the triangle data is only read once per level.
+		//	Axes where every centroid is on one plane have nothing to split along and are skipped
+		Bin bins[3][MAX_BIN_COUNT];
+		bool splittable[3];
+		float scale[3];
+		for (int axis = 0; axis < 3; axis++) {
+			const float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+			splittable[axis] = extent > 0.f;
+			scale[axis] = splittable[axis] ? binCount / extent : 0.f;
+		}
+		for (uint32_t i = begin; i < end; i++) {
+			const uint32_t index = indices[i];
+			const glm::vec3 centroid = context.centroids[index];
+			const PrxAabb& triangleBounds = context.triangleBounds[index];
+			for (int axis = 0; axis < 3; axis++) {
+				uint32_t bin = std::min(binCount - 1, static_cast<uint32_t>((centroid[axis] - centroidBounds.min[axis]) * scale[axis]));
+				bins[axis][bin].count++;
+				bins[axis][bin].bounds.grow(triangleBounds);
+			}
+		}
+
+		for (int axis = 0; axis < 3; axis++) {
+			if (!splittable[axis]) continue;
+
+			// left side of every plane in one sweep, right side while sweeping back
+			float leftArea[MAX_BIN_COUNT - 1];
+			uint32_t leftCount[MAX_BIN_COUNT - 1];
+			PrxAabb leftBounds{};
+			uint32_t leftSum = 0;
+			for (uint32_t plane = 0; plane < binCount - 1; plane++) {
+				leftBounds.grow(bins[axis][plane].bounds);
+				leftSum += bins[axis][plane].count;
+				leftArea[plane] = leftSum > 0 ? leftBounds.surfaceArea() : 0.f;
+				leftCount[plane] = leftSum;
+			}
+
+			PrxAabb rightBounds{};
+			uint32_t rightSum = 0;
+			for (uint32_t plane = binCount - 1; plane > 0; plane--) {
+				rightBounds.grow(bins[axis][plane].bounds);
+				rightSum += bins[axis][plane].count;
+				if (leftCount[plane - 1] == 0 || rightSum == 0) continue;
+
+				float cost = leftArea[plane - 1] * leftCount[plane - 1] + rightBounds.surfaceArea() * rightSum;
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = plane;
+				}
+			}
+		}
+
+		uint32_t mid;
+		if (bestAxis < 0) {
+			// every centroid is the same point, so no plane separates anything.
+			//	Any split is as good as another, halve the range if it's too big for one leaf
+			if (count <= settings.maxLeafSize) {
+				makeLeaf();
+				return;
+			}
+			mid = begin + count / 2;
+		}
+		else {
+			const float leafCost = settings.intersectionCost * count;
+			const float splitCost = settings.traversalCost
+				+ settings.intersectionCost * bestCost / std::max(bounds.surfaceArea(), FLT_MIN);
+			if (splitCost >= leafCost && count <= settings.maxLeafSize) {
+				makeLeaf();
+				return;
+			}
+
+			// same bin math as above, so every triangle lands on the side it was counted on
+			const float axisMin = centroidBounds.min[bestAxis];
+			const float scale = binCount / (centroidBounds.max[bestAxis] - axisMin);
+			uint32_t* split = std::partition(indices + begin, indices + end, [&](uint32_t index) {
+				uint32_t bin = std::min(binCount - 1, static_cast<uint32_t>((context.centroids[index][bestAxis] - axisMin) * scale));
+				return bin < bestSplit;
+			});
+			mid = static_cast<uint32_t>(split - indices);
+			out[nodeIndex].splitAxis = static_cast<uint16_t>(bestAxis);
+		}
+
+		buildChildren(context, nodeIndex, begin, mid, end, depth, out);
+	}
+
+	void PrxBvh::buildChildren(BuildContext& context, uint32_t nodeIndex, uint32_t begin, uint32_t mid, uint32_t end,
+		uint32_t depth, std::vector<Node>& out) {
+		// big ranges near the top build their halves in parallel into their own arrays, which are
+		//	then spliced in behind this node (left first, to keep depth first order)
+		if (end - begin >= context.settings.parallelThreshold && depth < context.parallelDepth) {
+			std::vector<Node> left;
+			std::vector<Node> right;
+			auto leftTask = std::async(std::launch::async, [&]() {
+				buildRange(context, begin, mid, depth + 1, left);
+			});
+			buildRange(context, mid, end, depth + 1, right);
+			leftTask.get();
+
+			out[nodeIndex].offset = nodeIndex + 1 + static_cast<uint32_t>(left.size());
+			appendSubtree(out, left);
+			appendSubtree(out, right);
+		}
+		else {
+			buildRange(context, begin, mid, depth + 1, out);
+			out[nodeIndex].offset = static_cast<uint32_t>(out.size());
+			buildRange(context, mid, end, depth + 1, out);
+		}
+	}
+
+	void PrxBvh::appendSubtree(std::vector<Node>& out, const std::vector<Node>& subtree) {
+		const uint32_t base = static_cast<uint32_t>(out.size());
+		for (Node node : subtree) {
+			if (!node.isLeaf()) {
+				node.offset += base;
+			}
+			out.push_back(node);
+		}
+	}
+
+	float PrxBvh::computeSahCost(float traversalCost, float intersectionCost) const {
+		if (nodes.empty()) return 0.f;
+
+		auto area = [](const Node& node) { return PrxAabb{ node.boundsMin, node.boundsMax }.surfaceArea(); };
+		const float rootArea = std::max(area(nodes[0]), FLT_MIN);
+
+		float cost = 0.f;
+		for (const Node& node : nodes) {
+			float probability = area(node) / rootArea;
+			cost += node.isLeaf() ? intersectionCost * node.triangleCount * probability : traversalCost * probability;
+		}
+		return cost;
+	}
+
+	bool PrxBvh::intersect(const PrxRay& ray, PrxHit& hit) const {
+		if (nodes.empty()) return false;
+
+		const PrxRayTriangleTest triangleTest{ ray };
+		const glm::vec3 invDirection = 1.f / ray.direction;
+		const bool directionNegative[3] = { ray.direction.x < 0.f, ray.direction.y < 0.f, ray.direction.z < 0.f };
+		float tMax = std::min(ray.tMax, hit.t);
+		bool found = false;
+
+		uint32_t stack[MAX_TRAVERSAL_DEPTH];
+		uint32_t stackSize = 0;
+		uint32_t nodeIndex = 0;
+		while (true) {
+			const Node& node = nodes[nodeIndex];
+
+			// slab test, with the far side pushed out a hair so rays along a box face still get in
+			const glm::vec3 t0 = (node.boundsMin - ray.origin) * invDirection;
+			const glm::vec3 t1 = (node.boundsMax - ray.origin) * invDirection;
+			const glm::vec3 tNear = glm::min(t0, t1);
+			const glm::vec3 tFar = glm::max(t0, t1);
+			const float tEnter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, ray.tMin));
+			const float tExit = std::min(std::min(std::min(tFar.x, tFar.y), tFar.z) * PrxRayTriangleTest::BOX_ROBUSTNESS, tMax);
+
+			if (tEnter <= tExit) {
+				if (node.isLeaf()) {
+					for (uint32_t i = node.offset; i < node.offset + node.triangleCount; i++) {
+						const Triangle& triangle = triangles[i];
+						float t, u, v;
+						if (triangleTest.intersect(triangle.v0, triangle.v1, triangle.v2, ray.tMin, tMax, t, u, v)) {
+							tMax = t;
+							hit = PrxHit{ t, u, v, triangleIndices[i] };
+							found = true;
+						}
+					}
+				}
+				else {
+					// nearer child first, so the far one is more likely to be culled by then
+					uint32_t first = nodeIndex + 1;
+					uint32_t second = node.offset;
+					if (directionNegative[node.splitAxis]) {
+						std::swap(first, second);
+					}
+					assert(stackSize < MAX_TRAVERSAL_DEPTH && "BVH traversal stack overflow");
+					stack[stackSize++] = second;
+					nodeIndex = first;
+					continue;
+				}
+			}
+
+			if (stackSize == 0) break;
+			nodeIndex = stack[--stackSize];
+		}
+		return found;
+	}
+
+	PrxAabb PrxBvh::getBounds() const {
+		if (nodes.empty()) return PrxAabb{};
+		return PrxAabb{ nodes[0].boundsMin, nodes[0].boundsMax };
+	}
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "PrxAabb.hpp"
+#include "PrxModel.hpp"
+#include "PrxRay.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm.hpp"
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace prx {
+
+	// Static bounding volume hierarchy over a triangle mesh, built on the CPU with binned SAH.
+	//	Meant as the software bottom level acceleration structure: picking and collision on the CPU,
+	//	uploading to the GPU as is, and a reference to check VK_KHR_acceleration_structure against.
+	//
+	// Nodes are 32 bytes and stored depth first, so an interior node's first child is always the
+	//	very next node and only the second child needs an index. Triangles are reordered so every
+	//	leaf covers a contiguous range of them.
+	class PrxBvh
+	{
+	public:
+		struct Node {
+			glm::vec3 boundsMin;
+			uint32_t offset; // leaf: first triangle. Interior: index of the second child
+			glm::vec3 boundsMax;
+			uint16_t triangleCount; // 0 for interior nodes
+			uint16_t splitAxis; // interior only, lets traversal visit the nearer child first
+
+			bool isLeaf() const { return triangleCount != 0; }
+		};
+		static_assert(sizeof(Node) == 32, "BVH nodes should stay 32 bytes, two per cache line");
+
+		struct Triangle {
+			glm::vec3 v0, v1, v2;
+		};
+
+		struct BuildSettings {
+			uint32_t binCount = 16; // per axis, up to MAX_BIN_COUNT
+			uint32_t maxLeafSize = 8; // leaves are split past this even when SAH says otherwise
+			float traversalCost = 1.f; // SAH cost of visiting a node, relative to one triangle test
+			float intersectionCost = 1.f;
+			// ranges at least this big have their two halves built on separate threads
+			uint32_t parallelThreshold = 16 * 1024;
+		};
+
+		struct BuildStats {
+			double buildMilliseconds = 0.0;
+			float sahCost = 0.f; // expected cost of a random ray, see computeSahCost
+			uint32_t nodeCount = 0;
+			uint32_t leafCount = 0;
+			uint32_t maxDepth = 0;
+			// nodes split at the median instead of by SAH, to stay under MAX_TRAVERSAL_DEPTH
+			uint32_t medianSplitCount = 0;
+		};
+
+		static constexpr uint32_t MAX_BIN_COUNT = 32;
+		static constexpr uint32_t MAX_LEAF_SIZE = UINT16_MAX;
+		// traversal keeps one stack entry per level, the build falls back to median splits
+		//	near this so no tree is ever deeper
+		static constexpr uint32_t MAX_TRAVERSAL_DEPTH = 64;
+
+		// triangles of the whole model, with every mesh's base vertex applied
+		static std::vector<Triangle> gatherTriangles(const PrxModel::ModelData& data);
+		static std::vector<Triangle> gatherTriangles(const PrxModel::OldModelData& data);
+		// Note: meshes may be empty, the indices are then taken as one mesh over all vertices
+		static std::vector<Triangle> gatherTriangles(const std::vector<PrxModel::Vertex>& vertices,
+			const std::vector<uint32_t>& indices, const std::vector<PrxModel::MeshEntryData>& meshes);
+		// same over raw arrays, e.g. straight out of a PrxMeshCache
+		static std::vector<Triangle> gatherTriangles(const PrxModel::Vertex* vertices, size_t vertexCount,
+			const uint32_t* indices, size_t indexCount, const PrxModel::MeshEntryData* meshes, size_t meshCount);
+		// the mesh's matIntex of every triangle gatherTriangles returns for these meshes, in the same
+		//	order (so indexed like getTriangleIndices). Empty without meshes, it's all material 0 then
+		static std::vector<uint32_t> gatherTriangleMaterials(const std::vector<PrxModel::MeshEntryData>& meshes);
+
+		PrxBvh() = default;
+		// Note: overloads instead of default arguments, BuildSettings{} isn't usable inside the class
+		explicit PrxBvh(std::vector<Triangle> triangles);
+		PrxBvh(std::vector<Triangle> triangles, const BuildSettings& settings);
+
+		void build(std::vector<Triangle> triangles);
+		void build(std::vector<Triangle> triangles, const BuildSettings& settings);
+
+		// SAH cost of the finished tree: the sum of every node's cost weighted by the odds that a ray
+		//	through the root also passes through it (surface area ratio)
+		float computeSahCost(float traversalCost = 1.f, float intersectionCost = 1.f) const;
+
+		// Closest hit along the ray, one ray at a time (see PrxRayTraversal.hpp for packets and wide nodes).
+		//	hit.t also caps the search, so hit can carry a closer hit from another query (e.g. another
+		//	instance) and is only overwritten by a closer one. Returns true if it was
+		bool intersect(const PrxRay& ray, PrxHit& hit) const;
+
+		const std::vector<Node>& getNodes() const { return nodes; }
+		// in leaf order
+		const std::vector<Triangle>& getTriangles() const { return triangles; }
+		// index each triangle had in the input, lined up with getTriangles()
+		const std::vector<uint32_t>& getTriangleIndices() const { return triangleIndices; }
+		const BuildStats& getBuildStats() const { return buildStats; }
+		PrxAabb getBounds() const;
+		bool isEmpty() const { return nodes.empty(); }
+
+	private:
+		struct BuildContext;
+
+		// builds the subtree over triangleIndices[begin, end) into out, in depth first order.
+		//	Interior offsets are relative to the start of out
+		static void buildRange(BuildContext& context, uint32_t begin, uint32_t end, uint32_t depth, std::vector<Node>& out);
+		// builds both children of out[nodeIndex], split at mid
+		static void buildChildren(BuildContext& context, uint32_t nodeIndex, uint32_t begin, uint32_t mid, uint32_t end,
+			uint32_t depth, std::vector<Node>& out);
+		static void appendSubtree(std::vector<Node>& out, const std::vector<Node>& subtree);
+
+		std::vector<Node> nodes;
+		std::vector<Triangle> triangles;
+		std::vector<uint32_t> triangleIndices;
+		BuildStats buildStats{};
+	};
+}
@@ -1,6 +1,8 @@
 #include "PrxDescriptors.hpp"
+#include "PrxUtils.hpp"
 
 // std
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 
@@ -25,25 +27,60 @@ namespace prx {
         return *this;
     }
 
+    PrxDescriptorSetLayout::Builder& PrxDescriptorSetLayout::Builder::setBindingFlags(
+        uint32_t binding, VkDescriptorBindingFlags flags) {
+        assert(bindings.count(binding) == 1 && "Binding flags set for a binding that was never added");
+        bindingFlags[binding] = flags;
+        return *this;
+    }
+
+    PrxDescriptorSetLayout::Builder& PrxDescriptorSetLayout::Builder::setLayoutFlags(
+        VkDescriptorSetLayoutCreateFlags flags) {
+        layoutFlags = flags;
+        return *this;
+    }
+
     std::unique_ptr<PrxDescriptorSetLayout> PrxDescriptorSetLayout::Builder::build() const {
-        return std::make_unique<PrxDescriptorSetLayout>(prxDevice, bindings);
+        return std::make_unique<PrxDescriptorSetLayout>(prxDevice, bindings, layoutFlags, bindingFlags);
+    }
+
+    PrxDescriptorSetLayout& PrxDescriptorSetLayout::Builder::build(PrxDescriptorLayoutCache& cache) const {
+        // Note: the cache only keys on the bindings. Layouts with flags are one-offs (e.g. bindless tables),
+        // so build those with build() instead
+        assert(layoutFlags == 0 && bindingFlags.empty() && "Layouts with flags can't be cached");
+        return cache.getLayout(bindings);
     }
 
     // *************** Descriptor Set Layout *********************
 
     PrxDescriptorSetLayout::PrxDescriptorSetLayout(
-        PrxDevice& prxDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings)
+        PrxDevice& prxDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+        VkDescriptorSetLayoutCreateFlags layoutFlags,
+        const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags)
         : prxDevice{ prxDevice }, bindings{ bindings } {
         std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+        std::vector<VkDescriptorBindingFlags> setLayoutBindingFlags{};
         for (auto kv : bindings) {
             setLayoutBindings.push_back(kv.second);
+            auto flags = bindingFlags.find(kv.first);
+            setLayoutBindingFlags.push_back(flags != bindingFlags.end() ? flags->second : 0);
         }
 
         VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
         descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        descriptorSetLayoutInfo.flags = layoutFlags;
         descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
         descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
 
+        // the flags array has to line up with pBindings
+        VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+        bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        bindingFlagsInfo.bindingCount = static_cast<uint32_t>(setLayoutBindingFlags.size());
+        bindingFlagsInfo.pBindingFlags = setLayoutBindingFlags.data();
+        if (!bindingFlags.empty()) {
+            descriptorSetLayoutInfo.pNext = &bindingFlagsInfo;
+        }
+
         if (vkCreateDescriptorSetLayout(
             prxDevice.device(),
             &descriptorSetLayoutInfo,
@@ -57,6 +94,52 @@ namespace prx {
         vkDestroyDescriptorSetLayout(prxDevice.device(), descriptorSetLayout, nullptr);
     }
 
+    // *************** Descriptor Layout Cache *********************
+
+    bool PrxDescriptorLayoutCache::LayoutKey::operator==(const LayoutKey& other) const {
+        if (bindings.size() != other.bindings.size()) return false;
+        for (size_t i = 0; i < bindings.size(); i++) {
+            const auto& a = bindings[i];
+            const auto& b = other.bindings[i];
+            if (a.binding != b.binding || a.descriptorType != b.descriptorType ||
+                a.descriptorCount != b.descriptorCount || a.stageFlags != b.stageFlags) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t PrxDescriptorLayoutCache::LayoutKeyHash::operator()(const LayoutKey& key) const {
+        size_t seed = 0;
+        for (const auto& binding : key.bindings) {
+            hashCombine(seed, binding.binding, static_cast<uint32_t>(binding.descriptorType),
+                binding.descriptorCount, binding.stageFlags);
+        }
+        return seed;
+    }
+
+    PrxDescriptorSetLayout& PrxDescriptorLayoutCache::getLayout(
+        const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>& bindings) {
+        LayoutKey key{};
+        for (auto& kv : bindings) {
+            key.bindings.push_back(kv.second);
+        }
+        std::sort(key.bindings.begin(), key.bindings.end(),
+            [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+                return a.binding < b.binding;
+            });
+
+        auto it = layouts.find(key);
+        if (it != layouts.end()) {
+            return *it->second;
+        }
+
+        auto layout = std::make_unique<PrxDescriptorSetLayout>(prxDevice, bindings);
+        auto& result = *layout;
+        layouts.emplace(std::move(key), std::move(layout));
+        return result;
+    }
+
     // *************** Descriptor Pool Builder *********************
 
     PrxDescriptorPool::Builder& PrxDescriptorPool::Builder::addPoolSize(
@@ -112,9 +195,8 @@ namespace prx {
         allocInfo.pSetLayouts = &descriptorSetLayout;
         allocInfo.descriptorSetCount = 1;
 
-        // Might want to create a "DescriptorPoolManager" class that handles this case, and builds
-        // a new pool whenever an old pool fills up. But this is beyond our current scope
-        // Consider using: https://vkguide.dev/docs/extra-chapter/abstracting_descriptors/
+        // Note: this fails once the pool is full. Use a PrxDescriptorAllocator if the number of
+        // sets isn't known up front, it moves on to a new pool instead
         if (vkAllocateDescriptorSets(prxDevice.device(), &allocInfo, &descriptor) != VK_SUCCESS) {
             return false;
         }
@@ -133,10 +215,117 @@ namespace prx {
         vkResetDescriptorPool(prxDevice.device(), descriptorPool, 0);
     }
 
+    // *************** Descriptor Allocator *********************
+
+    std::vector<PrxDescriptorAllocator::PoolRatio> PrxDescriptorAllocator::defaultPoolRatios() {
+        return {
+            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.f },
+            { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.f },
+            { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .5f },
+        };
+    }
+
+    PrxDescriptorAllocator::PrxDescriptorAllocator(
+        PrxDevice& prxDevice,
+        uint32_t initialSetsPerPool,
+        std::vector<PoolRatio> poolRatios)
+        : prxDevice{ prxDevice },
+        poolRatios{ std::move(poolRatios) },
+        initialSetsPerPool{ std::min(std::max(initialSetsPerPool, 1u), MAX_SETS_PER_POOL) },
+        setsPerPool{ this->initialSetsPerPool } {
+        stats.setsPerPool = setsPerPool;
+    }
+
+    PrxDescriptorPool& PrxDescriptorAllocator::grabPool() {
+        if (!freePools.empty()) {
+            usedPools.push_back(std::move(freePools.back()));
+            freePools.pop_back();
+        }
+        else {
+            PrxDescriptorPool::Builder builder{ prxDevice };
+            builder.setMaxSets(setsPerPool);
+            for (const auto& poolRatio : poolRatios) {
+                uint32_t count = std::max(1u, static_cast<uint32_t>(poolRatio.ratio * setsPerPool));
+                builder.addPoolSize(poolRatio.type, count);
+            }
+            usedPools.push_back(builder.build());
+            stats.poolCount++;
+
+            // needing another pool means the last ones were too small for this workload
+            setsPerPool = std::min(setsPerPool * 2, MAX_SETS_PER_POOL);
+            stats.setsPerPool = setsPerPool;
+        }
+
+        stats.poolsInUse++;
+        stats.highWaterPools = std::max(stats.highWaterPools, stats.poolsInUse);
+        return *usedPools.back();
+    }
+
+    bool PrxDescriptorAllocator::allocate(
+        const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor) {
+        if (currentPool == nullptr) {
+            currentPool = &grabPool();
+        }
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = currentPool->descriptorPool;
+        allocInfo.pSetLayouts = &descriptorSetLayout;
+        allocInfo.descriptorSetCount = 1;
+
+        VkResult result = vkAllocateDescriptorSets(prxDevice.device(), &allocInfo, &descriptor);
+
+        // the pool is full, move on to the next one and try once more
+        if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+            currentPool = &grabPool();
+            allocInfo.descriptorPool = currentPool->descriptorPool;
+            result = vkAllocateDescriptorSets(prxDevice.device(), &allocInfo, &descriptor);
+        }
+
+        if (result != VK_SUCCESS) {
+            return false;
+        }
+
+        stats.setsAllocated++;
+        stats.highWaterSets = std::max(stats.highWaterSets, stats.setsAllocated);
+        return true;
+    }
+
+    void PrxDescriptorAllocator::reset() {
+        // Note: a frame that spilled over into a second pool outgrew them. Those pools are destroyed
+        //  (nothing allocated from them is in use anymore, same as for resetting them) and the next
+        //  pool is sized from this frame's high-water mark so the whole frame fits in it
+        bool outgrown = usedPools.size() > 1;
+        if (outgrown) {
+            stats.poolCount -= static_cast<uint32_t>(usedPools.size());
+            uint32_t seed = initialSetsPerPool;
+            while (seed < stats.setsAllocated && seed < MAX_SETS_PER_POOL) {
+                seed *= 2;
+            }
+            setsPerPool = std::min(seed, MAX_SETS_PER_POOL);
+            stats.setsPerPool = setsPerPool;
+        }
+        else {
+            for (auto& pool : usedPools) {
+                pool->resetPool();
+                freePools.push_back(std::move(pool));
+            }
+        }
+        usedPools.clear();
+        currentPool = nullptr;
+
+        stats.lastFrameSets = stats.setsAllocated;
+        stats.setsAllocated = 0;
+        stats.poolsInUse = 0;
+    }
+
     // *************** Descriptor Writer *********************
 
     PrxDescriptorWriter::PrxDescriptorWriter(PrxDescriptorSetLayout& setLayout, PrxDescriptorPool& pool)
-        : setLayout{ setLayout }, pool{ pool } {}
+        : setLayout{ setLayout }, pool{ &pool } {}
+
+    PrxDescriptorWriter::PrxDescriptorWriter(PrxDescriptorSetLayout& setLayout, PrxDescriptorAllocator& allocator)
+        : setLayout{ setLayout }, allocator{ &allocator } {}
 
     PrxDescriptorWriter& PrxDescriptorWriter::writeBuffer(
         uint32_t binding, VkDescriptorBufferInfo* bufferInfo) {
@@ -181,7 +370,10 @@ namespace prx {
     }
 
     bool PrxDescriptorWriter::build(VkDescriptorSet& set) {
-        bool success = pool.allocateDescriptorSet(setLayout.getDescriptorSetLayout(), set);
+        assert((pool != nullptr || allocator != nullptr) && "Writer was created without a pool to build from");
+        bool success = allocator != nullptr
+            ? allocator->allocate(setLayout.getDescriptorSetLayout(), set)
+            : pool->allocateDescriptorSet(setLayout.getDescriptorSetLayout(), set);
         if (!success) {
             return false;
         }
@@ -193,7 +385,6 @@ namespace prx {
         for (auto& write : writes) {
             write.dstSet = set;
         }
-        vkUpdateDescriptorSets(pool.prxDevice.device(), writes.size(), writes.data(), 0, nullptr);
+        vkUpdateDescriptorSets(setLayout.prxDevice.device(), writes.size(), writes.data(), 0, nullptr);
     }
-
 }
\ No newline at end of file
@@ -11,6 +11,8 @@
 
 namespace prx {
 
+    class PrxDescriptorLayoutCache;
+
     class PrxDescriptorSetLayout {
     public:
         class Builder {
@@ -23,15 +25,24 @@ namespace prx {
                 VkDescriptorType descriptorType,
                 VkShaderStageFlags stageFlags,
                 uint32_t count = 1);
+            // descriptor indexing flags (e.g. PARTIALLY_BOUND) for a binding that was already added
+            Builder& setBindingFlags(uint32_t binding, VkDescriptorBindingFlags flags);
+            Builder& setLayoutFlags(VkDescriptorSetLayoutCreateFlags flags);
             std::unique_ptr<PrxDescriptorSetLayout> build() const;
+            // returns a shared layout from the cache, only creating one if no identical layout exists
+            PrxDescriptorSetLayout& build(PrxDescriptorLayoutCache& cache) const;
 
         private:
             PrxDevice& prxDevice;
             std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+            std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags{};
+            VkDescriptorSetLayoutCreateFlags layoutFlags = 0;
         };
 
         PrxDescriptorSetLayout(
-            PrxDevice& prxDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+            PrxDevice& prxDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+            VkDescriptorSetLayoutCreateFlags layoutFlags = 0,
+            const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags = {});
         ~PrxDescriptorSetLayout();
         PrxDescriptorSetLayout(const PrxDescriptorSetLayout&) = delete;
         PrxDescriptorSetLayout& operator=(const PrxDescriptorSetLayout&) = delete;
@@ -46,6 +57,34 @@ namespace prx {
         friend class PrxDescriptorWriter;
     };
 
+    // Dedupes descriptor set layouts by their bindings, so systems that describe the same
+    // layout end up sharing one VkDescriptorSetLayout (and sets built for it are interchangeable)
+    class PrxDescriptorLayoutCache {
+    public:
+        PrxDescriptorLayoutCache(PrxDevice& prxDevice) : prxDevice{ prxDevice } {}
+        PrxDescriptorLayoutCache(const PrxDescriptorLayoutCache&) = delete;
+        PrxDescriptorLayoutCache& operator=(const PrxDescriptorLayoutCache&) = delete;
+
+        PrxDescriptorSetLayout& getLayout(
+            const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>& bindings);
+
+        size_t size() const { return layouts.size(); }
+
+    private:
+        struct LayoutKey {
+            std::vector<VkDescriptorSetLayoutBinding> bindings; // sorted by binding
+
+            bool operator==(const LayoutKey& other) const;
+        };
+
+        struct LayoutKeyHash {
+            size_t operator()(const LayoutKey& key) const;
+        };
+
+        PrxDevice& prxDevice;
+        std::unordered_map<LayoutKey, std::unique_ptr<PrxDescriptorSetLayout>, LayoutKeyHash> layouts;
+    };
+
     class PrxDescriptorPool {
     public:
         class Builder {
@@ -85,11 +124,72 @@ namespace prx {
         VkDescriptorPool descriptorPool;
 
         friend class PrxDescriptorWriter;
+        friend class PrxDescriptorAllocator;
+    };
+
+    // Hands out descriptor sets from a list of pools that grows on demand.
+    // When the current pool runs out (OUT_OF_POOL_MEMORY / FRAGMENTED_POOL) the next free pool is
+    // grabbed, or a new one is created, so allocation only fails on a real error.
+    // reset() recycles every pool at once (e.g. at the start of a frame). Within a frame each new pool
+    // is twice the size of the previous one up to MAX_SETS_PER_POOL. A frame that needed more than one
+    // pool outgrew them: reset() drops those and seeds the next pool from that frame's set count, so
+    // a steady workload settles on a single pool of the right size.
+    class PrxDescriptorAllocator {
+    public:
+        static constexpr uint32_t DEFAULT_SETS_PER_POOL = 256;
+        static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+        // descriptors of a type reserved per set in each pool
+        struct PoolRatio {
+            VkDescriptorType type;
+            float ratio;
+        };
+
+        struct Stats {
+            uint32_t setsAllocated = 0; // since the last reset
+            uint32_t lastFrameSets = 0; // between the last two resets
+            uint32_t setsPerPool = 0; // size of the next pool that gets created
+            uint32_t poolsInUse = 0; // since the last reset
+            uint32_t poolCount = 0; // in use + recycled
+            uint32_t highWaterSets = 0; // most sets handed out between two resets
+            uint32_t highWaterPools = 0; // most pools needed between two resets
+        };
+
+        PrxDescriptorAllocator(
+            PrxDevice& prxDevice,
+            uint32_t initialSetsPerPool = DEFAULT_SETS_PER_POOL,
+            std::vector<PoolRatio> poolRatios = defaultPoolRatios());
+        PrxDescriptorAllocator(const PrxDescriptorAllocator&) = delete;
+        PrxDescriptorAllocator& operator=(const PrxDescriptorAllocator&) = delete;
+
+        bool allocate(const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor);
+
+        // every set handed out so far becomes invalid
+        void reset();
+
+        const Stats& getStats() const { return stats; }
+
+        static std::vector<PoolRatio> defaultPoolRatios();
+
+    private:
+        PrxDescriptorPool& grabPool();
+
+        PrxDevice& prxDevice;
+        std::vector<PoolRatio> poolRatios;
+        uint32_t initialSetsPerPool;
+        uint32_t setsPerPool; // size of the next pool that gets created
+
+        PrxDescriptorPool* currentPool = nullptr;
+        std::vector<std::unique_ptr<PrxDescriptorPool>> usedPools;
+        std::vector<std::unique_ptr<PrxDescriptorPool>> freePools;
+
+        Stats stats{};
     };
 
     class PrxDescriptorWriter {
     public:
         PrxDescriptorWriter(PrxDescriptorSetLayout& setLayout, PrxDescriptorPool& pool);
+        PrxDescriptorWriter(PrxDescriptorSetLayout& setLayout, PrxDescriptorAllocator& allocator);
 
         PrxDescriptorWriter& writeBuffer(uint32_t binding, VkDescriptorBufferInfo* bufferInfo);
         PrxDescriptorWriter& writeImage(uint32_t binding, VkDescriptorImageInfo* imageInfo);
@@ -99,7 +199,8 @@ namespace prx {
 
     private:
         PrxDescriptorSetLayout& setLayout;
-        PrxDescriptorPool& pool;
+        PrxDescriptorPool* pool = nullptr;
+        PrxDescriptorAllocator* allocator = nullptr;
         std::vector<VkWriteDescriptorSet> writes;
     };
 
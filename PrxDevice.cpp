@@ -1,4 +1,6 @@
 #include "PrxDevice.hpp"
+#include "PrxUploadContext.hpp"
+#include "PrxGeometryArena.hpp"
 
 // std headers
 #include <cstring>
@@ -54,9 +56,16 @@ PrxDevice::PrxDevice(PrxWindow &window) : window{window} {
   pickPhysicalDevice(); // pick which physical device will work with the Vulkan API (should be the graphics card)
   createLogicalDevice(); // pick which features of the physical device to use
   createCommandPool(); // setup command buffer allocation
+  createMemoryAllocator(); // setup sub-allocation of device memory for buffers and images
+  createUploadContext(); // setup batched staging uploads
+  createGeometryArena(); // setup the vertex and index buffers every model shares
 }
 
 PrxDevice::~PrxDevice() {
+  // the upload context waits for its copies first, some of them land in the arena
+  uploadContext.reset();
+  geometryArena.reset();
+  memoryAllocator.reset();
   vkDestroyCommandPool(device_, commandPool, nullptr);
   vkDestroyDevice(device_, nullptr);
 
@@ -79,7 +88,7 @@ void PrxDevice::createInstance() {
   appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
   appInfo.pEngineName = "No Engine";
   appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-  appInfo.apiVersion = VK_API_VERSION_1_0;
+  appInfo.apiVersion = VK_API_VERSION_1_2; // descriptor indexing (bindless textures) is core in 1.2
 
   VkInstanceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -132,6 +141,17 @@ void PrxDevice::pickPhysicalDevice() {
 
   vkGetPhysicalDeviceProperties(physicalDevice, &properties);
   std::cout << "physical device: " << properties.deviceName << std::endl;
+
+  descriptorIndexingProperties = {};
+  descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+  VkPhysicalDeviceProperties2 properties2 = {};
+  properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+  properties2.pNext = &descriptorIndexingProperties;
+  vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+  supportsGpuDrivenRendering = checkGpuDrivenRenderingSupport(physicalDevice);
+  std::cout << "GPU driven rendering: " << (supportsGpuDrivenRendering ? "supported" : "not supported")
+            << std::endl;
 }
 
 void PrxDevice::createLogicalDevice() {
@@ -152,9 +172,25 @@ void PrxDevice::createLogicalDevice() {
 
   VkPhysicalDeviceFeatures deviceFeatures = {};
   deviceFeatures.samplerAnisotropy = VK_TRUE;
+  // draw lists generated on the GPU (see GpuDrivenRenderSystem)
+  deviceFeatures.multiDrawIndirect = supportsGpuDrivenRendering ? VK_TRUE : VK_FALSE;
+  deviceFeatures.drawIndirectFirstInstance = supportsGpuDrivenRendering ? VK_TRUE : VK_FALSE;
+
+  // what the bindless texture table needs: a runtime sized, partially bound sampler array
+  //  that can be written to while it is bound
+  VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+  vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  vulkan12Features.descriptorIndexing = VK_TRUE;
+  vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+  vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+  vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+  vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+  vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+  vulkan12Features.drawIndirectCount = supportsGpuDrivenRendering ? VK_TRUE : VK_FALSE;
 
   VkDeviceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  createInfo.pNext = &vulkan12Features;
 
   createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
@@ -194,6 +230,35 @@ void PrxDevice::createCommandPool() {
   }
 }
 
+void PrxDevice::createMemoryAllocator() {
+  VkPhysicalDeviceMemoryProperties memProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+  PrxMemoryAllocator::MemoryCallbacks callbacks{};
+  callbacks.allocate = [this](uint32_t memoryTypeIndex, VkDeviceSize size, VkDeviceMemory &memory) {
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+    return vkAllocateMemory(device_, &allocInfo, nullptr, &memory);
+  };
+  callbacks.free = [this](VkDeviceMemory memory) { vkFreeMemory(device_, memory, nullptr); };
+  callbacks.map = [this](VkDeviceMemory memory, void **data) {
+    return vkMapMemory(device_, memory, 0, VK_WHOLE_SIZE, 0, data);
+  };
+  callbacks.unmap = [this](VkDeviceMemory memory) { vkUnmapMemory(device_, memory); };
+
+  memoryAllocator = std::make_unique<PrxMemoryAllocator>(
+      memProperties,
+      properties.limits.bufferImageGranularity,
+      properties.limits.nonCoherentAtomSize,
+      std::move(callbacks));
+}
+
+void PrxDevice::createUploadContext() { uploadContext = std::make_unique<PrxUploadContext>(*this); }
+
+void PrxDevice::createGeometryArena() { geometryArena = std::make_unique<PrxGeometryArena>(*this); }
+
 void PrxDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
 
 bool PrxDevice::isDeviceSuitable(VkPhysicalDevice device) {
@@ -211,7 +276,50 @@ bool PrxDevice::isDeviceSuitable(VkPhysicalDevice device) {
   vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
   return indices.isComplete() && extensionsSupported && swapChainAdequate &&
-         supportedFeatures.samplerAnisotropy;
+         supportedFeatures.samplerAnisotropy && supportsDescriptorIndexing(device);
+}
+
+bool PrxDevice::supportsDescriptorIndexing(VkPhysicalDevice device) {
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(device, &deviceProperties);
+  if (deviceProperties.apiVersion < VK_API_VERSION_1_2) {
+    return false;
+  }
+
+  VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+  vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  VkPhysicalDeviceFeatures2 features2 = {};
+  features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features2.pNext = &vulkan12Features;
+  vkGetPhysicalDeviceFeatures2(device, &features2);
+
+  return vulkan12Features.descriptorIndexing && vulkan12Features.runtimeDescriptorArray &&
+         vulkan12Features.descriptorBindingPartiallyBound &&
+         vulkan12Features.descriptorBindingSampledImageUpdateAfterBind &&
+         vulkan12Features.descriptorBindingUpdateUnusedWhilePending &&
+         vulkan12Features.shaderSampledImageArrayNonUniformIndexing;
+}
+
+bool PrxDevice::checkGpuDrivenRenderingSupport(VkPhysicalDevice device) {
+  // the cull dispatch is recorded into the same command buffer as the draws
+  QueueFamilyIndices indices = findQueueFamilies(device);
+  uint32_t queueFamilyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+  if (!(queueFamilies[indices.graphicsFamily].queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+    return false;
+  }
+
+  VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+  vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  VkPhysicalDeviceFeatures2 features2 = {};
+  features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features2.pNext = &vulkan12Features;
+  vkGetPhysicalDeviceFeatures2(device, &features2);
+
+  return vulkan12Features.drawIndirectCount && features2.features.multiDrawIndirect &&
+         features2.features.drawIndirectFirstInstance;
 }
 
 void PrxDevice::populateDebugMessengerCreateInfo(
@@ -409,7 +517,7 @@ void PrxDevice::createBuffer(
     VkBufferUsageFlags usage,
     VkMemoryPropertyFlags properties,
     VkBuffer &buffer,
-    VkDeviceMemory &bufferMemory) {
+    PrxAllocation &bufferAllocation) {
   VkBufferCreateInfo bufferInfo{};
   bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   bufferInfo.size = size;
@@ -423,16 +531,13 @@ void PrxDevice::createBuffer(
   VkMemoryRequirements memRequirements;
   vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+  bufferAllocation =
+      memoryAllocator->allocate(memRequirements, properties, PrxAllocationKind::Linear);
 
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate vertex buffer memory!");
+  if (vkBindBufferMemory(device_, buffer, bufferAllocation.memory, bufferAllocation.offset) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to bind vertex buffer memory!");
   }
-
-  vkBindBufferMemory(device_, buffer, bufferMemory, 0);
 }
 
 VkCommandBuffer PrxDevice::beginSingleTimeCommands() {
@@ -510,7 +615,7 @@ void PrxDevice::createImageWithInfo(
     const VkImageCreateInfo &imageInfo,
     VkMemoryPropertyFlags properties,
     VkImage &image,
-    VkDeviceMemory &imageMemory) {
+    PrxAllocation &imageAllocation) {
   if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
     throw std::runtime_error("failed to create image!");
   }
@@ -518,20 +623,19 @@ void PrxDevice::createImageWithInfo(
   VkMemoryRequirements memRequirements;
   vkGetImageMemoryRequirements(device_, image, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+  PrxAllocationKind kind = imageInfo.tiling == VK_IMAGE_TILING_OPTIMAL
+      ? PrxAllocationKind::Optimal
+      : PrxAllocationKind::Linear;
+  imageAllocation = memoryAllocator->allocate(memRequirements, properties, kind);
 
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate image memory!");
-  }
-
-  if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) {
+  if (vkBindImageMemory(device_, image, imageAllocation.memory, imageAllocation.offset) !=
+      VK_SUCCESS) {
     throw std::runtime_error("failed to bind image memory!");
   }
 }
 
+void PrxDevice::freeAllocation(PrxAllocation &allocation) { memoryAllocator->free(allocation); }
+
 void PrxDevice::transitionImageLayout(
     VkImage image,
     VkFormat format,
@@ -1,13 +1,18 @@
 #pragma once
 
 #include "PrxWindow.hpp"
+#include "PrxMemoryAllocator.hpp"
 
 // std lib headers
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace prx {
 
+class PrxUploadContext;
+class PrxGeometryArena;
+
 struct SwapChainSupportDetails {
   VkSurfaceCapabilitiesKHR capabilities;
   std::vector<VkSurfaceFormatKHR> formats;
@@ -46,6 +51,9 @@ class PrxDevice {
   VkSurfaceKHR surface() { return surface_; }
   VkQueue graphicsQueue() { return graphicsQueue_; }
   VkQueue presentQueue() { return presentQueue_; }
+  PrxMemoryAllocator &getMemoryAllocator() { return *memoryAllocator; }
+  PrxUploadContext &getUploadContext() { return *uploadContext; }
+  PrxGeometryArena &getGeometryArena() { return *geometryArena; }
 
 
   SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
@@ -60,7 +68,9 @@ class PrxDevice {
       VkBufferUsageFlags usage,
       VkMemoryPropertyFlags properties,
       VkBuffer &buffer,
-      VkDeviceMemory &bufferMemory);
+      PrxAllocation &bufferAllocation);
+  // Note: these submit and wait on the spot. Prefer getUploadContext() for
+  //  anything that happens more than once (model and texture loading)
   VkCommandBuffer beginSingleTimeCommands();
   void endSingleTimeCommands(VkCommandBuffer commandBuffer);
   void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -71,7 +81,11 @@ class PrxDevice {
       const VkImageCreateInfo &imageInfo,
       VkMemoryPropertyFlags properties,
       VkImage &image,
-      VkDeviceMemory &imageMemory);
+      PrxAllocation &imageAllocation);
+
+  // returns memory handed out by createBuffer/createImageWithInfo to the allocator.
+  //  Destroy the buffer or image that was bound to it first.
+  void freeAllocation(PrxAllocation &allocation);
 
   void transitionImageLayout(
       VkImage image,
@@ -82,6 +96,11 @@ class PrxDevice {
       uint32_t layerCount = 1);
 
   VkPhysicalDeviceProperties properties;
+  VkPhysicalDeviceDescriptorIndexingProperties descriptorIndexingProperties;
+
+  // optional: compute culling on the graphics queue + vkCmdDrawIndexedIndirectCount
+  //  (drawIndirectCount, multiDrawIndirect and drawIndirectFirstInstance are enabled when this is true)
+  bool supportsGpuDrivenRendering = false;
 
  private:
   void createInstance();
@@ -90,9 +109,14 @@ class PrxDevice {
   void pickPhysicalDevice();
   void createLogicalDevice();
   void createCommandPool();
+  void createMemoryAllocator();
+  void createUploadContext();
+  void createGeometryArena();
 
   // helper functions
   bool isDeviceSuitable(VkPhysicalDevice device);
+  bool supportsDescriptorIndexing(VkPhysicalDevice device);
+  bool checkGpuDrivenRenderingSupport(VkPhysicalDevice device);
   std::vector<const char *> getRequiredExtensions();
   bool checkValidationLayerSupport();
   QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
@@ -112,6 +136,10 @@ class PrxDevice {
   VkQueue graphicsQueue_;
   VkQueue presentQueue_;
 
+  std::unique_ptr<PrxMemoryAllocator> memoryAllocator;
+  std::unique_ptr<PrxUploadContext> uploadContext;
+  std::unique_ptr<PrxGeometryArena> geometryArena;
+
   const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
   const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 };
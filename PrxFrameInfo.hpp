@@ -32,7 +32,7 @@ namespace prx {
 		VkCommandBuffer commandBuffer;
 		PrxCamera& camera;
 		VkDescriptorSet globalDescriptorSet;
-		PrxDescriptorPool& frameDescriptorPool; // pool of descriptors that is cleared each frame
-		PrxGameObject::Map& gameObjects;
+		PrxDescriptorAllocator& frameDescriptorAllocator; // descriptors allocated here are recycled each frame
+		PrxGameObjectManager& gameObjectManager;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include "PrxFrustum.hpp"
+
+namespace prx {
+
+	PrxFrustum PrxFrustum::fromMatrix(const glm::mat4& projectionView) {
+		// glm is column major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+		auto row = [&](int i) {
+			return glm::vec4{ projectionView[0][i], projectionView[1][i], projectionView[2][i], projectionView[3][i] };
+		};
+		glm::vec4 row0 = row(0);
+		glm::vec4 row1 = row(1);
+		glm::vec4 row2 = row(2);
+		glm::vec4 row3 = row(3);
+
+		PrxFrustum frustum{};
+		frustum.planes[PLANE_LEFT] = row3 + row0;
+		frustum.planes[PLANE_RIGHT] = row3 - row0;
+		frustum.planes[PLANE_BOTTOM] = row3 + row1;
+		frustum.planes[PLANE_TOP] = row3 - row1;
+		frustum.planes[PLANE_NEAR] = row2; // depth is 0..w instead of -w..w
+		frustum.planes[PLANE_FAR] = row3 - row2;
+
+		// normalize, so plane distances are real distances and can be compared to a radius
+		for (glm::vec4& plane : frustum.planes) {
+			plane /= glm::length(glm::vec3(plane));
+		}
+		return frustum;
+	}
+
+	bool PrxFrustum::intersectsSphere(const glm::vec3& center, float radius) const {
+		for (const glm::vec4& plane : planes) {
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool PrxFrustum::intersectsAabb(const glm::vec3& min, const glm::vec3& max) const {
+		for (const glm::vec4& plane : planes) {
+			glm::vec3 positive{
+				plane.x >= 0.f ? max.x : min.x,
+				plane.y >= 0.f ? max.y : min.y,
+				plane.z >= 0.f ? max.z : min.z };
+			if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.f) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	PrxFrustum::Containment PrxFrustum::classifyAabb(const glm::vec3& min, const glm::vec3& max) const {
+		Containment result = CONTAINMENT_INSIDE;
+		for (const glm::vec4& plane : planes) {
+			// the corners furthest along and furthest against the normal
+			glm::vec3 positive{
+				plane.x >= 0.f ? max.x : min.x,
+				plane.y >= 0.f ? max.y : min.y,
+				plane.z >= 0.f ? max.z : min.z };
+			glm::vec3 negative{
+				plane.x >= 0.f ? min.x : max.x,
+				plane.y >= 0.f ? min.y : max.y,
+				plane.z >= 0.f ? min.z : max.z };
+			if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.f) {
+				return CONTAINMENT_OUTSIDE;
+			}
+			if (glm::dot(glm::vec3(plane), negative) + plane.w < 0.f) {
+				result = CONTAINMENT_INTERSECTING;
+			}
+		}
+		return result;
+	}
+}
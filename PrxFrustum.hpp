@@ -0,0 +1,32 @@
+#pragma once
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm.hpp"
+
+namespace prx {
+
+	// The six planes of a view frustum, each as (normal, distance) with the normal facing inwards,
+	//	so a point p is inside a plane when dot(normal, p) + distance >= 0.
+	//	Note: cull.comp does the same sphere test, keep both in sync
+	struct PrxFrustum {
+		// Note: not NEAR/FAR, windows.h defines those as macros
+		enum Plane { PLANE_LEFT = 0, PLANE_RIGHT, PLANE_BOTTOM, PLANE_TOP, PLANE_NEAR, PLANE_FAR, PLANE_COUNT };
+
+		enum Containment { CONTAINMENT_OUTSIDE = 0, CONTAINMENT_INTERSECTING, CONTAINMENT_INSIDE };
+
+		glm::vec4 planes[PLANE_COUNT]{};
+
+		// Gribb/Hartmann plane extraction from projection * view, for a [0, 1] depth range
+		//	(GLM_FORCE_DEPTH_ZERO_TO_ONE). Planes come out in world space.
+		static PrxFrustum fromMatrix(const glm::mat4& projectionView);
+
+		bool intersectsSphere(const glm::vec3& center, float radius) const;
+		// world space box; tests the corner furthest along each plane's normal
+		bool intersectsAabb(const glm::vec3& min, const glm::vec3& max) const;
+		// like intersectsAabb, but also tells apart boxes that are entirely inside, whose contents
+		//	need no further tests (e.g. a whole subtree of the scene tree)
+		Containment classifyAabb(const glm::vec3& min, const glm::vec3& max) const;
+	};
+}
@@ -1,7 +1,8 @@
 #include "PrxGameObject.hpp"
+#include "PrxTransformBatch.hpp"
 
 // std
-#include <numeric>
+#include <algorithm>
 
 namespace prx {
 	glm::mat4 TransformComponent::mat4() {
@@ -65,54 +66,225 @@ namespace prx {
 	}
 
 
-	PrxGameObject& PrxGameObjectManager::makePointLight(float intensity,
+	PrxGameObjectManager::PrxGameObjectManager(PrxDevice& device) : prxDevice{ device } {
+		for (int i = 0; i < objectBuffers.size(); i++) {
+			reserveBuffer(i, INITIAL_BUFFER_CAPACITY);
+		}
+	}
+
+	PrxGameObject PrxGameObjectManager::createGameObject() {
+		assert(registry.getEntityCount() < MAX_GAME_OBJECTS && "Max game object count exceeded");
+		PrxGameObject gameObj{ registry.create(), *this };
+		gameObj.addComponent<TransformComponent>();
+		markTransformDirty(gameObj.getId());
+		return gameObj;
+	}
+
+	PrxGameObject PrxGameObjectManager::makePointLight(float intensity,
 		float radius, glm::vec3 color) {
-		auto& gameObj = createGameObject();
-		gameObj.color = color;
-		gameObj.transform.scale.x = radius;
-		gameObj.pointLight = std::make_unique<PointLightComponent>();
-		gameObj.pointLight->lightIntensity = intensity;
+		auto gameObj = createGameObject();
+		gameObj.transform().scale.x = radius;
+		auto& pointLight = gameObj.addComponent<PointLightComponent>();
+		pointLight.lightIntensity = intensity;
+		pointLight.color = color;
 
 		return gameObj;
 	}
 
-	PrxGameObjectManager::PrxGameObjectManager(PrxDevice& device) {
-		
-		// setup memory alignment
-		// including nonCoherentAtomSize enables flushing a specific index at once
-		int alignment = std::lcm(
-			device.properties.limits.nonCoherentAtomSize,
-			device.properties.limits.minUniformBufferOffsetAlignment
-		);
+	void PrxGameObjectManager::destroyGameObject(PrxGameObject::id_t id) {
+		// the index may be handed out again before the next update, so the proxy can't wait for it
+		uint32_t index = getBufferIndex(id);
+		if (index < treeProxies.size() && treeProxies[index] != PrxAabbTree::NULL_NODE) {
+			sceneTree.destroyProxy(treeProxies[index]);
+			treeProxies[index] = PrxAabbTree::NULL_NODE;
+		}
+		registry.destroy(id);
+	}
 
-		// setup UBOs
-		// Note: find where the hell you put the UBOs and change it to here
-		for (int i = 0; i < uboBuffers.size(); i++) {
-			uboBuffers[i] = std::make_unique<PrxBuffer>(
-				device,
-				sizeof(GameObjectBufferData),
-				PrxGameObjectManager::MAX_GAME_OBJECTS,
-				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, // setup for usage as a uniform buffer
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, 
-				alignment);
-			uboBuffers[i]->map(); // map the UBO to memory
+	void PrxGameObjectManager::markTransformDirty(PrxGameObject::id_t id) {
+		uint32_t index = getBufferIndex(id);
+		if (index >= dirtyFrames.size()) {
+			dirtyFrames.resize(index + 1, 0);
+		}
+		if (dirtyFrames[index] == 0) {
+			dirtyIndices.push_back(index);
 		}
+		dirtyFrames[index] = ALL_FRAMES_DIRTY | NEEDS_COMPUTE;
+	}
+
+	bool PrxGameObjectManager::reserveBuffer(int frameIndex, uint32_t objectCount) {
+		auto& buffer = objectBuffers[frameIndex];
+		if (buffer != nullptr && buffer->getInstanceCount() >= objectCount) return false;
+
+		// grow geometrically so spawning objects one at a time doesn't reallocate every frame
+		uint32_t capacity = buffer != nullptr ? buffer->getInstanceCount() : 0;
+		capacity = std::max(objectCount, capacity * 2);
+		capacity = std::min(capacity, MAX_GAME_OBJECTS);
+
+		// Note: this is only called for the frame that is being recorded, whose previous
+		//	submission has already finished, so the old buffer can go right away
+		buffer = std::make_unique<PrxBuffer>(
+			prxDevice,
+			sizeof(GameObjectBufferData),
+			capacity,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, // packed array indexed in the shader, instead of one UBO range per object
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+		buffer->map();
+		return true;
 	}
 
 	void PrxGameObjectManager::updateBuffer(int frameIndex) {
-		// copy model and normal matrices for each game object into the buffer for this frame
-		for (auto& kv : gameObjects) {
-			auto& obj = kv.second;
-			GameObjectBufferData data{};
-			data.modelMatrix = obj.transform.mat4();
-			data.normalMatrix = obj.transform.normalMatrix();
-			uboBuffers[frameIndex]->writeToIndex(&data, kv.first);
+		computeChangedTransforms();
+		updateSceneTree();
+		if (reserveBuffer(frameIndex, registry.getEntityCapacity())) {
+			copyAllObjects(frameIndex);
+		}
+		else {
+			copyDirtyObjects(frameIndex);
+		}
+	}
+
+	void PrxGameObjectManager::computeChangedTransforms() {
+		if (objectData.size() < registry.getEntityCapacity()) {
+			objectData.resize(registry.getEntityCapacity());
+		}
+
+		auto& transformPool = registry.getPool<TransformComponent>();
+		dirtySlots.clear();
+		for (uint32_t index : dirtyIndices) {
+			if (dirtyFrames[index] & NEEDS_COMPUTE) {
+				dirtyFrames[index] &= ~NEEDS_COMPUTE;
+				// destroyed objects don't need their slot recomputed
+				if (transformPool.contains(index)) {
+					dirtySlots.push_back(index);
+				}
+			}
+		}
+		if (dirtySlots.empty()) return;
+
+		// gather into a packed array so the batch kernel can run on it.
+		//	Note: the slot index works as an entity here, since the kernel only looks at the index bits
+		dirtyTransforms.clear();
+		for (uint32_t index : dirtySlots) {
+			dirtyTransforms.push_back(transformPool.get(index));
+		}
+		computeTransformBatch(dirtyTransforms.data(), dirtySlots.data(), dirtySlots.size(), objectData.data());
+	}
+
+	void PrxGameObjectManager::copyAllObjects(int frameIndex) {
+		auto& buffer = *objectBuffers[frameIndex];
+		buffer.writeToBuffer(objectData.data(), objectData.size() * sizeof(GameObjectBufferData));
+		buffer.flush();
+
+		// this frame is up to date now, the other frames still need whatever was dirty
+		const uint8_t frameBit = static_cast<uint8_t>(1u << frameIndex);
+		for (uint32_t index : dirtyIndices) {
+			dirtyFrames[index] &= ~frameBit;
+		}
+		pruneDirtyIndices();
+	}
+
+	void PrxGameObjectManager::copyDirtyObjects(int frameIndex) {
+		if (dirtyIndices.empty()) return;
+
+		// pull out the slots that are stale in this frame's copy
+		const uint8_t frameBit = static_cast<uint8_t>(1u << frameIndex);
+		dirtySlots.clear();
+		for (uint32_t index : dirtyIndices) {
+			if (dirtyFrames[index] & frameBit) {
+				dirtyFrames[index] &= ~frameBit;
+				dirtySlots.push_back(index);
+			}
+		}
+		pruneDirtyIndices();
+		if (dirtySlots.empty()) return;
+
+		// sorted slots turn into few, contiguous ranges (and sequential writes)
+		std::sort(dirtySlots.begin(), dirtySlots.end());
+
+		// coalesce runs of dirty slots. objectData is current everywhere, so the clean slots
+		//	inside a merged gap can just be copied along
+		const VkDeviceSize objectSize = sizeof(GameObjectBufferData);
+		flushRanges.clear();
+		uint32_t runBegin = dirtySlots[0];
+		uint32_t runEnd = dirtySlots[0] + 1;
+		for (size_t i = 1; i < dirtySlots.size(); i++) {
+			if (dirtySlots[i] > runEnd + FLUSH_MERGE_GAP) {
+				flushRanges.push_back({ runBegin * objectSize, (runEnd - runBegin) * objectSize });
+				runBegin = dirtySlots[i];
+			}
+			runEnd = dirtySlots[i] + 1;
+		}
+		flushRanges.push_back({ runBegin * objectSize, (runEnd - runBegin) * objectSize });
+
+		auto& buffer = *objectBuffers[frameIndex];
+		for (const auto& range : flushRanges) {
+			buffer.writeToBuffer(
+				reinterpret_cast<char*>(objectData.data()) + range.offset, range.size, range.offset);
+		}
+		buffer.flushRanges(flushRanges);
+	}
+
+	void PrxGameObjectManager::pruneDirtyIndices() {
+		size_t kept = 0;
+		for (uint32_t index : dirtyIndices) {
+			if (dirtyFrames[index] != 0) {
+				dirtyIndices[kept++] = index;
+			}
+		}
+		dirtyIndices.resize(kept);
+	}
+
+	void PrxGameObjectManager::updateSceneTree() {
+		auto& modelPool = registry.getPool<ModelComponent>();
+		if (treeProxies.size() < registry.getEntityCapacity()) {
+			treeProxies.resize(registry.getEntityCapacity(), PrxAabbTree::NULL_NODE);
+		}
+
+		// only when models were added or removed somewhere
+		if (modelPool.getVersion() != modelPoolVersion) {
+			modelPoolVersion = modelPool.getVersion();
+
+			for (uint32_t index = 0; index < treeProxies.size(); index++) {
+				if (treeProxies[index] != PrxAabbTree::NULL_NODE && !modelPool.contains(index)) {
+					sceneTree.destroyProxy(treeProxies[index]);
+					treeProxies[index] = PrxAabbTree::NULL_NODE;
+				}
+			}
+			for (PrxEntity entity : modelPool.entities()) {
+				uint32_t index = getBufferIndex(entity);
+				if (treeProxies[index] == PrxAabbTree::NULL_NODE && modelPool.get(index).model != nullptr) {
+					treeProxies[index] = sceneTree.createProxy(computeWorldBounds(index), entity);
+					updatePositionDecode(index);
+				}
+			}
+		}
+
+		// dirtySlots still holds the transforms that were just recomputed.
+		//	Note: most moves stay inside the fat box and don't touch the tree
+		for (uint32_t index : dirtySlots) {
+			if (treeProxies[index] != PrxAabbTree::NULL_NODE) {
+				sceneTree.moveProxy(treeProxies[index], computeWorldBounds(index));
+				updatePositionDecode(index); // in case the model was swapped in place
+			}
 		}
-		uboBuffers[frameIndex]->flush();
 	}
 
-	VkDescriptorBufferInfo PrxGameObject::getBufferInfo(int frameIndex) {
-		return gameObjectManager.getBufferInfoForGameObject(frameIndex, id);
+	void PrxGameObjectManager::updatePositionDecode(uint32_t index) {
+		objectData[index].positionDecode = registry.getPool<ModelComponent>().get(index).model->getPositionDecode();
+
+		// Note: the model can arrive long after the transform was last written
+		if (index >= dirtyFrames.size()) {
+			dirtyFrames.resize(index + 1, 0);
+		}
+		if (dirtyFrames[index] == 0) {
+			dirtyIndices.push_back(index);
+		}
+		dirtyFrames[index] |= ALL_FRAMES_DIRTY;
 	}
 
+	PrxAabb PrxGameObjectManager::computeWorldBounds(uint32_t index) {
+		const PrxModel::Bounds& bounds = registry.getPool<ModelComponent>().get(index).model->getBounds();
+		return PrxAabb{ bounds.min, bounds.max }.transformed(objectData[index].modelMatrix);
+	}
 }
@@ -2,13 +2,16 @@
 
 #include "PrxModel.hpp"
 #include "PrxTexture.hpp"
+#include "PrxRegistry.hpp"
+#include "PrxSwapChain.hpp"
+#include "PrxAabbTree.hpp"
 
 //lib
 #include <glm/gtc/matrix_transform.hpp>
 
 //std
 #include <memory>
-#include <unordered_map>
+#include <vector>
 
 namespace prx {
 
@@ -23,17 +26,41 @@ namespace prx {
 		//	https://en.wikipedia.org/wiki/Euler_angles#Rotation_matrix
 		//	
 		//	Returns the object's mat4 in the shared world space
+		//	Note: for many objects at once, use computeTransformBatch (PrxTransformBatch.hpp)
 		glm::mat4 mat4();
 		glm::mat3 normalMatrix();
 	};
 
 	struct PointLightComponent {
 		float lightIntensity = 1.f;
+		glm::vec3 color{ 1.f };
 	};
 
+	// Note: model and texture components hold shared handles, so an asset stays alive while
+	//	any game object still uses it
+	struct ModelComponent {
+		std::shared_ptr<PrxModel> model{};
+	};
+
+	struct DiffuseMapComponent {
+		std::shared_ptr<PrxTexture> texture{};
+	};
+
+	// One material per material of the object's model, indexed like its meshes' matIntex, so
+	//	every triangle gets its own mesh's material. Null (or missing) entries fall back to the
+	//	model's own material parameters.
+	//	Note: only read by the CPU path tracer (PrxPathTracer) so far, the raster path shades with
+	//	vertex colors and the diffuse map
+	struct MaterialComponent {
+		std::vector<std::shared_ptr<PrxMaterial>> materials{};
+	};
+
+	// per-object data read by the shaders, indexed by the game object's entity index
 	struct GameObjectBufferData {
 		glm::mat4 modelMatrix{1.f};
 		glm::mat4 normalMatrix{1.f};
+		// the model's, so quantized vertex positions come back in model space before modelMatrix
+		PrxVertexLayout::PositionDecode positionDecode{};
 	};
 
 	struct RenderSettings {
@@ -42,46 +69,49 @@ namespace prx {
 
 	class PrxGameObjectManager; // forward declaration for proper compatibility with PrxGameObject
 
+	// Lightweight handle to an entity in the manager's registry. The components themselves live
+	//	packed per type in the registry, so copying a PrxGameObject only copies the id.
 	class PrxGameObject
 	{
 	public:
-		// Note: this method of entity component systems is inefficient.
-		//	Look at https://austinmorlan.com/posts/entity_component_system/ for a better system
-		using id_t = unsigned int;
-		using Map = std::unordered_map<id_t, PrxGameObject>;
-
-		// No copying - avoid dupicate game objects
-		PrxGameObject(const PrxGameObject&) = delete;
-		PrxGameObject& operator=(const PrxGameObject&) = delete;
-		PrxGameObject& operator=(PrxGameObject&&) = delete;
-
-		// make move function and assign operator to use the default
-		PrxGameObject(PrxGameObject&&) = default;
-
-		id_t getId() { return id; }
-
-		VkDescriptorBufferInfo getBufferInfo(int frameIndex);
-
-		glm::vec3 color{};
-		TransformComponent transform{};
-
-		// Optional pointer components
-		std::shared_ptr<PrxModel> model{};
-		std::shared_ptr<PrxTexture> diffuseMap = nullptr;
-		std::unique_ptr<PointLightComponent> pointLight = nullptr;
+		using id_t = PrxEntity;
+
+		id_t getId() const { return id; }
+		bool isValid() const;
+
+		// every game object has a transform
+		// Note: this marks the transform dirty, so the object buffer rewrites it. Use getTransform()
+		//	when only reading it
+		TransformComponent& transform();
+		const TransformComponent& getTransform() const;
+
+		template<typename T, typename... Args>
+		T& addComponent(Args&&... args);
+		template<typename T>
+		T& getComponent();
+		template<typename T>
+		T* tryGetComponent();
+		template<typename T>
+		bool hasComponent();
+		template<typename T>
+		void removeComponent();
 
 	private:
-		PrxGameObject(id_t objId, const PrxGameObjectManager& manager) : id{ objId }, gameObjectManager{ manager } {}
+		PrxGameObject(id_t objId, PrxGameObjectManager& manager) : id{ objId }, manager{ &manager } {}
 
-		id_t id;
-		const PrxGameObjectManager& gameObjectManager;
+		id_t id = PrxRegistry::NULL_ENTITY;
+		PrxGameObjectManager* manager = nullptr;
 
 		friend class PrxGameObjectManager;
 	};
 
 	class PrxGameObjectManager {
 	public:
-		static constexpr int MAX_GAME_OBJECTS = 1000;
+		// Note: the per-frame object buffers grow with the number of game objects, this is only the cap
+		static constexpr uint32_t MAX_GAME_OBJECTS = 1'000'000;
+		static constexpr uint32_t INITIAL_BUFFER_CAPACITY = 1024;
+		static_assert(MAX_GAME_OBJECTS <= PrxRegistry::MAX_ENTITIES, "Registry ids can't address that many game objects");
+		static_assert(PrxSwapChain::MAX_FRAMES_IN_FLIGHT <= 7, "Dirty flags keep one bit per frame in flight, plus one");
 
 		PrxGameObjectManager(PrxDevice& device);
 		
@@ -91,32 +121,112 @@ namespace prx {
 		PrxGameObjectManager(PrxGameObjectManager&&) = delete;
 		PrxGameObjectManager &operator=(PrxGameObjectManager&&) = delete;
 
-		PrxGameObject &createGameObject() {
-			assert(currentID < MAX_GAME_OBJECTS && "Max game object count exceeded");
-			auto gameObj = PrxGameObject{ currentID++, *this };
-			auto gameObjId = gameObj.getId();
-			gameObj.diffuseMap = textureDefault;
-			gameObjects.emplace(gameObjId, std::move(gameObj));
-			return gameObjects.at(gameObjId);
-		}
-		
-		PrxGameObject& makePointLight(
+		PrxGameObject createGameObject();
+		PrxGameObject makePointLight(
 			float intensity = 10.f, float radius = 1.0f, glm::vec3 color = glm::vec3{ 1.f });
 
-		VkDescriptorBufferInfo getBufferInfoForGameObject(int frameIndex, PrxGameObject::id_t gameObjId) const {
-			return uboBuffers[frameIndex]->descriptorInfoForIndex(gameObjId);
-		};
+		// the id is recycled, and any handle still holding it becomes invalid
+		void destroyGameObject(PrxGameObject::id_t id);
+		PrxGameObject getGameObject(PrxGameObject::id_t id) { return PrxGameObject{ id, *this }; }
 
+		// Flags the object's slot as stale in every frame's object buffer.
+		//	PrxGameObject::transform() does this already, only code that changes a TransformComponent
+		//	straight through the registry (e.g. a view) has to call it.
+		void markTransformDirty(PrxGameObject::id_t id);
+
+		// Recomputes the matrices of transforms that changed, then copies whatever this frame's buffer
+		//	hasn't seen yet into it and flushes only those ranges. A scene where nothing moves costs
+		//	(almost) nothing here. Grows the buffer if needed, which rewrites everything for this frame.
 		void updateBuffer(int frameIndex);
 
-		
-		PrxGameObject::Map gameObjects{};
-		std::vector<std::unique_ptr<PrxBuffer>> uboBuffers{PrxSwapChain::MAX_FRAMES_IN_FLIGHT};
+		// CPU copy of the object buffer, indexed like it (see getBufferIndex). Up to date after updateBuffer,
+		//	and unlike the mapped buffer it is cheap to read (e.g. for culling)
+		const GameObjectBufferData& getObjectData(PrxGameObject::id_t id) const { return objectData[getBufferIndex(id)]; }
+		const std::vector<GameObjectBufferData>& getObjectData() const { return objectData; }
 
-	private:
-		PrxGameObject::id_t currentID = 0;
-		std::shared_ptr<PrxTexture> textureDefault;
+		// World boxes of every object with a model, for culling and picking without scanning every
+		//	object. Proxies carry the entity as user data. Kept up to date by updateBuffer, along with
+		//	each object's positionDecode.
+		//	Note: swapping the model of an existing ModelComponent in place needs a markTransformDirty
+		const PrxAabbTree& getSceneTree() const { return sceneTree; }
+
+		// whole object buffer for this frame; shaders index it with the entity index
+		VkDescriptorBufferInfo getBufferInfo(int frameIndex) const {
+			return objectBuffers[frameIndex]->descriptorInfo();
+		}
+		static uint32_t getBufferIndex(PrxGameObject::id_t id) { return PrxRegistry::getIndex(id); }
+
+		PrxRegistry registry{};
 
+	private:
+		static constexpr uint8_t ALL_FRAMES_DIRTY = (1u << PrxSwapChain::MAX_FRAMES_IN_FLIGHT) - 1;
+		static constexpr uint8_t NEEDS_COMPUTE = 1u << 7; // objectData itself is stale
+		// dirty slots closer than this are flushed as one range, fewer ranges beats flushing a few extra bytes
+		static constexpr uint32_t FLUSH_MERGE_GAP = 4;
+
+		// returns true if the buffer was (re)created, so its contents are garbage
+		bool reserveBuffer(int frameIndex, uint32_t objectCount);
+		// objectData for every transform marked since the last update
+		void computeChangedTransforms();
+		void copyAllObjects(int frameIndex);
+		void copyDirtyObjects(int frameIndex);
+		// drops indices that are clean in every frame from dirtyIndices
+		void pruneDirtyIndices();
+		// adds and removes proxies for objects that gained or lost a model, and moves the proxies
+		//	of the transforms computeChangedTransforms just recomputed
+		void updateSceneTree();
+		PrxAabb computeWorldBounds(uint32_t index);
+		// copies the model's position decode into objectData, and flags the slot for every frame
+		void updatePositionDecode(uint32_t index);
+
+		PrxDevice& prxDevice;
+		std::vector<std::unique_ptr<PrxBuffer>> objectBuffers{PrxSwapChain::MAX_FRAMES_IN_FLIGHT};
+
+		// matrices are computed once into here, and copied into each frame's buffer from here
+		std::vector<GameObjectBufferData> objectData;
+
+		// entity index -> one bit per frame whose buffer still holds an old transform, plus NEEDS_COMPUTE
+		std::vector<uint8_t> dirtyFrames;
+		// every index with any dirty bit, so updates never scan clean objects
+		std::vector<uint32_t> dirtyIndices;
+
+		PrxAabbTree sceneTree{};
+		std::vector<int32_t> treeProxies; // entity index -> proxy in sceneTree, or NULL_NODE
+		uint64_t modelPoolVersion = UINT64_MAX;
+
+		// scratch space for updateBuffer, kept around to avoid reallocating every frame
+		std::vector<TransformComponent> dirtyTransforms;
+		std::vector<PrxEntity> dirtySlots;
+		std::vector<PrxBuffer::Range> flushRanges;
 	};
-}
 
+	inline bool PrxGameObject::isValid() const {
+		return manager != nullptr && manager->registry.isAlive(id);
+	}
+
+	inline TransformComponent& PrxGameObject::transform() {
+		manager->markTransformDirty(id);
+		return manager->registry.get<TransformComponent>(id);
+	}
+
+	inline const TransformComponent& PrxGameObject::getTransform() const {
+		return manager->registry.get<TransformComponent>(id);
+	}
+
+	template<typename T, typename... Args>
+	T& PrxGameObject::addComponent(Args&&... args) {
+		return manager->registry.add<T>(id, std::forward<Args>(args)...);
+	}
+
+	template<typename T>
+	T& PrxGameObject::getComponent() { return manager->registry.get<T>(id); }
+
+	template<typename T>
+	T* PrxGameObject::tryGetComponent() { return manager->registry.tryGet<T>(id); }
+
+	template<typename T>
+	bool PrxGameObject::hasComponent() { return manager->registry.has<T>(id); }
+
+	template<typename T>
+	void PrxGameObject::removeComponent() { manager->registry.remove<T>(id); }
+}
@@ -0,0 +1,181 @@
+#include "PrxGeometryArena.hpp"
+#include "PrxModel.hpp"
+#include "PrxUploadContext.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+
+namespace prx {
+
+	PrxGeometryArena::PrxGeometryArena(PrxDevice& device, const PrxVertexLayout& layout, uint32_t vertexCapacity, uint32_t indexCapacity)
+		: prxDevice{ device }, layout{ layout }, vertexRanges{ vertexCapacity, 1 }, indexRanges{ indexCapacity, 1 } {
+		// storage too, so compute passes can read the geometry in place
+		vertexBuffer = std::make_unique<PrxBuffer>(
+			prxDevice,
+			layout.getStreamStride(0),
+			vertexCapacity,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+		);
+
+		if (layout.splitPositions) {
+			attributeBuffer = std::make_unique<PrxBuffer>(
+				prxDevice,
+				layout.getStreamStride(1),
+				vertexCapacity,
+				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+			);
+		}
+
+		indexBuffer = std::make_unique<PrxBuffer>(
+			prxDevice,
+			sizeof(uint16_t), // ranges of uint32_t indices take two
+			indexCapacity,
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+		);
+	}
+
+	PrxGeometryArena::Range PrxGeometryArena::allocateVertices(const void* vertices, uint32_t vertexCount,
+		const PrxVertexLayout::PositionDecode& decode) {
+		assert(vertexCount > 0 && "Allocating an empty vertex range");
+
+		VkDeviceSize first;
+		if (!vertexRanges.allocate(vertexCount, 1, PrxAllocationKind::Linear, first)) {
+			throw std::runtime_error("geometry arena is out of vertex space!");
+		}
+
+		Range range{ static_cast<uint32_t>(first), vertexCount };
+
+		// encoded straight into staging memory, a chunk at a time since reserved uploads can't span chunks
+		PrxUploadContext& uploadContext = prxDevice.getUploadContext();
+		const auto* source = static_cast<const PrxModel::Vertex*>(vertices);
+		const VkDeviceSize positionStride = layout.getStreamStride(0);
+		const VkDeviceSize attributeStride = layout.splitPositions ? layout.getStreamStride(1) : 0;
+		const uint32_t chunkVertices = static_cast<uint32_t>(uploadContext.getMaxChunkSize() / std::max(positionStride, attributeStride));
+		for (uint32_t chunkFirst = 0; chunkFirst < vertexCount; chunkFirst += chunkVertices) {
+			const uint32_t count = std::min(chunkVertices, vertexCount - chunkFirst);
+			const VkDeviceSize dstVertex = VkDeviceSize{ range.first } + chunkFirst;
+
+			auto* positions = static_cast<uint8_t*>(uploadContext.reserveBufferUpload(
+				positionStride * count, vertexBuffer->getBuffer(), positionStride * dstVertex));
+			for (uint32_t i = 0; i < count; i++) {
+				const PrxModel::Vertex& vertex = source[chunkFirst + i];
+				uint8_t* positionOut = positions + positionStride * i;
+				layout.encodePosition(vertex.position, decode, positionOut);
+				if (!layout.splitPositions) {
+					layout.encodeAttributes(vertex.color, vertex.normal, vertex.uv, positionOut + layout.getPositionSize());
+				}
+			}
+
+			// Note: only reserved once the positions are written, reserving can submit the batch
+			//	that already holds the position copy
+			if (layout.splitPositions) {
+				auto* attributes = static_cast<uint8_t*>(uploadContext.reserveBufferUpload(
+					attributeStride * count, attributeBuffer->getBuffer(), attributeStride * dstVertex));
+				for (uint32_t i = 0; i < count; i++) {
+					const PrxModel::Vertex& vertex = source[chunkFirst + i];
+					layout.encodeAttributes(vertex.color, vertex.normal, vertex.uv, attributes + attributeStride * i);
+				}
+			}
+		}
+		return range;
+	}
+
+	PrxGeometryArena::IndexRange PrxGeometryArena::allocateIndices(const uint32_t* indices, uint32_t indexCount, VkIndexType indexType) {
+		assert(indexCount > 0 && "Allocating an empty index range");
+		assert((indexType == VK_INDEX_TYPE_UINT16 || indexType == VK_INDEX_TYPE_UINT32) && "Unsupported index type");
+
+		// uint32_t ranges start on a 4 byte boundary, so their first index is a whole number of uint32_ts
+		const bool isShort = indexType == VK_INDEX_TYPE_UINT16;
+		const uint32_t slotsPerIndex = isShort ? 1 : 2;
+		VkDeviceSize firstSlot;
+		if (!indexRanges.allocate(VkDeviceSize{ indexCount } * slotsPerIndex, slotsPerIndex, PrxAllocationKind::Linear, firstSlot)) {
+			throw std::runtime_error("geometry arena is out of index space!");
+		}
+
+		IndexRange range{ static_cast<uint32_t>(firstSlot / slotsPerIndex), indexCount, indexType };
+		PrxUploadContext& uploadContext = prxDevice.getUploadContext();
+		if (!isShort) {
+			uploadContext.uploadBuffer(indices, sizeof(uint32_t) * indexCount,
+				indexBuffer->getBuffer(), sizeof(uint32_t) * VkDeviceSize{ range.first });
+		}
+		else {
+			// narrowed straight into staging memory, a chunk at a time like the vertices
+			const uint32_t chunkIndices = static_cast<uint32_t>(uploadContext.getMaxChunkSize() / sizeof(uint16_t));
+			for (uint32_t chunkFirst = 0; chunkFirst < indexCount; chunkFirst += chunkIndices) {
+				const uint32_t count = std::min(chunkIndices, indexCount - chunkFirst);
+				auto* out = static_cast<uint16_t*>(uploadContext.reserveBufferUpload(sizeof(uint16_t) * count,
+					indexBuffer->getBuffer(), sizeof(uint16_t) * (VkDeviceSize{ range.first } + chunkFirst)));
+				for (uint32_t i = 0; i < count; i++) {
+					assert(indices[chunkFirst + i] <= UINT16_MAX && "Index doesn't fit in 16 bits");
+					out[i] = static_cast<uint16_t>(indices[chunkFirst + i]);
+				}
+			}
+			shortIndexCount += indexCount;
+		}
+		this->indexCount += indexCount;
+		return range;
+	}
+
+	VkIndexType PrxGeometryArena::smallestIndexType(const uint32_t* indices, uint32_t indexCount) {
+		for (uint32_t i = 0; i < indexCount; i++) {
+			if (indices[i] > UINT16_MAX) return VK_INDEX_TYPE_UINT32;
+		}
+		return VK_INDEX_TYPE_UINT16;
+	}
+
+	void PrxGeometryArena::freeVertices(Range& range) {
+		if (!range.isValid()) return;
+		vertexRanges.free(range.first);
+		range = Range{};
+	}
+
+	void PrxGeometryArena::freeIndices(IndexRange& range) {
+		if (!range.isValid()) return;
+		const bool isShort = range.indexType == VK_INDEX_TYPE_UINT16;
+		indexRanges.free(isShort ? range.first : VkDeviceSize{ range.first } * 2);
+		indexCount -= range.count;
+		if (isShort) {
+			shortIndexCount -= range.count;
+		}
+		range = IndexRange{};
+	}
+
+	void PrxGeometryArena::bind(VkCommandBuffer commandBuffer, VkIndexType indexType) const {
+		VkBuffer buffers[] = { vertexBuffer->getBuffer(), getAttributeBuffer() };
+		VkDeviceSize offsets[] = { 0, 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 0, layout.getStreamCount(), buffers, offsets);
+		bindIndices(commandBuffer, indexType);
+	}
+
+	void PrxGeometryArena::bindPositions(VkCommandBuffer commandBuffer, VkIndexType indexType) const {
+		VkBuffer buffers[] = { vertexBuffer->getBuffer() };
+		VkDeviceSize offsets[] = { 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+		bindIndices(commandBuffer, indexType);
+	}
+
+	void PrxGeometryArena::bindIndices(VkCommandBuffer commandBuffer, VkIndexType indexType) const {
+		// both widths are bound from offset 0, ranges of either one are addressed by firstIndex
+		vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, indexType);
+	}
+
+	PrxGeometryArena::Stats PrxGeometryArena::getStats() const {
+		// the metadata's "bytes" are elements here
+		Stats stats{};
+		stats.vertexCount = static_cast<uint32_t>(vertexRanges.getUsedBytes());
+		stats.vertexCapacity = static_cast<uint32_t>(vertexRanges.getSize());
+		stats.vertexSize = layout.getVertexSize();
+		stats.indexCount = indexCount;
+		stats.shortIndexCount = shortIndexCount;
+		stats.indexBytes = indexRanges.getUsedBytes() * sizeof(uint16_t);
+		stats.indexCapacityBytes = indexRanges.getSize() * sizeof(uint16_t);
+		stats.rangeCount = vertexRanges.getAllocationCount() + indexRanges.getAllocationCount();
+		return stats;
+	}
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "PrxDevice.hpp"
+#include "PrxBuffer.hpp"
+#include "PrxMemoryAllocator.hpp"
+#include "PrxVertexLayout.hpp"
+
+// std
+#include <cstdint>
+#include <memory>
+
+namespace prx {
+
+	// One device local vertex buffer and one index buffer that every PrxModel's geometry is
+	//	suballocated from. Models only remember where their vertices and indices start, and draw with
+	//	firstIndex/vertexOffset, so a whole frame binds geometry once (and indirect draws of
+	//	different models can go out in a single multi-draw).
+	//	Owned by PrxDevice, next to the upload context that fills it.
+	//
+	// Vertices are stored in the arena's PrxVertexLayout (compact by default), encoded from
+	//	PrxModel::Vertex on upload. A split layout keeps positions in a second buffer of their own.
+	//
+	// Indices come in both widths, packed into the same index buffer: a range whose indices all fit
+	//	is stored as uint16_t (see smallestIndexType), at half the memory and bandwidth. The index type
+	//	is a property of the bind, not the buffer, so draws of different widths only need the index
+	//	buffer bound again (bindIndices), with firstIndex counted in the range's own width.
+	//
+	// Ranges are counted in vertices and indices, not bytes.
+	//	Note: the buffers don't grow, running out of space throws. Raise the capacities if a scene
+	//	needs more. Freeing a range has the same rule as destroying a buffer: no frame in flight
+	//	may still draw from it
+	class PrxGeometryArena
+	{
+	public:
+		static constexpr uint32_t DEFAULT_VERTEX_CAPACITY = 1u << 20; // 20 MB compact, 44 MB full
+		static constexpr uint32_t DEFAULT_INDEX_CAPACITY = 1u << 23; // in uint16_t slots, 16 MB
+
+		struct Range {
+			uint32_t first = 0;
+			uint32_t count = 0;
+
+			bool isValid() const { return count > 0; }
+		};
+
+		// first and count are in indices of indexType
+		struct IndexRange {
+			uint32_t first = 0;
+			uint32_t count = 0;
+			VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+
+			bool isValid() const { return count > 0; }
+		};
+
+		struct Stats {
+			uint32_t vertexCount = 0; // in use
+			uint32_t vertexCapacity = 0;
+			uint32_t vertexSize = 0; // bytes per vertex in the arena's layout
+			uint32_t indexCount = 0; // of either width
+			uint32_t shortIndexCount = 0; // the ones stored as uint16_t
+			VkDeviceSize indexBytes = 0;
+			VkDeviceSize indexCapacityBytes = 0;
+			uint32_t rangeCount = 0;
+		};
+
+		PrxGeometryArena(PrxDevice& device, const PrxVertexLayout& layout = PrxVertexLayout::compact(),
+			uint32_t vertexCapacity = DEFAULT_VERTEX_CAPACITY, uint32_t indexCapacity = DEFAULT_INDEX_CAPACITY);
+
+		// do not allow for copying
+		PrxGeometryArena(const PrxGeometryArena&) = delete;
+		PrxGeometryArena& operator=(const PrxGeometryArena&) = delete;
+
+		// Reserve a range and record its upload on the device's upload context.
+		//	Indices stay relative to their own model, draws add the vertex range's first as vertexOffset.
+		//	vertices are PrxModel::Vertex, encoded with decode (see PrxVertexLayout::getPositionDecode)
+		Range allocateVertices(const void* vertices, uint32_t vertexCount, const PrxVertexLayout::PositionDecode& decode);
+		//	indexType UINT16 narrows the indices on the way into staging memory, they all have to fit
+		IndexRange allocateIndices(const uint32_t* indices, uint32_t indexCount, VkIndexType indexType);
+		void freeVertices(Range& range);
+		void freeIndices(IndexRange& range);
+
+		// UINT16 if every index fits in 16 bits, UINT32 otherwise.
+		//	Note: 0xFFFF counts as fitting, primitive restart is never enabled (see PrxPipeline)
+		static VkIndexType smallestIndexType(const uint32_t* indices, uint32_t indexCount);
+
+		// binds every vertex stream and the index buffer as indexType, once per command buffer is
+		//	enough for every model (plus a bindIndices whenever the index width changes)
+		void bind(VkCommandBuffer commandBuffer, VkIndexType indexType) const;
+		// only the position stream (and the index buffer), for pipelines made with the layout's
+		//	position descriptions, e.g. depth or shadow passes
+		void bindPositions(VkCommandBuffer commandBuffer, VkIndexType indexType) const;
+		// rebinds just the index buffer, to switch to ranges of the other width
+		void bindIndices(VkCommandBuffer commandBuffer, VkIndexType indexType) const;
+
+		const PrxVertexLayout& getLayout() const { return layout; }
+		// the position stream if the layout is split
+		VkBuffer getVertexBuffer() const { return vertexBuffer->getBuffer(); }
+		// null unless the layout is split
+		VkBuffer getAttributeBuffer() const { return attributeBuffer != nullptr ? attributeBuffer->getBuffer() : VK_NULL_HANDLE; }
+		VkBuffer getIndexBuffer() const { return indexBuffer->getBuffer(); }
+
+		Stats getStats() const;
+
+	private:
+		PrxDevice& prxDevice;
+		PrxVertexLayout layout;
+
+		std::unique_ptr<PrxBuffer> vertexBuffer;
+		std::unique_ptr<PrxBuffer> attributeBuffer;
+		std::unique_ptr<PrxBuffer> indexBuffer;
+
+		// Note: the same best fit bookkeeping as memory blocks, just counted in elements instead of bytes.
+		//	Index ranges are counted in uint16_t slots, a uint32_t index takes two
+		PrxMemoryBlockMetadata vertexRanges;
+		PrxMemoryBlockMetadata indexRanges;
+		uint32_t indexCount = 0;
+		uint32_t shortIndexCount = 0;
+	};
+}
@@ -0,0 +1,119 @@
+#include "PrxMappedFile.hpp"
+
+// std
+#include <cstring>
+
+// libs
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace prx {
+
+	PrxMappedFile::~PrxMappedFile() {
+		close();
+	}
+
+	uint64_t PrxMappedFile::hash() const {
+		// FNV-1a, but 8 bytes at a time (the byte at a time version is too slow for big files),
+		//	with a final mix so every input bit reaches every output bit
+		uint64_t hash = 0xCBF29CE484222325ull ^ mappingSize;
+		size_t i = 0;
+		for (; i + sizeof(uint64_t) <= mappingSize; i += sizeof(uint64_t)) {
+			uint64_t word;
+			std::memcpy(&word, mapping + i, sizeof(word));
+			hash = (hash ^ word) * 0x100000001B3ull;
+			hash ^= hash >> 29;
+		}
+		for (; i < mappingSize; i++) {
+			hash = (hash ^ mapping[i]) * 0x100000001B3ull;
+		}
+		hash ^= hash >> 33;
+		hash *= 0xFF51AFD7ED558CCDull;
+		hash ^= hash >> 33;
+		return hash;
+	}
+
+#if defined(_WIN32)
+	bool PrxMappedFile::open(const std::string& filepath) {
+		close();
+
+		HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return false;
+
+		LARGE_INTEGER fileSize{};
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+			CloseHandle(file);
+			return false;
+		}
+
+		HANDLE fileMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (fileMapping == nullptr) {
+			CloseHandle(file);
+			return false;
+		}
+
+		void* view = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+		if (view == nullptr) {
+			CloseHandle(fileMapping);
+			CloseHandle(file);
+			return false;
+		}
+
+		fileHandle = file;
+		mappingHandle = fileMapping;
+		mapping = static_cast<const uint8_t*>(view);
+		mappingSize = static_cast<size_t>(fileSize.QuadPart);
+		return true;
+	}
+
+	void PrxMappedFile::close() {
+		if (mapping != nullptr) UnmapViewOfFile(mapping);
+		if (mappingHandle != nullptr) CloseHandle(mappingHandle);
+		if (fileHandle != nullptr) CloseHandle(fileHandle);
+		mapping = nullptr;
+		mappingSize = 0;
+		mappingHandle = nullptr;
+		fileHandle = nullptr;
+	}
+#else
+	bool PrxMappedFile::open(const std::string& filepath) {
+		close();
+
+		int file = ::open(filepath.c_str(), O_RDONLY);
+		if (file < 0) return false;
+
+		struct stat fileStats {};
+		if (fstat(file, &fileStats) != 0 || fileStats.st_size == 0) {
+			::close(file);
+			return false;
+		}
+
+		void* view = mmap(nullptr, static_cast<size_t>(fileStats.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		// the mapping keeps the file alive on its own
+		::close(file);
+		if (view == MAP_FAILED) return false;
+
+		// it is read front to back (hashing, or the upload), let the OS read ahead
+		madvise(view, static_cast<size_t>(fileStats.st_size), MADV_SEQUENTIAL);
+
+		mapping = static_cast<const uint8_t*>(view);
+		mappingSize = static_cast<size_t>(fileStats.st_size);
+		return true;
+	}
+
+	void PrxMappedFile::close() {
+		if (mapping != nullptr) munmap(const_cast<uint8_t*>(mapping), mappingSize);
+		mapping = nullptr;
+		mappingSize = 0;
+	}
+#endif
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace prx {
+
+	// A whole file mapped read only into memory (mmap, or a file mapping on Windows).
+	//	Pages are read in by the OS when first touched, so nothing is copied into a buffer up front
+	class PrxMappedFile
+	{
+	public:
+		PrxMappedFile() = default;
+		~PrxMappedFile();
+
+		// do not allow for copying, the mapping is owned
+		PrxMappedFile(const PrxMappedFile&) = delete;
+		PrxMappedFile& operator=(const PrxMappedFile&) = delete;
+
+		// returns false if the file doesn't exist, can't be mapped or is empty
+		bool open(const std::string& filepath);
+		void close();
+
+		bool isOpen() const { return mapping != nullptr; }
+		const uint8_t* data() const { return mapping; }
+		size_t size() const { return mappingSize; }
+
+		// 64 bit hash of the contents, for telling files apart (not cryptographic)
+		uint64_t hash() const;
+
+	private:
+		const uint8_t* mapping = nullptr;
+		size_t mappingSize = 0;
+
+		// Note: only used on Windows, where the handles have to stay open as long as the view
+		void* fileHandle = nullptr;
+		void* mappingHandle = nullptr;
+	};
+}
@@ -0,0 +1,307 @@
+#include "PrxMemoryAllocator.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <stdexcept>
+
+namespace prx {
+
+	static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+		return alignment > 1 ? (value + alignment - 1) & ~(alignment - 1) : value;
+	}
+
+	static VkDeviceSize alignDown(VkDeviceSize value, VkDeviceSize alignment) {
+		return alignment > 1 ? value & ~(alignment - 1) : value;
+	}
+
+	// *************** Block Metadata *********************
+
+	PrxMemoryBlockMetadata::PrxMemoryBlockMetadata(VkDeviceSize size, VkDeviceSize bufferImageGranularity)
+		: blockSize{ size }, granularity{ std::max<VkDeviceSize>(bufferImageGranularity, 1) } {
+		ranges.push_back({ 0, size, PrxAllocationKind::Free });
+	}
+
+	bool PrxMemoryBlockMetadata::conflicts(PrxAllocationKind a, PrxAllocationKind b) const {
+		return a != PrxAllocationKind::Free && b != PrxAllocationKind::Free && a != b;
+	}
+
+	bool PrxMemoryBlockMetadata::onSamePage(VkDeviceSize lastByteOfA, VkDeviceSize firstByteOfB) const {
+		return alignDown(lastByteOfA, granularity) == alignDown(firstByteOfB, granularity);
+	}
+
+	bool PrxMemoryBlockMetadata::allocate(
+		VkDeviceSize size, VkDeviceSize alignment, PrxAllocationKind kind, VkDeviceSize& outOffset) {
+		assert(size > 0 && kind != PrxAllocationKind::Free && "Invalid allocation request");
+
+		size_t bestRange = ranges.size();
+		VkDeviceSize bestOffset = 0;
+		VkDeviceSize bestSize = std::numeric_limits<VkDeviceSize>::max();
+
+		for (size_t i = 0; i < ranges.size(); i++) {
+			const Range& range = ranges[i];
+			if (range.kind != PrxAllocationKind::Free || range.size < size || range.size >= bestSize) continue;
+
+			VkDeviceSize offset = alignUp(range.offset, alignment);
+
+			// push past the previous resource's page if it is of the other kind
+			if (granularity > 1 && i > 0) {
+				const Range& prev = ranges[i - 1];
+				if (conflicts(prev.kind, kind) && onSamePage(prev.offset + prev.size - 1, offset)) {
+					offset = alignUp(offset, granularity);
+				}
+			}
+
+			if (offset + size > range.offset + range.size) continue;
+
+			// the next resource can't be moved, so skip this range if we would share its page
+			if (granularity > 1 && i + 1 < ranges.size()) {
+				const Range& next = ranges[i + 1];
+				if (conflicts(kind, next.kind) && onSamePage(offset + size - 1, next.offset)) continue;
+			}
+
+			bestRange = i;
+			bestOffset = offset;
+			bestSize = range.size;
+		}
+
+		if (bestRange == ranges.size()) {
+			return false;
+		}
+
+		// split the free range into [padding][allocation][remainder]
+		Range range = ranges[bestRange];
+		std::vector<Range> pieces;
+		if (bestOffset > range.offset) {
+			pieces.push_back({ range.offset, bestOffset - range.offset, PrxAllocationKind::Free });
+		}
+		pieces.push_back({ bestOffset, size, kind });
+		VkDeviceSize end = bestOffset + size;
+		if (end < range.offset + range.size) {
+			pieces.push_back({ end, range.offset + range.size - end, PrxAllocationKind::Free });
+		}
+
+		ranges.erase(ranges.begin() + bestRange);
+		ranges.insert(ranges.begin() + bestRange, pieces.begin(), pieces.end());
+
+		usedBytes += size;
+		allocationCount++;
+		outOffset = bestOffset;
+		return true;
+	}
+
+	void PrxMemoryBlockMetadata::free(VkDeviceSize offset) {
+		auto it = std::lower_bound(ranges.begin(), ranges.end(), offset,
+			[](const Range& range, VkDeviceSize value) { return range.offset < value; });
+		assert(it != ranges.end() && it->offset == offset && it->kind != PrxAllocationKind::Free
+			&& "Freeing an offset that was never allocated");
+
+		usedBytes -= it->size;
+		allocationCount--;
+		it->kind = PrxAllocationKind::Free;
+
+		// merge with the following range, then the preceding one
+		auto next = it + 1;
+		if (next != ranges.end() && next->kind == PrxAllocationKind::Free) {
+			it->size += next->size;
+			it = ranges.erase(next) - 1;
+		}
+		if (it != ranges.begin()) {
+			auto prev = it - 1;
+			if (prev->kind == PrxAllocationKind::Free) {
+				prev->size += it->size;
+				ranges.erase(it);
+			}
+		}
+	}
+
+	// *************** Memory Allocator *********************
+
+	PrxMemoryAllocator::PrxMemoryAllocator(
+		const VkPhysicalDeviceMemoryProperties& memoryProperties,
+		VkDeviceSize bufferImageGranularity,
+		VkDeviceSize nonCoherentAtomSize,
+		MemoryCallbacks callbacks,
+		VkDeviceSize preferredBlockSize)
+		: memoryProperties{ memoryProperties },
+		bufferImageGranularity{ bufferImageGranularity },
+		nonCoherentAtomSize{ std::max<VkDeviceSize>(nonCoherentAtomSize, 1) },
+		preferredBlockSize{ preferredBlockSize },
+		callbacks{ std::move(callbacks) } {
+		blocks.resize(memoryProperties.memoryTypeCount);
+	}
+
+	PrxMemoryAllocator::~PrxMemoryAllocator() {
+		for (auto& typeBlocks : blocks) {
+			for (auto& block : typeBlocks) {
+				assert(block->metadata.isEmpty() && "Memory allocator destroyed with live allocations");
+				destroyBlock(*block);
+			}
+		}
+	}
+
+	uint32_t PrxMemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+			if ((typeFilter & (1 << i)) &&
+				(memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+				return i;
+			}
+		}
+
+		throw std::runtime_error("failed to find suitable memory type!");
+	}
+
+	bool PrxMemoryAllocator::isHostVisible(uint32_t memoryTypeIndex) const {
+		return memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+	}
+
+	// small heaps (e.g. the 256MB device local + host visible heap) get smaller blocks
+	//	so a single block can't eat most of the heap
+	VkDeviceSize PrxMemoryAllocator::getBlockSize(uint32_t memoryTypeIndex) const {
+		uint32_t heapIndex = memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+		VkDeviceSize heapSize = memoryProperties.memoryHeaps[heapIndex].size;
+		return std::min(preferredBlockSize, alignUp(heapSize / 8, nonCoherentAtomSize));
+	}
+
+	PrxAllocation PrxMemoryAllocator::allocate(
+		const VkMemoryRequirements& requirements,
+		VkMemoryPropertyFlags properties,
+		PrxAllocationKind kind) {
+		uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+
+		VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+		VkDeviceSize size = requirements.size;
+
+		// host visible suballocations are kept on nonCoherentAtomSize boundaries so each
+		//	resource can be flushed/invalidated on its own without touching its neighbours
+		if (isHostVisible(memoryTypeIndex)) {
+			alignment = std::max(alignment, nonCoherentAtomSize);
+			size = alignUp(size, nonCoherentAtomSize);
+		}
+
+		auto& typeBlocks = blocks[memoryTypeIndex];
+		VkDeviceSize blockSize = getBlockSize(memoryTypeIndex);
+
+		Block* target = nullptr;
+		VkDeviceSize offset = 0;
+
+		// anything bigger than half a block gets its own block instead of fragmenting the shared ones
+		if (size > blockSize / 2) {
+			target = createBlock(memoryTypeIndex, size, true);
+			if (!target->metadata.allocate(size, alignment, kind, offset)) {
+				throw std::runtime_error("failed to suballocate from a dedicated memory block!");
+			}
+		}
+		else {
+			for (auto& block : typeBlocks) {
+				if (!block->dedicated && block->metadata.allocate(size, alignment, kind, offset)) {
+					target = block.get();
+					break;
+				}
+			}
+
+			if (target == nullptr) {
+				target = createBlock(memoryTypeIndex, blockSize, false);
+				if (!target->metadata.allocate(size, alignment, kind, offset)) {
+					throw std::runtime_error("failed to suballocate from a new memory block!");
+				}
+			}
+		}
+
+		PrxAllocation allocation{};
+		allocation.memory = target->memory;
+		allocation.offset = offset;
+		allocation.size = size;
+		allocation.memoryTypeIndex = memoryTypeIndex;
+		allocation.blockId = target->id;
+		if (target->mapped != nullptr) {
+			allocation.mapped = static_cast<char*>(target->mapped) + offset;
+		}
+		return allocation;
+	}
+
+	void PrxMemoryAllocator::free(PrxAllocation& allocation) {
+		if (!allocation.isValid()) return;
+
+		auto& typeBlocks = blocks[allocation.memoryTypeIndex];
+		auto it = std::find_if(typeBlocks.begin(), typeBlocks.end(),
+			[&](const std::unique_ptr<Block>& block) { return block->id == allocation.blockId; });
+		assert(it != typeBlocks.end() && "Allocation does not belong to this allocator");
+
+		Block& block = **it;
+		block.metadata.free(allocation.offset);
+
+		// Release empty blocks, but keep one shared block per type around so that
+		//	load/unload patterns don't keep hitting vkAllocateMemory
+		if (block.metadata.isEmpty()) {
+			bool keep = !block.dedicated && std::count_if(typeBlocks.begin(), typeBlocks.end(),
+				[](const std::unique_ptr<Block>& b) { return !b->dedicated; }) == 1;
+			if (!keep) {
+				destroyBlock(block);
+				typeBlocks.erase(it);
+			}
+		}
+
+		allocation = PrxAllocation{};
+	}
+
+	VkMappedMemoryRange PrxMemoryAllocator::getMappedRange(
+		const PrxAllocation& allocation, VkDeviceSize size, VkDeviceSize offset) const {
+		assert(offset <= allocation.size && "Mapped range starts outside of the allocation");
+
+		VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.size : std::min(offset + size, allocation.size);
+		VkDeviceSize begin = alignDown(allocation.offset + offset, nonCoherentAtomSize);
+		end = alignUp(allocation.offset + end, nonCoherentAtomSize);
+
+		VkMappedMemoryRange mappedRange = {};
+		mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		mappedRange.memory = allocation.memory;
+		mappedRange.offset = begin;
+		mappedRange.size = end - begin;
+		return mappedRange;
+	}
+
+	PrxMemoryAllocator::Stats PrxMemoryAllocator::getStats() const {
+		Stats stats{};
+		for (auto& typeBlocks : blocks) {
+			for (auto& block : typeBlocks) {
+				stats.blockCount++;
+				stats.allocationCount += block->metadata.getAllocationCount();
+				stats.reservedBytes += block->metadata.getSize();
+				stats.usedBytes += block->metadata.getUsedBytes();
+			}
+		}
+		return stats;
+	}
+
+	PrxMemoryAllocator::Block* PrxMemoryAllocator::createBlock(
+		uint32_t memoryTypeIndex, VkDeviceSize size, bool dedicated) {
+		auto block = std::make_unique<Block>(size, bufferImageGranularity);
+		block->id = nextBlockId++;
+		block->dedicated = dedicated;
+
+		if (callbacks.allocate(memoryTypeIndex, size, block->memory) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate device memory block!");
+		}
+
+		if (isHostVisible(memoryTypeIndex)) {
+			if (callbacks.map(block->memory, &block->mapped) != VK_SUCCESS) {
+				callbacks.free(block->memory);
+				throw std::runtime_error("failed to map device memory block!");
+			}
+		}
+
+		blocks[memoryTypeIndex].push_back(std::move(block));
+		return blocks[memoryTypeIndex].back().get();
+	}
+
+	void PrxMemoryAllocator::destroyBlock(Block& block) {
+		if (block.mapped != nullptr) {
+			callbacks.unmap(block.memory);
+			block.mapped = nullptr;
+		}
+		callbacks.free(block.memory);
+		block.memory = VK_NULL_HANDLE;
+	}
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+// lib
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace prx {
+
+	// What kind of resource lives in a suballocation.
+	//	Linear resources (buffers, linear images) and optimal images are not allowed to share
+	//	a bufferImageGranularity "page" with each other, so the allocator has to know which is which.
+	enum class PrxAllocationKind : uint8_t {
+		Free = 0,
+		Linear,
+		Optimal
+	};
+
+	// Handle to a piece of a larger VkDeviceMemory block.
+	//	Resources bind to (memory, offset) instead of owning their own VkDeviceMemory.
+	struct PrxAllocation {
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		void* mapped = nullptr; // non-null if the block is host visible (blocks stay mapped for their whole life)
+		uint32_t memoryTypeIndex = 0;
+		uint32_t blockId = 0;
+
+		bool isValid() const { return memory != VK_NULL_HANDLE; }
+	};
+
+	// Bookkeeping for the ranges inside one block. Makes no Vulkan calls, so it can be
+	//	exercised entirely on the CPU.
+	class PrxMemoryBlockMetadata {
+	public:
+		PrxMemoryBlockMetadata(VkDeviceSize size, VkDeviceSize bufferImageGranularity);
+
+		// finds the best fitting free range and marks it as used. Returns false if nothing fits
+		bool allocate(VkDeviceSize size, VkDeviceSize alignment, PrxAllocationKind kind, VkDeviceSize& outOffset);
+		void free(VkDeviceSize offset);
+
+		VkDeviceSize getSize() const { return blockSize; }
+		VkDeviceSize getUsedBytes() const { return usedBytes; }
+		uint32_t getAllocationCount() const { return allocationCount; }
+		bool isEmpty() const { return allocationCount == 0; }
+
+	private:
+		struct Range {
+			VkDeviceSize offset;
+			VkDeviceSize size;
+			PrxAllocationKind kind;
+		};
+
+		bool conflicts(PrxAllocationKind a, PrxAllocationKind b) const;
+		bool onSamePage(VkDeviceSize lastByteOfA, VkDeviceSize firstByteOfB) const;
+
+		// sorted by offset, always covers [0, blockSize); neighbouring free ranges are merged
+		std::vector<Range> ranges;
+		VkDeviceSize blockSize;
+		VkDeviceSize granularity;
+		VkDeviceSize usedBytes = 0;
+		uint32_t allocationCount = 0;
+	};
+
+	// Block based sub-allocator. Keeps a list of large VkDeviceMemory blocks per memory type
+	//	and hands out pieces of them, so the number of vkAllocateMemory calls scales with
+	//	the amount of memory used rather than the number of buffers and images.
+	class PrxMemoryAllocator {
+	public:
+		static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+		// Note: the allocator never calls Vulkan directly; PrxDevice fills these in with
+		//	vkAllocateMemory etc. Handing it a fake memory-type table and fake callbacks
+		//	lets the allocation logic run without a GPU.
+		struct MemoryCallbacks {
+			std::function<VkResult(uint32_t memoryTypeIndex, VkDeviceSize size, VkDeviceMemory& memory)> allocate;
+			std::function<void(VkDeviceMemory memory)> free;
+			std::function<VkResult(VkDeviceMemory memory, void** data)> map;
+			std::function<void(VkDeviceMemory memory)> unmap;
+		};
+
+		struct Stats {
+			uint32_t blockCount = 0;
+			uint32_t allocationCount = 0;
+			VkDeviceSize reservedBytes = 0; // total size of all blocks
+			VkDeviceSize usedBytes = 0; // bytes handed out to resources (including alignment)
+		};
+
+		PrxMemoryAllocator(
+			const VkPhysicalDeviceMemoryProperties& memoryProperties,
+			VkDeviceSize bufferImageGranularity,
+			VkDeviceSize nonCoherentAtomSize,
+			MemoryCallbacks callbacks,
+			VkDeviceSize preferredBlockSize = DEFAULT_BLOCK_SIZE);
+		~PrxMemoryAllocator();
+
+		// do not allow for copying
+		PrxMemoryAllocator(const PrxMemoryAllocator&) = delete;
+		PrxMemoryAllocator& operator=(const PrxMemoryAllocator&) = delete;
+
+		uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+		PrxAllocation allocate(
+			const VkMemoryRequirements& requirements,
+			VkMemoryPropertyFlags properties,
+			PrxAllocationKind kind);
+		void free(PrxAllocation& allocation);
+
+		// Builds a flush/invalidate range for part of an allocation, expanded so that it
+		//	respects nonCoherentAtomSize. Pass VK_WHOLE_SIZE to cover the rest of the allocation.
+		VkMappedMemoryRange getMappedRange(
+			const PrxAllocation& allocation, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0) const;
+
+		Stats getStats() const;
+
+	private:
+		struct Block {
+			Block(VkDeviceSize size, VkDeviceSize granularity) : metadata{ size, granularity } {}
+
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			void* mapped = nullptr;
+			uint32_t id = 0;
+			bool dedicated = false; // created for a single oversized resource
+			PrxMemoryBlockMetadata metadata;
+		};
+
+		Block* createBlock(uint32_t memoryTypeIndex, VkDeviceSize size, bool dedicated);
+		void destroyBlock(Block& block);
+		VkDeviceSize getBlockSize(uint32_t memoryTypeIndex) const;
+		bool isHostVisible(uint32_t memoryTypeIndex) const;
+
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		VkDeviceSize bufferImageGranularity;
+		VkDeviceSize nonCoherentAtomSize;
+		VkDeviceSize preferredBlockSize;
+		MemoryCallbacks callbacks;
+
+		std::vector<std::vector<std::unique_ptr<Block>>> blocks; // one list per memory type
+		uint32_t nextBlockId = 1;
+	};
+}
@@ -0,0 +1,269 @@
+#include "PrxMeshCache.hpp"
+
+// std
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+
+namespace prx {
+
+	namespace {
+		constexpr uint64_t SECTION_ALIGNMENT = 16;
+
+		static_assert(std::is_trivially_copyable<PrxModel::Vertex>::value, "Vertices are stored as raw bytes");
+		static_assert(std::is_trivially_copyable<PrxModel::MeshEntryData>::value, "Meshes are stored as raw bytes");
+		static_assert(std::is_trivially_copyable<PrxModel::Bounds>::value, "Bounds are stored as raw bytes");
+
+		struct Header {
+			uint32_t magic;
+			uint32_t version;
+			uint64_t sourceHash;
+			uint32_t importer;
+			uint32_t importFlags;
+			uint32_t vertexSize; // catches changes to PrxModel::Vertex without a version bump
+			uint32_t meshCount;
+			uint32_t vertexCount;
+			uint32_t indexCount;
+			uint32_t materialCount;
+			uint32_t textureFilePathCount;
+			uint64_t meshOffset;
+			uint64_t vertexOffset;
+			uint64_t indexOffset;
+			uint64_t materialOffset;
+			uint64_t fileSize;
+			PrxModel::Bounds bounds;
+		};
+
+		// the fixed size part of a MtlData
+		struct MaterialRecord {
+			glm::vec3 diffuse;
+			glm::vec3 specular;
+			glm::vec3 ambient;
+			glm::vec3 emission;
+			glm::vec3 transmittance;
+			float opacity;
+			float shininess;
+			float ior;
+		};
+
+		uint64_t alignUp(uint64_t offset) {
+			return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+		}
+
+		// bounds checked reads out of the materials section
+		class Reader {
+		public:
+			Reader(const uint8_t* data, size_t size, size_t offset) : data{ data }, size{ size }, offset{ offset } {}
+
+			bool read(void* destination, size_t byteCount) {
+				if (offset > size || byteCount > size - offset) return false;
+				std::memcpy(destination, data + offset, byteCount);
+				offset += byteCount;
+				return true;
+			}
+
+			bool readString(std::string& string) {
+				uint32_t length = 0;
+				if (!read(&length, sizeof(length))) return false;
+				if (offset > size || length > size - offset) return false;
+				string.assign(reinterpret_cast<const char*>(data + offset), length);
+				offset += length;
+				return true;
+			}
+
+		private:
+			const uint8_t* data;
+			size_t size;
+			size_t offset;
+		};
+	}
+
+	uint64_t PrxMeshCache::hashFile(const std::string& filepath) {
+		PrxMappedFile source{};
+		if (!source.open(filepath)) {
+			throw std::runtime_error("failed to open file: " + filepath + "!");
+		}
+
+		return source.hash();
+	}
+
+	bool PrxMeshCache::open(const std::string& cachePath, const Key& key) {
+		close();
+		if (!file.open(cachePath) || file.size() < sizeof(Header)) {
+			close();
+			return false;
+		}
+
+		Header header;
+		std::memcpy(&header, file.data(), sizeof(header));
+		const bool matches = header.magic == MAGIC
+			&& header.version == VERSION
+			&& header.sourceHash == key.sourceHash
+			&& header.importer == static_cast<uint32_t>(key.importer)
+			&& header.importFlags == key.importFlags
+			&& header.vertexSize == sizeof(PrxModel::Vertex)
+			&& header.fileSize == file.size();
+		// the sections have to fit, in case the file was cut short or made by a broken writer
+		const bool fits = matches
+			&& header.meshOffset + uint64_t{ header.meshCount } * sizeof(PrxModel::MeshEntryData) <= header.vertexOffset
+			&& header.vertexOffset + uint64_t{ header.vertexCount } * sizeof(PrxModel::Vertex) <= header.indexOffset
+			&& header.indexOffset + uint64_t{ header.indexCount } * sizeof(uint32_t) <= header.materialOffset
+			&& header.materialOffset <= file.size();
+		if (!fits) {
+			close();
+			return false;
+		}
+
+		// Note: the mapping is page aligned and every section 16 byte aligned, so these can be read in place
+		meshes = reinterpret_cast<const PrxModel::MeshEntryData*>(file.data() + header.meshOffset);
+		meshCount = header.meshCount;
+		vertices = reinterpret_cast<const PrxModel::Vertex*>(file.data() + header.vertexOffset);
+		vertexCount = header.vertexCount;
+		indices = reinterpret_cast<const uint32_t*>(file.data() + header.indexOffset);
+		indexCount = header.indexCount;
+		bounds = header.bounds;
+
+		Reader reader{ file.data(), file.size(), static_cast<size_t>(header.materialOffset) };
+		materials.resize(header.materialCount);
+		for (PrxModel::MtlData& material : materials) {
+			MaterialRecord record;
+			if (!reader.read(&record, sizeof(record))
+				|| !reader.readString(material.name)
+				|| !reader.readString(material.diffuseTexFilePath)) {
+				close();
+				return false;
+			}
+			material.diffuse = record.diffuse;
+			material.specular = record.specular;
+			material.ambient = record.ambient;
+			material.emission = record.emission;
+			material.transmittance = record.transmittance;
+			material.opacity = record.opacity;
+			material.shininess = record.shininess;
+			material.ior = record.ior;
+		}
+
+		textureFilePaths.resize(header.textureFilePathCount);
+		for (std::string& textureFilePath : textureFilePaths) {
+			if (!reader.readString(textureFilePath)) {
+				close();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void PrxMeshCache::close() {
+		file.close();
+		vertices = nullptr;
+		vertexCount = 0;
+		indices = nullptr;
+		indexCount = 0;
+		meshes = nullptr;
+		meshCount = 0;
+		bounds = PrxModel::Bounds{};
+		materials.clear();
+		textureFilePaths.clear();
+	}
+
+	bool PrxMeshCache::write(const std::string& cachePath, const Key& key,
+		const PrxModel::ModelData& data, const PrxModel::Bounds& bounds) {
+		return write(cachePath, key, data.vertices, data.indices, data.meshes, bounds, data.materials, data.textureFilePaths);
+	}
+
+	bool PrxMeshCache::write(const std::string& cachePath, const Key& key,
+		const PrxModel::OldModelData& data, const PrxModel::Bounds& bounds) {
+		return write(cachePath, key, data.vertices, data.indices, {}, bounds, data.mats, {});
+	}
+
+	bool PrxMeshCache::write(const std::string& cachePath, const Key& key,
+		const std::vector<PrxModel::Vertex>& vertices, const std::vector<uint32_t>& indices,
+		const std::vector<PrxModel::MeshEntryData>& meshes, const PrxModel::Bounds& bounds,
+		const std::vector<PrxModel::MtlData>& materials, const std::vector<std::string>& textureFilePaths) {
+
+		Header header{};
+		header.magic = MAGIC;
+		header.version = VERSION;
+		header.sourceHash = key.sourceHash;
+		header.importer = static_cast<uint32_t>(key.importer);
+		header.importFlags = key.importFlags;
+		header.vertexSize = sizeof(PrxModel::Vertex);
+		header.meshCount = static_cast<uint32_t>(meshes.size());
+		header.vertexCount = static_cast<uint32_t>(vertices.size());
+		header.indexCount = static_cast<uint32_t>(indices.size());
+		header.materialCount = static_cast<uint32_t>(materials.size());
+		header.textureFilePathCount = static_cast<uint32_t>(textureFilePaths.size());
+		header.meshOffset = alignUp(sizeof(Header));
+		header.vertexOffset = alignUp(header.meshOffset + meshes.size() * sizeof(PrxModel::MeshEntryData));
+		header.indexOffset = alignUp(header.vertexOffset + vertices.size() * sizeof(PrxModel::Vertex));
+		header.materialOffset = alignUp(header.indexOffset + indices.size() * sizeof(uint32_t));
+		header.bounds = bounds;
+
+		uint64_t materialSize = 0;
+		for (const auto& material : materials) {
+			materialSize += sizeof(MaterialRecord) + 2 * sizeof(uint32_t) + material.name.size() + material.diffuseTexFilePath.size();
+		}
+		for (const auto& textureFilePath : textureFilePaths) {
+			materialSize += sizeof(uint32_t) + textureFilePath.size();
+		}
+		header.fileSize = header.materialOffset + materialSize;
+
+		// written to the side and renamed over the old cache, so a crash mid write never leaves a
+		//	cache that looks valid
+		const std::string tempPath = cachePath + ".tmp";
+		{
+			std::ofstream out{ tempPath, std::ios::binary | std::ios::trunc };
+			if (!out) return false;
+
+			uint64_t position = 0;
+			auto write = [&](const void* data, size_t size) {
+				out.write(static_cast<const char*>(data), size);
+				position += size;
+			};
+			auto padTo = [&](uint64_t offset) {
+				const char zeros[SECTION_ALIGNMENT] = {};
+				write(zeros, static_cast<size_t>(offset - position));
+			};
+			auto writeString = [&](const std::string& string) {
+				const uint32_t length = static_cast<uint32_t>(string.size());
+				write(&length, sizeof(length));
+				write(string.data(), string.size());
+			};
+
+			write(&header, sizeof(header));
+			padTo(header.meshOffset);
+			write(meshes.data(), meshes.size() * sizeof(PrxModel::MeshEntryData));
+			padTo(header.vertexOffset);
+			write(vertices.data(), vertices.size() * sizeof(PrxModel::Vertex));
+			padTo(header.indexOffset);
+			write(indices.data(), indices.size() * sizeof(uint32_t));
+			padTo(header.materialOffset);
+			for (const auto& material : materials) {
+				MaterialRecord record{ material.diffuse, material.specular, material.ambient,
+					material.emission, material.transmittance, material.opacity, material.shininess, material.ior };
+				write(&record, sizeof(record));
+				writeString(material.name);
+				writeString(material.diffuseTexFilePath);
+			}
+			for (const auto& textureFilePath : textureFilePaths) {
+				writeString(textureFilePath);
+			}
+
+			if (!out) {
+				out.close();
+				std::remove(tempPath.c_str());
+				return false;
+			}
+		}
+
+		// Note: rename won't replace an existing file on Windows
+		std::remove(cachePath.c_str());
+		if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+			std::remove(tempPath.c_str());
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "PrxMappedFile.hpp"
+#include "PrxModel.hpp"
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace prx {
+
+	// Binary copy of an imported model, written next to the source (model.obj -> model.obj.prxmesh)
+	//	after the first import. Later loads map the file and hand its vertex and index blobs straight
+	//	to the staging buffer, nothing is parsed or copied into vectors on the way.
+	//	A cache is only used if it was made from the same source bytes (by hash) with the same
+	//	importer, import flags and vertex layout, otherwise the model is imported again and the cache
+	//	rewritten.
+	//
+	// Layout (host byte order, every section 16 byte aligned):
+	//	Header | MeshEntryData[meshCount] | Vertex[vertexCount] | uint32_t[indexCount] | materials
+	//	where materials are, per MtlData, its fixed size part and then its name and texture path,
+	//	followed by the texture file paths. Strings are a uint32_t length and the characters.
+	//	Note: bump VERSION whenever any of these change
+	class PrxMeshCache
+	{
+	public:
+		static constexpr uint32_t MAGIC = 0x4D585250; // "PRXM"
+		static constexpr uint32_t VERSION = 5; // 2: one texture file path per material, 3: multi mesh models were imported over each other, 4: reordered by PrxMeshOptimizer, 5: assimp material parameters
+
+		// which loader made the data, the same import flags mean different things to each
+		enum class Importer : uint32_t {
+			Assimp = 0,
+			TinyObj = 1,
+		};
+
+		// what a cache is keyed on, besides the vertex layout
+		struct Key {
+			uint64_t sourceHash = 0;
+			Importer importer = Importer::Assimp;
+			uint32_t importFlags = 0;
+		};
+
+		static std::string getCachePath(const std::string& sourcePath) { return sourcePath + ".prxmesh"; }
+		// Hash of the file's bytes, read through a mapping. Throws if the file can't be read
+		static uint64_t hashFile(const std::string& filepath);
+
+		PrxMeshCache() = default;
+
+		// do not allow for copying, the views point into the mapping
+		PrxMeshCache(const PrxMeshCache&) = delete;
+		PrxMeshCache& operator=(const PrxMeshCache&) = delete;
+
+		// Maps the cache, returns false (and stays closed) if it is missing, made with another key
+		//	or layout, or cut short
+		bool open(const std::string& cachePath, const Key& key);
+		void close();
+
+		// Returns false if the cache couldn't be written (e.g. a read only models folder), which is
+		//	not an error, the model just gets imported again next time
+		static bool write(const std::string& cachePath, const Key& key,
+			const PrxModel::ModelData& data, const PrxModel::Bounds& bounds);
+		static bool write(const std::string& cachePath, const Key& key,
+			const PrxModel::OldModelData& data, const PrxModel::Bounds& bounds);
+
+		// views into the mapping, valid until close()
+		const PrxModel::Vertex* getVertices() const { return vertices; }
+		uint32_t getVertexCount() const { return vertexCount; }
+		const uint32_t* getIndices() const { return indices; }
+		uint32_t getIndexCount() const { return indexCount; }
+		const PrxModel::MeshEntryData* getMeshes() const { return meshes; }
+		uint32_t getMeshCount() const { return meshCount; }
+
+		const PrxModel::Bounds& getBounds() const { return bounds; }
+		const std::vector<PrxModel::MtlData>& getMaterials() const { return materials; }
+		const std::vector<std::string>& getTextureFilePaths() const { return textureFilePaths; }
+
+	private:
+		static bool write(const std::string& cachePath, const Key& key,
+			const std::vector<PrxModel::Vertex>& vertices, const std::vector<uint32_t>& indices,
+			const std::vector<PrxModel::MeshEntryData>& meshes, const PrxModel::Bounds& bounds,
+			const std::vector<PrxModel::MtlData>& materials, const std::vector<std::string>& textureFilePaths);
+
+		PrxMappedFile file{};
+
+		const PrxModel::Vertex* vertices = nullptr;
+		uint32_t vertexCount = 0;
+		const uint32_t* indices = nullptr;
+		uint32_t indexCount = 0;
+		const PrxModel::MeshEntryData* meshes = nullptr;
+		uint32_t meshCount = 0;
+
+		// small, so decoded out of the mapping
+		PrxModel::Bounds bounds{};
+		std::vector<PrxModel::MtlData> materials;
+		std::vector<std::string> textureFilePaths;
+	};
+}
@@ -0,0 +1,305 @@
+#include "PrxMeshOptimizer.hpp"
+#include "PrxParallel.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+
+namespace prx {
+
+	namespace {
+		// one mesh's slice of the model's vertices and indices
+		struct MeshRange {
+			uint32_t firstVertex;
+			uint32_t vertexCount;
+			uint32_t firstIndex;
+			uint32_t indexCount;
+		};
+
+		// the next vertex to fan around once the current one's candidates are all used up: the most
+		//	recently emitted vertex that still has triangles left, else the next one in input order
+		int64_t skipDeadEnd(std::vector<uint32_t>& deadEnds, const std::vector<uint32_t>& liveTriangles,
+			uint32_t& cursor, uint32_t vertexCount) {
+			while (!deadEnds.empty()) {
+				const uint32_t vertex = deadEnds.back();
+				deadEnds.pop_back();
+				if (liveTriangles[vertex] > 0) return vertex;
+			}
+			for (; cursor < vertexCount; cursor++) {
+				if (liveTriangles[cursor] > 0) return cursor++;
+			}
+			return -1;
+		}
+	}
+
+	void PrxMeshOptimizer::Stats::add(const Stats& other) {
+		triangleCount += other.triangleCount;
+		vertexCount += other.vertexCount;
+		cacheMisses += other.cacheMisses;
+	}
+
+	PrxMeshOptimizer::Report PrxMeshOptimizer::optimize(std::vector<PrxModel::Vertex>& vertices, std::vector<uint32_t>& indices,
+		const std::vector<PrxModel::MeshEntryData>& meshes) {
+
+		// a mesh's vertices end where the next triangle mesh's begin (non triangle meshes have no range)
+		std::vector<MeshRange> ranges;
+		if (meshes.empty()) {
+			ranges.push_back({ 0, static_cast<uint32_t>(vertices.size()), 0, static_cast<uint32_t>(indices.size()) });
+		}
+		for (size_t i = 0; i < meshes.size(); i++) {
+			if (meshes[i].numIndices == 0) continue;
+			uint32_t vertexEnd = static_cast<uint32_t>(vertices.size());
+			for (size_t j = i + 1; j < meshes.size(); j++) {
+				if (meshes[j].numIndices > 0) {
+					vertexEnd = meshes[j].baseVertex;
+					break;
+				}
+			}
+			ranges.push_back({ meshes[i].baseVertex, vertexEnd - meshes[i].baseVertex, meshes[i].baseIndex, meshes[i].numIndices });
+		}
+
+		// meshes don't share vertices or indices, so they are optimized in parallel like the import
+		const uint32_t rangeCount = static_cast<uint32_t>(ranges.size());
+		std::vector<Report> reports(rangeCount);
+		PrxParallel::forEachMesh(rangeCount, static_cast<uint32_t>(vertices.size()), [&](uint32_t i) {
+			const MeshRange& range = ranges[i];
+			assert(range.firstIndex + range.indexCount <= indices.size() && "Mesh indices out of range");
+			reports[i] = optimizeMesh(vertices.data() + range.firstVertex, range.vertexCount,
+				indices.data() + range.firstIndex, range.indexCount);
+		});
+
+		Report report{};
+		for (const Report& meshReport : reports) {
+			report.before.add(meshReport.before);
+			report.after.add(meshReport.after);
+		}
+		return report;
+	}
+
+	PrxMeshOptimizer::Report PrxMeshOptimizer::optimizeMesh(PrxModel::Vertex* vertices, uint32_t vertexCount,
+		uint32_t* indices, uint32_t indexCount) {
+		Report report{};
+		if (vertexCount == 0 || indexCount < 3 || indexCount % 3 != 0) return report;
+		// Note: a broken file can reference vertices of other meshes, such a mesh is left as it is
+		for (uint32_t i = 0; i < indexCount; i++) {
+			if (indices[i] >= vertexCount) return report;
+		}
+
+		report.before = analyze(indices, indexCount, vertexCount);
+		std::vector<uint32_t> clusterStarts;
+		optimizeVertexCache(indices, indexCount, vertexCount, clusterStarts);
+		optimizeOverdraw(indices, indexCount, vertices, clusterStarts);
+		optimizeVertexFetch(vertices, vertexCount, indices, indexCount);
+		report.after = analyze(indices, indexCount, vertexCount);
+		return report;
+	}
+
+	PrxMeshOptimizer::Stats PrxMeshOptimizer::analyze(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize) {
+		Stats stats{};
+		stats.triangleCount = indexCount / 3;
+
+		// FIFO: a vertex is a hit while fewer than cacheSize misses happened since it went in.
+		//	Starting the clock past cacheSize makes every vertex a miss at first
+		std::vector<uint32_t> cachedAt(vertexCount, 0);
+		std::vector<bool> referenced(vertexCount, false);
+		uint32_t time = cacheSize + 1;
+		for (uint32_t i = 0; i < indexCount; i++) {
+			const uint32_t vertex = indices[i];
+			assert(vertex < vertexCount && "Index out of range");
+			if (!referenced[vertex]) {
+				referenced[vertex] = true;
+				stats.vertexCount++;
+			}
+			if (time - cachedAt[vertex] > cacheSize) {
+				cachedAt[vertex] = time++;
+				stats.cacheMisses++;
+			}
+		}
+		return stats;
+	}
+
+	void PrxMeshOptimizer::optimizeVertexCache(uint32_t* indices, uint32_t indexCount, uint32_t vertexCount,
+		std::vector<uint32_t>& clusterStarts) {
+		const uint32_t triangleCount = indexCount / 3;
+		clusterStarts.clear();
+		if (triangleCount == 0) return;
+
+		// triangles around every vertex, in one array
+		std::vector<uint32_t> liveTriangles(vertexCount, 0);
+		for (uint32_t i = 0; i < indexCount; i++) {
+			liveTriangles[indices[i]]++;
+		}
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+		for (uint32_t v = 0; v < vertexCount; v++) {
+			adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+		}
+		std::vector<uint32_t> adjacency(indexCount);
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (uint32_t i = 0; i < indexCount; i++) {
+			adjacency[fill[indices[i]]++] = i / 3;
+		}
+
+		std::vector<uint32_t> output;
+		output.reserve(indexCount);
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<uint32_t> cachedAt(vertexCount, 0);
+		std::vector<uint32_t> deadEnds;
+		std::vector<uint32_t> candidates;
+		uint32_t time = CACHE_SIZE + 1;
+		uint32_t cursor = 0;
+
+		// Tipsify: emit every triangle around the fanning vertex, then move on to the candidate
+		//	(a vertex of those triangles) that will still be in the cache after its own fan
+		int64_t fanning = skipDeadEnd(deadEnds, liveTriangles, cursor, vertexCount);
+		clusterStarts.push_back(0);
+		while (fanning >= 0) {
+			candidates.clear();
+			for (uint32_t a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; a++) {
+				const uint32_t triangle = adjacency[a];
+				if (emitted[triangle]) continue;
+				for (uint32_t k = 0; k < 3; k++) {
+					const uint32_t vertex = indices[triangle * 3 + k];
+					output.push_back(vertex);
+					deadEnds.push_back(vertex);
+					candidates.push_back(vertex);
+					liveTriangles[vertex]--;
+					if (time - cachedAt[vertex] > CACHE_SIZE) {
+						cachedAt[vertex] = time++;
+					}
+				}
+				emitted[triangle] = true;
+			}
+
+			// a candidate whose remaining triangles would push it out of the cache scores 0,
+			//	otherwise the longer it has been in the cache the better
+			int64_t next = -1;
+			int64_t bestPriority = -1;
+			for (uint32_t vertex : candidates) {
+				if (liveTriangles[vertex] == 0) continue;
+				int64_t priority = 0;
+				const uint32_t age = time - cachedAt[vertex];
+				if (age + 2 * liveTriangles[vertex] <= CACHE_SIZE) {
+					priority = age;
+				}
+				if (priority > bestPriority) {
+					bestPriority = priority;
+					next = vertex;
+				}
+			}
+
+			// jumping to a dead end or the cursor starts over with a cold cache, that is where
+			//	clusters end (and optimizeOverdraw may reorder them)
+			if (next < 0) {
+				next = skipDeadEnd(deadEnds, liveTriangles, cursor, vertexCount);
+				const uint32_t emittedTriangles = static_cast<uint32_t>(output.size() / 3);
+				if (next >= 0 && emittedTriangles > clusterStarts.back()) {
+					clusterStarts.push_back(emittedTriangles);
+				}
+			}
+			fanning = next;
+		}
+
+		assert(output.size() == indexCount && "Tipsify didn't emit every triangle");
+		std::copy(output.begin(), output.end(), indices);
+	}
+
+	void PrxMeshOptimizer::optimizeOverdraw(uint32_t* indices, uint32_t indexCount, const PrxModel::Vertex* vertices,
+		const std::vector<uint32_t>& clusterStarts) {
+		const uint32_t triangleCount = indexCount / 3;
+		if (clusterStarts.empty()) return;
+
+		// merge small clusters into the one before them
+		std::vector<uint32_t> starts;
+		for (size_t i = 0; i < clusterStarts.size(); i++) {
+			if (starts.empty() || clusterStarts[i] - starts.back() >= MIN_CLUSTER_TRIANGLES) {
+				starts.push_back(clusterStarts[i]);
+			}
+		}
+		if (starts.size() < 2) return;
+		starts.push_back(triangleCount);
+
+		struct Cluster {
+			uint32_t firstTriangle;
+			uint32_t triangleCount;
+			glm::vec3 normal; // area weighted, so not normalized
+			glm::vec3 centroid;
+			float area;
+			float sortKey;
+		};
+		std::vector<Cluster> clusters(starts.size() - 1);
+
+		glm::vec3 meshCentroid{ 0.f };
+		float meshArea = 0.f;
+		for (size_t c = 0; c < clusters.size(); c++) {
+			Cluster& cluster = clusters[c];
+			cluster.firstTriangle = starts[c];
+			cluster.triangleCount = starts[c + 1] - starts[c];
+			cluster.normal = glm::vec3{ 0.f };
+			cluster.centroid = glm::vec3{ 0.f };
+			cluster.area = 0.f;
+
+			glm::vec3 averageCentroid{ 0.f };
+			for (uint32_t t = cluster.firstTriangle; t < cluster.firstTriangle + cluster.triangleCount; t++) {
+				const glm::vec3& p0 = vertices[indices[t * 3 + 0]].position;
+				const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+				const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+				const glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+				const float area = glm::length(cross);
+				const glm::vec3 centroid = (p0 + p1 + p2) / 3.f;
+
+				cluster.normal += cross;
+				cluster.centroid += centroid * area;
+				cluster.area += area;
+				averageCentroid += centroid;
+			}
+			// Note: clusters of only degenerate triangles have no area to weigh with
+			cluster.centroid = cluster.area > 0.f ? cluster.centroid / cluster.area : averageCentroid / static_cast<float>(cluster.triangleCount);
+			meshCentroid += cluster.centroid * cluster.area;
+			meshArea += cluster.area;
+		}
+		if (meshArea <= 0.f) return;
+		meshCentroid /= meshArea;
+
+		// clusters facing away from the middle of the mesh are the outside, drawn first they
+		//	occlude the rest (Sander et al.'s sort, without their per view occlusion measure)
+		for (Cluster& cluster : clusters) {
+			cluster.sortKey = glm::dot(cluster.normal, cluster.centroid - meshCentroid);
+		}
+		std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) {
+			return a.sortKey > b.sortKey;
+		});
+
+		std::vector<uint32_t> sorted;
+		sorted.reserve(indexCount);
+		for (const Cluster& cluster : clusters) {
+			sorted.insert(sorted.end(), indices + cluster.firstTriangle * 3,
+				indices + (cluster.firstTriangle + cluster.triangleCount) * 3);
+		}
+		std::copy(sorted.begin(), sorted.end(), indices);
+	}
+
+	void PrxMeshOptimizer::optimizeVertexFetch(PrxModel::Vertex* vertices, uint32_t vertexCount, uint32_t* indices, uint32_t indexCount) {
+		// vertices numbered in order of first use, unused ones go last
+		constexpr uint32_t UNUSED = ~0u;
+		std::vector<uint32_t> remap(vertexCount, UNUSED);
+		uint32_t nextVertex = 0;
+		for (uint32_t i = 0; i < indexCount; i++) {
+			assert(indices[i] < vertexCount && "Index out of range");
+			if (remap[indices[i]] == UNUSED) {
+				remap[indices[i]] = nextVertex++;
+			}
+			indices[i] = remap[indices[i]];
+		}
+		for (uint32_t v = 0; v < vertexCount; v++) {
+			if (remap[v] == UNUSED) {
+				remap[v] = nextVertex++;
+			}
+		}
+
+		std::vector<PrxModel::Vertex> reordered(vertexCount);
+		for (uint32_t v = 0; v < vertexCount; v++) {
+			reordered[remap[v]] = vertices[v];
+		}
+		std::copy(reordered.begin(), reordered.end(), vertices);
+	}
+}
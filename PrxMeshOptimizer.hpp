@@ -0,0 +1,63 @@
+#pragma once
+
+#include "PrxModel.hpp"
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace prx {
+
+	// Import time reordering of a model's triangles and vertices for the GPU, run before the mesh
+	//	cache is written (so cached models load already optimized). Per mesh, in this order:
+	//	1. vertex cache: Tipsify (Sander, Nehab and Barczak 2007), fans triangles around vertices that
+	//	   are still in a simulated post-transform cache, so most vertices are shaded once
+	//	2. overdraw: Tipsify's clusters are sorted so the ones facing out of the mesh draw first and
+	//	   occlude the rest. Triangles only move between clusters, so the cache order mostly survives
+	//	3. vertex fetch: vertices are renumbered in the order the indices first use them
+	// Nothing changes what is drawn, only the order, so the BLAS and bounds don't care.
+	//
+	// Cache efficiency is measured on a FIFO cache of CACHE_SIZE entries:
+	//	ACMR, average cache misses per triangle (0.5 is the best a big grid can do, 3 is no reuse at all)
+	//	ATVR, average transforms per vertex (1 is every vertex shaded exactly once)
+	class PrxMeshOptimizer
+	{
+	public:
+		static constexpr uint32_t CACHE_SIZE = 16;
+		// smaller clusters are merged into the one before them, sorting many tiny ones would undo
+		//	the cache order for no real overdraw gain
+		static constexpr uint32_t MIN_CLUSTER_TRIANGLES = 64;
+
+		struct Stats {
+			uint32_t triangleCount = 0;
+			uint32_t vertexCount = 0;
+			uint32_t cacheMisses = 0;
+
+			float getAcmr() const { return triangleCount > 0 ? static_cast<float>(cacheMisses) / triangleCount : 0.f; }
+			float getAtvr() const { return vertexCount > 0 ? static_cast<float>(cacheMisses) / vertexCount : 0.f; }
+			void add(const Stats& other);
+		};
+
+		struct Report {
+			Stats before;
+			Stats after;
+		};
+
+		// Optimizes every mesh (or the whole model, if meshes is empty) in place, in parallel for big
+		//	models. Mesh indices have to be relative to the mesh's baseVertex, like the importers write them
+		static Report optimize(std::vector<PrxModel::Vertex>& vertices, std::vector<uint32_t>& indices,
+			const std::vector<PrxModel::MeshEntryData>& meshes);
+
+		// the steps on their own, for a single mesh with indices in [0, vertexCount)
+		static Stats analyze(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize = CACHE_SIZE);
+		// clusterStarts gets the first triangle of every cluster, for optimizeOverdraw
+		static void optimizeVertexCache(uint32_t* indices, uint32_t indexCount, uint32_t vertexCount,
+			std::vector<uint32_t>& clusterStarts);
+		static void optimizeOverdraw(uint32_t* indices, uint32_t indexCount, const PrxModel::Vertex* vertices,
+			const std::vector<uint32_t>& clusterStarts);
+		static void optimizeVertexFetch(PrxModel::Vertex* vertices, uint32_t vertexCount, uint32_t* indices, uint32_t indexCount);
+
+	private:
+		static Report optimizeMesh(PrxModel::Vertex* vertices, uint32_t vertexCount, uint32_t* indices, uint32_t indexCount);
+	};
+}
@@ -1,6 +1,11 @@
 #include "PrxModel.hpp"
+#include "PrxBvh.hpp"
+#include "PrxMeshCache.hpp"
+#include "PrxMeshOptimizer.hpp"
+#include "PrxParallel.hpp"
 #include "PrxRenderer.hpp" // used to access the default texture
 #include "PrxUtils.hpp"
+#include "PrxUploadContext.hpp"
 
 // lib
 #define TINYOBJLOADER_IMPLEMENTATION
@@ -10,9 +15,13 @@
 #include <glm/gtx/hash.hpp>
 
 // std
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstring>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 
 //start here tomorrow to get textures properly loaded in through here!
 
@@ -34,6 +43,51 @@ namespace std {
 
 namespace prx {
 
+	namespace {
+		bool openCache(PrxModel::LoadedData& data, const std::string& filepath, const PrxMeshCache::Key& key) {
+			data.cache = std::make_unique<PrxMeshCache>();
+			if (!data.cache->open(PrxMeshCache::getCachePath(filepath), key)) {
+				data.cache.reset();
+				return false;
+			}
+
+			// the bounds were computed when the cache was written
+			data.vertices = data.cache->getVertices();
+			data.vertexCount = data.cache->getVertexCount();
+			data.indices = data.cache->getIndices();
+			data.indexCount = data.cache->getIndexCount();
+			data.meshes.assign(data.cache->getMeshes(), data.cache->getMeshes() + data.cache->getMeshCount());
+			data.materials = data.cache->getMaterials();
+			data.materialTextureFilePaths = data.cache->getTextureFilePaths();
+			data.bounds = data.cache->getBounds();
+			data.blas = std::make_unique<PrxBvh>(PrxBvh::gatherTriangles(data.vertices, data.vertexCount,
+				data.indices, data.indexCount, data.meshes.data(), data.meshes.size()));
+			return true;
+		}
+
+		// Note: models load on worker threads, so the line is built first and printed in one go
+		void printOptimizeReport(const std::string& filepath, const PrxMeshOptimizer::Report& report) {
+			if (report.before.triangleCount == 0) return;
+			std::ostringstream line;
+			line << std::fixed << std::setprecision(3) << "Optimized " << filepath << ": ACMR "
+				<< report.before.getAcmr() << " -> " << report.after.getAcmr() << ", ATVR "
+				<< report.before.getAtvr() << " -> " << report.after.getAtvr() << "\n";
+			std::cout << line.str();
+		}
+
+		void useImported(PrxModel::LoadedData& data, const std::vector<PrxModel::Vertex>& importedVertices,
+			const std::vector<uint32_t>& importedIndices, const std::vector<PrxModel::MeshEntryData>& importedMeshes) {
+			data.vertices = importedVertices.data();
+			data.vertexCount = static_cast<uint32_t>(importedVertices.size());
+			data.indices = importedIndices.data();
+			data.indexCount = static_cast<uint32_t>(importedIndices.size());
+			data.meshes = importedMeshes;
+			data.bounds = PrxModel::computeBounds(data.vertices, data.vertexCount);
+			data.blas = std::make_unique<PrxBvh>(PrxBvh::gatherTriangles(data.vertices, data.vertexCount,
+				data.indices, data.indexCount, data.meshes.data(), data.meshes.size()));
+		}
+	}
+
 	PrxModel::PrxModel(PrxDevice& device, const PrxModel::OldModelData& data) : prxDevice{ device } {
 		/*texDescriptorPool = PrxDescriptorPool::Builder(prxDevice)
 			.setMaxSets(1) // increase this to 2 or more when making room for materials in the future
@@ -41,8 +95,11 @@ namespace prx {
 			.build();
 		texMatsDescriptorSets = std::vector<VkDescriptorSet>(1);*/
 		
-		createVertexBuffers(data.vertices);
-		createIndexBuffer(data.indices);
+		bounds = computeBounds(data.vertices.data(), static_cast<uint32_t>(data.vertices.size()));
+		createVertexBuffers(data.vertices.data(), static_cast<uint32_t>(data.vertices.size()));
+		createIndexBuffers(data.indices.data(), static_cast<uint32_t>(data.indices.size()));
+		materialData = data.mats;
+		blas = std::make_unique<PrxBvh>(PrxBvh::gatherTriangles(data));
 	}
 
 	/*PrxModel::PrxModel(PrxDevice& device, PrxModel::MeshEntryData& data) : prxDevice{device}, modelData{data} {
@@ -51,142 +108,208 @@ namespace prx {
 	}*/
 
 	PrxModel::PrxModel(PrxDevice& device, const PrxModel::ModelData& data) : prxDevice{device} {
-		createVertexBuffers(data.vertices);
-		createIndexBuffer(data.indices);
+		bounds = computeBounds(data.vertices.data(), static_cast<uint32_t>(data.vertices.size()));
+		meshes = data.meshes;
+		createVertexBuffers(data.vertices.data(), static_cast<uint32_t>(data.vertices.size()));
+		createIndexBuffers(data.indices.data(), static_cast<uint32_t>(data.indices.size()));
+		materialData = data.materials;
+		texFilePaths = data.textureFilePaths;
+		materialTextures.resize(texFilePaths.size());
+		blas = std::make_unique<PrxBvh>(PrxBvh::gatherTriangles(data));
 		// move the mesh data and texture data with std::move
 
 	}
 
+	PrxModel::PrxModel(PrxDevice& device, LoadedData& data) : prxDevice{ device } {
+		assert(data.blas != nullptr && "Model data wasn't loaded");
+		bounds = data.bounds;
+		meshes = data.meshes;
+		createVertexBuffers(data.vertices, data.vertexCount);
+		createIndexBuffers(data.indices, data.indexCount);
+		materialData = data.materials;
+		texFilePaths = data.materialTextureFilePaths;
+		materialTextures.resize(texFilePaths.size());
+		blas = std::move(data.blas);
+	}
+
 	PrxModel::~PrxModel() {
 		freeBuffers();
 	}
 
+	PrxModel::LoadedData::LoadedData() = default;
+	PrxModel::LoadedData::~LoadedData() = default;
+	PrxModel::LoadedData::LoadedData(LoadedData&&) noexcept = default;
+	PrxModel::LoadedData& PrxModel::LoadedData::operator=(LoadedData&&) noexcept = default;
+
+	PrxModel::LoadedData PrxModel::loadFromFileOld(const std::string& filepath) {
+		const PrxMeshCache::Key key{ PrxMeshCache::hashFile(filepath), PrxMeshCache::Importer::TinyObj, 0 };
+		LoadedData data{};
+		if (openCache(data, filepath, key)) return data;
+
+		data.importedOld = std::make_unique<OldModelData>();
+		data.importedOld->loadModel(filepath);
+		// optimized before the cache is written, so cached loads get it for free
+		printOptimizeReport(filepath, PrxMeshOptimizer::optimize(data.importedOld->vertices, data.importedOld->indices, {}));
+		useImported(data, data.importedOld->vertices, data.importedOld->indices, {});
+		data.materials = data.importedOld->mats;
+		// Note: failing to write the cache only costs the next load an import
+		PrxMeshCache::write(PrxMeshCache::getCachePath(filepath), key, *data.importedOld, data.bounds);
+		return data;
+	}
+
+	PrxModel::LoadedData PrxModel::loadFromFile(PrxDevice& device, const std::string& filepath) {
+		const PrxMeshCache::Key key{ PrxMeshCache::hashFile(filepath), PrxMeshCache::Importer::Assimp, ASSIMP_LOAD_FLAGS };
+		LoadedData data{};
+		if (openCache(data, filepath, key)) return data;
+
+		data.imported = std::make_unique<ModelData>(device);
+		data.imported->loadModel(filepath);
+		printOptimizeReport(filepath, PrxMeshOptimizer::optimize(data.imported->vertices, data.imported->indices, data.imported->meshes));
+		useImported(data, data.imported->vertices, data.imported->indices, data.imported->meshes);
+		data.materials = data.imported->materials;
+		data.materialTextureFilePaths = data.imported->textureFilePaths;
+		PrxMeshCache::write(PrxMeshCache::getCachePath(filepath), key, *data.imported, data.bounds);
+		return data;
+	}
+
 	std::unique_ptr<PrxModel> PrxModel::createModelFromFileOld(PrxDevice& device, const std::string& filepath) {
-		OldModelData builder{};
-		builder.loadModel(filepath);
-		return std::make_unique<PrxModel>(device, builder);
+		LoadedData data = loadFromFileOld(filepath);
+		return std::make_unique<PrxModel>(device, data);
 	}
 
 	std::unique_ptr<PrxModel> PrxModel::createModelFromFile(PrxDevice& device, const std::string& filepath) {
-		ModelData builder{ device };
-		builder.loadModel(filepath);
-		return std::make_unique<PrxModel>(device, builder);
+		LoadedData data = loadFromFile(device, filepath);
+		return std::make_unique<PrxModel>(device, data);
 	}
 
-	void PrxModel::createVertexBuffers(const std::vector<Vertex>& vertices) {
-		vertexCount = static_cast<uint32_t>(vertices.size());
+	PrxModel::Bounds PrxModel::computeBounds(const Vertex* vertices, uint32_t vertexCount) {
+		assert(vertexCount > 0 && "Bounds need at least one vertex");
 
-		assert(vertexCount >= 3 && "Vertex count must be at least 3");
-		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
-		uint32_t vertexSize = sizeof(vertices[0]);
-
-		PrxBuffer stagingBuffer{
-			prxDevice,
-			vertexSize,
-			vertexCount,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		};
+		Bounds bounds{};
+		// center on the box around the vertices, radius out to the furthest one
+		glm::vec3 minPosition = vertices[0].position;
+		glm::vec3 maxPosition = vertices[0].position;
+		for (uint32_t i = 0; i < vertexCount; i++) {
+			minPosition = glm::min(minPosition, vertices[i].position);
+			maxPosition = glm::max(maxPosition, vertices[i].position);
+		}
+		bounds.min = minPosition;
+		bounds.max = maxPosition;
+		bounds.center = (minPosition + maxPosition) * .5f;
+		float radiusSquared = 0.f;
+		for (uint32_t i = 0; i < vertexCount; i++) {
+			glm::vec3 offset = vertices[i].position - bounds.center;
+			radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+		}
+		bounds.radius = std::sqrt(radiusSquared);
+		return bounds;
+	}
 
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*)vertices.data()); // MUST cast to a void*
+	void PrxModel::createVertexBuffers(const Vertex* vertices, uint32_t vertexCount) {
+		this->vertexCount = vertexCount;
 
-		vertexBuffer = std::make_unique<PrxBuffer>(
-			prxDevice,
-			vertexSize,
-			vertexCount,
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-		);
+		assert(vertexCount >= 3 && "Vertex count must be at least 3");
 
-		// copy the staging buffer to the vertex buffer
-		prxDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+		// staging + copy is batched with every other upload, see PrxUploadContext.
+		//	Note: quantized layouts are relative to the bounds, so those have to be computed by now
+		PrxGeometryArena& arena = prxDevice.getGeometryArena();
+		positionDecode = arena.getLayout().getPositionDecode(bounds.min, bounds.max);
+		vertexRange = arena.allocateVertices(vertices, vertexCount, positionDecode);
 
 	}
 
-	void PrxModel::createIndexBuffer(const std::vector<uint32_t>& indices) {
-		indexCount = static_cast<uint32_t>(indices.size());
+	void PrxModel::createIndexBuffers(const uint32_t* indices, uint32_t indexCount) {
+		this->indexCount = indexCount;
 		hasIndexBuffer = indexCount > 0;
 
+		drawRanges.clear();
 		if (!hasIndexBuffer) return;
 
-		VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
-		uint32_t indexSize = sizeof(indices[0]);
-
-		PrxBuffer stagingBuffer{
-			prxDevice,
-			indexSize,
-			indexCount,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		// each draw range gets its own index range, as uint16_t whenever its indices fit.
+		//	Note: mesh indices count from the mesh's first vertex, so even meshes of a big model
+		//	usually fit, and each mesh needs its own vertexOffset
+		PrxGeometryArena& arena = prxDevice.getGeometryArena();
+		auto addRange = [&](uint32_t baseIndex, uint32_t count, uint32_t baseVertex, uint32_t materialIndex) {
+			const uint32_t* rangeIndices = indices + baseIndex;
+			PrxGeometryArena::IndexRange indexRange = arena.allocateIndices(rangeIndices, count,
+				PrxGeometryArena::smallestIndexType(rangeIndices, count));
+			indexRanges.push_back(indexRange);
+			drawRanges.push_back({ count, indexRange.first, static_cast<int32_t>(vertexRange.first + baseVertex),
+				materialIndex, indexRange.indexType });
 		};
 
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*)indices.data());
-
-		indexBuffer = std::make_unique<PrxBuffer>(
-			prxDevice,
-			indexSize,
-			indexCount,
-			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-		);
-
-		// copy the staging buffer to the vertex buffer
-		prxDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
+		// tinyobj models have no meshes, their indices cover the whole model
+		if (meshes.empty()) {
+			addRange(0, indexCount, 0, 0);
+			return;
+		}
 
+		for (const MeshEntryData& mesh : meshes) {
+			if (mesh.numIndices == 0) continue; // not triangles, nothing was imported for it
+			addRange(mesh.baseIndex, mesh.numIndices, mesh.baseVertex, mesh.matIntex);
+		}
 	}
 
 	void PrxModel::freeBuffers() {
-		indexBuffer.reset();
-		vertexBuffer.reset();
+		PrxGeometryArena& arena = prxDevice.getGeometryArena();
+		for (PrxGeometryArena::IndexRange& indexRange : indexRanges) {
+			arena.freeIndices(indexRange);
+		}
+		indexRanges.clear();
+		arena.freeVertices(vertexRange);
 	}
 
-	void PrxModel::draw(VkCommandBuffer commandBuffer) {
+	void PrxModel::draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance) {
 
 
 		if (hasIndexBuffer) {
-			vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+			// the ranges can mix index widths, see PrxGeometryArena
+			PrxGeometryArena& arena = prxDevice.getGeometryArena();
+			for (uint32_t i = 0; i < drawRanges.size(); i++) {
+				const DrawRange& range = drawRanges[i];
+				if (i == 0 || range.indexType != drawRanges[i - 1].indexType) {
+					arena.bindIndices(commandBuffer, range.indexType);
+				}
+				vkCmdDrawIndexed(commandBuffer, range.indexCount, instanceCount,
+					range.firstIndex, range.vertexOffset, firstInstance);
+			}
 		}
 		else {
-			vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+			vkCmdDraw(commandBuffer, vertexCount, instanceCount, vertexRange.first, firstInstance);
 		}
 
 	}
 
-	void PrxModel::bind(VkCommandBuffer commandBuffer, int baseVertex) {
-		VkBuffer buffers[] = { vertexBuffer->getBuffer() };
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(commandBuffer, baseVertex, 1, buffers, offsets);
+	void PrxModel::drawMesh(VkCommandBuffer commandBuffer, uint32_t rangeIndex, uint32_t instanceCount, uint32_t firstInstance) {
+		assert(rangeIndex < drawRanges.size() && "Draw range out of range");
+		const DrawRange& range = drawRanges[rangeIndex];
+		vkCmdDrawIndexed(commandBuffer, range.indexCount, instanceCount, range.firstIndex, range.vertexOffset, firstInstance);
+	}
 
-		if (hasIndexBuffer) {
-			vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
-		}
+	void PrxModel::setMaterialTexture(uint32_t materialIndex, std::shared_ptr<PrxTexture> texture) {
+		assert(materialIndex < materialTextures.size() && "Material out of range");
+		materialTextures[materialIndex] = std::move(texture);
+	}
+
+	const std::shared_ptr<PrxTexture>& PrxModel::getMaterialTexture(uint32_t materialIndex) const {
+		static const std::shared_ptr<PrxTexture> none{};
+		return materialIndex < materialTextures.size() ? materialTextures[materialIndex] : none;
+	}
 
+	void PrxModel::bind(VkCommandBuffer commandBuffer) {
+		const VkIndexType indexType = drawRanges.empty() ? VK_INDEX_TYPE_UINT32 : drawRanges[0].indexType;
+		prxDevice.getGeometryArena().bind(commandBuffer, indexType);
 	}
 
 
 	// Note: you could just return a vector containing a single struct with the 3
 	//	fields below as its data, but for readability purposes, that's not done here.
 	std::vector<VkVertexInputBindingDescription> PrxModel::Vertex::getBindingDescriptions() {
-
-		std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
-		bindingDescriptions[0].binding = 0;
-		bindingDescriptions[0].stride = sizeof(Vertex);
-		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-		return bindingDescriptions;
+		return PrxVertexLayout::full().getBindingDescriptions();
 	};
 
 	std::vector<VkVertexInputAttributeDescription> PrxModel::Vertex::getAttributeDescriptions() {
-		std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
-
-		attributeDescriptions.push_back({ 0,0,VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position) });
-		attributeDescriptions.push_back({ 1,0,VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color) });
-		attributeDescriptions.push_back({ 2,0,VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal) });
-		attributeDescriptions.push_back({ 3,0,VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, uv) });
-
-		return attributeDescriptions;
+		return PrxVertexLayout::full().getAttributeDescriptions();
 	};
 
 	bool PrxModel::OldModelData::loadModel(const std::string& filepath) {
@@ -307,7 +430,8 @@ namespace prx {
 
 	bool PrxModel::ModelData::initFromScene(const aiScene* pScene, const std::string& filepath) {
 		meshes.resize(pScene->mNumMeshes);
-		textureFilePaths.resize(pScene->mNumTextures);
+		materials.resize(pScene->mNumMaterials);
+		textureFilePaths.resize(pScene->mNumMaterials);
 		
 		int numVerts = 0;
 		int numIndices = 0;
@@ -317,10 +441,11 @@ namespace prx {
 
 		reserveSpace(numVerts, numIndices);
 
-		for (int i = 0; i < meshes.size(); i++) {
-			const aiMesh* paiMesh = pScene->mMeshes[i];
-			initSingleMesh(paiMesh);
-		}
+		// every mesh writes its own range of vertices and indices, so big models fill them in parallel
+		PrxParallel::forEachMesh(static_cast<uint32_t>(meshes.size()), static_cast<uint32_t>(numVerts), [&](uint32_t i) {
+			if (meshes[i].numIndices == 0) return; // not triangles, see countVerticesAndIndices
+			initSingleMesh(pScene->mMeshes[i], meshes[i]);
+		});
 
 		if (!initMaterials(pScene, filepath)) {
 			return false;
@@ -353,13 +478,17 @@ namespace prx {
 		indices.resize(numIndices);
 	}
 
-	void PrxModel::ModelData::initSingleMesh(const aiMesh* paiMesh) {
+	void PrxModel::ModelData::initSingleMesh(const aiMesh* paiMesh, const MeshEntryData& mesh) {
 		const aiVector3D zero3D(0.0f, 0.0f, 0.0f);
 		const aiColor4D white(1.0f, 1.0f, 1.0f, 1.0f);
 
+		// the mesh's own ranges, indices stay relative to its first vertex (draws add baseVertex)
+		Vertex* meshVertices = vertices.data() + mesh.baseVertex;
+		uint32_t* meshIndices = indices.data() + mesh.baseIndex;
+
 		for (int i = 0; i < paiMesh->mNumVertices; i++) {
 			const aiVector3D& pPos = paiMesh->mVertices[i];
-			const aiVector3D& pNormal = paiMesh->mNormals[i];
+			const aiVector3D& pNormal = paiMesh->HasNormals() ? paiMesh->mNormals[i] : zero3D;
 			const aiVector3D& pUV = paiMesh->HasTextureCoords(0) ? paiMesh->mTextureCoords[0][i] : zero3D;
 			const aiColor4D& pColor = paiMesh->HasVertexColors(0) ? paiMesh->mColors[0][i] : white;
 			
@@ -368,7 +497,7 @@ namespace prx {
 				glm::vec3(pNormal.x, pNormal.y, pNormal.z),
 				glm::vec2(pUV.x, pUV.y) };
 
-			vertices[i] = v;
+			meshVertices[i] = v;
 			
 		}
 
@@ -376,9 +505,9 @@ namespace prx {
 			const aiFace& face = paiMesh->mFaces[i];
 			assert(face.mNumIndices == 3 && "face does not contain exactly 3 indices");
 			size_t indexArrSlot = i * 3;
-			indices[indexArrSlot] = static_cast<uint32_t>(face.mIndices[0]);
-			indices[indexArrSlot + 1] = static_cast<uint32_t>(face.mIndices[1]);
-			indices[indexArrSlot + 2] = static_cast<uint32_t>(face.mIndices[2]);
+			meshIndices[indexArrSlot] = static_cast<uint32_t>(face.mIndices[0]);
+			meshIndices[indexArrSlot + 1] = static_cast<uint32_t>(face.mIndices[1]);
+			meshIndices[indexArrSlot + 2] = static_cast<uint32_t>(face.mIndices[2]);
 		}
 	}
 
@@ -400,9 +529,28 @@ namespace prx {
 
 		for (int i = 0; i < pScene->mNumMaterials; i++) {
 			const aiMaterial* pMaterial = pScene->mMaterials[i];
-			
 
-			if (textureFilePaths.size() > 0) textureFilePaths[i] = "";
+			// Note: keys the file doesn't set keep these defaults
+			MtlData& material = materials[i];
+			material.name = pMaterial->GetName().C_Str();
+			auto getColor = [pMaterial](const char* key, unsigned int type, unsigned int index, glm::vec3 fallback) {
+				aiColor3D color{ fallback.x, fallback.y, fallback.z };
+				pMaterial->Get(key, type, index, color);
+				return glm::vec3{ color.r, color.g, color.b };
+			};
+			material.diffuse = getColor(AI_MATKEY_COLOR_DIFFUSE, glm::vec3{ .6f });
+			material.specular = getColor(AI_MATKEY_COLOR_SPECULAR, glm::vec3{ 0.f });
+			material.ambient = getColor(AI_MATKEY_COLOR_AMBIENT, glm::vec3{ 0.f });
+			material.emission = getColor(AI_MATKEY_COLOR_EMISSIVE, glm::vec3{ 0.f });
+			material.transmittance = getColor(AI_MATKEY_COLOR_TRANSPARENT, glm::vec3{ 0.f });
+			material.opacity = 1.f;
+			pMaterial->Get(AI_MATKEY_OPACITY, material.opacity);
+			material.shininess = 1.f;
+			pMaterial->Get(AI_MATKEY_SHININESS, material.shininess);
+			material.ior = 1.f;
+			pMaterial->Get(AI_MATKEY_REFRACTI, material.ior);
+
+			textureFilePaths[i] = "";
 			
 			if (pMaterial->GetTextureCount(aiTextureType_DIFFUSE) > 0) {
 				aiString path;
@@ -415,10 +563,9 @@ namespace prx {
 						p = p.substr(2, p.size() - 2);
 					}
 
-					std::string fullpath = dir + "/" + p;
-
-					// TODO: in the future, have textures added to a pool, and store the index on the model
-					//PrxTexture::makeTextureFromFile(prxDevice, fullpath);
+					// Note: only the path is kept, loading it here would decode the same image once
+					//	per model (or per material). PrxTextureCache does that once for all of them
+					textureFilePaths[i] = dir + "/" + p;
 				}
 			}
 		}
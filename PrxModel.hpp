@@ -4,6 +4,7 @@
 #include "PrxDescriptors.hpp"
 #include "PrxTexture.hpp"
 #include "PrxMaterial.hpp"
+#include "PrxGeometryArena.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS 
@@ -21,6 +22,11 @@
 
 namespace prx {
 
+	class PrxBvh; // PrxBvh.hpp needs PrxModel's vertex types, so only forward declared here
+	class PrxMeshCache; // same for PrxMeshCache.hpp
+
+	// Geometry lives in the device's PrxGeometryArena, a model is only the ranges it got there
+	//	(plus its bounds, BLAS and materials). Every model draws from the same bound buffers.
 	class PrxModel
 	{
 	public:
@@ -34,6 +40,8 @@ namespace prx {
 			// this is inefficient - better way is to store per-face, but its what we're rolling with now
 			int mat_id = 0;
 
+			// the unquantized arena layout (PrxVertexLayout::full), mat_id never reaches the GPU.
+			//	Pipelines that draw from the geometry arena should use its own layout instead
 			static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
 			static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
 
@@ -45,6 +53,14 @@ namespace prx {
 			}
 		};
 
+		// model space bounding volumes of every vertex, computed once when the vertices are loaded
+		struct Bounds {
+			glm::vec3 min{}; // axis aligned box
+			glm::vec3 max{};
+			glm::vec3 center{};
+			float radius = 0.f; // sphere around center
+		};
+
 		struct MtlData {
 			std::string name;
 
@@ -93,13 +109,18 @@ namespace prx {
 			std::vector<uint32_t> indices;
 
 			std::vector<MeshEntryData> meshes;
+			// parameters of each material, indexed like matIntex
+			std::vector<MtlData> materials;
+			// diffuse texture of each material (indexed like matIntex), empty if it has none.
+			//	Load them through a PrxTextureCache, materials tend to share them
 			std::vector<std::string> textureFilePaths;
 
 			PrxDevice& prxDevice;
 
 			bool loadModel(const std::string& filepath);
 			bool initFromScene(const aiScene* pScene, const std::string& filepath);
-			void initSingleMesh(const aiMesh* paiMesh);
+			// writes the mesh at its baseVertex/baseIndex. Safe to run for different meshes at once
+			void initSingleMesh(const aiMesh* paiMesh, const MeshEntryData& mesh);
 			bool initMaterials(const aiScene* pScene, const std::string& filepath);
 
 			// helpers
@@ -108,8 +129,46 @@ namespace prx {
 
 		};
 
+		// A model read and processed on the CPU (imported, or mapped from its mesh cache, with its
+		//	bounds and BLAS) but not on the GPU yet. Making one touches no Vulkan state, so it can
+		//	happen on any thread (see PrxAssetLoader), only creating the PrxModel has to be on the main one
+		struct LoadedData {
+			// views into whichever of imported, importedOld or cache holds the data
+			const Vertex* vertices = nullptr;
+			uint32_t vertexCount = 0;
+			const uint32_t* indices = nullptr;
+			uint32_t indexCount = 0;
+			std::vector<MeshEntryData> meshes;
+			std::vector<MtlData> materials; // see ModelData::materials
+			std::vector<std::string> materialTextureFilePaths; // see ModelData::textureFilePaths
+			Bounds bounds{};
+			std::unique_ptr<PrxBvh> blas;
+
+			std::unique_ptr<ModelData> imported;
+			std::unique_ptr<OldModelData> importedOld;
+			std::unique_ptr<PrxMeshCache> cache;
+
+			// Note: out of line, PrxBvh and PrxMeshCache are incomplete here
+			LoadedData();
+			~LoadedData();
+			LoadedData(LoadedData&&) noexcept;
+			LoadedData& operator=(LoadedData&&) noexcept;
+		};
+
+		// one vkCmdDrawIndexed worth of the model (one mesh), already offset into the geometry arena
+		struct DrawRange {
+			uint32_t indexCount;
+			uint32_t firstIndex; // in indices of indexType
+			int32_t vertexOffset;
+			uint32_t materialIndex; // the mesh's matIntex
+			VkIndexType indexType; // UINT16 unless the mesh needs more, the arena has to be bound with it
+		};
+
 		PrxModel(PrxDevice& device, const PrxModel::OldModelData &data);
 		PrxModel(PrxDevice& device, const PrxModel::ModelData& data);
+		// uploads straight from the loaded data (so from the cache's mapping, if it came from
+		//	there) and takes its BLAS. The data can be dropped once this returns
+		PrxModel(PrxDevice& device, LoadedData& data);
 		~PrxModel();
 
 		// do not allow for copying
@@ -117,13 +176,47 @@ namespace prx {
 		PrxModel(const PrxModel&) = delete;
 		void operator=(const PrxModel&) = delete;
 
+		// Both load from the file's mesh cache if it is up to date, and import the file (then write the
+		//	cache) otherwise, see PrxMeshCache. Safe to call from any thread
+		static LoadedData loadFromFileOld(const std::string& filepath);
+		static LoadedData loadFromFile(PrxDevice& device, const std::string& filepath);
 		static std::unique_ptr<PrxModel> createModelFromFileOld(PrxDevice& device, const std::string& filepath);
 		static std::unique_ptr<PrxModel> createModelFromFile(PrxDevice& device, const std::string& filepath);
+
+		static Bounds computeBounds(const Vertex* vertices, uint32_t vertexCount);
 		
-		void bind(VkCommandBuffer commandBuffer, int baseVertex = 0);
-		void draw(VkCommandBuffer commandBuffer);
-		
-		void drawAssimp(VkCommandBuffer commandBuffer);
+		// binds the geometry arena, which is the same for every model. Draw loops should bind it
+		//	once up front (PrxGeometryArena::bind) rather than per model
+		void bind(VkCommandBuffer commandBuffer);
+		// one draw per mesh of the model (see getDrawRanges), rebinding the arena's index buffer
+		//	whenever the index width changes
+		//	firstInstance shows up in the shader's gl_InstanceIndex, so instances can index a buffer with it
+		void draw(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+		// just one of the draw ranges, for draws that pick a material per mesh.
+		//	Note: doesn't bind anything, the index buffer has to be bound as the range's indexType
+		void drawMesh(VkCommandBuffer commandBuffer, uint32_t rangeIndex, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+
+		const Bounds& getBounds() const { return bounds; }
+		// turns the arena's (possibly quantized) positions back into model space, see GameObjectBufferData
+		const PrxVertexLayout::PositionDecode& getPositionDecode() const { return positionDecode; }
+		bool hasIndices() const { return hasIndexBuffer; }
+		uint32_t getIndexCount() const { return indexCount; }
+		// where the model's vertices start in the arena
+		int32_t getVertexOffset() const { return static_cast<int32_t>(vertexRange.first); }
+		// indexed models only, one per mesh with triangles (or one for the whole model if it has no meshes)
+		const std::vector<DrawRange>& getDrawRanges() const { return drawRanges; }
+		// empty for tinyobj models, their indices cover the whole model
+		const std::vector<MeshEntryData>& getMeshes() const { return meshes; }
+		// parameters of every material as loaded, indexed like matIntex
+		const std::vector<MtlData>& getMaterials() const { return materialData; }
+
+		// Diffuse texture per material, by path. The model doesn't load them itself (PrxAssetLoader
+		//	does, through the texture cache), until then, or if the material has none, it's null
+		const std::vector<std::string>& getMaterialTextureFilePaths() const { return texFilePaths; }
+		void setMaterialTexture(uint32_t materialIndex, std::shared_ptr<PrxTexture> texture);
+		const std::shared_ptr<PrxTexture>& getMaterialTexture(uint32_t materialIndex) const;
+		// triangle BVH of the whole model (bottom level acceleration structure), built at load
+		const PrxBvh& getBlas() const { return *blas; }
 
 		std::unique_ptr<PrxDescriptorPool> texDescriptorPool;
 		std::vector<VkDescriptorSet> texMatsDescriptorSets;
@@ -134,25 +227,33 @@ namespace prx {
 
 		PrxModel(PrxDevice& device);
 
-		void createVertexBuffers(const std::vector<Vertex>& vertices);
-		void createIndexBuffer(const std::vector<uint32_t>& indices);
+		void createVertexBuffers(const Vertex* vertices, uint32_t vertexCount);
+		// also builds the draw ranges, so meshes and the vertex range have to be set first
+		void createIndexBuffers(const uint32_t* indices, uint32_t indexCount);
 
 		void freeBuffers();
 
 		PrxDevice& prxDevice;
 
-		std::unique_ptr<PrxBuffer> vertexBuffer;
+		PrxGeometryArena::Range vertexRange{};
 		uint32_t vertexCount;
+		PrxVertexLayout::PositionDecode positionDecode{};
 
-		std::unique_ptr<PrxBuffer> indexBuffer;
+		std::vector<PrxGeometryArena::IndexRange> indexRanges; // one per draw range
 		uint32_t indexCount;
+		std::vector<DrawRange> drawRanges;
 
 		std::vector<MeshEntryData> meshes;
 		std::vector<std::unique_ptr<PrxMaterial>> materials;
+		std::vector<MtlData> materialData;
 		std::vector<std::string> texFilePaths;
+		std::vector<std::shared_ptr<PrxTexture>> materialTextures; // lined up with texFilePaths
 
 		bool hasIndexBuffer = false;
 
+		Bounds bounds{};
+		std::unique_ptr<PrxBvh> blas;
+
 	};
 }
 
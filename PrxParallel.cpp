@@ -0,0 +1,93 @@
+#include "PrxParallel.hpp"
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace prx {
+
+	namespace {
+		thread_local bool workerThread = false;
+	}
+
+	void PrxParallel::forEachMesh(uint32_t meshCount, uint32_t vertexCount, const std::function<void(uint32_t)>& task) {
+		uint32_t threadCount = 1;
+		if (vertexCount >= MIN_VERTICES) {
+			threadCount = std::max(1u, std::min(getThreadCount(), meshCount));
+		}
+		run(threadCount, meshCount, task);
+	}
+
+	void PrxParallel::forEachRange(uint32_t count, uint32_t minRangeSize, const std::function<void(uint32_t, uint32_t)>& task) {
+		if (count == 0) return;
+
+		const uint32_t rangeCount = std::max(1u, std::min(getThreadCount(), count / std::max(1u, minRangeSize)));
+		// the first count % rangeCount ranges take one extra item
+		const uint32_t rangeSize = count / rangeCount;
+		const uint32_t remainder = count % rangeCount;
+		run(rangeCount, rangeCount, [&](uint32_t range) {
+			const uint32_t begin = range * rangeSize + std::min(range, remainder);
+			task(begin, begin + rangeSize + (range < remainder ? 1 : 0));
+		});
+	}
+
+	uint32_t PrxParallel::getThreadCount() {
+		return workerThread ? 1 : std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	void PrxParallel::run(uint32_t threadCount, uint32_t taskCount, const std::function<void(uint32_t)>& task) {
+		if (threadCount <= 1) {
+			for (uint32_t i = 0; i < taskCount; i++) {
+				task(i);
+			}
+			return;
+		}
+
+		// Note: an exception escaping a std::thread would terminate, so the helpers keep the first
+		//	one for the calling thread
+		std::atomic<uint32_t> nextTask{ 0 };
+		std::atomic<bool> failed{ false };
+		std::mutex errorMutex;
+		std::exception_ptr error{};
+		auto worker = [&]() {
+			for (uint32_t i = nextTask++; i < taskCount && !failed; i = nextTask++) {
+				try {
+					task(i);
+				}
+				catch (...) {
+					std::lock_guard<std::mutex> lock{ errorMutex };
+					if (error == nullptr) {
+						error = std::current_exception();
+					}
+					failed = true;
+				}
+			}
+		};
+
+		std::vector<std::thread> threads;
+		threads.reserve(threadCount - 1);
+		for (uint32_t i = 1; i < threadCount; i++) {
+			threads.emplace_back(worker);
+		}
+		worker();
+		for (auto& thread : threads) {
+			thread.join();
+		}
+
+		if (error != nullptr) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	void PrxParallel::markWorkerThread() {
+		workerThread = true;
+	}
+
+	bool PrxParallel::isWorkerThread() {
+		return workerThread;
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <functional>
+
+namespace prx {
+
+	// The one place import, processing and per frame scene code fans work out over threads.
+	//	Models are usually loaded on PrxAssetLoader's workers, which already keep every core busy,
+	//	so on a worker the work just runs on the calling thread. Anywhere else (e.g. a model loaded
+	//	synchronously on the main thread) it is spread over up to a thread per core.
+	class PrxParallel
+	{
+	public:
+		// below this many vertices a model's meshes are handled on the calling thread, threads would
+		//	cost more than they save
+		static constexpr uint32_t MIN_VERTICES = 1u << 16;
+
+		// Runs task(i) for every mesh i in [0, meshCount). Meshes are handed out one at a time, a few
+		//	huge ones next to many small ones still spread out.
+		//	The first exception a task throws stops the remaining meshes and is rethrown here, on
+		//	the calling thread, once every thread is done
+		static void forEachMesh(uint32_t meshCount, uint32_t vertexCount, const std::function<void(uint32_t)>& task);
+
+		// Runs task(begin, end) over [0, count) cut into up to one range per thread, none shorter
+		//	than minRangeSize. For loops over many cheap items (e.g. PrxTlas instances), where handing
+		//	them out one at a time would cost more than the items. Exceptions work like forEachMesh
+		static void forEachRange(uint32_t count, uint32_t minRangeSize, const std::function<void(uint32_t, uint32_t)>& task);
+
+		// threads worth fanning out to from the calling thread, 1 on a worker
+		static uint32_t getThreadCount();
+
+		// marks the calling thread as a pool worker for the rest of its life
+		static void markWorkerThread();
+		static bool isWorkerThread();
+
+	private:
+		// runs task(i) for every i in [0, taskCount) on threadCount threads, the calling one included
+		static void run(uint32_t threadCount, uint32_t taskCount, const std::function<void(uint32_t)>& task);
+	};
+}
@@ -0,0 +1,552 @@
+#include "PrxPathTracer.hpp"
+
+// libs
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+namespace prx {
+
+	namespace {
+		constexpr float PI = 3.14159265358979f;
+		// past this many bounces, paths are cut at random (and the survivors weighted up) instead of followed to the end
+		constexpr uint32_t RUSSIAN_ROULETTE_BOUNCE = 3;
+
+		float luminance(const glm::vec3& color) {
+			return glm::dot(color, glm::vec3{ .2126f, .7152f, .0722f });
+		}
+
+		glm::vec3 reflect(const glm::vec3& direction, const glm::vec3& normal) {
+			return direction - normal * (2.f * glm::dot(direction, normal));
+		}
+
+		// orthonormal basis around n (Duff et al. 2017)
+		void makeBasis(const glm::vec3& n, glm::vec3& tangent, glm::vec3& bitangent) {
+			const float sign = std::copysign(1.f, n.z);
+			const float a = -1.f / (sign + n.z);
+			const float b = n.x * n.y * a;
+			tangent = glm::vec3{ 1.f + sign * n.x * n.x * a, sign * b, -sign * n.x };
+			bitangent = glm::vec3{ b, sign + n.y * n.y * a, -n.y };
+		}
+
+		// direction around axis with the given cosine to it
+		glm::vec3 aroundAxis(const glm::vec3& axis, float cosTheta, float phi) {
+			glm::vec3 tangent, bitangent;
+			makeBasis(axis, tangent, bitangent);
+			const float sinTheta = std::sqrt(std::max(0.f, 1.f - cosTheta * cosTheta));
+			return tangent * (std::cos(phi) * sinTheta) + bitangent * (std::sin(phi) * sinTheta) + axis * cosTheta;
+		}
+
+		// pushes ray origins off the surface they start on, relative to how far from the origin it is
+		glm::vec3 offsetOrigin(const glm::vec3& position, const glm::vec3& side) {
+			const float scale = std::max({ 1.f, std::abs(position.x), std::abs(position.y), std::abs(position.z) });
+			return position + side * (1e-4f * scale);
+		}
+	}
+
+	// PCG32, seeded per pixel and sample
+	struct PrxPathTracer::Random {
+		uint64_t state;
+
+		Random(uint32_t pixel, uint32_t sample) {
+			// splitmix64, so neighbouring seeds don't give neighbouring sequences
+			uint64_t z = (static_cast<uint64_t>(sample) << 32 | pixel) + 0x9E3779B97F4A7C15ull;
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			state = z ^ (z >> 31);
+		}
+
+		uint32_t next() {
+			uint64_t old = state;
+			state = old * 6364136223846793005ull + 1442695040888963407ull;
+			uint32_t shifted = static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+			uint32_t rotation = static_cast<uint32_t>(old >> 59u);
+			return (shifted >> rotation) | (shifted << ((32 - rotation) & 31));
+		}
+
+		// [0, 1)
+		float nextFloat() { return (next() >> 8) * (1.f / 16777216.f); }
+	};
+
+	struct PrxPathTracer::Surface {
+		glm::vec3 position;
+		glm::vec3 normal; // geometric, facing the side the ray came from
+		bool frontFace; // the ray hit the side the triangle's winding faces
+	};
+
+	PrxPathTracer::Material PrxPathTracer::Material::fromMaterial(const PrxMaterial& material) {
+		Material result{};
+		result.diffuse = material.diffuse;
+		result.specular = material.specular;
+		result.emission = material.emission;
+		result.shininess = material.shininess;
+		result.ior = material.ior;
+		result.opacity = material.opacity;
+		return result;
+	}
+
+	PrxPathTracer::Material PrxPathTracer::Material::fromMtl(const PrxModel::MtlData& material) {
+		Material result{};
+		result.diffuse = material.diffuse;
+		result.specular = material.specular;
+		result.emission = material.emission;
+		result.shininess = material.shininess;
+		result.ior = material.ior;
+		result.opacity = material.opacity;
+		return result;
+	}
+
+	PrxPathTracer::PrxPathTracer(const Settings& settings) : settings{ settings } {
+		assert(settings.width > 0 && settings.height > 0 && "Image can't be empty");
+		assert(settings.tileSize > 0 && "Tiles can't be empty");
+		accumulation.resize(static_cast<size_t>(settings.width) * settings.height);
+	}
+
+	void PrxPathTracer::setScene(PrxGameObjectManager& gameObjectManager) {
+		sceneTlas.update(gameObjectManager);
+
+		const auto& instances = sceneTlas.getInstances();
+		const auto& entities = sceneTlas.getInstanceEntities();
+		std::vector<std::vector<Material>> instanceMaterials(instances.size());
+		std::vector<std::vector<uint32_t>> blasTriangleMaterials(sceneTlas.getBlases().size());
+		std::vector<bool> blasGathered(sceneTlas.getBlases().size(), false);
+		for (size_t i = 0; i < instances.size(); i++) {
+			const PrxModel& model = *gameObjectManager.registry.get<ModelComponent>(entities[i]).model;
+			const auto blasIndex = static_cast<size_t>(instances[i].accelerationStructureReference);
+			if (!blasGathered[blasIndex]) {
+				blasTriangleMaterials[blasIndex] = PrxBvh::gatherTriangleMaterials(model.getMeshes());
+				blasGathered[blasIndex] = true;
+			}
+
+			const MaterialComponent* component = gameObjectManager.registry.tryGet<MaterialComponent>(entities[i]);
+			const auto& modelMaterials = model.getMaterials();
+			const size_t materialCount = std::max(modelMaterials.size(), component != nullptr ? component->materials.size() : 0);
+			std::vector<Material>& objectMaterials = instanceMaterials[i];
+			objectMaterials.resize(std::max<size_t>(materialCount, 1));
+			for (size_t j = 0; j < materialCount; j++) {
+				if (component != nullptr && j < component->materials.size() && component->materials[j] != nullptr) {
+					objectMaterials[j] = Material::fromMaterial(*component->materials[j]);
+				}
+				else if (j < modelMaterials.size()) {
+					objectMaterials[j] = Material::fromMtl(modelMaterials[j]);
+				}
+			}
+		}
+
+		std::vector<PointLight> pointLights;
+		gameObjectManager.registry.view<TransformComponent, PointLightComponent>().each(
+			[&](PrxEntity entity, TransformComponent& transform, PointLightComponent& pointLight) {
+				pointLights.push_back(PointLight{ transform.translation, pointLight.color, pointLight.lightIntensity });
+			});
+
+		setScene(sceneTlas, std::move(instanceMaterials), std::move(blasTriangleMaterials), std::move(pointLights));
+	}
+
+	void PrxPathTracer::setScene(const PrxTlas& sceneTlas, std::vector<std::vector<Material>> instanceMaterials,
+		std::vector<std::vector<uint32_t>> blasTriangleMaterials, std::vector<PointLight> sceneLights) {
+		assert(instanceMaterials.size() == sceneTlas.getInstances().size() && "Every instance needs materials");
+		tlas = &sceneTlas;
+		materials = std::move(instanceMaterials);
+		triangleMaterials = std::move(blasTriangleMaterials);
+		triangleMaterials.resize(sceneTlas.getBlases().size());
+		lights = std::move(sceneLights);
+		for (const auto& instanceMaterial : materials) {
+			assert(!instanceMaterial.empty() && "Every instance needs at least one material");
+		}
+
+		const auto& blases = tlas->getBlases();
+		triangleSlots.resize(blases.size());
+		for (size_t i = 0; i < blases.size(); i++) {
+			const auto& triangleIndices = blases[i]->getTriangleIndices();
+			triangleSlots[i].resize(triangleIndices.size());
+			for (uint32_t slot = 0; slot < triangleIndices.size(); slot++) {
+				triangleSlots[i][triangleIndices[slot]] = slot;
+			}
+		}
+		reset();
+	}
+
+	void PrxPathTracer::setCamera(const PrxCamera& camera) {
+		inverseProjection = glm::inverse(camera.getProjection());
+		inverseView = camera.getInverseView();
+		reset();
+	}
+
+	void PrxPathTracer::reset() {
+		std::fill(accumulation.begin(), accumulation.end(), glm::vec3{ 0.f });
+		stats.sampleCount = 0;
+	}
+
+	void PrxPathTracer::render(uint32_t samplesPerPixel) {
+		for (uint32_t i = 0; i < samplesPerPixel; i++) {
+			renderPass();
+		}
+	}
+
+	void PrxPathTracer::renderPass() {
+		assert(tlas != nullptr && "Path tracer has no scene");
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		const uint32_t tilesX = (settings.width + settings.tileSize - 1) / settings.tileSize;
+		const uint32_t tilesY = (settings.height + settings.tileSize - 1) / settings.tileSize;
+		const uint32_t tileCount = tilesX * tilesY;
+
+		uint32_t threadCount = settings.threadCount != 0 ? settings.threadCount : std::thread::hardware_concurrency();
+		threadCount = std::max(1u, std::min(threadCount, tileCount));
+
+		// tiles are handed out one at a time, so threads that got cheap tiles (sky) just take more
+		std::atomic<uint32_t> nextTile{ 0 };
+		auto worker = [&]() {
+			for (uint32_t tile = nextTile++; tile < tileCount; tile = nextTile++) {
+				renderTile(tile);
+			}
+		};
+		std::vector<std::thread> threads;
+		threads.reserve(threadCount - 1);
+		for (uint32_t i = 1; i < threadCount; i++) {
+			threads.emplace_back(worker);
+		}
+		worker();
+		for (auto& thread : threads) {
+			thread.join();
+		}
+		stats.sampleCount++;
+
+		auto endTime = std::chrono::high_resolution_clock::now();
+		stats.threadCount = threadCount;
+		stats.passMilliseconds = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+		stats.samplesPerSecond = accumulation.size() / std::max(stats.passMilliseconds * 1e-3, 1e-9);
+	}
+
+	void PrxPathTracer::renderTile(uint32_t tileIndex) {
+		const uint32_t tilesX = (settings.width + settings.tileSize - 1) / settings.tileSize;
+		const uint32_t beginX = (tileIndex % tilesX) * settings.tileSize;
+		const uint32_t beginY = (tileIndex / tilesX) * settings.tileSize;
+		const uint32_t endX = std::min(beginX + settings.tileSize, settings.width);
+		const uint32_t endY = std::min(beginY + settings.tileSize, settings.height);
+
+		for (uint32_t y = beginY; y < endY; y++) {
+			for (uint32_t x = beginX; x < endX; x++) {
+				const uint32_t pixel = y * settings.width + x;
+				Random random{ pixel, stats.sampleCount };
+				// box filtered: a random spot in the pixel every pass
+				const float jitterX = random.nextFloat();
+				const float jitterY = random.nextFloat();
+				glm::vec3 radiance = tracePath(makeCameraRay(x + jitterX, y + jitterY), random);
+				// a stray NaN would stick in the accumulation forever
+				if (std::isfinite(radiance.x) && std::isfinite(radiance.y) && std::isfinite(radiance.z)) {
+					accumulation[pixel] += radiance;
+				}
+			}
+		}
+	}
+
+	PrxRay PrxPathTracer::makeCameraRay(float x, float y) const {
+		// Vulkan NDC: y points down, depth goes 0 (near) to 1 (far)
+		const float ndcX = x / settings.width * 2.f - 1.f;
+		const float ndcY = y / settings.height * 2.f - 1.f;
+		auto unproject = [&](float depth) {
+			glm::vec4 view = inverseProjection * glm::vec4{ ndcX, ndcY, depth, 1.f };
+			return glm::vec3(inverseView * glm::vec4(glm::vec3(view) / view.w, 1.f));
+		};
+
+		// from the near plane through the far plane, works for orthographic cameras as well
+		PrxRay ray{};
+		ray.origin = unproject(0.f);
+		ray.direction = glm::normalize(unproject(1.f) - ray.origin);
+		return ray;
+	}
+
+	glm::vec3 PrxPathTracer::tracePath(PrxRay ray, Random& random) const {
+		glm::vec3 radiance{ 0.f };
+		glm::vec3 throughput{ 1.f };
+
+		for (uint32_t bounce = 0; ; bounce++) {
+			PrxHit hit{};
+			if (!tlas->intersect(ray, hit)) {
+				radiance += throughput * settings.environment;
+				break;
+			}
+
+			const Material& material = getMaterial(hit);
+			const Surface surface = computeSurface(ray, hit);
+			const glm::vec3 toViewer = -ray.direction;
+			radiance += throughput * material.emission;
+			if (bounce == settings.maxBounces) break;
+
+			// the transparent part of the material, picked with odds of 1 - opacity
+			if (material.opacity < 1.f && random.nextFloat() >= material.opacity) {
+				glm::vec3 direction = ray.direction;
+				if (material.ior != 1.f) {
+					// dielectric: reflect or refract by Fresnel (Schlick)
+					const float eta = surface.frontFace ? 1.f / material.ior : material.ior;
+					const float cosIncident = glm::dot(toViewer, surface.normal);
+					const float sin2Transmitted = eta * eta * (1.f - cosIncident * cosIncident);
+					float r0 = (1.f - material.ior) / (1.f + material.ior);
+					r0 *= r0;
+					const float fresnel = r0 + (1.f - r0) * std::pow(1.f - cosIncident, 5.f);
+					if (sin2Transmitted >= 1.f || random.nextFloat() < fresnel) {
+						direction = reflect(ray.direction, surface.normal);
+					}
+					else {
+						const float cosTransmitted = std::sqrt(1.f - sin2Transmitted);
+						direction = glm::normalize(ray.direction * eta + surface.normal * (eta * cosIncident - cosTransmitted));
+					}
+				}
+				const float side = glm::dot(direction, surface.normal) >= 0.f ? 1.f : -1.f;
+				ray = PrxRay{ offsetOrigin(surface.position, surface.normal * side), 0.f, direction, FLT_MAX };
+				continue;
+			}
+
+			// point lights can only be reached by aiming at them
+			radiance += throughput * sampleLights(surface, toViewer, material);
+
+			// pick a lobe by how bright it is, then sample it
+			const float diffuseWeight = luminance(material.diffuse);
+			const float specularWeight = luminance(material.specular);
+			if (diffuseWeight + specularWeight <= 0.f) break;
+			const float diffuseOdds = diffuseWeight / (diffuseWeight + specularWeight);
+
+			glm::vec3 direction;
+			if (random.nextFloat() < diffuseOdds) {
+				// cosine weighted, so the cosine and 1/pi cancel against the pdf
+				const float u = random.nextFloat();
+				direction = aroundAxis(surface.normal, std::sqrt(1.f - u), 2.f * PI * random.nextFloat());
+				throughput *= material.diffuse / diffuseOdds;
+			}
+			else {
+				// normalized Phong, sampled around the mirror direction. What's left after the pdf is
+				//	specular * (n + 2) / (n + 1) * cos
+				const float exponent = std::max(material.shininess, 0.f);
+				const glm::vec3 mirror = reflect(ray.direction, surface.normal);
+				direction = aroundAxis(mirror, std::pow(random.nextFloat(), 1.f / (exponent + 1.f)), 2.f * PI * random.nextFloat());
+				const float cosine = glm::dot(direction, surface.normal);
+				if (cosine <= 0.f) break;
+				throughput *= material.specular * ((exponent + 2.f) / (exponent + 1.f) * cosine / (1.f - diffuseOdds));
+			}
+
+			if (bounce >= RUSSIAN_ROULETTE_BOUNCE) {
+				const float survival = std::min(std::max({ throughput.x, throughput.y, throughput.z }), .95f);
+				if (random.nextFloat() >= survival) break;
+				throughput /= survival;
+			}
+
+			ray = PrxRay{ offsetOrigin(surface.position, surface.normal), 0.f, direction, FLT_MAX };
+		}
+		return radiance;
+	}
+
+	const PrxPathTracer::Material& PrxPathTracer::getMaterial(const PrxHit& hit) const {
+		const std::vector<Material>& instanceMaterials = materials[hit.instance];
+		const auto blasIndex = static_cast<size_t>(tlas->getInstances()[hit.instance].accelerationStructureReference);
+		const std::vector<uint32_t>& blasMaterials = triangleMaterials[blasIndex];
+		// Note: indices past the instance's materials clamp to its last one
+		const uint32_t materialIndex = hit.triangle < blasMaterials.size() ? blasMaterials[hit.triangle] : 0;
+		return instanceMaterials[std::min<size_t>(materialIndex, instanceMaterials.size() - 1)];
+	}
+
+	PrxPathTracer::Surface PrxPathTracer::computeSurface(const PrxRay& ray, const PrxHit& hit) const {
+		const PrxTlasInstance& instance = tlas->getInstances()[hit.instance];
+		const uint32_t blasIndex = static_cast<uint32_t>(instance.accelerationStructureReference);
+		const PrxBvh& blas = *tlas->getBlases()[blasIndex];
+		const PrxBvh::Triangle& triangle = blas.getTriangles()[triangleSlots[blasIndex][hit.triangle]];
+
+		// edges taken into world space, so their cross product is the world normal for any transform
+		const glm::vec3 edge1 = triangle.v1 - triangle.v0;
+		const glm::vec3 edge2 = triangle.v2 - triangle.v0;
+		glm::vec3 worldEdge1, worldEdge2;
+		for (int row = 0; row < 3; row++) {
+			const float* m = instance.transform[row];
+			worldEdge1[row] = m[0] * edge1.x + m[1] * edge1.y + m[2] * edge1.z;
+			worldEdge2[row] = m[0] * edge2.x + m[1] * edge2.y + m[2] * edge2.z;
+		}
+
+		Surface surface{};
+		surface.position = ray.origin + ray.direction * hit.t;
+		surface.normal = glm::normalize(glm::cross(worldEdge1, worldEdge2));
+		surface.frontFace = glm::dot(surface.normal, ray.direction) < 0.f;
+		if (!surface.frontFace) {
+			surface.normal = -surface.normal;
+		}
+		return surface;
+	}
+
+	glm::vec3 PrxPathTracer::sampleLights(const Surface& surface, const glm::vec3& toViewer, const Material& material) const {
+		glm::vec3 radiance{ 0.f };
+		const glm::vec3 origin = offsetOrigin(surface.position, surface.normal);
+		for (const PointLight& light : lights) {
+			const glm::vec3 toLight = light.position - origin;
+			const float distanceSquared = glm::dot(toLight, toLight);
+			const float distance = std::sqrt(distanceSquared);
+			const glm::vec3 direction = toLight / distance;
+			const float cosine = glm::dot(direction, surface.normal);
+			if (cosine <= 0.f) continue;
+
+			// shadow ray, anything in between blocks it
+			PrxRay shadowRay{ origin, 0.f, direction, distance * (1.f - 1e-4f) };
+			PrxHit blocker{};
+			if (tlas->intersect(shadowRay, blocker)) continue;
+
+			// Note: the light's radiant intensity is color * intensity * pi, the pi cancels the
+			//	Lambert 1/pi so the diffuse term matches simple_shader.frag
+			const glm::vec3 intensity = light.color * (light.intensity * PI);
+			radiance += evaluateBsdf(material, surface.normal, toViewer, direction) * intensity * (cosine / distanceSquared);
+		}
+		return radiance;
+	}
+
+	glm::vec3 PrxPathTracer::evaluateBsdf(const Material& material, const glm::vec3& normal,
+		const glm::vec3& toViewer, const glm::vec3& toLight) const {
+		glm::vec3 value = material.diffuse * (1.f / PI);
+		if (luminance(material.specular) > 0.f) {
+			const float exponent = std::max(material.shininess, 0.f);
+			const float cosine = glm::dot(reflect(-toViewer, normal), toLight);
+			if (cosine > 0.f) {
+				value += material.specular * ((exponent + 2.f) / (2.f * PI) * std::pow(cosine, exponent));
+			}
+		}
+		// only the opaque part reflects
+		return value * material.opacity;
+	}
+
+	std::vector<glm::vec3> PrxPathTracer::getImage() const {
+		std::vector<glm::vec3> image(accumulation.size(), glm::vec3{ 0.f });
+		if (stats.sampleCount == 0) return image;
+
+		const float scale = 1.f / stats.sampleCount;
+		for (size_t i = 0; i < image.size(); i++) {
+			image[i] = accumulation[i] * scale;
+		}
+		return image;
+	}
+
+	void PrxPathTracer::writeImage(const std::string& filepath) const {
+		const std::vector<glm::vec3> image = getImage();
+		auto endsWith = [&](const char* extension) {
+			const size_t length = std::strlen(extension);
+			if (filepath.size() < length) return false;
+			return std::equal(extension, extension + length, filepath.end() - length,
+				[](char a, char b) { return a == std::tolower(static_cast<unsigned char>(b)); });
+		};
+
+		if (endsWith(".png")) {
+			writePng(filepath, image);
+		}
+		else if (endsWith(".exr")) {
+			writeExr(filepath, image);
+		}
+		else {
+			throw std::runtime_error("unsupported image format: " + filepath + ", expected .png or .exr!");
+		}
+	}
+
+	void PrxPathTracer::writePng(const std::string& filepath, const std::vector<glm::vec3>& image) const {
+		auto encode = [](float linear) {
+			linear = std::min(std::max(linear, 0.f), 1.f);
+			float srgb = linear <= .0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.f / 2.4f) - .055f;
+			return static_cast<uint8_t>(srgb * 255.f + .5f);
+		};
+
+		std::vector<uint8_t> pixels(image.size() * 3);
+		for (size_t i = 0; i < image.size(); i++) {
+			pixels[i * 3 + 0] = encode(image[i].x);
+			pixels[i * 3 + 1] = encode(image[i].y);
+			pixels[i * 3 + 2] = encode(image[i].z);
+		}
+		if (!stbi_write_png(filepath.c_str(), settings.width, settings.height, 3, pixels.data(), settings.width * 3)) {
+			throw std::runtime_error("failed to write image: " + filepath + "!");
+		}
+	}
+
+	void PrxPathTracer::writeExr(const std::string& filepath, const std::vector<glm::vec3>& image) const {
+		// Uncompressed scanline OpenEXR with B, G, R float channels (they have to be sorted by name).
+		//	Note: written as the host's bytes, EXR is little endian like every platform this runs on
+		std::ofstream file{ filepath, std::ios::binary };
+		if (!file) {
+			throw std::runtime_error("failed to write image: " + filepath + "!");
+		}
+
+		auto write = [&](const void* data, size_t size) { file.write(static_cast<const char*>(data), size); };
+		auto writeInt = [&](int32_t value) { write(&value, sizeof(value)); };
+		auto writeFloat = [&](float value) { write(&value, sizeof(value)); };
+		auto writeAttribute = [&](const char* name, const char* type, int32_t size) {
+			write(name, std::strlen(name) + 1);
+			write(type, std::strlen(type) + 1);
+			writeInt(size);
+		};
+
+		const int32_t width = static_cast<int32_t>(settings.width);
+		const int32_t height = static_cast<int32_t>(settings.height);
+		const uint8_t magic[4] = { 0x76, 0x2f, 0x31, 0x01 };
+		write(magic, sizeof(magic));
+		writeInt(2); // version 2, single part scanline
+
+		const char* channels[3] = { "B", "G", "R" };
+		writeAttribute("channels", "chlist", 3 * (2 + 16) + 1);
+		for (const char* channel : channels) {
+			write(channel, 2);
+			writeInt(2); // FLOAT
+			const uint8_t linearAndReserved[4] = { 0, 0, 0, 0 };
+			write(linearAndReserved, sizeof(linearAndReserved));
+			writeInt(1); // x sampling
+			writeInt(1); // y sampling
+		}
+		write("", 1);
+
+		const uint8_t noCompression = 0;
+		writeAttribute("compression", "compression", 1);
+		write(&noCompression, 1);
+		const int32_t window[4] = { 0, 0, width - 1, height - 1 };
+		writeAttribute("dataWindow", "box2i", 16);
+		write(window, sizeof(window));
+		writeAttribute("displayWindow", "box2i", 16);
+		write(window, sizeof(window));
+		const uint8_t increasingY = 0;
+		writeAttribute("lineOrder", "lineOrder", 1);
+		write(&increasingY, 1);
+		writeAttribute("pixelAspectRatio", "float", 4);
+		writeFloat(1.f);
+		writeAttribute("screenWindowCenter", "v2f", 8);
+		writeFloat(0.f);
+		writeFloat(0.f);
+		writeAttribute("screenWindowWidth", "float", 4);
+		writeFloat(1.f);
+		write("", 1); // end of header
+
+		// one offset per scanline, then the scanlines: y, byte count, then each channel's row
+		const uint64_t lineSize = 3ull * width * sizeof(float);
+		const uint64_t firstLine = static_cast<uint64_t>(file.tellp()) + height * sizeof(uint64_t);
+		for (int32_t y = 0; y < height; y++) {
+			uint64_t offset = firstLine + y * (lineSize + 2 * sizeof(int32_t));
+			write(&offset, sizeof(offset));
+		}
+
+		std::vector<float> line(3 * width);
+		for (int32_t y = 0; y < height; y++) {
+			for (int32_t x = 0; x < width; x++) {
+				const glm::vec3& pixel = image[static_cast<size_t>(y) * width + x];
+				line[x] = pixel.z;
+				line[width + x] = pixel.y;
+				line[2 * width + x] = pixel.x;
+			}
+			writeInt(y);
+			writeInt(static_cast<int32_t>(lineSize));
+			write(line.data(), lineSize);
+		}
+
+		if (!file) {
+			throw std::runtime_error("failed to write image: " + filepath + "!");
+		}
+	}
+}
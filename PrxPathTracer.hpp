@@ -0,0 +1,131 @@
+#pragma once
+
+#include "PrxCamera.hpp"
+#include "PrxGameObject.hpp"
+#include "PrxTlas.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm.hpp"
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace prx {
+
+	// Multithreaded CPU path tracer, the reference image the Vulkan RT path is checked against.
+	//	Renders the instances of a PrxTlas with PrxMaterial parameters and point lights, one sample per
+	//	pixel per pass into an accumulation buffer (progressive), split into tiles that worker threads
+	//	pull from a shared counter.
+	//	Every pixel and sample seeds its own random numbers, so the image is the same for any thread
+	//	count or tile size, which is what image comparisons in CI need.
+	//
+	// Lighting follows simple_shader.frag where the two overlap: a point light of intensity I lights a
+	//	diffuse surface with color * I * cos / d^2, and rays that escape see the ambient color.
+	//	Note: surfaces use flat (geometric) normals, and vertex colors and textures are not read,
+	//	PrxModel keeps no CPU copy of them
+	class PrxPathTracer
+	{
+	public:
+		// the PrxMaterial parameters the tracer understands
+		struct Material {
+			glm::vec3 diffuse{ .8f };
+			glm::vec3 specular{ 0.f }; // normalized Phong lobe, sharpness from shininess
+			glm::vec3 emission{ 0.f };
+			float shininess = 1.f;
+			float ior = 1.f; // for the transparent part: refracts if not 1, otherwise passes straight through
+			float opacity = 1.f;
+
+			static Material fromMaterial(const PrxMaterial& material);
+			static Material fromMtl(const PrxModel::MtlData& material);
+		};
+
+		struct PointLight {
+			glm::vec3 position{};
+			glm::vec3 color{ 1.f };
+			float intensity = 1.f;
+		};
+
+		struct Settings {
+			uint32_t width = 800;
+			uint32_t height = 600;
+			uint32_t tileSize = 16;
+			uint32_t maxBounces = 5;
+			uint32_t threadCount = 0; // 0 for one per core
+			glm::vec3 environment{ .02f }; // what rays that hit nothing see, FrameInfo's ambient light by default
+		};
+
+		struct Stats {
+			uint32_t sampleCount = 0; // per pixel, so far
+			uint32_t threadCount = 0;
+			double passMilliseconds = 0.0; // last pass
+			double samplesPerSecond = 0.0; // last pass, over all threads
+		};
+
+		explicit PrxPathTracer(const Settings& settings);
+
+		// do not allow for copying
+		PrxPathTracer(const PrxPathTracer&) = delete;
+		PrxPathTracer& operator=(const PrxPathTracer&) = delete;
+
+		// Every game object with a model (through an internal PrxTlas, so call it after
+		//	PrxGameObjectManager::updateBuffer), and every point light. Each triangle is shaded with
+		//	the material of its mesh: the game object's MaterialComponent entry for it, or else the
+		//	model's own (PrxModel::getMaterials)
+		void setScene(PrxGameObjectManager& gameObjectManager);
+		// Lower level, for scenes that don't come from game objects (or a device). The TLAS has to
+		//	outlive the tracer. instanceMaterials are lined up with its instances, each indexed by
+		//	material index, and blasTriangleMaterials with its BLASes, the material index of each
+		//	triangle (see PrxBvh::gatherTriangleMaterials). A BLAS without them uses material 0
+		void setScene(const PrxTlas& tlas, std::vector<std::vector<Material>> instanceMaterials,
+			std::vector<std::vector<uint32_t>> blasTriangleMaterials, std::vector<PointLight> lights);
+		void setCamera(const PrxCamera& camera);
+
+		// Adds one sample per pixel. Changing the scene or the camera starts the accumulation over
+		void renderPass();
+		void render(uint32_t samplesPerPixel);
+		void reset();
+
+		// average of every pass so far, linear radiance, rows top to bottom
+		std::vector<glm::vec3> getImage() const;
+		// picked by extension: .png (clamped, sRGB) or .exr (linear, 32 bit float)
+		void writeImage(const std::string& filepath) const;
+
+		const Stats& getStats() const { return stats; }
+		const Settings& getSettings() const { return settings; }
+
+	private:
+		struct Random;
+		struct Surface;
+
+		void renderTile(uint32_t tileIndex);
+		glm::vec3 tracePath(PrxRay ray, Random& random) const;
+		Surface computeSurface(const PrxRay& ray, const PrxHit& hit) const;
+		const Material& getMaterial(const PrxHit& hit) const;
+		glm::vec3 sampleLights(const Surface& surface, const glm::vec3& toViewer, const Material& material) const;
+		glm::vec3 evaluateBsdf(const Material& material, const glm::vec3& normal,
+			const glm::vec3& toViewer, const glm::vec3& toLight) const;
+		PrxRay makeCameraRay(float x, float y) const;
+		void writePng(const std::string& filepath, const std::vector<glm::vec3>& image) const;
+		void writeExr(const std::string& filepath, const std::vector<glm::vec3>& image) const;
+
+		Settings settings;
+		Stats stats{};
+
+		PrxTlas sceneTlas{}; // only used by setScene(PrxGameObjectManager&)
+		const PrxTlas* tlas = nullptr;
+		std::vector<std::vector<Material>> materials; // per instance, by material index
+		std::vector<std::vector<uint32_t>> triangleMaterials; // per BLAS, by original triangle index
+		std::vector<PointLight> lights;
+		// per BLAS, where each original triangle index ended up in getTriangles()
+		std::vector<std::vector<uint32_t>> triangleSlots;
+
+		glm::mat4 inverseProjection{ 1.f };
+		glm::mat4 inverseView{ 1.f };
+
+		std::vector<glm::vec3> accumulation;
+	};
+}
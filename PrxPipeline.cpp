@@ -64,6 +64,21 @@ namespace prx {
 		shaderStages[0].pNext = nullptr;
 		shaderStages[0].pSpecializationInfo = nullptr;
 
+		std::vector<VkSpecializationMapEntry> specializationEntries(configInfo.vertexSpecializationConstants.size());
+		for (uint32_t i = 0; i < specializationEntries.size(); i++) {
+			specializationEntries[i].constantID = i;
+			specializationEntries[i].offset = i * sizeof(uint32_t);
+			specializationEntries[i].size = sizeof(uint32_t);
+		}
+		VkSpecializationInfo specializationInfo{};
+		specializationInfo.mapEntryCount = static_cast<uint32_t>(specializationEntries.size());
+		specializationInfo.pMapEntries = specializationEntries.data();
+		specializationInfo.dataSize = configInfo.vertexSpecializationConstants.size() * sizeof(uint32_t);
+		specializationInfo.pData = configInfo.vertexSpecializationConstants.data();
+		if (!specializationEntries.empty()) {
+			shaderStages[0].pSpecializationInfo = &specializationInfo;
+		}
+
 		// fragment shader stage
 		shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
@@ -212,6 +227,13 @@ namespace prx {
 	}
 
 
+	void PrxPipeline::setVertexLayout(PipelineConfigInfo& configInfo, const PrxVertexLayout& layout) {
+		configInfo.bindingDescriptions = layout.getBindingDescriptions();
+		configInfo.attributeDescriptions = layout.getAttributeDescriptions();
+		// constant_id 0: NORMAL_ENCODING
+		configInfo.vertexSpecializationConstants = { static_cast<uint32_t>(layout.normal) };
+	}
+
 	void PrxPipeline::enableAlphaBlending(PipelineConfigInfo& configInfo) {
 		configInfo.colorBlendAttachment.blendEnable = VK_TRUE; // enable color blending
 															   // disable when not in use, can cost performance
@@ -233,4 +255,40 @@ namespace prx {
 		configInfo.colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;              
 	}
 
-}
\ No newline at end of file
+	PrxComputePipeline::PrxComputePipeline(PrxDevice& device, const std::string& compFilepath,
+		VkPipelineLayout pipelineLayout) : prxDevice{ device } {
+		assert(pipelineLayout != VK_NULL_HANDLE && "Cannot create compute pipeline: no pipelineLayout provided");
+
+		auto compCode = PrxPipeline::readFile(compFilepath);
+
+		VkShaderModuleCreateInfo moduleInfo{};
+		moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		moduleInfo.codeSize = compCode.size();
+		moduleInfo.pCode = reinterpret_cast<const uint32_t*>(compCode.data());
+		if (vkCreateShaderModule(prxDevice.device(), &moduleInfo, nullptr, &compShaderModule) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create shader module!");
+		}
+
+		VkComputePipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.module = compShaderModule;
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = pipelineLayout;
+
+		if (vkCreateComputePipelines(prxDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo,
+			nullptr, &computePipeline) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create compute pipeline!");
+		}
+	}
+
+	PrxComputePipeline::~PrxComputePipeline() {
+		vkDestroyShaderModule(prxDevice.device(), compShaderModule, nullptr);
+		vkDestroyPipeline(prxDevice.device(), computePipeline, nullptr);
+	}
+
+	void PrxComputePipeline::bind(VkCommandBuffer commandBuffer) {
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+	}
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "PrxDevice.hpp"
+#include "PrxVertexLayout.hpp"
 #include <string>
 #include <vector>
 
@@ -13,6 +14,8 @@ namespace prx {
 
 		std::vector<VkVertexInputBindingDescription> bindingDescriptions{};
 		std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+		// vertex shader specialization constants, one uint32_t per constant_id starting at 0
+		std::vector<uint32_t> vertexSpecializationConstants{};
 
 		VkPipelineViewportStateCreateInfo viewportInfo;
 		VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
@@ -43,11 +46,16 @@ namespace prx {
 		void bind(VkCommandBuffer commandBuffer);
 		static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
 		static void enableAlphaBlending(PipelineConfigInfo& configInfo);
+		// vertex input and shader constants for drawing from a geometry arena with this layout
+		//	(see PrxGeometryArena::getLayout), for shaders that decode it like simple_shader.vert
+		static void setVertexLayout(PipelineConfigInfo& configInfo, const PrxVertexLayout& layout);
 
 
 	private:
 		static std::vector<char> readFile(const std::string& filepath);
 
+		friend class PrxComputePipeline;
+
 		void createGraphicsPipeline(const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo);
 
 		void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
@@ -62,6 +70,25 @@ namespace prx {
 		VkShaderModule vertShaderModule;
 		VkShaderModule fragShaderModule;
 	};
+
+	// Single compute shader pipeline, e.g. for work that is generated on the GPU (see GpuDrivenRenderSystem)
+	class PrxComputePipeline
+	{
+	public:
+		PrxComputePipeline(PrxDevice& device, const std::string& compFilepath, VkPipelineLayout pipelineLayout);
+		~PrxComputePipeline();
+
+		// do not allow for copying
+		PrxComputePipeline(const PrxComputePipeline&) = delete;
+		PrxComputePipeline& operator=(const PrxComputePipeline&) = delete;
+
+		void bind(VkCommandBuffer commandBuffer);
+
+	private:
+		PrxDevice& prxDevice;
+		VkPipeline computePipeline;
+		VkShaderModule compShaderModule;
+	};
 }
 
 
@@ -0,0 +1,114 @@
+#pragma once
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm.hpp"
+
+// std
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+
+namespace prx {
+
+	struct PrxRay {
+		glm::vec3 origin{};
+		float tMin = 0.f;
+		glm::vec3 direction{ 0.f, 0.f, 1.f }; // doesn't have to be normalized, t is in units of it
+		float tMax = FLT_MAX;
+	};
+
+	struct PrxHit {
+		static constexpr uint32_t NO_HIT = UINT32_MAX;
+
+		float t = FLT_MAX;
+		// barycentrics of v1 and v2, the hit point is (1 - u - v) * v0 + u * v1 + v * v2
+		float u = 0.f;
+		float v = 0.f;
+		uint32_t triangle = NO_HIT; // index the triangle had when the BVH was built
+		uint32_t instance = NO_HIT; // only set by PrxTlas::intersect, index into its instances
+
+		bool isHit() const { return triangle != NO_HIT; }
+	};
+
+	// Watertight ray/triangle test (Woop, Benthin, Wald 2013). The ray is sheared so it runs along +z
+	//	through the origin, then the triangle's 2D edge functions decide the hit. Rays through an edge
+	//	or a vertex shared by several triangles hit exactly one of them, so there are no cracks for
+	//	rays to slip through, unlike with Moller-Trumbore.
+	//	The per ray setup lives here so it is paid once per ray instead of once per triangle
+	struct PrxRayTriangleTest {
+		// conservative traversal needs boxes grown by this much to stay watertight (Ize 2013)
+		static constexpr float BOX_ROBUSTNESS = 1.f + 2.f * 3.f * (FLT_EPSILON * .5f) / (1.f - 3.f * (FLT_EPSILON * .5f));
+
+		int kx, ky, kz; // kz is the dominant direction axis
+		float sx, sy, sz; // shear constants
+		glm::vec3 origin;
+
+		explicit PrxRayTriangleTest(const PrxRay& ray) : origin{ ray.origin } {
+			glm::vec3 absDirection = glm::abs(ray.direction);
+			kz = absDirection.x > absDirection.y
+				? (absDirection.x > absDirection.z ? 0 : 2)
+				: (absDirection.y > absDirection.z ? 1 : 2);
+			kx = kz == 2 ? 0 : kz + 1;
+			ky = kx == 2 ? 0 : kx + 1;
+			// keep the winding, so det has the same sign for front faces on every axis
+			if (ray.direction[kz] < 0.f) {
+				int swap = kx;
+				kx = ky;
+				ky = swap;
+			}
+			sx = ray.direction[kx] / ray.direction[kz];
+			sy = ray.direction[ky] / ray.direction[kz];
+			sz = 1.f / ray.direction[kz];
+		}
+
+		// returns true for a hit in [tMin, tMax], both faces count
+		bool intersect(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2,
+			float tMin, float tMax, float& t, float& u, float& v) const {
+			const glm::vec3 a = v0 - origin;
+			const glm::vec3 b = v1 - origin;
+			const glm::vec3 c = v2 - origin;
+
+			const float ax = a[kx] - sx * a[kz];
+			const float ay = a[ky] - sy * a[kz];
+			const float bx = b[kx] - sx * b[kz];
+			const float by = b[ky] - sy * b[kz];
+			const float cx = c[kx] - sx * c[kz];
+			const float cy = c[ky] - sy * c[kz];
+
+			float edgeA = cx * by - cy * bx;
+			float edgeB = ax * cy - ay * cx;
+			float edgeC = bx * ay - by * ax;
+
+			// exactly on an edge in float, redo it in double so shared edges go to one side only
+			if (edgeA == 0.f || edgeB == 0.f || edgeC == 0.f) {
+				edgeA = static_cast<float>(static_cast<double>(cx) * by - static_cast<double>(cy) * bx);
+				edgeB = static_cast<float>(static_cast<double>(ax) * cy - static_cast<double>(ay) * cx);
+				edgeC = static_cast<float>(static_cast<double>(bx) * ay - static_cast<double>(by) * ax);
+			}
+
+			if ((edgeA < 0.f || edgeB < 0.f || edgeC < 0.f) && (edgeA > 0.f || edgeB > 0.f || edgeC > 0.f)) {
+				return false;
+			}
+			const float det = edgeA + edgeB + edgeC;
+			if (det == 0.f) {
+				return false;
+			}
+
+			// t stays scaled by det until the range check, which saves the divide for misses
+			const float scaledT = sz * (edgeA * a[kz] + edgeB * b[kz] + edgeC * c[kz]);
+			const float sign = det < 0.f ? -1.f : 1.f;
+			const float absDet = det * sign;
+			if (scaledT * sign < tMin * absDet || scaledT * sign > tMax * absDet) {
+				return false;
+			}
+
+			const float invDet = 1.f / det;
+			t = scaledT * invDet;
+			u = edgeB * invDet;
+			v = edgeC * invDet;
+			return true;
+		}
+	};
+}
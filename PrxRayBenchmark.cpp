@@ -0,0 +1,154 @@
+#include "PrxRayBenchmark.hpp"
+#include "PrxBvh.hpp"
+#include "PrxRayTraversal.hpp"
+
+// libs
+#include <glm/gtc/constants.hpp>
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace prx {
+
+	namespace {
+		constexpr uint32_t IMAGE_SIZE = 512;
+		constexpr uint32_t TILE_SIZE = 8;
+		constexpr uint32_t INCOHERENT_RAY_COUNT = IMAGE_SIZE * IMAGE_SIZE;
+		constexpr int RUNS = 3; // best of
+
+		// Camera rays, ordered tile by tile so consecutive rays (one packet) are neighbours on screen
+		std::vector<PrxRay> makeCoherentRays(const PrxAabb& bounds) {
+			const glm::vec3 center = bounds.center();
+			const float radius = std::max(glm::length(bounds.extent()) * .5f, 1e-3f);
+			const glm::vec3 eye = center + glm::normalize(glm::vec3{ .6f, .4f, 1.f }) * radius * 2.f;
+			const glm::vec3 forward = glm::normalize(center - eye);
+			const glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3{ 0.f, 1.f, 0.f }));
+			const glm::vec3 up = glm::cross(right, forward);
+			const float halfHeight = std::tan(glm::radians(30.f));
+
+			std::vector<PrxRay> rays;
+			rays.reserve(IMAGE_SIZE * IMAGE_SIZE);
+			for (uint32_t tileY = 0; tileY < IMAGE_SIZE; tileY += TILE_SIZE) {
+				for (uint32_t tileX = 0; tileX < IMAGE_SIZE; tileX += TILE_SIZE) {
+					for (uint32_t y = tileY; y < tileY + TILE_SIZE; y++) {
+						for (uint32_t x = tileX; x < tileX + TILE_SIZE; x++) {
+							float screenX = ((x + .5f) / IMAGE_SIZE * 2.f - 1.f) * halfHeight;
+							float screenY = (1.f - (y + .5f) / IMAGE_SIZE * 2.f) * halfHeight;
+							PrxRay ray{};
+							ray.origin = eye;
+							ray.direction = glm::normalize(forward + right * screenX + up * screenY);
+							rays.push_back(ray);
+						}
+					}
+				}
+			}
+			return rays;
+		}
+
+		// random origins inside the model's box, random directions: close to what diffuse bounces do
+		std::vector<PrxRay> makeIncoherentRays(const PrxAabb& bounds) {
+			std::mt19937 random{ 1234 };
+			std::uniform_real_distribution<float> unit{ 0.f, 1.f };
+
+			std::vector<PrxRay> rays(INCOHERENT_RAY_COUNT);
+			for (PrxRay& ray : rays) {
+				ray.origin = bounds.min + bounds.extent() * glm::vec3{ unit(random), unit(random), unit(random) };
+				float z = unit(random) * 2.f - 1.f;
+				float phi = unit(random) * glm::two_pi<float>();
+				float r = std::sqrt(std::max(0.f, 1.f - z * z));
+				ray.direction = glm::vec3{ r * std::cos(phi), r * std::sin(phi), z };
+			}
+			return rays;
+		}
+
+		struct KernelResult {
+			double megaRaysPerSecond = 0.0;
+			size_t hitCount = 0;
+			size_t mismatches = 0;
+		};
+
+		using Kernel = std::function<void(const std::vector<PrxRay>&, std::vector<PrxHit>&)>;
+
+		KernelResult measure(const Kernel& kernel, const std::vector<PrxRay>& rays, const std::vector<PrxHit>* reference) {
+			KernelResult result{};
+			std::vector<PrxHit> hits;
+			double bestSeconds = 1e30;
+			for (int run = 0; run < RUNS; run++) {
+				hits.assign(rays.size(), PrxHit{});
+				auto startTime = std::chrono::high_resolution_clock::now();
+				kernel(rays, hits);
+				auto endTime = std::chrono::high_resolution_clock::now();
+				bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(endTime - startTime).count());
+			}
+			result.megaRaysPerSecond = rays.size() / bestSeconds * 1e-6;
+
+			for (size_t i = 0; i < hits.size(); i++) {
+				result.hitCount += hits[i].isHit() ? 1 : 0;
+				if (reference == nullptr) continue;
+
+				// Note: compared by distance, equally close triangles may be found in any order
+				const PrxHit& expected = (*reference)[i];
+				if (hits[i].isHit() != expected.isHit()
+					|| (expected.isHit() && std::abs(hits[i].t - expected.t) > 1e-4f * std::max(1.f, expected.t))) {
+					result.mismatches++;
+				}
+			}
+			return result;
+		}
+
+		void report(const char* name, const KernelResult& result) {
+			std::cout << "    " << std::left << std::setw(22) << name << std::right
+				<< std::fixed << std::setprecision(2) << std::setw(9) << result.megaRaysPerSecond << " Mrays/s"
+				<< "  hits " << result.hitCount << "  mismatches " << result.mismatches << std::endl;
+		}
+	}
+
+	void runRayBenchmark(const std::string& modelPath) {
+		// Note: the tinyobj loader, ModelData wants a device for its materials
+		PrxModel::OldModelData data{};
+		data.loadModel(modelPath);
+
+		PrxBvh bvh{ PrxBvh::gatherTriangles(data) };
+		auto startTime = std::chrono::high_resolution_clock::now();
+		PrxWideBvh wideBvh{ bvh };
+		auto endTime = std::chrono::high_resolution_clock::now();
+
+		const PrxBvh::BuildStats& stats = bvh.getBuildStats();
+		std::cout << modelPath << ": " << bvh.getTriangles().size() << " triangles, "
+			<< stats.nodeCount << " nodes (" << std::fixed << std::setprecision(2) << stats.buildMilliseconds << " ms), "
+			<< wideBvh.getNodes().size() << " wide nodes ("
+			<< std::chrono::duration<double, std::milli>(endTime - startTime).count() << " ms), "
+			<< getRayTraversalPath() << ", " << RAY_SIMD_WIDTH << " wide" << std::endl;
+
+		const Kernel single = [&](const std::vector<PrxRay>& rays, std::vector<PrxHit>& hits) {
+			for (size_t i = 0; i < rays.size(); i++) bvh.intersect(rays[i], hits[i]);
+		};
+		const Kernel packet = [&](const std::vector<PrxRay>& rays, std::vector<PrxHit>& hits) {
+			intersectPacket(bvh, rays.data(), hits.data(), rays.size());
+		};
+		const Kernel wide = [&](const std::vector<PrxRay>& rays, std::vector<PrxHit>& hits) {
+			for (size_t i = 0; i < rays.size(); i++) wideBvh.intersect(rays[i], hits[i]);
+		};
+
+		const std::pair<const char*, std::vector<PrxRay>> raySets[] = {
+			{ "coherent", makeCoherentRays(bvh.getBounds()) },
+			{ "incoherent", makeIncoherentRays(bvh.getBounds()) } };
+		for (const auto& [setName, rays] : raySets) {
+			std::cout << "  " << setName << " (" << rays.size() << " rays)" << std::endl;
+
+			std::vector<PrxHit> reference(rays.size());
+			single(rays, reference);
+
+			report("single ray, binary", measure(single, rays, nullptr));
+			report("packet, binary", measure(packet, rays, &reference));
+			report("single ray, wide", measure(wide, rays, &reference));
+		}
+	}
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+// std
+#include <string>
+
+namespace prx {
+
+	// Loads an .obj model (no device needed), builds its BVHs and traces coherent rays (a pinhole camera
+	//	looking at the model) and incoherent rays (random origins inside it, random directions)
+	//	through every traversal kernel, printing Mrays/s for each. The kernels are also checked
+	//	against the single ray binary traversal, any disagreement is printed as mismatches.
+	//	Run with: VulkanRTX --ray-benchmark models/viking_room.obj [more models...]
+	void runRayBenchmark(const std::string& modelPath);
+}
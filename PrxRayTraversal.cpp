@@ -0,0 +1,505 @@
+#include "PrxRayTraversal.hpp"
+
+// libs
+#if defined(PRX_RAY_AVX2)
+#include <immintrin.h>
+#elif defined(PRX_RAY_SSE2)
+#include <emmintrin.h>
+#endif
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+namespace prx {
+
+	namespace {
+
+		// The few lane operations the kernels need, written once per path so the kernels themselves
+		//	are shared. Masks are lanes too: all bits set (SIMD) or 1.f (scalar) for true
+		constexpr uint32_t W = RAY_SIMD_WIDTH;
+
+#if defined(PRX_RAY_AVX2)
+		using Lanes = __m256;
+		inline Lanes splat(float f) { return _mm256_set1_ps(f); }
+		inline Lanes load(const float* p) { return _mm256_loadu_ps(p); }
+		inline void store(float* p, Lanes a) { _mm256_storeu_ps(p, a); }
+		inline Lanes add(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+		inline Lanes sub(Lanes a, Lanes b) { return _mm256_sub_ps(a, b); }
+		inline Lanes mul(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+		inline Lanes div(Lanes a, Lanes b) { return _mm256_div_ps(a, b); }
+		inline Lanes min(Lanes a, Lanes b) { return _mm256_min_ps(a, b); }
+		inline Lanes max(Lanes a, Lanes b) { return _mm256_max_ps(a, b); }
+		inline Lanes less(Lanes a, Lanes b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+		inline Lanes lessEqual(Lanes a, Lanes b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+		inline Lanes equal(Lanes a, Lanes b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+		inline Lanes maskAnd(Lanes a, Lanes b) { return _mm256_and_ps(a, b); }
+		inline Lanes maskOr(Lanes a, Lanes b) { return _mm256_or_ps(a, b); }
+		inline Lanes maskAndNot(Lanes a, Lanes b) { return _mm256_andnot_ps(b, a); } // a && !b
+		inline Lanes select(Lanes mask, Lanes a, Lanes b) { return _mm256_blendv_ps(b, a, mask); }
+		inline uint32_t bits(Lanes mask) { return static_cast<uint32_t>(_mm256_movemask_ps(mask)); }
+		// a with its sign flipped wherever s is negative
+		inline Lanes xorSign(Lanes a, Lanes s) { return _mm256_xor_ps(a, _mm256_and_ps(s, _mm256_set1_ps(-0.f))); }
+#elif defined(PRX_RAY_SSE2)
+		using Lanes = __m128;
+		inline Lanes splat(float f) { return _mm_set1_ps(f); }
+		inline Lanes load(const float* p) { return _mm_loadu_ps(p); }
+		inline void store(float* p, Lanes a) { _mm_storeu_ps(p, a); }
+		inline Lanes add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+		inline Lanes sub(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+		inline Lanes mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+		inline Lanes div(Lanes a, Lanes b) { return _mm_div_ps(a, b); }
+		inline Lanes min(Lanes a, Lanes b) { return _mm_min_ps(a, b); }
+		inline Lanes max(Lanes a, Lanes b) { return _mm_max_ps(a, b); }
+		inline Lanes less(Lanes a, Lanes b) { return _mm_cmplt_ps(a, b); }
+		inline Lanes lessEqual(Lanes a, Lanes b) { return _mm_cmple_ps(a, b); }
+		inline Lanes equal(Lanes a, Lanes b) { return _mm_cmpeq_ps(a, b); }
+		inline Lanes maskAnd(Lanes a, Lanes b) { return _mm_and_ps(a, b); }
+		inline Lanes maskOr(Lanes a, Lanes b) { return _mm_or_ps(a, b); }
+		inline Lanes maskAndNot(Lanes a, Lanes b) { return _mm_andnot_ps(b, a); }
+		// no blendv before SSE4.1
+		inline Lanes select(Lanes mask, Lanes a, Lanes b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+		inline uint32_t bits(Lanes mask) { return static_cast<uint32_t>(_mm_movemask_ps(mask)); }
+		inline Lanes xorSign(Lanes a, Lanes s) { return _mm_xor_ps(a, _mm_and_ps(s, _mm_set1_ps(-0.f))); }
+#else
+		struct Lanes {
+			float v[W];
+		};
+		template<typename F>
+		inline Lanes map(Lanes a, Lanes b, F f) {
+			Lanes r;
+			for (uint32_t i = 0; i < W; i++) r.v[i] = f(a.v[i], b.v[i]);
+			return r;
+		}
+		inline Lanes splat(float f) { Lanes r; for (uint32_t i = 0; i < W; i++) r.v[i] = f; return r; }
+		inline Lanes load(const float* p) { Lanes r; for (uint32_t i = 0; i < W; i++) r.v[i] = p[i]; return r; }
+		inline void store(float* p, Lanes a) { for (uint32_t i = 0; i < W; i++) p[i] = a.v[i]; }
+		inline Lanes add(Lanes a, Lanes b) { return map(a, b, [](float x, float y) { return x + y; }); }
+		inline Lanes sub(Lanes a, Lanes b) { return map(a, b, [](float x, float y) { return x - y; }); }
+		inline Lanes mul(Lanes a, Lanes b) { return map(a, b, [](float x, float y) { return x * y; }); }
+		inline Lanes div(Lanes a, Lanes b) { return map(a, b, [](float x, float y) { return x / y; }); }
+		// same operand order as minps/maxps: the second one wins if either is NaN
+		inline Lanes min(Lanes a, Lanes b) { return map(a, b, [](float x, float y) { return x < y ? x : y; }); }
+		inline Lanes max(Lanes a, Lanes b) { return map(a, b, [](float x, float y) { return x > y ? x : y; }); }
+		inline Lanes less(Lanes a, Lanes b) { return map(a, b, [](float x, float y) { return x < y ? 1.f : 0.f; }); }
+		inline Lanes lessEqual(Lanes a, Lanes b) { return map(a, b, [](float x, float y) { return x <= y ? 1.f : 0.f; }); }
+		inline Lanes equal(Lanes a, Lanes b) { return map(a, b, [](float x, float y) { return x == y ? 1.f : 0.f; }); }
+		inline Lanes maskAnd(Lanes a, Lanes b) { return map(a, b, [](float x, float y) { return x * y; }); }
+		inline Lanes maskOr(Lanes a, Lanes b) { return map(a, b, [](float x, float y) { return x > y ? x : y; }); }
+		inline Lanes maskAndNot(Lanes a, Lanes b) { return map(a, b, [](float x, float y) { return x * (1.f - y); }); }
+		inline Lanes select(Lanes mask, Lanes a, Lanes b) {
+			Lanes r;
+			for (uint32_t i = 0; i < W; i++) r.v[i] = mask.v[i] != 0.f ? a.v[i] : b.v[i];
+			return r;
+		}
+		inline uint32_t bits(Lanes mask) {
+			uint32_t result = 0;
+			for (uint32_t i = 0; i < W; i++) result |= (mask.v[i] != 0.f ? 1u : 0u) << i;
+			return result;
+		}
+		inline Lanes xorSign(Lanes a, Lanes s) { return map(a, s, [](float x, float y) { return std::signbit(y) ? -x : x; }); }
+#endif
+
+		inline uint32_t lowestBit(uint32_t mask) {
+			uint32_t index = 0;
+			while ((mask & 1u) == 0) {
+				mask >>= 1;
+				index++;
+			}
+			return index;
+		}
+
+		// Rays of one packet in SoA form, with the watertight setup of every lane.
+		//	The per lane axis permutation (kx, ky, kz) becomes masks, and coordinates are picked with
+		//	selects instead of indexing
+		struct RayPacket {
+			Lanes originX, originY, originZ;
+			Lanes invDirectionX, invDirectionY, invDirectionZ;
+			Lanes tMin, tMax;
+			Lanes kxIsX, kxIsY, kyIsX, kyIsY, kzIsX, kzIsY;
+			Lanes shearX, shearY, shearZ;
+			bool directionNegative[3]; // of the first ray, decides child order for the whole packet
+		};
+
+		RayPacket makePacket(const PrxRay* rays, const PrxHit* hits, uint32_t laneCount) {
+			alignas(32) float lanes[17][W];
+			for (uint32_t lane = 0; lane < W; lane++) {
+				// padding lanes copy the last ray, with a range nothing can hit
+				const bool padding = lane >= laneCount;
+				const PrxRay& ray = rays[padding ? laneCount - 1 : lane];
+				const PrxRayTriangleTest test{ ray };
+				lanes[0][lane] = ray.origin.x;
+				lanes[1][lane] = ray.origin.y;
+				lanes[2][lane] = ray.origin.z;
+				lanes[3][lane] = 1.f / ray.direction.x;
+				lanes[4][lane] = 1.f / ray.direction.y;
+				lanes[5][lane] = 1.f / ray.direction.z;
+				lanes[6][lane] = padding ? 1.f : ray.tMin;
+				lanes[7][lane] = padding ? -1.f : std::min(ray.tMax, hits[lane].t);
+				lanes[8][lane] = test.kx == 0 ? 1.f : 0.f;
+				lanes[9][lane] = test.kx == 1 ? 1.f : 0.f;
+				lanes[10][lane] = test.ky == 0 ? 1.f : 0.f;
+				lanes[11][lane] = test.ky == 1 ? 1.f : 0.f;
+				lanes[12][lane] = test.kz == 0 ? 1.f : 0.f;
+				lanes[13][lane] = test.kz == 1 ? 1.f : 0.f;
+				lanes[14][lane] = test.sx;
+				lanes[15][lane] = test.sy;
+				lanes[16][lane] = test.sz;
+			}
+
+			RayPacket packet;
+			const Lanes one = splat(1.f);
+			packet.originX = load(lanes[0]);
+			packet.originY = load(lanes[1]);
+			packet.originZ = load(lanes[2]);
+			packet.invDirectionX = load(lanes[3]);
+			packet.invDirectionY = load(lanes[4]);
+			packet.invDirectionZ = load(lanes[5]);
+			packet.tMin = load(lanes[6]);
+			packet.tMax = load(lanes[7]);
+			packet.kxIsX = equal(load(lanes[8]), one);
+			packet.kxIsY = equal(load(lanes[9]), one);
+			packet.kyIsX = equal(load(lanes[10]), one);
+			packet.kyIsY = equal(load(lanes[11]), one);
+			packet.kzIsX = equal(load(lanes[12]), one);
+			packet.kzIsY = equal(load(lanes[13]), one);
+			packet.shearX = load(lanes[14]);
+			packet.shearY = load(lanes[15]);
+			packet.shearZ = load(lanes[16]);
+			for (int axis = 0; axis < 3; axis++) {
+				packet.directionNegative[axis] = rays[0].direction[axis] < 0.f;
+			}
+			return packet;
+		}
+
+		inline Lanes pick(Lanes isX, Lanes isY, Lanes x, Lanes y, Lanes z) {
+			return select(isX, x, select(isY, y, z));
+		}
+
+		// PrxRayTriangleTest::intersect for every lane against one triangle. Returns the lanes that hit,
+		//	leaving out lanes that landed exactly on an edge (needsScalar), those have to be redone in double
+		Lanes intersectTriangle(const RayPacket& packet, const PrxBvh::Triangle& triangle,
+			Lanes& t, Lanes& u, Lanes& v, uint32_t& needsScalar) {
+
+			// vertex relative to each ray, sheared into that ray's space
+			auto shear = [&](const glm::vec3& vertex, Lanes& x, Lanes& y, Lanes& z) {
+				Lanes dx = sub(splat(vertex.x), packet.originX);
+				Lanes dy = sub(splat(vertex.y), packet.originY);
+				Lanes dz = sub(splat(vertex.z), packet.originZ);
+				z = pick(packet.kzIsX, packet.kzIsY, dx, dy, dz);
+				x = sub(pick(packet.kxIsX, packet.kxIsY, dx, dy, dz), mul(packet.shearX, z));
+				y = sub(pick(packet.kyIsX, packet.kyIsY, dx, dy, dz), mul(packet.shearY, z));
+			};
+			Lanes ax, ay, az, bx, by, bz, cx, cy, cz;
+			shear(triangle.v0, ax, ay, az);
+			shear(triangle.v1, bx, by, bz);
+			shear(triangle.v2, cx, cy, cz);
+
+			const Lanes edgeA = sub(mul(cx, by), mul(cy, bx));
+			const Lanes edgeB = sub(mul(ax, cy), mul(ay, cx));
+			const Lanes edgeC = sub(mul(bx, ay), mul(by, ax));
+
+			const Lanes zero = splat(0.f);
+			const Lanes onEdge = maskOr(maskOr(equal(edgeA, zero), equal(edgeB, zero)), equal(edgeC, zero));
+			const Lanes anyNegative = maskOr(maskOr(less(edgeA, zero), less(edgeB, zero)), less(edgeC, zero));
+			const Lanes anyPositive = maskOr(maskOr(less(zero, edgeA), less(zero, edgeB)), less(zero, edgeC));
+
+			const Lanes det = add(add(edgeA, edgeB), edgeC);
+			const Lanes scaledT = mul(packet.shearZ, add(add(mul(edgeA, az), mul(edgeB, bz)), mul(edgeC, cz)));
+			const Lanes signedT = xorSign(scaledT, det);
+			const Lanes absDet = xorSign(det, det);
+
+			Lanes accepted = maskAnd(lessEqual(mul(packet.tMin, absDet), signedT), lessEqual(signedT, mul(packet.tMax, absDet)));
+			accepted = maskAndNot(accepted, maskOr(maskAnd(anyNegative, anyPositive), equal(det, zero)));
+
+			// padding lanes have an empty range, so they never show up here
+			needsScalar = bits(onEdge) & bits(lessEqual(packet.tMin, packet.tMax));
+			accepted = maskAndNot(accepted, onEdge);
+			if (bits(accepted) == 0) return accepted;
+
+			const Lanes invDet = div(splat(1.f), det);
+			t = mul(scaledT, invDet);
+			u = mul(edgeB, invDet);
+			v = mul(edgeC, invDet);
+			return accepted;
+		}
+
+		void tracePacket(const PrxBvh& bvh, const PrxRay* rays, PrxHit* hits, uint32_t laneCount) {
+			const auto& nodes = bvh.getNodes();
+			const auto& triangles = bvh.getTriangles();
+			const auto& triangleIndices = bvh.getTriangleIndices();
+
+			RayPacket packet = makePacket(rays, hits, laneCount);
+			const Lanes robustness = splat(PrxRayTriangleTest::BOX_ROBUSTNESS);
+
+			alignas(32) float hitT[W], hitU[W], hitV[W];
+			uint32_t hitTriangle[W];
+			std::fill(hitTriangle, hitTriangle + W, PrxHit::NO_HIT);
+
+			uint32_t stack[PrxBvh::MAX_TRAVERSAL_DEPTH];
+			uint32_t stackSize = 0;
+			uint32_t nodeIndex = 0;
+			while (true) {
+				const PrxBvh::Node& node = nodes[nodeIndex];
+
+				const Lanes t0x = mul(sub(splat(node.boundsMin.x), packet.originX), packet.invDirectionX);
+				const Lanes t1x = mul(sub(splat(node.boundsMax.x), packet.originX), packet.invDirectionX);
+				const Lanes t0y = mul(sub(splat(node.boundsMin.y), packet.originY), packet.invDirectionY);
+				const Lanes t1y = mul(sub(splat(node.boundsMax.y), packet.originY), packet.invDirectionY);
+				const Lanes t0z = mul(sub(splat(node.boundsMin.z), packet.originZ), packet.invDirectionZ);
+				const Lanes t1z = mul(sub(splat(node.boundsMax.z), packet.originZ), packet.invDirectionZ);
+				const Lanes tEnter = max(max(min(t0x, t1x), min(t0y, t1y)), max(min(t0z, t1z), packet.tMin));
+				const Lanes tExit = min(mul(min(min(max(t0x, t1x), max(t0y, t1y)), max(t0z, t1z)), robustness), packet.tMax);
+
+				if (bits(lessEqual(tEnter, tExit)) != 0) {
+					if (node.isLeaf()) {
+						for (uint32_t i = node.offset; i < node.offset + node.triangleCount; i++) {
+							Lanes t, u, v;
+							uint32_t needsScalar;
+							const Lanes accepted = intersectTriangle(packet, triangles[i], t, u, v, needsScalar);
+							uint32_t hitLanes = bits(accepted);
+							if (hitLanes != 0) {
+								packet.tMax = select(accepted, t, packet.tMax);
+								alignas(32) float laneU[W], laneV[W];
+								store(hitT, packet.tMax);
+								store(laneU, u);
+								store(laneV, v);
+								for (uint32_t lanes = hitLanes; lanes != 0; lanes &= lanes - 1) {
+									uint32_t lane = lowestBit(lanes);
+									hitU[lane] = laneU[lane];
+									hitV[lane] = laneV[lane];
+									hitTriangle[lane] = triangleIndices[i];
+								}
+							}
+							if (needsScalar != 0) {
+								alignas(32) float tMax[W], tMin[W];
+								store(tMax, packet.tMax);
+								store(tMin, packet.tMin);
+								const PrxBvh::Triangle& triangle = triangles[i];
+								for (uint32_t lanes = needsScalar; lanes != 0; lanes &= lanes - 1) {
+									uint32_t lane = lowestBit(lanes);
+									float laneT, laneU, laneV;
+									if (PrxRayTriangleTest{ rays[lane] }.intersect(
+										triangle.v0, triangle.v1, triangle.v2, tMin[lane], tMax[lane], laneT, laneU, laneV)) {
+										tMax[lane] = laneT;
+										hitT[lane] = laneT;
+										hitU[lane] = laneU;
+										hitV[lane] = laneV;
+										hitTriangle[lane] = triangleIndices[i];
+									}
+								}
+								packet.tMax = load(tMax);
+							}
+						}
+					}
+					else {
+						uint32_t first = nodeIndex + 1;
+						uint32_t second = node.offset;
+						if (packet.directionNegative[node.splitAxis]) {
+							std::swap(first, second);
+						}
+						assert(stackSize < PrxBvh::MAX_TRAVERSAL_DEPTH && "BVH traversal stack overflow");
+						stack[stackSize++] = second;
+						nodeIndex = first;
+						continue;
+					}
+				}
+
+				if (stackSize == 0) break;
+				nodeIndex = stack[--stackSize];
+			}
+
+			for (uint32_t lane = 0; lane < laneCount; lane++) {
+				if (hitTriangle[lane] != PrxHit::NO_HIT) {
+					hits[lane] = PrxHit{ hitT[lane], hitU[lane], hitV[lane], hitTriangle[lane] };
+				}
+			}
+		}
+	}
+
+	size_t intersectPacket(const PrxBvh& bvh, const PrxRay* rays, PrxHit* hits, size_t count) {
+		size_t hitCount = 0;
+		for (size_t first = 0; first < count; first += W) {
+			const uint32_t laneCount = static_cast<uint32_t>(std::min<size_t>(W, count - first));
+			if (!bvh.isEmpty()) {
+				tracePacket(bvh, rays + first, hits + first, laneCount);
+			}
+			for (uint32_t lane = 0; lane < laneCount; lane++) {
+				hitCount += hits[first + lane].isHit() ? 1 : 0;
+			}
+		}
+		return hitCount;
+	}
+
+	void PrxWideBvh::build(const PrxBvh& bvh) {
+		nodes.clear();
+		triangles = bvh.getTriangles();
+		triangleIndices = bvh.getTriangleIndices();
+		if (bvh.isEmpty()) return;
+
+		const auto& binaryNodes = bvh.getNodes();
+		nodes.reserve(binaryNodes.size() / (WIDTH - 1) + 1);
+		collapse(binaryNodes, 0);
+	}
+
+	uint32_t PrxWideBvh::collapse(const std::vector<PrxBvh::Node>& binaryNodes, uint32_t binaryIndex) {
+		const uint32_t nodeIndex = static_cast<uint32_t>(nodes.size());
+		nodes.emplace_back();
+
+		// Open up the binary subtree until there are WIDTH children, always splitting the biggest
+		//	interior child: it's the one rays are most likely to enter
+		uint32_t children[WIDTH];
+		uint32_t childCount = 0;
+		const PrxBvh::Node& root = binaryNodes[binaryIndex];
+		if (root.isLeaf()) {
+			// only for a root that is a single leaf
+			children[childCount++] = binaryIndex;
+		}
+		else {
+			children[childCount++] = binaryIndex + 1;
+			children[childCount++] = root.offset;
+		}
+		while (childCount < WIDTH) {
+			int widest = -1;
+			float widestArea = -1.f;
+			for (uint32_t i = 0; i < childCount; i++) {
+				const PrxBvh::Node& child = binaryNodes[children[i]];
+				if (child.isLeaf()) continue;
+				float area = PrxAabb{ child.boundsMin, child.boundsMax }.surfaceArea();
+				if (area > widestArea) {
+					widest = static_cast<int>(i);
+					widestArea = area;
+				}
+			}
+			if (widest < 0) break;
+
+			const uint32_t opened = children[widest];
+			children[widest] = opened + 1;
+			children[childCount++] = binaryNodes[opened].offset;
+		}
+
+		Node node{};
+		for (uint32_t i = 0; i < WIDTH; i++) {
+			if (i >= childCount) {
+				node.minX[i] = node.minY[i] = node.minZ[i] = FLT_MAX;
+				node.maxX[i] = node.maxY[i] = node.maxZ[i] = -FLT_MAX;
+				node.child[i] = 0;
+				node.triangleCount[i] = 0;
+				continue;
+			}
+			const PrxBvh::Node& child = binaryNodes[children[i]];
+			node.minX[i] = child.boundsMin.x;
+			node.minY[i] = child.boundsMin.y;
+			node.minZ[i] = child.boundsMin.z;
+			node.maxX[i] = child.boundsMax.x;
+			node.maxY[i] = child.boundsMax.y;
+			node.maxZ[i] = child.boundsMax.z;
+			if (child.isLeaf()) {
+				node.child[i] = child.offset;
+				node.triangleCount[i] = child.triangleCount;
+			}
+			else {
+				// Note: nodes may reallocate in here, so node is only stored at the end
+				node.child[i] = collapse(binaryNodes, children[i]);
+				node.triangleCount[i] = 0;
+			}
+		}
+		nodes[nodeIndex] = node;
+		return nodeIndex;
+	}
+
+	bool PrxWideBvh::intersect(const PrxRay& ray, PrxHit& hit) const {
+		if (nodes.empty()) return false;
+
+		const PrxRayTriangleTest triangleTest{ ray };
+		const glm::vec3 invDirection = 1.f / ray.direction;
+		float tMax = std::min(ray.tMax, hit.t);
+		bool found = false;
+
+		// Picking the near plane by the direction's sign (instead of min/max) is what makes the
+		//	inverted boxes of unused slots miss. Offsets are in floats into the node's box arrays
+		uint32_t nearOffset[3], farOffset[3];
+		for (int axis = 0; axis < 3; axis++) {
+			const bool negative = ray.direction[axis] < 0.f;
+			nearOffset[axis] = (negative ? 3 + axis : axis) * WIDTH;
+			farOffset[axis] = (negative ? axis : 3 + axis) * WIDTH;
+		}
+		const Lanes originX = splat(ray.origin.x), originY = splat(ray.origin.y), originZ = splat(ray.origin.z);
+		const Lanes invX = splat(invDirection.x), invY = splat(invDirection.y), invZ = splat(invDirection.z);
+		const Lanes tMin = splat(ray.tMin);
+		const Lanes robustness = splat(PrxRayTriangleTest::BOX_ROBUSTNESS);
+
+		struct Entry {
+			uint32_t child;
+			uint32_t triangleCount;
+			float distance;
+		};
+		Entry stack[PrxBvh::MAX_TRAVERSAL_DEPTH * (WIDTH - 1) + 1];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = Entry{ 0, 0, 0.f };
+
+		while (stackSize != 0) {
+			const Entry entry = stack[--stackSize];
+			if (entry.distance > tMax) continue; // something closer was found since it was pushed
+
+			if (entry.triangleCount != 0) {
+				for (uint32_t i = entry.child; i < entry.child + entry.triangleCount; i++) {
+					const PrxBvh::Triangle& triangle = triangles[i];
+					float t, u, v;
+					if (triangleTest.intersect(triangle.v0, triangle.v1, triangle.v2, ray.tMin, tMax, t, u, v)) {
+						tMax = t;
+						hit = PrxHit{ t, u, v, triangleIndices[i] };
+						found = true;
+					}
+				}
+				continue;
+			}
+
+			const Node& node = nodes[entry.child];
+			const float* boxes = node.minX;
+			const Lanes tNearX = mul(sub(load(boxes + nearOffset[0]), originX), invX);
+			const Lanes tNearY = mul(sub(load(boxes + nearOffset[1]), originY), invY);
+			const Lanes tNearZ = mul(sub(load(boxes + nearOffset[2]), originZ), invZ);
+			const Lanes tFarX = mul(sub(load(boxes + farOffset[0]), originX), invX);
+			const Lanes tFarY = mul(sub(load(boxes + farOffset[1]), originY), invY);
+			const Lanes tFarZ = mul(sub(load(boxes + farOffset[2]), originZ), invZ);
+			const Lanes tEnter = max(max(tNearX, tNearY), max(tNearZ, tMin));
+			const Lanes tExit = min(mul(min(min(tFarX, tFarY), tFarZ), robustness), splat(tMax));
+			uint32_t hitChildren = bits(lessEqual(tEnter, tExit));
+			if (hitChildren == 0) continue;
+
+			alignas(32) float enter[W];
+			store(enter, tEnter);
+
+			// push the hit children farthest first, so the nearest is popped next
+			Entry sorted[WIDTH];
+			uint32_t sortedCount = 0;
+			for (; hitChildren != 0; hitChildren &= hitChildren - 1) {
+				uint32_t i = lowestBit(hitChildren);
+				Entry childEntry{ node.child[i], node.triangleCount[i], enter[i] };
+				uint32_t position = sortedCount++;
+				while (position > 0 && sorted[position - 1].distance < childEntry.distance) {
+					sorted[position] = sorted[position - 1];
+					position--;
+				}
+				sorted[position] = childEntry;
+			}
+			for (uint32_t i = 0; i < sortedCount; i++) {
+				stack[stackSize++] = sorted[i];
+			}
+		}
+		return found;
+	}
+
+	const char* getRayTraversalPath() {
+#if defined(PRX_RAY_AVX2)
+		return "AVX2";
+#elif defined(PRX_RAY_SSE2)
+		return "SSE2";
+#else
+		return "Scalar";
+#endif
+	}
+}
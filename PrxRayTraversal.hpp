@@ -0,0 +1,75 @@
+#pragma once
+
+#include "PrxBvh.hpp"
+#include "PrxRay.hpp"
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Like PrxTransformBatch, the kernels follow what the build targets: AVX2 gets 8 wide nodes and packets,
+//	SSE2 4 wide ones, and anything else runs the same 4 wide layout with plain loops
+#if defined(__AVX2__)
+#define PRX_RAY_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PRX_RAY_SSE2
+#endif
+
+namespace prx {
+
+#if defined(PRX_RAY_AVX2)
+	constexpr uint32_t RAY_SIMD_WIDTH = 8;
+#else
+	constexpr uint32_t RAY_SIMD_WIDTH = 4;
+#endif
+
+	// Traces rays through a binary BVH RAY_SIMD_WIDTH at a time. The rays of a packet walk the tree
+	//	together and a node is entered if any of them hits its box, so consecutive rays should be
+	//	coherent (camera rays of a small tile, shadow rays towards one light). Scattered rays are
+	//	better off with PrxWideBvh.
+	//	Same rules as PrxBvh::intersect: hits[i] holds the closest hit of rays[i], and is read as the
+	//	starting max distance too. Returns how many of the hits are hits.
+	size_t intersectPacket(const PrxBvh& bvh, const PrxRay* rays, PrxHit* hits, size_t count);
+
+	// BVH4 / BVH8 collapsed from a binary PrxBvh. Every node keeps the boxes of up to WIDTH children
+	//	in SoA form, so a single ray tests all of them with one SIMD slab test, and the tree gets two
+	//	(BVH4) or three (BVH8) times shallower. That is fewer dependent node fetches per ray, which is
+	//	what incoherent rays are waiting on.
+	class PrxWideBvh
+	{
+	public:
+		static constexpr uint32_t WIDTH = RAY_SIMD_WIDTH;
+
+		struct alignas(32) Node {
+			float minX[WIDTH], minY[WIDTH], minZ[WIDTH];
+			float maxX[WIDTH], maxY[WIDTH], maxZ[WIDTH];
+			uint32_t child[WIDTH]; // interior: node index. Leaf: first triangle
+			// 0 for interior children. Unused slots are leaves with inverted boxes, nothing hits them
+			uint32_t triangleCount[WIDTH];
+		};
+
+		PrxWideBvh() = default;
+		explicit PrxWideBvh(const PrxBvh& bvh) { build(bvh); }
+
+		// Note: copies the triangles, the binary BVH doesn't have to outlive this one
+		void build(const PrxBvh& bvh);
+
+		// same rules as PrxBvh::intersect
+		bool intersect(const PrxRay& ray, PrxHit& hit) const;
+
+		const std::vector<Node>& getNodes() const { return nodes; }
+		bool isEmpty() const { return nodes.empty(); }
+
+	private:
+		// builds the wide node over the binary subtree at binaryIndex, returns its index
+		uint32_t collapse(const std::vector<PrxBvh::Node>& binaryNodes, uint32_t binaryIndex);
+
+		std::vector<Node> nodes;
+		std::vector<PrxBvh::Triangle> triangles;
+		std::vector<uint32_t> triangleIndices;
+	};
+
+	// "AVX2", "SSE2" or "Scalar"
+	const char* getRayTraversalPath();
+}
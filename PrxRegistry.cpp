@@ -0,0 +1,45 @@
+#include "PrxRegistry.hpp"
+
+// std
+#include <stdexcept>
+
+namespace prx {
+
+	PrxEntity PrxRegistry::create() {
+		uint32_t index;
+		if (!freeIndices.empty()) {
+			index = freeIndices.back();
+			freeIndices.pop_back();
+		}
+		else {
+			if (generations.size() >= MAX_ENTITIES) {
+				throw std::runtime_error("entity registry is full!");
+			}
+			index = static_cast<uint32_t>(generations.size());
+			generations.push_back(0);
+		}
+
+		aliveCount++;
+		return (generations[index] << ENTITY_INDEX_BITS) | index;
+	}
+
+	void PrxRegistry::destroy(PrxEntity entity) {
+		assert(isAlive(entity) && "Destroying an entity that is not alive");
+
+		uint32_t index = getIndex(entity);
+		for (auto& pool : pools) {
+			if (pool != nullptr) {
+				pool->remove(index);
+			}
+		}
+
+		generations[index] = (generations[index] + 1) & GENERATION_MASK;
+		freeIndices.push_back(index);
+		aliveCount--;
+	}
+
+	bool PrxRegistry::isAlive(PrxEntity entity) const {
+		uint32_t index = getIndex(entity);
+		return index < generations.size() && generations[index] == getGeneration(entity);
+	}
+}
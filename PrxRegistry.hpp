@@ -0,0 +1,242 @@
+#pragma once
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace prx {
+
+	// Entities are just ids: the low ENTITY_INDEX_BITS are a slot index, the rest is a generation that
+	//	is bumped whenever the slot is recycled, so a stale id never aliases a newer entity.
+	using PrxEntity = uint32_t;
+	constexpr uint32_t ENTITY_INDEX_BITS = 20;
+	constexpr uint32_t ENTITY_INDEX_MASK = (1u << ENTITY_INDEX_BITS) - 1;
+
+	// Type erased part of a component pool, so the registry can strip every component off an entity
+	//	without knowing its types.
+	class PrxComponentPoolBase {
+	public:
+		static constexpr uint32_t NOT_PRESENT = UINT32_MAX;
+
+		virtual ~PrxComponentPoolBase() = default;
+
+		virtual void remove(uint32_t entityIndex) = 0;
+
+		bool contains(uint32_t entityIndex) const {
+			return entityIndex < sparse.size() && sparse[entityIndex] != NOT_PRESENT;
+		}
+
+		size_t size() const { return dense.size(); }
+
+		// entity owning each component, in the same (packed) order as the components
+		const std::vector<PrxEntity>& entities() const { return dense; }
+
+		// bumped whenever a component is added or removed, so anything derived from the pool can tell
+		//	when it is out of date. Note: changing a component in place doesn't count
+		uint64_t getVersion() const { return version; }
+
+	protected:
+		std::vector<uint32_t> sparse; // entity index -> position in the packed arrays
+		std::vector<PrxEntity> dense;
+		uint64_t version = 0;
+	};
+
+	// Sparse set: components of one type are packed into a contiguous array. Removing swaps the
+	//	last component into the hole, so iteration never skips over dead entries.
+	// Note: component references are invalidated by adding or removing components of the same type.
+	template<typename T>
+	class PrxComponentPool : public PrxComponentPoolBase {
+	public:
+		template<typename... Args>
+		T& emplace(PrxEntity entity, Args&&... args) {
+			uint32_t entityIndex = entity & ENTITY_INDEX_MASK;
+			assert(!contains(entityIndex) && "Entity already has this component");
+
+			if (entityIndex >= sparse.size()) {
+				sparse.resize(entityIndex + 1, NOT_PRESENT);
+			}
+			sparse[entityIndex] = static_cast<uint32_t>(dense.size());
+			dense.push_back(entity);
+			components.push_back(T{ std::forward<Args>(args)... });
+			version++;
+			return components.back();
+		}
+
+		void remove(uint32_t entityIndex) override {
+			if (!contains(entityIndex)) return;
+
+			uint32_t position = sparse[entityIndex];
+			uint32_t last = static_cast<uint32_t>(dense.size() - 1);
+			if (position != last) {
+				dense[position] = dense[last];
+				components[position] = std::move(components[last]);
+				sparse[dense[position] & ENTITY_INDEX_MASK] = position;
+			}
+			dense.pop_back();
+			components.pop_back();
+			sparse[entityIndex] = NOT_PRESENT;
+			version++;
+		}
+
+		T& get(uint32_t entityIndex) {
+			assert(contains(entityIndex) && "Entity does not have this component");
+			return components[sparse[entityIndex]];
+		}
+
+		T* tryGet(uint32_t entityIndex) {
+			return contains(entityIndex) ? &components[sparse[entityIndex]] : nullptr;
+		}
+
+		// packed components, lined up with entities()
+		std::vector<T>& data() { return components; }
+
+	private:
+		std::vector<T> components;
+	};
+
+	template<typename... Ts>
+	class PrxView;
+
+	// Owns every entity and one packed pool per component type.
+	//	Systems iterate with view<A, B...>().each(...), which walks the smallest of the pools
+	//	involved in order, so the hot loops read contiguous memory instead of chasing map nodes.
+	class PrxRegistry {
+	public:
+		static constexpr uint32_t GENERATION_MASK = (1u << (32 - ENTITY_INDEX_BITS)) - 1;
+		// the last index is never handed out so NULL_ENTITY can't be alive
+		static constexpr uint32_t MAX_ENTITIES = ENTITY_INDEX_MASK;
+		static constexpr PrxEntity NULL_ENTITY = UINT32_MAX;
+
+		PrxRegistry() = default;
+
+		// do not allow for copying
+		PrxRegistry(const PrxRegistry&) = delete;
+		PrxRegistry& operator=(const PrxRegistry&) = delete;
+
+		static uint32_t getIndex(PrxEntity entity) { return entity & ENTITY_INDEX_MASK; }
+		static uint32_t getGeneration(PrxEntity entity) { return entity >> ENTITY_INDEX_BITS; }
+
+		PrxEntity create();
+		// removes every component and recycles the index
+		void destroy(PrxEntity entity);
+		bool isAlive(PrxEntity entity) const;
+
+		size_t getEntityCount() const { return aliveCount; }
+		// one past the highest index handed out so far, i.e. the size a per-entity array needs to be
+		uint32_t getEntityCapacity() const { return static_cast<uint32_t>(generations.size()); }
+
+		template<typename T, typename... Args>
+		T& add(PrxEntity entity, Args&&... args) {
+			assert(isAlive(entity) && "Adding a component to a dead entity");
+			return getPool<T>().emplace(entity, std::forward<Args>(args)...);
+		}
+
+		template<typename T>
+		void remove(PrxEntity entity) {
+			getPool<T>().remove(getIndex(entity));
+		}
+
+		template<typename T>
+		T& get(PrxEntity entity) {
+			assert(isAlive(entity) && "Getting a component from a dead entity");
+			return getPool<T>().get(getIndex(entity));
+		}
+
+		template<typename T>
+		T* tryGet(PrxEntity entity) {
+			return isAlive(entity) ? getPool<T>().tryGet(getIndex(entity)) : nullptr;
+		}
+
+		template<typename T>
+		bool has(PrxEntity entity) {
+			return isAlive(entity) && getPool<T>().contains(getIndex(entity));
+		}
+
+		template<typename... Ts>
+		PrxView<Ts...> view() {
+			return PrxView<Ts...>{ getPool<Ts>()... };
+		}
+
+		template<typename T>
+		PrxComponentPool<T>& getPool() {
+			size_t typeId = componentTypeId<T>();
+			if (typeId >= pools.size()) {
+				pools.resize(typeId + 1);
+			}
+			if (pools[typeId] == nullptr) {
+				pools[typeId] = std::make_unique<PrxComponentPool<T>>();
+			}
+			return static_cast<PrxComponentPool<T>&>(*pools[typeId]);
+		}
+
+	private:
+		// small sequential ids, so pools can live in a vector instead of a map keyed on type
+		inline static size_t nextComponentTypeId = 0;
+
+		template<typename T>
+		static size_t componentTypeId() {
+			static const size_t typeId = nextComponentTypeId++;
+			return typeId;
+		}
+
+		std::vector<std::unique_ptr<PrxComponentPoolBase>> pools;
+		std::vector<uint32_t> generations; // current generation of each index
+		std::vector<uint32_t> freeIndices;
+		size_t aliveCount = 0;
+	};
+
+	// Iterates every entity that has all of Ts.
+	// Note: don't add or remove components of the viewed types from inside each()
+	template<typename... Ts>
+	class PrxView {
+	public:
+		PrxView(PrxComponentPool<Ts>&... pools) : pools{ &pools... } {}
+
+		// f(PrxEntity, Ts&...)
+		template<typename Func>
+		void each(Func&& func) {
+			if constexpr (sizeof...(Ts) == 1) {
+				// single component: a straight walk over the packed arrays
+				auto& pool = *std::get<0>(pools);
+				auto& components = pool.data();
+				const auto& entities = pool.entities();
+				for (size_t i = 0; i < entities.size(); i++) {
+					func(entities[i], components[i]);
+				}
+			}
+			else {
+				const PrxComponentPoolBase* smallest = std::get<0>(pools);
+				std::apply([&](auto*... pool) {
+					((smallest = pool->size() < smallest->size() ? pool : smallest), ...);
+				}, pools);
+
+				for (PrxEntity entity : smallest->entities()) {
+					uint32_t entityIndex = PrxRegistry::getIndex(entity);
+					bool hasAll = std::apply([&](auto*... pool) {
+						return (pool->contains(entityIndex) && ...);
+					}, pools);
+					if (!hasAll) continue;
+
+					std::apply([&](auto*... pool) {
+						func(entity, pool->get(entityIndex)...);
+					}, pools);
+				}
+			}
+		}
+
+		// upper bound on the number of entities each() will visit
+		size_t sizeHint() const {
+			size_t result = SIZE_MAX;
+			std::apply([&](auto*... pool) { ((result = std::min(result, pool->size())), ...); }, pools);
+			return result;
+		}
+
+	private:
+		std::tuple<PrxComponentPool<Ts>*...> pools;
+	};
+}
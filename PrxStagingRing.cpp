@@ -0,0 +1,62 @@
+#include "PrxStagingRing.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace prx {
+
+	static uint64_t alignUp(uint64_t value, uint64_t alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	PrxStagingRing::PrxStagingRing(PrxDevice& device, VkDeviceSize capacity)
+		: capacity{ alignUp(capacity, MIN_ALIGNMENT) } {
+		buffer = std::make_unique<PrxBuffer>(
+			device, 1, static_cast<uint32_t>(this->capacity), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+		if (buffer->map() != VK_SUCCESS) {
+			throw std::runtime_error("failed to map staging ring!");
+		}
+		mapped = static_cast<char*>(buffer->getMappedMemory());
+	}
+
+	bool PrxStagingRing::tryAllocate(VkDeviceSize size, VkDeviceSize alignment, Allocation& outAllocation) {
+		assert(size > 0 && size <= capacity && "Staging allocation larger than the ring, split it into chunks");
+
+		alignment = std::max(alignment, MIN_ALIGNMENT);
+		uint64_t start = alignUp(head, alignment);
+
+		// allocations never wrap around the end of the buffer; skip to the beginning instead
+		if (start % capacity + size > capacity) {
+			start = alignUp(start, capacity);
+		}
+
+		if (start + size - tail > capacity) {
+			return false;
+		}
+
+		head = start + size;
+
+		outAllocation.data = mapped + start % capacity;
+		outAllocation.offset = start % capacity;
+		outAllocation.size = size;
+		return true;
+	}
+
+	void PrxStagingRing::closeRegion(uint64_t ticket) {
+		if (head == closedHead) return;
+
+		regions.push_back({ ticket, head });
+		closedHead = head;
+	}
+
+	void PrxStagingRing::release(uint64_t ticket) {
+		while (!regions.empty() && regions.front().ticket <= ticket) {
+			tail = regions.front().end;
+			regions.pop_front();
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "PrxDevice.hpp"
+#include "PrxBuffer.hpp"
+
+// std
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+namespace prx {
+
+	// Fixed size, persistently mapped HOST_VISIBLE buffer used as a ring for staging data.
+	//	Space is handed out front to back; everything allocated between two calls to closeRegion()
+	//	belongs to the submission with that ticket and is only reused once release() is called
+	//	for it (i.e. once its fence has signaled). Staging memory is capped at the ring size no
+	//	matter how much gets uploaded.
+	class PrxStagingRing
+	{
+	public:
+		static constexpr VkDeviceSize DEFAULT_CAPACITY = 64ull * 1024 * 1024;
+		static constexpr VkDeviceSize MIN_ALIGNMENT = 16; // covers copy offset rules for the formats we upload
+
+		struct Allocation {
+			void* data = nullptr; // write the payload here
+			VkDeviceSize offset = 0; // offset into getBuffer() to copy from
+			VkDeviceSize size = 0;
+		};
+
+		PrxStagingRing(PrxDevice& device, VkDeviceSize capacity = DEFAULT_CAPACITY);
+
+		// do not allow for copying
+		PrxStagingRing(const PrxStagingRing&) = delete;
+		PrxStagingRing& operator=(const PrxStagingRing&) = delete;
+
+		// returns false if the ring is too full right now; release older regions and try again
+		bool tryAllocate(VkDeviceSize size, VkDeviceSize alignment, Allocation& outAllocation);
+
+		// everything allocated since the last call belongs to the submission with this ticket
+		void closeRegion(uint64_t ticket);
+		// the submission with this ticket (and every one before it) is done with its staging data
+		void release(uint64_t ticket);
+
+		bool hasOpenAllocations() const { return head != closedHead; }
+		bool hasPendingRegions() const { return !regions.empty(); }
+
+		VkBuffer getBuffer() const { return buffer->getBuffer(); }
+		VkDeviceSize getCapacity() const { return capacity; }
+		VkDeviceSize getUsedBytes() const { return head - tail; }
+
+	private:
+		struct Region {
+			uint64_t ticket;
+			uint64_t end;
+		};
+
+		std::unique_ptr<PrxBuffer> buffer;
+		char* mapped = nullptr;
+		VkDeviceSize capacity;
+
+		// head and tail only ever increase; the byte in the buffer is (value % capacity)
+		uint64_t head = 0; // next free byte
+		uint64_t tail = 0; // oldest byte still owned by the GPU
+		uint64_t closedHead = 0; // head at the last closeRegion()
+		std::deque<Region> regions;
+	};
+}
@@ -6,20 +6,26 @@
 #include "PrxRenderer.hpp"
 #include "PrxGlobalVars.hpp"
 #include "PrxDescriptors.hpp"
+#include "PrxUploadContext.hpp"
+#include "PrxMappedFile.hpp"
 
 // lib
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
 // std
+#include <cassert>
 #include <stdexcept>
 #include <cmath>
 
 namespace prx {
 	unsigned int PrxTexture::next_id = 0;
 
-	PrxTexture::PrxTexture(PrxDevice& device, const std::string& filepath) : prxDevice(device) {
-		createTextureImage(filepath);
+	PrxTexture::PrxTexture(PrxDevice& device, const std::string& filepath)
+		: PrxTexture(device, ImageData::loadFromFile(filepath)) {}
+
+	PrxTexture::PrxTexture(PrxDevice& device, const ImageData& image) : prxDevice(device) {
+		createTextureImage(image);
 		createTextureImageView(VK_IMAGE_VIEW_TYPE_2D); // only supports 2D images for now
 													   //	in the future, update to support more image types!
 		createTextureSampler();
@@ -57,7 +63,7 @@ namespace prx {
 		imageCreateInfo.usage = usage;
 		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 		device.createImageWithInfo(imageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			texImage, texImageMemory);
+			texImage, texImageAllocation);
 
 		VkImageViewCreateInfo viewCreateInfo{};
 		viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -104,21 +110,8 @@ namespace prx {
 		texImageDescriptor.imageView = texImageView;
 		texImageDescriptor.imageLayout = samplerImageLayout;
 
-		// this stuff is for texture arrays, come back to it when you are going to implement them
-		/*
-		VkDescriptorSetLayoutBinding layoutBinding{};
-		layoutBinding.descriptorCount = 8;
-		layoutBinding.binding = 1; // binding textures to bind 1
-		layoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT; // Again, textures only go in the fragment shader
-		layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-		layoutBinding.pImmutableSamplers = 0;
-
-		VkDescriptorImageInfo texImageDescriptors[TEXTURE_ARRAY_SIZE];
-		for (int i = 0; i < TEXTURE_ARRAY_SIZE; ++i) {
-			imageDescriptors[i].sampler = nullptr;
-			imageDescriptors[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			imageDescriptors[i].imageView = imageView;
-		}*/
+		// Note: texture arrays are handled by PrxBindlessTextureTable, which writes this descriptor
+		//	into its sampler array when the texture is registered
 
 	}
 
@@ -133,48 +126,42 @@ namespace prx {
 		texImageDescriptor.imageLayout = texImageLayout;
 	}
 
-	void PrxTexture::createTextureImage(const std::string& filepath) {
+	PrxTexture::ImageData PrxTexture::ImageData::loadFromFile(const std::string& filepath) {
 		int texWidth;
-		int texHeight; 
+		int texHeight;
 		int texChannels;
+		// decoded straight out of the mapping, the file is only read once for both the hash and the pixels
+		PrxMappedFile file{};
+		if (!file.open(filepath)) {
+			throw std::runtime_error("failed to load texture image: " + filepath + "!");
+		}
 		// note: somewhere in here is why texture coordinates are flipped
-		stbi_uc* pixels = stbi_load(filepath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-		VkDeviceSize imageSize = texWidth * texHeight * 4;
+		stbi_uc* pixels = stbi_load_from_memory(file.data(), static_cast<int>(file.size()),
+			&texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
 
 		if (!pixels) {
-			throw std::runtime_error("failed to load texture image!");
+			throw std::runtime_error("failed to load texture image: " + filepath + "!");
 		}
 
+		ImageData image{};
+		image.width = static_cast<uint32_t>(texWidth);
+		image.height = static_cast<uint32_t>(texHeight);
+		image.pixels = std::unique_ptr<uint8_t, void (*)(void*)>{ pixels, stbi_image_free };
+		image.contentHash = file.hash();
+		return image;
+	}
+
+	void PrxTexture::createTextureImage(const ImageData& image) {
+		assert(image.pixels != nullptr && "Texture created from an empty image");
+		VkDeviceSize imageSize = static_cast<VkDeviceSize>(image.width) * image.height * 4;
+
 		// find a way to make more mip levels later on when support is added later
 		// example would be to use this code from how you were doing it before:
 		// mipLevels = std::floor(std::log2(std::max(width, height))) + 1;
 		mipLevels = 1;
 
-		PrxBuffer stagingBuffer(
-			prxDevice, 1, static_cast<uint32_t>(imageSize), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer(pixels);
-
-		// the above buffer class functionally does the following,
-		//	but does not unmap until the wrapper's EOL (unless otherwise specified)
-		/*VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-
-		prxDevice.createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			stagingBuffer, stagingBufferMemory);
-
-		void* data;
-		vkMapMemory(prxDevice.device(), stagingBufferMemory, 0, imageSize, 0, &data);
-		memcpy(data, pixels, static_cast<uint32_t>(imageSize));
-		vkUnmapMemory(prxDevice.device(), stagingBufferMemory);*/
-
-		stbi_image_free(pixels);
-
 		texFormat = VK_FORMAT_R8G8B8A8_SRGB;
-		texExtent = { static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), 1 };
+		texExtent = { image.width, image.height, 1 };
 
 		VkImageCreateInfo imageCreateInfo{};
 		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -191,24 +178,15 @@ namespace prx {
 		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
 		prxDevice.createImageWithInfo(imageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			texImage, texImageMemory);
-		prxDevice.transitionImageLayout(texImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels, layerCount);
-		prxDevice.copyBufferToImage(stagingBuffer.getBuffer(), texImage,
-			static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight),
-			layerCount);
+			texImage, texImageAllocation);
 
-		// copy out once mips are implemented
-		prxDevice.transitionImageLayout(texImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels, layerCount);
+		// the upload context copies the pixels into staging memory straight away and records the
+		//	layout transitions + copy into the current upload batch, so the pixels can be freed after this
+		prxDevice.getUploadContext().uploadImage(image.pixels.get(), imageSize, texImage, texExtent, mipLevels, layerCount);
 
 		// if mip maps are generated then the final image will already be READ_ONLY_OPTIMAL
 		//generateMipmaps(); // shift this to the device class asap, you have the code base in this file
 		texImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-		// Uncomment if doing manual memory management instead of using PrxBuffer
-		/*vkDestroyBuffer(prxDevice.device(), stagingBuffer, nullptr);
-		vkFreeMemory(prxDevice.device(), stagingBufferMemory, nullptr);*/
 	}
 
 	void PrxTexture::createTextureImageView(VkImageViewType viewType) {
@@ -268,9 +246,9 @@ namespace prx {
 	}
 
 	PrxTexture::~PrxTexture() {
-		vkDestroyImage(prxDevice.device(), texImage, nullptr);
-		vkFreeMemory(prxDevice.device(), texImageMemory, nullptr);
 		vkDestroyImageView(prxDevice.device(), texImageView, nullptr);
+		vkDestroyImage(prxDevice.device(), texImage, nullptr);
+		prxDevice.freeAllocation(texImageAllocation);
 		vkDestroySampler(prxDevice.device(), texSampler, nullptr);
 	}
 
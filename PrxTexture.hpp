@@ -1,5 +1,6 @@
 #pragma once
 #include "PrxDevice.hpp"
+#include <cstdint>
 #include <string>
 #include <memory>
 
@@ -18,7 +19,19 @@ namespace prx {
 		//	Do that later, though.
 		static unsigned int next_id;
 
+		// Decoded RGBA8 pixels of an image file. Decoding touches no Vulkan state, so it can run on
+		//	any thread (see PrxAssetLoader), only creating the PrxTexture has to be on the main one
+		struct ImageData {
+			uint32_t width = 0;
+			uint32_t height = 0;
+			std::unique_ptr<uint8_t, void (*)(void*)> pixels{ nullptr, nullptr }; // owned by stb_image
+			uint64_t contentHash = 0; // of the file, not the pixels (see PrxTextureCache)
+
+			static ImageData loadFromFile(const std::string& filepath);
+		};
+
 		PrxTexture(PrxDevice& device, const std::string& filepath);
+		PrxTexture(PrxDevice& device, const ImageData& image);
 		PrxTexture(PrxDevice& device, VkFormat format, VkExtent3D extent,
 			VkImageUsageFlags usage, VkSampleCountFlagBits);
 		~PrxTexture();
@@ -47,7 +60,7 @@ namespace prx {
 
 	private:
 
-		void createTextureImage(const std::string& filepath);
+		void createTextureImage(const ImageData& image);
 		void createTextureImageView(VkImageViewType viewType);
 		void createTextureSampler();
 		void assignID();
@@ -61,7 +74,7 @@ namespace prx {
 
 		VkSampler texSampler = nullptr;
 		VkImage texImage = nullptr;
-		VkDeviceMemory texImageMemory = nullptr;
+		PrxAllocation texImageAllocation{};
 		VkImageView texImageView = nullptr; // image views provide metadata for an image, as Vulkan does not access images direction
 		VkDescriptorImageInfo texImageDescriptor;
 		VkImageLayout texImageLayout;
@@ -0,0 +1,133 @@
+#include "PrxTextureCache.hpp"
+#include "PrxSwapChain.hpp"
+
+// std
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+
+namespace prx {
+
+	PrxTextureCache::PrxTextureCache(PrxDevice& device, VkDeviceSize memoryBudget)
+		: prxDevice{ device }, memoryBudget{ memoryBudget } {}
+
+	std::string PrxTextureCache::canonicalPath(const std::string& filepath) {
+		// weakly, so a missing file still gets a key (and fails later, when it is loaded)
+		//	Note: absolute first, a relative path that doesn't exist would stay relative otherwise
+		std::error_code error;
+		std::filesystem::path path = std::filesystem::absolute(filepath, error);
+		if (!error) {
+			path = std::filesystem::weakly_canonical(path, error);
+		}
+		if (error) {
+			path = std::filesystem::path{ filepath }.lexically_normal();
+		}
+		return path.generic_string();
+	}
+
+	std::shared_ptr<PrxTexture> PrxTextureCache::use(Entry& entry) {
+		entry.lastUse = ++useCounter;
+		return entry.texture;
+	}
+
+	std::shared_ptr<PrxTexture> PrxTextureCache::find(const std::string& filepath) {
+		auto it = contentHashes.find(canonicalPath(filepath));
+		if (it == contentHashes.end()) return nullptr;
+
+		stats.pathHits++;
+		return use(entries.at(it->second));
+	}
+
+	std::shared_ptr<PrxTexture> PrxTextureCache::get(const std::string& filepath) {
+		if (auto texture = find(filepath)) {
+			return texture;
+		}
+		return insert(filepath, PrxTexture::ImageData::loadFromFile(filepath));
+	}
+
+	std::shared_ptr<PrxTexture> PrxTextureCache::insert(const std::string& filepath, const PrxTexture::ImageData& image) {
+		const std::string path = canonicalPath(filepath);
+
+		// Note: a 64 bit hash, two different images sharing one isn't a real concern
+		auto it = entries.find(image.contentHash);
+		if (it != entries.end()) {
+			Entry& entry = it->second;
+			if (contentHashes.emplace(path, image.contentHash).second) {
+				entry.paths.push_back(path);
+				stats.contentHits++;
+			}
+			else {
+				// loaded twice before the first one made it in (two loads of the same file in flight)
+				stats.pathHits++;
+			}
+			return use(entry);
+		}
+
+		Entry& entry = entries[image.contentHash];
+		entry.texture = std::make_shared<PrxTexture>(prxDevice, image);
+		// RGBA8 and a single mip level, see PrxTexture::createTextureImage
+		entry.size = VkDeviceSize{ image.width } * image.height * 4;
+		entry.paths.push_back(path);
+		contentHashes[path] = image.contentHash;
+
+		stats.misses++;
+		stats.residentBytes += entry.size;
+		stats.entryCount++;
+		return use(entry);
+	}
+
+	void PrxTextureCache::trim() {
+		if (stats.residentBytes <= memoryBudget) return;
+
+		// the cache's own reference is the only one left on an unused entry
+		std::vector<std::unordered_map<uint64_t, Entry>::iterator> unused;
+		for (auto it = entries.begin(); it != entries.end(); ++it) {
+			if (it->second.texture.use_count() == 1) {
+				unused.push_back(it);
+			}
+		}
+		std::sort(unused.begin(), unused.end(), [](const auto& a, const auto& b) {
+			return a->second.lastUse < b->second.lastUse;
+		});
+
+		for (auto it : unused) {
+			if (stats.residentBytes <= memoryBudget) break;
+
+			Entry& entry = it->second;
+			for (const std::string& path : entry.paths) {
+				// the path may point at a newer entry by now, if the file changed on disk
+				auto hash = contentHashes.find(path);
+				if (hash != contentHashes.end() && hash->second == it->first) {
+					contentHashes.erase(hash);
+				}
+			}
+
+			stats.residentBytes -= entry.size;
+			stats.entryCount--;
+			stats.evictions++;
+			stats.retiredBytes += entry.size;
+			stats.retiredCount++;
+			retired.push_back(RetiredTexture{ std::move(entry.texture), entry.size, frameCount });
+			entries.erase(it);
+		}
+	}
+
+	void PrxTextureCache::nextFrame() {
+		frameCount++;
+
+		// oldest first, so this stops at the first one that still has to wait
+		size_t releaseCount = 0;
+		while (releaseCount < retired.size()
+			&& frameCount - retired[releaseCount].frame > PrxSwapChain::MAX_FRAMES_IN_FLIGHT) {
+			RetiredTexture& texture = retired[releaseCount];
+			if (onEvict) {
+				onEvict(*texture.texture);
+			}
+			stats.retiredBytes -= texture.size;
+			stats.retiredCount--;
+			texture.texture.reset();
+			releaseCount++;
+		}
+		retired.erase(retired.begin(), retired.begin() + releaseCount);
+	}
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "PrxDevice.hpp"
+#include "PrxTexture.hpp"
+
+// std
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace prx {
+
+	// Every PrxTexture made from an image file, so each image is decoded and uploaded once no matter
+	//	how many materials or game objects use it.
+	//	Entries are found by canonical path first (so "textures/a.png" and "./textures/../textures/a.png"
+	//	are the same entry), then by a hash of the file's contents, which catches the same image
+	//	copied next to several models.
+	//
+	// Handles are shared_ptrs: an entry is in use as long as anything outside the cache holds one.
+	//	Entries nothing holds anymore stay cached (a later load is still a hit) until trim() needs
+	//	their memory back to fit the budget, least recently used first.
+	//	Frames still in flight may sample a texture nothing holds anymore, so an evicted texture
+	//	is only released (eviction callback, then destroyed) MAX_FRAMES_IN_FLIGHT frames later, see nextFrame().
+	class PrxTextureCache
+	{
+	public:
+		static constexpr VkDeviceSize DEFAULT_MEMORY_BUDGET = 512ull * 1024 * 1024;
+
+		struct Stats {
+			uint64_t pathHits = 0;
+			uint64_t contentHits = 0; // a new path, but the same image as a cached one
+			uint64_t misses = 0;
+			uint64_t evictions = 0;
+			VkDeviceSize residentBytes = 0;
+			uint32_t entryCount = 0;
+			VkDeviceSize retiredBytes = 0; // evicted, waiting for the frames in flight
+			uint32_t retiredCount = 0;
+		};
+
+		explicit PrxTextureCache(PrxDevice& device, VkDeviceSize memoryBudget = DEFAULT_MEMORY_BUDGET);
+
+		// do not allow for copying
+		PrxTextureCache(const PrxTextureCache&) = delete;
+		PrxTextureCache& operator=(const PrxTextureCache&) = delete;
+
+		// the cached texture, or loads it (decode and upload, on this thread) on a miss
+		std::shared_ptr<PrxTexture> get(const std::string& filepath);
+		// the cached texture for a path, or null. Counts as a hit, but never loads
+		std::shared_ptr<PrxTexture> find(const std::string& filepath);
+		// for images decoded somewhere else (PrxAssetLoader's workers): returns the cached texture
+		//	with the same contents, or creates one from image. Main thread only, like any PrxTexture
+		std::shared_ptr<PrxTexture> insert(const std::string& filepath, const PrxTexture::ImageData& image);
+
+		// Evicts textures nothing outside the cache holds, least recently used first, until the
+		//	cache fits its budget. Nothing is evicted on its own, call this e.g. once a frame.
+		//	Evicted textures stay alive (and keep their table slot) until nextFrame() releases them
+		void trim();
+		// Call once a frame, after its submission. Releases textures evicted more than
+		//	MAX_FRAMES_IN_FLIGHT frames ago, every frame that could sample them has finished by then
+		void nextFrame();
+		void setMemoryBudget(VkDeviceSize budget) { memoryBudget = budget; }
+		VkDeviceSize getMemoryBudget() const { return memoryBudget; }
+		// runs right before an evicted texture is released, e.g. to take it out of a PrxBindlessTextureTable
+		void setEvictionCallback(std::function<void(PrxTexture&)> callback) { onEvict = std::move(callback); }
+
+		const Stats& getStats() const { return stats; }
+
+		static std::string canonicalPath(const std::string& filepath);
+
+	private:
+		struct Entry {
+			std::shared_ptr<PrxTexture> texture;
+			VkDeviceSize size = 0;
+			uint64_t lastUse = 0;
+			std::vector<std::string> paths; // every canonical path that led here
+		};
+
+		// an evicted texture, until nextFrame() releases it
+		struct RetiredTexture {
+			std::shared_ptr<PrxTexture> texture;
+			VkDeviceSize size = 0;
+			uint64_t frame = 0; // frameCount when it was evicted
+		};
+
+		std::shared_ptr<PrxTexture> use(Entry& entry);
+
+		PrxDevice& prxDevice;
+		VkDeviceSize memoryBudget;
+		std::function<void(PrxTexture&)> onEvict;
+
+		std::unordered_map<uint64_t, Entry> entries; // by content hash
+		std::unordered_map<std::string, uint64_t> contentHashes; // by canonical path
+		uint64_t useCounter = 0;
+		std::vector<RetiredTexture> retired; // oldest first
+		uint64_t frameCount = 0;
+		Stats stats{};
+	};
+}
@@ -0,0 +1,580 @@
+#include "PrxTlas.hpp"
+#include "PrxParallel.hpp"
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <mutex>
+
+namespace prx {
+
+	void PrxTlasInstance::setTransform(const glm::mat4& objectToWorld) {
+		// glm is column major, the instance wants rows
+		for (int row = 0; row < 3; row++) {
+			for (int column = 0; column < 4; column++) {
+				transform[row][column] = objectToWorld[column][row];
+			}
+		}
+	}
+
+	glm::mat4 PrxTlasInstance::getTransform() const {
+		glm::mat4 objectToWorld{ 1.f };
+		for (int row = 0; row < 3; row++) {
+			for (int column = 0; column < 4; column++) {
+				objectToWorld[column][row] = transform[row][column];
+			}
+		}
+		return objectToWorld;
+	}
+
+	glm::mat4 PrxTlasInstance::getInverseTransform() const {
+		// inverse of the 3x3 part from its cofactors, then the translation taken back through it
+		const auto& m = transform;
+		const float c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+		const float c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+		const float c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+		const float det = m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02;
+		if (det == 0.f) {
+			return glm::mat4{ 0.f };
+		}
+		const float invDet = 1.f / det;
+
+		// rows of the inverse
+		float inverse[3][3] = {
+			{ c00 * invDet, (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * invDet, (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * invDet },
+			{ c01 * invDet, (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * invDet, (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * invDet },
+			{ c02 * invDet, (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * invDet, (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * invDet } };
+
+		glm::mat4 worldToObject{ 1.f };
+		for (int row = 0; row < 3; row++) {
+			float translation = 0.f;
+			for (int column = 0; column < 3; column++) {
+				worldToObject[column][row] = inverse[row][column];
+				translation -= inverse[row][column] * m[column][3];
+			}
+			worldToObject[3][row] = translation;
+		}
+		return worldToObject;
+	}
+
+	namespace {
+		// spreads the low 10 bits of v out to every third bit
+		uint32_t expandBits(uint32_t v) {
+			v = (v * 0x00010001u) & 0xFF0000FFu;
+			v = (v * 0x00000101u) & 0x0F00F00Fu;
+			v = (v * 0x00000011u) & 0xC30C30C3u;
+			v = (v * 0x00000005u) & 0x49249249u;
+			return v;
+		}
+
+		// 30 bit code, x in the highest bit of every triple. p is in [0, 1]
+		uint32_t mortonCode(const glm::vec3& p) {
+			uint32_t x = static_cast<uint32_t>(std::min(std::max(p.x * 1024.f, 0.f), 1023.f));
+			uint32_t y = static_cast<uint32_t>(std::min(std::max(p.y * 1024.f, 0.f), 1023.f));
+			uint32_t z = static_cast<uint32_t>(std::min(std::max(p.z * 1024.f, 0.f), 1023.f));
+			return (expandBits(x) << 2) | (expandBits(y) << 1) | expandBits(z);
+		}
+
+		void appendSubtree(std::vector<PrxBvh::Node>& out, const std::vector<PrxBvh::Node>& subtree) {
+			const uint32_t base = static_cast<uint32_t>(out.size());
+			for (PrxBvh::Node node : subtree) {
+				if (!node.isLeaf()) {
+					node.offset += base;
+				}
+				out.push_back(node);
+			}
+		}
+	}
+
+	void PrxTlas::update(PrxGameObjectManager& gameObjectManager) {
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		auto& modelPool = gameObjectManager.registry.getPool<ModelComponent>();
+		const auto& objectData = gameObjectManager.getObjectData();
+
+		if (forceRebuild || modelPool.getVersion() != modelPoolVersion) {
+			modelPoolVersion = modelPool.getVersion();
+			forceRebuild = false;
+
+			// walk the packed model pool, one instance per object and one BLAS per distinct model
+			instances.clear();
+			blases.clear();
+			blasLookup.clear();
+			instanceEntities.clear();
+			const auto& entities = modelPool.entities();
+			auto& models = modelPool.data();
+			for (size_t i = 0; i < entities.size(); i++) {
+				const PrxModel* model = models[i].model.get();
+				if (model == nullptr) continue;
+
+				auto [it, inserted] = blasLookup.try_emplace(model, static_cast<uint32_t>(blases.size()));
+				if (inserted) {
+					blases.push_back(&model->getBlas());
+				}
+
+				uint32_t objectIndex = PrxGameObjectManager::getBufferIndex(entities[i]);
+				PrxTlasInstance instance{};
+				instance.setTransform(objectData[objectIndex].modelMatrix);
+				instance.instanceCustomIndex = objectIndex;
+				instance.mask = 0xFF;
+				instance.instanceShaderBindingTableRecordOffset = 0;
+				instance.flags = 0;
+				instance.accelerationStructureReference = it->second;
+				instances.push_back(instance);
+				instanceEntities.push_back(entities[i]);
+			}
+			rebuild();
+		}
+		else {
+			// same objects, same models: only the transforms can have changed
+			for (size_t i = 0; i < instances.size(); i++) {
+				uint32_t objectIndex = PrxGameObjectManager::getBufferIndex(instanceEntities[i]);
+				instances[i].setTransform(objectData[objectIndex].modelMatrix);
+			}
+			refit();
+		}
+
+		auto endTime = std::chrono::high_resolution_clock::now();
+		stats.updateMilliseconds = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+	}
+
+	void PrxTlas::build(std::vector<PrxTlasInstance> newInstances, std::vector<const PrxBvh*> newBlases) {
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		instances = std::move(newInstances);
+		blases = std::move(newBlases);
+		// the game object bookkeeping doesn't describe these instances
+		instanceEntities.clear();
+		blasLookup.clear();
+		forceRebuild = true;
+		rebuild();
+
+		auto endTime = std::chrono::high_resolution_clock::now();
+		stats.updateMilliseconds = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+	}
+
+	void PrxTlas::refit() {
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		const uint32_t changedCount = updateInstances(false);
+		stats.changedInstanceCount = changedCount;
+		stats.refitted = true;
+		if (changedCount > 0) {
+			// Note: partial refits only add up how the area changed, so a full refit now and then
+			//	also puts nodeArea back on its exact sum
+			if (changedCount < instances.size() / PARTIAL_REFIT_FRACTION) {
+				nodeArea += refitChangedNodes();
+			}
+			else {
+				gatherSortedBounds();
+				nodeArea = refitNodes();
+			}
+			if (nodeArea > REBUILD_AREA_RATIO * builtNodeArea) {
+				rebuild();
+			}
+		}
+
+		auto endTime = std::chrono::high_resolution_clock::now();
+		stats.updateMilliseconds = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+	}
+
+	void PrxTlas::rebuild() {
+		blasBounds.resize(blases.size());
+		for (size_t i = 0; i < blases.size(); i++) {
+			blasBounds[i] = blases[i]->getBounds();
+		}
+
+		uint32_t threadCount = PrxParallel::getThreadCount();
+		parallelDepth = 0;
+		while ((1u << parallelDepth) < threadCount) {
+			parallelDepth++;
+		}
+
+		stats.changedInstanceCount = updateInstances(true);
+		sortInstances();
+		gatherSortedBounds();
+
+		nodes.clear();
+		builtNodeArea = 0.f;
+		if (!instances.empty()) {
+			nodes.reserve(2 * instances.size());
+			emitRange(0, static_cast<uint32_t>(instances.size()), 0, nodes, builtNodeArea);
+		}
+		nodeArea = builtNodeArea;
+		linkNodes();
+		splitRefitRanges();
+
+		stats.refitted = false;
+		stats.instanceCount = static_cast<uint32_t>(instances.size());
+		stats.nodeCount = static_cast<uint32_t>(nodes.size());
+	}
+
+	uint32_t PrxTlas::updateInstances(bool all) {
+		const uint32_t count = static_cast<uint32_t>(instances.size());
+		if (all) {
+			instanceBounds.resize(count);
+			worldToObject.resize(count);
+			computedTransforms.resize(count);
+		}
+		assert(computedTransforms.size() == count && "Instances were added or removed without a rebuild");
+
+		// Note: update() sets every transform every frame, so this compares instead of trusting a
+		//	dirty flag. Objects that stood still keep their inverse and box
+		std::atomic<uint32_t> changedCount{ 0 };
+		std::mutex changedMutex;
+		changedInstances.clear();
+		PrxParallel::forEachRange(count, PARALLEL_THRESHOLD, [&](uint32_t begin, uint32_t end) {
+			uint32_t changed = 0;
+			std::vector<uint32_t> rangeChanged;
+			for (uint32_t i = begin; i < end; i++) {
+				const PrxTlasInstance& instance = instances[i];
+				InstanceTransform& computed = computedTransforms[i];
+				if (!all && std::memcmp(computed.transform, instance.transform, sizeof(computed.transform)) == 0) continue;
+
+				std::memcpy(computed.transform, instance.transform, sizeof(computed.transform));
+				worldToObject[i] = instance.getInverseTransform();
+				instanceBounds[i] = computeInstanceBounds(instance);
+				changed++;
+				if (!all) {
+					rangeChanged.push_back(i);
+				}
+			}
+			changedCount.fetch_add(changed, std::memory_order_relaxed);
+			if (!rangeChanged.empty()) {
+				std::lock_guard<std::mutex> lock{ changedMutex };
+				changedInstances.insert(changedInstances.end(), rangeChanged.begin(), rangeChanged.end());
+			}
+		});
+		return changedCount.load();
+	}
+
+	void PrxTlas::gatherSortedBounds() {
+		sortedBounds.resize(instances.size());
+		PrxParallel::forEachRange(static_cast<uint32_t>(instanceOrder.size()), PARALLEL_THRESHOLD, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				sortedBounds[i] = instanceBounds[instanceOrder[i]];
+			}
+		});
+	}
+
+	bool PrxTlas::intersect(const PrxRay& ray, PrxHit& hit) const {
+		if (nodes.empty()) return false;
+
+		const glm::vec3 invDirection = 1.f / ray.direction;
+		const bool directionNegative[3] = { ray.direction.x < 0.f, ray.direction.y < 0.f, ray.direction.z < 0.f };
+		bool found = false;
+
+		uint32_t stack[PrxBvh::MAX_TRAVERSAL_DEPTH];
+		uint32_t stackSize = 0;
+		uint32_t nodeIndex = 0;
+		while (true) {
+			const PrxBvh::Node& node = nodes[nodeIndex];
+			const float tMax = std::min(ray.tMax, hit.t);
+
+			const glm::vec3 t0 = (node.boundsMin - ray.origin) * invDirection;
+			const glm::vec3 t1 = (node.boundsMax - ray.origin) * invDirection;
+			const glm::vec3 tNear = glm::min(t0, t1);
+			const glm::vec3 tFar = glm::max(t0, t1);
+			const float tEnter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, ray.tMin));
+			const float tExit = std::min(std::min(std::min(tFar.x, tFar.y), tFar.z) * PrxRayTriangleTest::BOX_ROBUSTNESS, tMax);
+
+			if (tEnter <= tExit) {
+				if (node.isLeaf()) {
+					for (uint32_t i = node.offset; i < node.offset + node.triangleCount; i++) {
+						const uint32_t instanceIndex = instanceOrder[i];
+						const glm::mat4& toObject = worldToObject[instanceIndex];
+						PrxRay objectRay{};
+						objectRay.origin = glm::vec3(toObject * glm::vec4(ray.origin, 1.f));
+						objectRay.direction = glm::vec3(toObject * glm::vec4(ray.direction, 0.f));
+						objectRay.tMin = ray.tMin;
+						objectRay.tMax = ray.tMax;
+						const PrxBvh& blas = *blases[instances[instanceIndex].accelerationStructureReference];
+						if (blas.intersect(objectRay, hit)) {
+							hit.instance = instanceIndex;
+							found = true;
+						}
+					}
+				}
+				else {
+					uint32_t first = nodeIndex + 1;
+					uint32_t second = node.offset;
+					if (directionNegative[node.splitAxis]) {
+						std::swap(first, second);
+					}
+					assert(stackSize < PrxBvh::MAX_TRAVERSAL_DEPTH && "TLAS traversal stack overflow");
+					stack[stackSize++] = second;
+					nodeIndex = first;
+					continue;
+				}
+			}
+
+			if (stackSize == 0) break;
+			nodeIndex = stack[--stackSize];
+		}
+		return found;
+	}
+
+	PrxAabb PrxTlas::computeInstanceBounds(const PrxTlasInstance& instance) const {
+		const auto& transform = instance.transform;
+		const PrxAabb& localBounds = blasBounds[instance.accelerationStructureReference];
+
+		glm::vec3 worldCenter{ transform[0][3], transform[1][3], transform[2][3] };
+		if (localBounds.isEmpty()) {
+			// nothing to hit, but it still needs a place on the curve
+			return PrxAabb{ worldCenter, worldCenter };
+		}
+
+		// box around the transformed box (Arvo), straight from the 3x4 rows
+		const glm::vec3 center = localBounds.center();
+		const glm::vec3 halfSize = localBounds.extent() * .5f;
+		glm::vec3 worldExtent{};
+		for (int row = 0; row < 3; row++) {
+			worldCenter[row] += transform[row][0] * center.x + transform[row][1] * center.y + transform[row][2] * center.z;
+			worldExtent[row] = std::abs(transform[row][0]) * halfSize.x
+				+ std::abs(transform[row][1]) * halfSize.y
+				+ std::abs(transform[row][2]) * halfSize.z;
+		}
+		return PrxAabb{ worldCenter - worldExtent, worldCenter + worldExtent };
+	}
+
+	void PrxTlas::sortInstances() {
+		const uint32_t count = static_cast<uint32_t>(instances.size());
+		instanceOrder.resize(count);
+		mortonCodes.resize(count);
+		if (count == 0) return;
+
+		PrxAabb centroidBounds{};
+		std::mutex boundsMutex;
+		PrxParallel::forEachRange(count, PARALLEL_THRESHOLD, [&](uint32_t begin, uint32_t end) {
+			PrxAabb rangeBounds{};
+			for (uint32_t i = begin; i < end; i++) {
+				rangeBounds.grow(instanceBounds[i].center());
+			}
+			std::lock_guard<std::mutex> lock{ boundsMutex };
+			centroidBounds.grow(rangeBounds);
+		});
+		glm::vec3 extent = centroidBounds.extent();
+		glm::vec3 invExtent{
+			extent.x > 0.f ? 1.f / extent.x : 0.f,
+			extent.y > 0.f ? 1.f / extent.y : 0.f,
+			extent.z > 0.f ? 1.f / extent.z : 0.f };
+
+		PrxParallel::forEachRange(count, PARALLEL_THRESHOLD, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				instanceOrder[i] = i;
+				mortonCodes[i] = mortonCode((instanceBounds[i].center() - centroidBounds.min) * invExtent);
+			}
+		});
+
+		// LSD radix sort, 3 passes of 10 bits covers the whole 30 bit code.
+		//	Note: stable, so instances with the same code keep their order from one build to the next
+		constexpr uint32_t RADIX_BITS = 10;
+		constexpr uint32_t BUCKET_COUNT = 1u << RADIX_BITS;
+		sortScratchCodes.resize(count);
+		sortScratchOrder.resize(count);
+		std::vector<uint32_t> bucketStart(BUCKET_COUNT);
+		for (uint32_t shift = 0; shift < 30; shift += RADIX_BITS) {
+			std::fill(bucketStart.begin(), bucketStart.end(), 0u);
+			for (uint32_t i = 0; i < count; i++) {
+				bucketStart[(mortonCodes[i] >> shift) & (BUCKET_COUNT - 1)]++;
+			}
+			uint32_t sum = 0;
+			for (uint32_t& bucket : bucketStart) {
+				uint32_t bucketCount = bucket;
+				bucket = sum;
+				sum += bucketCount;
+			}
+			for (uint32_t i = 0; i < count; i++) {
+				uint32_t destination = bucketStart[(mortonCodes[i] >> shift) & (BUCKET_COUNT - 1)]++;
+				sortScratchCodes[destination] = mortonCodes[i];
+				sortScratchOrder[destination] = instanceOrder[i];
+			}
+			mortonCodes.swap(sortScratchCodes);
+			instanceOrder.swap(sortScratchOrder);
+		}
+	}
+
+	PrxAabb PrxTlas::emitRange(uint32_t begin, uint32_t end, uint32_t depth, std::vector<PrxBvh::Node>& out, float& nodeArea) const {
+		const uint32_t nodeIndex = static_cast<uint32_t>(out.size());
+		out.emplace_back();
+
+		if (end - begin <= MAX_LEAF_SIZE) {
+			PrxAabb bounds{};
+			for (uint32_t i = begin; i < end; i++) {
+				bounds.grow(sortedBounds[i]);
+			}
+			out[nodeIndex] = PrxBvh::Node{ bounds.min, begin, bounds.max,
+				static_cast<uint16_t>(end - begin), static_cast<uint16_t>(0) };
+			nodeArea += bounds.surfaceArea();
+			return bounds;
+		}
+
+		// Split where the highest bit that differs across the range flips. The codes are sorted,
+		//	so everything shares the bits above it and it splits the range in two.
+		//	Identical codes have no such bit, so those are just halved
+		const uint32_t firstCode = mortonCodes[begin];
+		const uint32_t lastCode = mortonCodes[end - 1];
+		uint32_t split;
+		uint16_t splitAxis = 0;
+		if (firstCode == lastCode) {
+			split = begin + (end - begin) / 2;
+		}
+		else {
+			const uint32_t difference = firstCode ^ lastCode;
+			uint32_t highestBit = 29;
+			while ((difference & (1u << highestBit)) == 0) {
+				highestBit--;
+			}
+			const uint32_t bit = 1u << highestBit;
+			split = static_cast<uint32_t>(std::partition_point(mortonCodes.begin() + begin, mortonCodes.begin() + end,
+				[bit](uint32_t code) { return (code & bit) == 0; }) - mortonCodes.begin());
+			// bits go x, y, z from the top of each triple
+			splitAxis = static_cast<uint16_t>(2 - highestBit % 3);
+		}
+
+		// like PrxBvh, big ranges near the top emit their halves on two threads into their own
+		//	arrays, which are then spliced in behind this node
+		PrxAabb leftBounds{};
+		PrxAabb rightBounds{};
+		uint32_t secondChild;
+		if (end - begin >= PARALLEL_THRESHOLD && depth < parallelDepth) {
+			std::vector<PrxBvh::Node> left;
+			std::vector<PrxBvh::Node> right;
+			float leftArea = 0.f;
+			float rightArea = 0.f;
+			auto leftTask = std::async(std::launch::async, [&]() {
+				leftBounds = emitRange(begin, split, depth + 1, left, leftArea);
+			});
+			rightBounds = emitRange(split, end, depth + 1, right, rightArea);
+			leftTask.get();
+
+			secondChild = nodeIndex + 1 + static_cast<uint32_t>(left.size());
+			appendSubtree(out, left);
+			appendSubtree(out, right);
+			nodeArea += leftArea + rightArea;
+		}
+		else {
+			leftBounds = emitRange(begin, split, depth + 1, out, nodeArea);
+			secondChild = static_cast<uint32_t>(out.size());
+			rightBounds = emitRange(split, end, depth + 1, out, nodeArea);
+		}
+
+		PrxAabb bounds = PrxAabb::merge(leftBounds, rightBounds);
+		out[nodeIndex] = PrxBvh::Node{ bounds.min, secondChild, bounds.max, static_cast<uint16_t>(0), splitAxis };
+		nodeArea += bounds.surfaceArea();
+		return bounds;
+	}
+
+	void PrxTlas::linkNodes() {
+		nodeParents.resize(nodes.size());
+		instanceLeaves.resize(instances.size());
+		sortedPositions.resize(instances.size());
+		if (nodes.empty()) return;
+
+		nodeParents[0] = 0;
+		for (uint32_t i = 0; i < nodes.size(); i++) {
+			const PrxBvh::Node& node = nodes[i];
+			if (node.isLeaf()) {
+				for (uint32_t j = node.offset; j < node.offset + node.triangleCount; j++) {
+					instanceLeaves[instanceOrder[j]] = i;
+					sortedPositions[instanceOrder[j]] = j;
+				}
+			}
+			else {
+				nodeParents[i + 1] = i;
+				nodeParents[node.offset] = i;
+			}
+		}
+	}
+
+	void PrxTlas::splitRefitRanges() {
+		refitSubtrees.clear();
+		refitTopNodes.clear();
+		if (nodes.empty()) return;
+
+		// a subtree's nodes are contiguous: the first child's end where the second one starts,
+		//	and the second child's end where its parent's does
+		struct Entry {
+			uint32_t node;
+			uint32_t end;
+			uint32_t depth;
+		};
+		std::vector<Entry> stack{ Entry{ 0, static_cast<uint32_t>(nodes.size()), 0 } };
+		while (!stack.empty()) {
+			const Entry entry = stack.back();
+			stack.pop_back();
+			const PrxBvh::Node& node = nodes[entry.node];
+			if (node.isLeaf() || entry.depth >= parallelDepth) {
+				refitSubtrees.emplace_back(entry.node, entry.end);
+				continue;
+			}
+			refitTopNodes.push_back(entry.node);
+			stack.push_back(Entry{ entry.node + 1, node.offset, entry.depth + 1 });
+			stack.push_back(Entry{ node.offset, entry.end, entry.depth + 1 });
+		}
+	}
+
+	float PrxTlas::refitNodes() {
+		// children always come after their parent, so going backwards through a subtree refits it
+		//	bottom up. The subtrees go first, then the few nodes above them
+		float nodeArea = 0.f;
+		std::mutex areaMutex;
+		PrxParallel::forEachRange(static_cast<uint32_t>(refitSubtrees.size()), 1, [&](uint32_t begin, uint32_t end) {
+			float area = 0.f;
+			for (uint32_t subtree = begin; subtree < end; subtree++) {
+				const auto [first, last] = refitSubtrees[subtree];
+				for (uint32_t i = last; i-- > first;) {
+					area += refitNode(i);
+				}
+			}
+			std::lock_guard<std::mutex> lock{ areaMutex };
+			nodeArea += area;
+		});
+		for (auto it = refitTopNodes.rbegin(); it != refitTopNodes.rend(); ++it) {
+			nodeArea += refitNode(*it);
+		}
+		return nodeArea;
+	}
+
+	float PrxTlas::refitChangedNodes() {
+		// walk up from every moved leaf until a box stops changing, anything above it is still right
+		float areaChange = 0.f;
+		for (uint32_t instance : changedInstances) {
+			sortedBounds[sortedPositions[instance]] = instanceBounds[instance];
+		}
+		for (uint32_t instance : changedInstances) {
+			uint32_t nodeIndex = instanceLeaves[instance];
+			while (true) {
+				const PrxBvh::Node& node = nodes[nodeIndex];
+				const PrxAabb before{ node.boundsMin, node.boundsMax };
+				areaChange += refitNode(nodeIndex) - before.surfaceArea();
+				if (nodeIndex == 0 || (node.boundsMin == before.min && node.boundsMax == before.max)) break;
+				nodeIndex = nodeParents[nodeIndex];
+			}
+		}
+		return areaChange;
+	}
+
+	float PrxTlas::refitNode(uint32_t nodeIndex) {
+		PrxBvh::Node& node = nodes[nodeIndex];
+		PrxAabb bounds{};
+		if (node.isLeaf()) {
+			for (uint32_t j = node.offset; j < node.offset + node.triangleCount; j++) {
+				bounds.grow(sortedBounds[j]);
+			}
+		}
+		else {
+			const PrxBvh::Node& first = nodes[nodeIndex + 1];
+			const PrxBvh::Node& second = nodes[node.offset];
+			bounds = PrxAabb{ glm::min(first.boundsMin, second.boundsMin), glm::max(first.boundsMax, second.boundsMax) };
+		}
+		node.boundsMin = bounds.min;
+		node.boundsMax = bounds.max;
+		return bounds.surfaceArea();
+	}
+}
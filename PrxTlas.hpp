@@ -0,0 +1,172 @@
+#pragma once
+
+#include "PrxBvh.hpp"
+#include "PrxGameObject.hpp"
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace prx {
+
+	// One placed BLAS, laid out exactly like VkAccelerationStructureInstanceKHR so the array can be
+	//	copied straight into an instance buffer for hardware ray tracing later.
+	//	On the CPU, accelerationStructureReference is an index into PrxTlas::getBlases() instead of a
+	//	device address, and instanceCustomIndex is the game object's buffer index.
+	struct PrxTlasInstance {
+		float transform[3][4]; // row major 3x4 object to world, like VkTransformMatrixKHR
+		uint32_t instanceCustomIndex : 24;
+		uint32_t mask : 8;
+		uint32_t instanceShaderBindingTableRecordOffset : 24;
+		uint32_t flags : 8;
+		uint64_t accelerationStructureReference;
+
+		void setTransform(const glm::mat4& objectToWorld);
+		glm::mat4 getTransform() const;
+		// world to object, all zeros if the transform can't be inverted (e.g. a scale of 0)
+		glm::mat4 getInverseTransform() const;
+	};
+	static_assert(sizeof(PrxTlasInstance) == sizeof(VkAccelerationStructureInstanceKHR),
+		"PrxTlasInstance has to match VkAccelerationStructureInstanceKHR");
+
+	// Top level acceleration structure: a BVH over instances of per-model BVHs (PrxModel::getBlas).
+	//	Built as an LBVH: instances are sorted along a Morton curve with a radix sort, and the tree
+	//	falls out of the sorted codes, which is cheap enough to redo every frame.
+	//	When only transforms changed, refit() keeps the tree and just recomputes its boxes, and only
+	//	instances whose transform actually changed get new bounds and a new inverse.
+	//	The per instance passes and the top of the tree are spread over threads (see PrxParallel).
+	//
+	// Nodes use PrxBvh::Node, so both levels traverse the same way. A leaf's triangleCount is its
+	//	instance count, and offset points into getInstanceOrder()
+	class PrxTlas
+	{
+	public:
+		static constexpr uint32_t MAX_LEAF_SIZE = 2;
+		// refits let boxes grow and overlap as objects move around, so the tree is rebuilt once the
+		//	summed surface area of its nodes (roughly what a ray pays to traverse it) got this much bigger
+		static constexpr float REBUILD_AREA_RATIO = 2.f;
+		// ranges at least this big have their two halves built on separate threads, and per instance
+		//	passes hand out at least this many instances per thread
+		static constexpr uint32_t PARALLEL_THRESHOLD = 4 * 1024;
+		// a refit where fewer than 1 in this many instances moved only walks up from their leaves,
+		//	otherwise it goes over every node
+		static constexpr uint32_t PARTIAL_REFIT_FRACTION = 16;
+
+		struct Stats {
+			double updateMilliseconds = 0.0;
+			bool refitted = false; // otherwise rebuilt
+			uint32_t instanceCount = 0;
+			// instances whose transform differed from the last update, every one on a rebuild
+			uint32_t changedInstanceCount = 0;
+			uint32_t nodeCount = 0;
+		};
+
+		PrxTlas() = default;
+
+		// do not allow for copying
+		PrxTlas(const PrxTlas&) = delete;
+		PrxTlas& operator=(const PrxTlas&) = delete;
+
+		// Instances every game object with a model, using the object data from the last
+		//	updateBuffer. Refits if the same objects have the same models as last time, otherwise
+		//	rebuilds. Note: call invalidate() after swapping a ModelComponent's model in place
+		void update(PrxGameObjectManager& gameObjectManager);
+		void invalidate() { forceRebuild = true; }
+
+		// lower level, for instances that don't come from game objects
+		void build(std::vector<PrxTlasInstance> instances, std::vector<const PrxBvh*> blases);
+		// after changing transforms through getInstances(), with the same BLAS per instance
+		void refit();
+
+		// Closest hit over every instance, same rules as PrxBvh::intersect. hit.instance is set
+		//	to the instance that was hit, hit.triangle is that BLAS's triangle.
+		//	Note: the ray is taken into object space as is (not renormalized), so t means the same in both
+		bool intersect(const PrxRay& ray, PrxHit& hit) const;
+
+		std::vector<PrxTlasInstance>& getInstances() { return instances; }
+		const std::vector<PrxTlasInstance>& getInstances() const { return instances; }
+		const std::vector<const PrxBvh*>& getBlases() const { return blases; }
+		// game object of every instance after update(), lined up with getInstances(). Empty after build()
+		const std::vector<PrxEntity>& getInstanceEntities() const { return instanceEntities; }
+		const std::vector<PrxBvh::Node>& getNodes() const { return nodes; }
+		const std::vector<uint32_t>& getInstanceOrder() const { return instanceOrder; }
+		// world box of every instance, lined up with getInstanceOrder() so leaves read them in one run
+		const std::vector<PrxAabb>& getSortedBounds() const { return sortedBounds; }
+		const Stats& getStats() const { return stats; }
+
+	private:
+		// the 3x4 transform worldToObject and instanceBounds were last computed from
+		struct InstanceTransform {
+			float transform[3][4];
+		};
+
+		PrxAabb computeInstanceBounds(const PrxTlasInstance& instance) const;
+		// recomputes worldToObject and instanceBounds of every instance whose transform changed
+		//	since the last call (or of all of them), returns how many that were. Unless all is set,
+		//	also lists them in changedInstances
+		uint32_t updateInstances(bool all);
+		// sorts instanceOrder by the Morton code of every box in instanceBounds
+		void sortInstances();
+		// instanceBounds in leaf order, into sortedBounds
+		void gatherSortedBounds();
+		// emits the subtree over instanceOrder[begin, end) into out in depth first order, returns its
+		//	box and adds the surface area of its nodes to nodeArea. Interior offsets are relative to
+		//	the start of out
+		PrxAabb emitRange(uint32_t begin, uint32_t end, uint32_t depth, std::vector<PrxBvh::Node>& out, float& nodeArea) const;
+		void rebuild();
+		// fills nodeParents, instanceLeaves and sortedPositions from the new tree
+		void linkNodes();
+		// cuts the tree into subtrees that refit on their own threads, and the nodes above them
+		void splitRefitRanges();
+		// returns the summed surface area of every node
+		float refitNodes();
+		// copies the boxes of changedInstances into sortedBounds and refits their leaves and
+		//	ancestors, returns how much the summed
+		//	node surface area changed
+		float refitChangedNodes();
+		// refits one node from its children or instances, returns its surface area
+		float refitNode(uint32_t nodeIndex);
+
+		std::vector<PrxTlasInstance> instances;
+		std::vector<const PrxBvh*> blases;
+		std::vector<PrxAabb> blasBounds; // root box of every BLAS, lined up with blases
+		std::vector<PrxAabb> instanceBounds; // lined up with instances
+		std::vector<PrxAabb> sortedBounds;
+		std::vector<glm::mat4> worldToObject; // lined up with instances, for traversal
+		std::vector<InstanceTransform> computedTransforms; // lined up with instances
+		std::vector<PrxBvh::Node> nodes;
+		std::vector<uint32_t> instanceOrder; // instance indices sorted by Morton code
+		std::vector<uint32_t> mortonCodes; // lined up with instanceOrder
+		float builtNodeArea = 0.f; // summed node surface area right after the last build
+		float nodeArea = 0.f; // summed node surface area now
+
+		// for partial refits, rebuilt with the tree
+		std::vector<uint32_t> nodeParents; // the root is its own parent
+		std::vector<uint32_t> instanceLeaves; // leaf node of every instance, lined up with instances
+		std::vector<uint32_t> sortedPositions; // where every instance is in instanceOrder
+		std::vector<uint32_t> changedInstances; // moved in the last refit
+
+		// no new threads below this depth of the tree, there are enough by then
+		uint32_t parallelDepth = 0;
+		// [first node, end) of every subtree at parallelDepth, and the nodes above them top down
+		std::vector<std::pair<uint32_t, uint32_t>> refitSubtrees;
+		std::vector<uint32_t> refitTopNodes;
+
+		// what update() built from, to tell a refit from a rebuild
+		std::vector<PrxEntity> instanceEntities;
+		std::unordered_map<const PrxModel*, uint32_t> blasLookup;
+		uint64_t modelPoolVersion = UINT64_MAX;
+		bool forceRebuild = false;
+
+		// scratch space for rebuilds
+		std::vector<uint32_t> sortScratchCodes;
+		std::vector<uint32_t> sortScratchOrder;
+
+		Stats stats{};
+	};
+}
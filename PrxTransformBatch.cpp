@@ -0,0 +1,304 @@
+#include "PrxTransformBatch.hpp"
+#include "PrxGameObject.hpp"
+
+// libs
+#if defined(__AVX2__)
+#define PRX_TRANSFORM_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PRX_TRANSFORM_SSE2
+#include <emmintrin.h>
+#endif
+
+// std
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace prx {
+
+	namespace {
+
+		// every object is written as model matrix then normal matrix, column major. The rest of the
+		//	object (the position decode) isn't touched
+		static_assert(offsetof(GameObjectBufferData, normalMatrix) == 16 * sizeof(float)
+			&& offsetof(GameObjectBufferData, positionDecode) == 32 * sizeof(float), "writeObject assumes two packed mat4s");
+
+		float* outputFor(GameObjectBufferData* out, const PrxEntity* entities, size_t i) {
+			size_t index = entities != nullptr ? PrxRegistry::getIndex(entities[i]) : i;
+			return &out[index].modelMatrix[0][0];
+		}
+
+		// Same math as TransformComponent::mat4() / normalMatrix(), written out once for every path:
+		//	R = Ry * Rx * Rz, model = T * R * S, normal = R * S^-1 (padded to a mat4)
+		template<typename V>
+		struct MatrixColumns {
+			V model[9]; // xyz of the 3 basis columns
+			V normal[9];
+		};
+
+		template<typename V, typename Mul, typename Add, typename Sub>
+		MatrixColumns<V> buildColumns(
+			V s1, V c1, V s2, V c2, V s3, V c3, V negS2,
+			V sx, V sy, V sz, V ix, V iy, V iz,
+			Mul mul, Add add, Sub sub) {
+			// rotation basis columns
+			V r00 = add(mul(c1, c3), mul(mul(s1, s2), s3));
+			V r01 = mul(c2, s3);
+			V r02 = sub(mul(mul(c1, s2), s3), mul(c3, s1));
+
+			V r10 = sub(mul(mul(c3, s1), s2), mul(c1, s3));
+			V r11 = mul(c2, c3);
+			V r12 = add(mul(mul(c1, c3), s2), mul(s1, s3));
+
+			V r20 = mul(c2, s1);
+			V r21 = negS2;
+			V r22 = mul(c1, c2);
+
+			MatrixColumns<V> columns;
+			columns.model[0] = mul(sx, r00); columns.model[1] = mul(sx, r01); columns.model[2] = mul(sx, r02);
+			columns.model[3] = mul(sy, r10); columns.model[4] = mul(sy, r11); columns.model[5] = mul(sy, r12);
+			columns.model[6] = mul(sz, r20); columns.model[7] = mul(sz, r21); columns.model[8] = mul(sz, r22);
+
+			columns.normal[0] = mul(ix, r00); columns.normal[1] = mul(ix, r01); columns.normal[2] = mul(ix, r02);
+			columns.normal[3] = mul(iy, r10); columns.normal[4] = mul(iy, r11); columns.normal[5] = mul(iy, r12);
+			columns.normal[6] = mul(iz, r20); columns.normal[7] = mul(iz, r21); columns.normal[8] = mul(iz, r22);
+			return columns;
+		}
+
+		void writeObject(float* dst, const float model[9], const float normal[9], float tx, float ty, float tz) {
+			// model matrix
+			dst[0] = model[0]; dst[1] = model[1]; dst[2] = model[2]; dst[3] = 0.f;
+			dst[4] = model[3]; dst[5] = model[4]; dst[6] = model[5]; dst[7] = 0.f;
+			dst[8] = model[6]; dst[9] = model[7]; dst[10] = model[8]; dst[11] = 0.f;
+			dst[12] = tx; dst[13] = ty; dst[14] = tz; dst[15] = 1.f;
+
+			// normal matrix, a mat3 padded out the same way glm converts mat3 -> mat4
+			dst[16] = normal[0]; dst[17] = normal[1]; dst[18] = normal[2]; dst[19] = 0.f;
+			dst[20] = normal[3]; dst[21] = normal[4]; dst[22] = normal[5]; dst[23] = 0.f;
+			dst[24] = normal[6]; dst[25] = normal[7]; dst[26] = normal[8]; dst[27] = 0.f;
+			dst[28] = 0.f; dst[29] = 0.f; dst[30] = 0.f; dst[31] = 1.f;
+		}
+
+		void computeScalar(const TransformComponent& transform, float* dst) {
+			const glm::vec3& r = transform.rotation;
+			const glm::vec3& s = transform.scale;
+
+			const float s2 = std::sin(r.x);
+
+			auto mul = [](float a, float b) { return a * b; };
+			auto add = [](float a, float b) { return a + b; };
+			auto sub = [](float a, float b) { return a - b; };
+			MatrixColumns<float> columns = buildColumns<float>(
+				std::sin(r.y), std::cos(r.y), s2, std::cos(r.x), std::sin(r.z), std::cos(r.z), -s2,
+				s.x, s.y, s.z, 1.f / s.x, 1.f / s.y, 1.f / s.z,
+				mul, add, sub);
+
+			writeObject(dst, columns.model, columns.normal,
+				transform.translation.x, transform.translation.y, transform.translation.z);
+		}
+
+#if defined(PRX_TRANSFORM_AVX2) || defined(PRX_TRANSFORM_SSE2)
+
+		// Thin wrappers so the sin/cos and batch code below is written once for both widths
+#if defined(PRX_TRANSFORM_AVX2)
+		constexpr int LANES = 8;
+		using FloatV = __m256;
+		using IntV = __m256i;
+
+		inline FloatV set1(float v) { return _mm256_set1_ps(v); }
+		inline FloatV load(const float* p) { return _mm256_load_ps(p); }
+		inline FloatV add(FloatV a, FloatV b) { return _mm256_add_ps(a, b); }
+		inline FloatV sub(FloatV a, FloatV b) { return _mm256_sub_ps(a, b); }
+		inline FloatV mul(FloatV a, FloatV b) { return _mm256_mul_ps(a, b); }
+		inline FloatV div(FloatV a, FloatV b) { return _mm256_div_ps(a, b); }
+		inline FloatV bitAnd(FloatV a, FloatV b) { return _mm256_and_ps(a, b); }
+		inline FloatV bitAndNot(FloatV a, FloatV b) { return _mm256_andnot_ps(a, b); }
+		inline FloatV bitXor(FloatV a, FloatV b) { return _mm256_xor_ps(a, b); }
+		inline IntV set1i(int v) { return _mm256_set1_epi32(v); }
+		inline IntV truncate(FloatV v) { return _mm256_cvttps_epi32(v); }
+		inline FloatV toFloat(IntV v) { return _mm256_cvtepi32_ps(v); }
+		inline IntV addi(IntV a, IntV b) { return _mm256_add_epi32(a, b); }
+		inline IntV subi(IntV a, IntV b) { return _mm256_sub_epi32(a, b); }
+		inline IntV andi(IntV a, IntV b) { return _mm256_and_si256(a, b); }
+		inline IntV andNoti(IntV a, IntV b) { return _mm256_andnot_si256(a, b); }
+		inline IntV equali(IntV a, IntV b) { return _mm256_cmpeq_epi32(a, b); }
+		inline IntV shiftLeft29(IntV v) { return _mm256_slli_epi32(v, 29); }
+		inline FloatV asFloat(IntV v) { return _mm256_castsi256_ps(v); }
+
+		// x, y, z and w of one column for 8 objects -> that column in each object, via two 4x4 transposes
+		inline void storeColumn(FloatV x, FloatV y, FloatV z, FloatV w, float* const dst[], int column) {
+			for (int half = 0; half < 2; half++) {
+				__m128 cx = half == 0 ? _mm256_castps256_ps128(x) : _mm256_extractf128_ps(x, 1);
+				__m128 cy = half == 0 ? _mm256_castps256_ps128(y) : _mm256_extractf128_ps(y, 1);
+				__m128 cz = half == 0 ? _mm256_castps256_ps128(z) : _mm256_extractf128_ps(z, 1);
+				__m128 cw = half == 0 ? _mm256_castps256_ps128(w) : _mm256_extractf128_ps(w, 1);
+				_MM_TRANSPOSE4_PS(cx, cy, cz, cw);
+				_mm_storeu_ps(dst[half * 4 + 0] + column * 4, cx);
+				_mm_storeu_ps(dst[half * 4 + 1] + column * 4, cy);
+				_mm_storeu_ps(dst[half * 4 + 2] + column * 4, cz);
+				_mm_storeu_ps(dst[half * 4 + 3] + column * 4, cw);
+			}
+		}
+#else
+		constexpr int LANES = 4;
+		using FloatV = __m128;
+		using IntV = __m128i;
+
+		inline FloatV set1(float v) { return _mm_set1_ps(v); }
+		inline FloatV load(const float* p) { return _mm_load_ps(p); }
+		inline FloatV add(FloatV a, FloatV b) { return _mm_add_ps(a, b); }
+		inline FloatV sub(FloatV a, FloatV b) { return _mm_sub_ps(a, b); }
+		inline FloatV mul(FloatV a, FloatV b) { return _mm_mul_ps(a, b); }
+		inline FloatV div(FloatV a, FloatV b) { return _mm_div_ps(a, b); }
+		inline FloatV bitAnd(FloatV a, FloatV b) { return _mm_and_ps(a, b); }
+		inline FloatV bitAndNot(FloatV a, FloatV b) { return _mm_andnot_ps(a, b); }
+		inline FloatV bitXor(FloatV a, FloatV b) { return _mm_xor_ps(a, b); }
+		inline IntV set1i(int v) { return _mm_set1_epi32(v); }
+		inline IntV truncate(FloatV v) { return _mm_cvttps_epi32(v); }
+		inline FloatV toFloat(IntV v) { return _mm_cvtepi32_ps(v); }
+		inline IntV addi(IntV a, IntV b) { return _mm_add_epi32(a, b); }
+		inline IntV subi(IntV a, IntV b) { return _mm_sub_epi32(a, b); }
+		inline IntV andi(IntV a, IntV b) { return _mm_and_si128(a, b); }
+		inline IntV andNoti(IntV a, IntV b) { return _mm_andnot_si128(a, b); }
+		inline IntV equali(IntV a, IntV b) { return _mm_cmpeq_epi32(a, b); }
+		inline IntV shiftLeft29(IntV v) { return _mm_slli_epi32(v, 29); }
+		inline FloatV asFloat(IntV v) { return _mm_castsi128_ps(v); }
+
+		// x, y, z and w of one column for 4 objects -> that column in each object
+		inline void storeColumn(FloatV x, FloatV y, FloatV z, FloatV w, float* const dst[], int column) {
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+			_mm_storeu_ps(dst[0] + column * 4, x);
+			_mm_storeu_ps(dst[1] + column * 4, y);
+			_mm_storeu_ps(dst[2] + column * 4, z);
+			_mm_storeu_ps(dst[3] + column * 4, w);
+		}
+#endif
+
+		// Cephes style sin/cos: reduce to [-pi/4, pi/4] using octants, then evaluate both minimax
+		//	polynomials and pick per lane. Accurate to a couple ulp for the angle range a transform uses.
+		void sinCos(FloatV x, FloatV& outSin, FloatV& outCos) {
+			const FloatV signMask = asFloat(set1i(INT32_MIN));
+
+			FloatV signSin = bitAnd(x, signMask);
+			x = bitAndNot(signMask, x); // |x|
+
+			// octant, rounded up to even
+			IntV j = truncate(mul(x, set1(1.27323954473516f))); // 4 / pi
+			j = addi(j, set1i(1));
+			j = andi(j, set1i(~1));
+			FloatV y = toFloat(j);
+
+			FloatV swapSignSin = asFloat(shiftLeft29(andi(j, set1i(4))));
+			FloatV polyMask = asFloat(equali(andi(j, set1i(2)), set1i(0)));
+			FloatV signCos = asFloat(shiftLeft29(andNoti(subi(j, set1i(2)), set1i(4))));
+			signSin = bitXor(signSin, swapSignSin);
+
+			// extended precision modular arithmetic: x - y * pi/4
+			x = sub(x, mul(y, set1(0.78515625f)));
+			x = sub(x, mul(y, set1(2.4187564849853515625e-4f)));
+			x = sub(x, mul(y, set1(3.77489497744594108e-8f)));
+
+			FloatV z = mul(x, x);
+
+			FloatV cosPoly = set1(2.443315711809948e-5f);
+			cosPoly = add(mul(cosPoly, z), set1(-1.388731625493765e-3f));
+			cosPoly = add(mul(cosPoly, z), set1(4.166664568298827e-2f));
+			cosPoly = mul(mul(cosPoly, z), z);
+			cosPoly = sub(cosPoly, mul(z, set1(0.5f)));
+			cosPoly = add(cosPoly, set1(1.f));
+
+			FloatV sinPoly = set1(-1.9515295891e-4f);
+			sinPoly = add(mul(sinPoly, z), set1(8.3321608736e-3f));
+			sinPoly = add(mul(sinPoly, z), set1(-1.6666654611e-1f));
+			sinPoly = add(mul(mul(sinPoly, z), x), x);
+
+			// polyMask lanes are in an octant where sin uses the sin polynomial (and cos the cos one)
+			FloatV sinResult = add(bitAnd(polyMask, sinPoly), bitAndNot(polyMask, cosPoly));
+			FloatV cosResult = add(bitAnd(polyMask, cosPoly), bitAndNot(polyMask, sinPoly));
+
+			outSin = bitXor(sinResult, signSin);
+			outCos = bitXor(cosResult, signCos);
+		}
+
+		void computeLanes(const TransformComponent* transforms, float* const dst[LANES]) {
+			// AoS -> SoA
+			alignas(32) float in[9][LANES];
+			for (int lane = 0; lane < LANES; lane++) {
+				const TransformComponent& transform = transforms[lane];
+				in[0][lane] = transform.rotation.x;
+				in[1][lane] = transform.rotation.y;
+				in[2][lane] = transform.rotation.z;
+				in[3][lane] = transform.scale.x;
+				in[4][lane] = transform.scale.y;
+				in[5][lane] = transform.scale.z;
+				in[6][lane] = transform.translation.x;
+				in[7][lane] = transform.translation.y;
+				in[8][lane] = transform.translation.z;
+			}
+
+			FloatV s1, c1, s2, c2, s3, c3;
+			sinCos(load(in[1]), s1, c1); // y
+			sinCos(load(in[0]), s2, c2); // x
+			sinCos(load(in[2]), s3, c3); // z
+
+			FloatV sx = load(in[3]), sy = load(in[4]), sz = load(in[5]);
+			FloatV one = set1(1.f);
+
+			MatrixColumns<FloatV> columns = buildColumns<FloatV>(
+				s1, c1, s2, c2, s3, c3, bitXor(s2, asFloat(set1i(INT32_MIN))),
+				sx, sy, sz, div(one, sx), div(one, sy), div(one, sz),
+				[](FloatV a, FloatV b) { return mul(a, b); },
+				[](FloatV a, FloatV b) { return add(a, b); },
+				[](FloatV a, FloatV b) { return sub(a, b); });
+
+			FloatV zero = set1(0.f);
+			FloatV tx = load(in[6]), ty = load(in[7]), tz = load(in[8]);
+			const FloatV* m = columns.model;
+			const FloatV* n = columns.normal;
+
+			// SoA -> each object's slot, transposed back one column at a time
+			storeColumn(m[0], m[1], m[2], zero, dst, 0);
+			storeColumn(m[3], m[4], m[5], zero, dst, 1);
+			storeColumn(m[6], m[7], m[8], zero, dst, 2);
+			storeColumn(tx, ty, tz, one, dst, 3);
+			storeColumn(n[0], n[1], n[2], zero, dst, 4);
+			storeColumn(n[3], n[4], n[5], zero, dst, 5);
+			storeColumn(n[6], n[7], n[8], zero, dst, 6);
+			storeColumn(zero, zero, zero, one, dst, 7);
+		}
+#endif
+	}
+
+	void computeTransformBatch(
+		const TransformComponent* transforms,
+		const PrxEntity* entities,
+		size_t count,
+		GameObjectBufferData* out) {
+		size_t i = 0;
+
+#if defined(PRX_TRANSFORM_AVX2) || defined(PRX_TRANSFORM_SSE2)
+		for (; i + LANES <= count; i += LANES) {
+			float* dst[LANES];
+			for (int lane = 0; lane < LANES; lane++) {
+				dst[lane] = outputFor(out, entities, i + lane);
+			}
+			computeLanes(transforms + i, dst);
+		}
+#endif
+
+		for (; i < count; i++) {
+			computeScalar(transforms[i], outputFor(out, entities, i));
+		}
+	}
+
+	const char* getTransformBatchPath() {
+#if defined(PRX_TRANSFORM_AVX2)
+		return "AVX2";
+#elif defined(PRX_TRANSFORM_SSE2)
+		return "SSE2";
+#else
+		return "Scalar";
+#endif
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "PrxRegistry.hpp"
+
+// std
+#include <cstddef>
+
+namespace prx {
+
+	struct TransformComponent;
+	struct GameObjectBufferData;
+
+	// Computes the model and normal matrix of many transforms in one pass and writes them straight
+	//	into GameObjectBufferData (e.g. the mapped object buffer).
+	//	Transforms are loaded a group at a time into SoA registers, so the six sin/cos and the
+	//	matrix products run once per lane group instead of once per object. Results match
+	//	TransformComponent::mat4() and normalMatrix() up to float rounding of the sin/cos approximation.
+	// Uses AVX2 (8 lanes) or SSE2 (4 lanes) depending on what the build targets, and plain scalar
+	//	code otherwise. Leftover objects that don't fill a lane group also go through the scalar path.
+	//
+	// If entities is not null, transforms[i] is written to out[PrxRegistry::getIndex(entities[i])],
+	//	otherwise to out[i].
+	void computeTransformBatch(
+		const TransformComponent* transforms,
+		const PrxEntity* entities,
+		size_t count,
+		GameObjectBufferData* out);
+
+	// "AVX2", "SSE2" or "Scalar"
+	const char* getTransformBatchPath();
+}
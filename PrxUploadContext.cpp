@@ -0,0 +1,287 @@
+#include "PrxUploadContext.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace prx {
+
+	PrxUploadContext::PrxUploadContext(PrxDevice& device, VkDeviceSize stagingCapacity)
+		: prxDevice{ device }, stagingRing{ device, stagingCapacity } {
+		// a quarter of the ring per chunk keeps a couple of chunks in flight while the next is written
+		maxChunkSize = stagingRing.getCapacity() / 4;
+		createCommandPool();
+	}
+
+	PrxUploadContext::~PrxUploadContext() {
+		flush();
+		vkDestroyCommandPool(prxDevice.device(), commandPool, nullptr);
+	}
+
+	// the upload context has its own pool so recording uploads never touches
+	//	the command buffers the renderer allocates from the device's pool
+	void PrxUploadContext::createCommandPool() {
+		QueueFamilyIndices queueFamilyIndices = prxDevice.findPhysicalQueueFamilies();
+
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		if (vkCreateCommandPool(prxDevice.device(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create upload command pool!");
+		}
+	}
+
+	VkCommandBuffer PrxUploadContext::getRecordingCommandBuffer() {
+		if (isRecording) {
+			return recording.commandBuffer;
+		}
+
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = commandPool;
+		allocInfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(prxDevice.device(), &allocInfo, &recording.commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate upload command buffer!");
+		}
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(recording.commandBuffer, &beginInfo);
+
+		recording.ticket = nextTicket;
+		isRecording = true;
+		return recording.commandBuffer;
+	}
+
+	// Grabs space in the staging ring. If the ring is full, the batch being recorded is sent off
+	//	and we block on the oldest submission until enough space comes back.
+	//	Note: may submit the current batch, so only fetch the command buffer after calling this
+	PrxStagingRing::Allocation PrxUploadContext::allocateStaging(VkDeviceSize size) {
+		PrxStagingRing::Allocation allocation{};
+		while (!stagingRing.tryAllocate(size, PrxStagingRing::MIN_ALIGNMENT, allocation)) {
+			if (inFlight.empty()) {
+				if (!isRecording) {
+					throw std::runtime_error("staging allocation does not fit in the staging ring!");
+				}
+				submit();
+			}
+			wait(inFlight.front().ticket);
+		}
+
+		recording.stagingBytes += size;
+		stats.bytesUploaded += size;
+		return allocation;
+	}
+
+	// once half the ring belongs to the current batch, send it so the GPU can start copying
+	//	while the rest of the ring is filled
+	void PrxUploadContext::afterRecord() {
+		if (recording.stagingBytes >= stagingRing.getCapacity() / 2) {
+			submit();
+		}
+	}
+
+	void PrxUploadContext::uploadBuffer(
+		const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset) {
+		const char* src = static_cast<const char*>(data);
+
+		for (VkDeviceSize copied = 0; copied < size;) {
+			VkDeviceSize chunkSize = std::min(size - copied, maxChunkSize);
+			PrxStagingRing::Allocation staging = allocateStaging(chunkSize);
+			memcpy(staging.data, src + copied, chunkSize);
+
+			VkBufferCopy copyRegion{};
+			copyRegion.srcOffset = staging.offset;
+			copyRegion.dstOffset = dstOffset + copied;
+			copyRegion.size = chunkSize;
+			vkCmdCopyBuffer(getRecordingCommandBuffer(), stagingRing.getBuffer(), dstBuffer, 1, &copyRegion);
+
+			stats.bufferCopyCount++;
+			copied += chunkSize;
+			afterRecord();
+		}
+	}
+
+	void* PrxUploadContext::reserveBufferUpload(VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset) {
+		if (size > maxChunkSize) {
+			throw std::runtime_error("reserved upload is larger than a staging chunk!");
+		}
+
+		PrxStagingRing::Allocation staging = allocateStaging(size);
+
+		VkBufferCopy copyRegion{};
+		copyRegion.srcOffset = staging.offset;
+		copyRegion.dstOffset = dstOffset;
+		copyRegion.size = size;
+		vkCmdCopyBuffer(getRecordingCommandBuffer(), stagingRing.getBuffer(), dstBuffer, 1, &copyRegion);
+
+		// no afterRecord() here, the caller hasn't written the data yet
+		stats.bufferCopyCount++;
+		return staging.data;
+	}
+
+	void PrxUploadContext::uploadImage(const void* data, VkDeviceSize size, VkImage image,
+		VkExtent3D extent, uint32_t mipLevels, uint32_t layerCount) {
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = mipLevels;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = layerCount;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		vkCmdPipelineBarrier(getRecordingCommandBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		// images too big for one chunk are copied a band of rows at a time, one layer
+		//	(and for 3D images one slice) after the other, so every copy fits in a chunk
+		const VkDeviceSize rowPitch = size / (static_cast<VkDeviceSize>(extent.height) * extent.depth * layerCount);
+		assert(rowPitch <= maxChunkSize && "Image row doesn't fit in a staging chunk");
+		const uint32_t rowsPerChunk = static_cast<uint32_t>(std::max<VkDeviceSize>(1, maxChunkSize / rowPitch));
+		const char* src = static_cast<const char*>(data);
+
+		for (uint32_t layer = 0; layer < layerCount; layer++) {
+			for (uint32_t slice = 0; slice < extent.depth; slice++) {
+				const VkDeviceSize sliceOffset = (static_cast<VkDeviceSize>(layer) * extent.depth + slice) * extent.height * rowPitch;
+				for (uint32_t row = 0; row < extent.height; row += rowsPerChunk) {
+					uint32_t rows = std::min(rowsPerChunk, extent.height - row);
+					VkDeviceSize chunkSize = rowPitch * rows;
+
+					PrxStagingRing::Allocation staging = allocateStaging(chunkSize);
+					memcpy(staging.data, src + sliceOffset + rowPitch * row, chunkSize);
+
+					VkBufferImageCopy region{};
+					region.bufferOffset = staging.offset;
+					region.bufferRowLength = 0;
+					region.bufferImageHeight = 0;
+					region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+					region.imageSubresource.mipLevel = 0;
+					region.imageSubresource.baseArrayLayer = layer;
+					region.imageSubresource.layerCount = 1;
+					region.imageOffset = { 0, static_cast<int32_t>(row), static_cast<int32_t>(slice) };
+					region.imageExtent = { extent.width, rows, 1 };
+
+					vkCmdCopyBufferToImage(getRecordingCommandBuffer(), stagingRing.getBuffer(), image,
+						VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+					stats.imageCopyCount++;
+					afterRecord();
+				}
+			}
+		}
+
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(getRecordingCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
+	PrxUploadContext::Ticket PrxUploadContext::submit() {
+		// recycle staging space from anything that finished in the meantime
+		retireCompleted();
+
+		if (!isRecording) {
+			return nextTicket - 1;
+		}
+
+		// make the copied buffers visible to whatever reads them in later submissions
+		//	(vertex/index fetch, uniform and storage reads)
+		VkMemoryBarrier memoryBarrier{};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		vkCmdPipelineBarrier(recording.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+		vkEndCommandBuffer(recording.commandBuffer);
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		if (vkCreateFence(prxDevice.device(), &fenceInfo, nullptr, &recording.fence) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create upload fence!");
+		}
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &recording.commandBuffer;
+
+		if (vkQueueSubmit(prxDevice.graphicsQueue(), 1, &submitInfo, recording.fence) != VK_SUCCESS) {
+			throw std::runtime_error("failed to submit upload command buffer!");
+		}
+
+		Ticket ticket = recording.ticket;
+		stagingRing.closeRegion(ticket);
+		inFlight.push_back(std::move(recording));
+		recording = Batch{};
+		isRecording = false;
+		nextTicket++;
+		stats.submitCount++;
+
+		return ticket;
+	}
+
+	// releases every batch whose fence has signaled
+	void PrxUploadContext::retireCompleted() {
+		while (!inFlight.empty()) {
+			Batch& batch = inFlight.front();
+			if (vkGetFenceStatus(prxDevice.device(), batch.fence) != VK_SUCCESS) break;
+
+			completedTicket = batch.ticket;
+			releaseBatch(batch);
+			inFlight.erase(inFlight.begin());
+		}
+	}
+
+	bool PrxUploadContext::isComplete(Ticket ticket) {
+		if (ticket <= completedTicket) return true;
+		retireCompleted();
+		return ticket <= completedTicket;
+	}
+
+	void PrxUploadContext::wait(Ticket ticket) {
+		if (isRecording && ticket >= recording.ticket) {
+			submit();
+		}
+
+		// batches are submitted to one queue in order, so waiting on the
+		//	batch with this ticket covers everything before it as well
+		for (Batch& batch : inFlight) {
+			if (batch.ticket >= ticket) {
+				vkWaitForFences(prxDevice.device(), 1, &batch.fence, VK_TRUE,
+					std::numeric_limits<uint64_t>::max());
+				break;
+			}
+		}
+		retireCompleted();
+	}
+
+	void PrxUploadContext::flush() {
+		Ticket ticket = submit();
+		wait(ticket);
+	}
+
+	void PrxUploadContext::releaseBatch(Batch& batch) {
+		vkDestroyFence(prxDevice.device(), batch.fence, nullptr);
+		vkFreeCommandBuffers(prxDevice.device(), commandPool, 1, &batch.commandBuffer);
+		stagingRing.release(batch.ticket);
+	}
+}
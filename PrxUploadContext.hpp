@@ -0,0 +1,96 @@
+#pragma once
+
+#include "PrxDevice.hpp"
+#include "PrxStagingRing.hpp"
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace prx {
+
+	// Batches buffer and image uploads into a single command buffer.
+	//	Instead of every model and texture doing its own submit + vkQueueWaitIdle, copies are
+	//	recorded into the current batch and go out together on submit(). Each submission
+	//	gets a ticket that can be polled (isComplete) or waited on (wait).
+	//	Staging data lives in a PrxStagingRing; payloads bigger than a chunk are split into
+	//	several copies, so any size can be uploaded through a fixed amount of staging memory.
+	class PrxUploadContext
+	{
+	public:
+		using Ticket = uint64_t;
+
+		struct Stats {
+			uint64_t submitCount = 0;
+			uint64_t bufferCopyCount = 0;
+			uint64_t imageCopyCount = 0;
+			VkDeviceSize bytesUploaded = 0;
+		};
+
+		PrxUploadContext(PrxDevice& device, VkDeviceSize stagingCapacity = PrxStagingRing::DEFAULT_CAPACITY);
+		~PrxUploadContext();
+
+		// do not allow for copying
+		PrxUploadContext(const PrxUploadContext&) = delete;
+		PrxUploadContext& operator=(const PrxUploadContext&) = delete;
+
+		// Copies data into staging memory right away (the source can be freed after this returns)
+		//	and records a copy into dstBuffer at dstOffset
+		void uploadBuffer(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0);
+
+		// Reserves staging space and records the copy, returning the staging pointer so the
+		//	caller can write (or decode) the payload straight into it without an extra copy.
+		//	The data must be written before the next submit(); size has to fit in one chunk.
+		void* reserveBufferUpload(VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0);
+		VkDeviceSize getMaxChunkSize() const { return maxChunkSize; }
+
+		// Records UNDEFINED -> TRANSFER_DST, the copy into mip 0, and -> SHADER_READ_ONLY.
+		//	data is mip 0 of every layer, tightly packed one layer after the other
+		void uploadImage(const void* data, VkDeviceSize size, VkImage image, VkExtent3D extent,
+			uint32_t mipLevels = 1, uint32_t layerCount = 1);
+
+		// Ticket the batch that is currently being recorded will get when submitted
+		Ticket getPendingTicket() const { return nextTicket; }
+
+		// Submits the current batch (if anything was recorded) and returns its ticket.
+		//	If nothing was recorded, returns the ticket of the last submission.
+		Ticket submit();
+		bool isComplete(Ticket ticket);
+		void wait(Ticket ticket);
+
+		// submits whatever is recorded and blocks until every upload has landed
+		void flush();
+
+		const Stats& getStats() const { return stats; }
+
+	private:
+		struct Batch {
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+			VkFence fence = VK_NULL_HANDLE;
+			Ticket ticket = 0;
+			VkDeviceSize stagingBytes = 0;
+		};
+
+		void createCommandPool();
+		VkCommandBuffer getRecordingCommandBuffer();
+		PrxStagingRing::Allocation allocateStaging(VkDeviceSize size);
+		void afterRecord();
+		void retireCompleted();
+		void releaseBatch(Batch& batch);
+
+		PrxDevice& prxDevice;
+		VkCommandPool commandPool = VK_NULL_HANDLE;
+
+		PrxStagingRing stagingRing;
+		VkDeviceSize maxChunkSize; // biggest single staging allocation
+
+		Batch recording{};
+		bool isRecording = false;
+		std::vector<Batch> inFlight;
+
+		Ticket nextTicket = 1;
+		Ticket completedTicket = 0; // every ticket <= this value is done
+
+		Stats stats{};
+	};
+}
@@ -0,0 +1,171 @@
+#include "PrxVertexLayout.hpp"
+
+// libs
+#include <glm/gtc/packing.hpp>
+
+// std
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace prx {
+
+	PrxVertexLayout PrxVertexLayout::compact() {
+		PrxVertexLayout layout{};
+		layout.position = PrxPositionEncoding::Snorm16x4;
+		layout.normal = PrxNormalEncoding::OctahedralSnorm16;
+		layout.uv = PrxUvEncoding::Half2;
+		layout.color = PrxColorEncoding::Unorm8x4;
+		return layout;
+	}
+
+	PrxVertexLayout PrxVertexLayout::compactSplit() {
+		PrxVertexLayout layout = compact();
+		layout.splitPositions = true;
+		return layout;
+	}
+
+	uint32_t PrxVertexLayout::getPositionSize() const {
+		return position == PrxPositionEncoding::Float3 ? 12 : 8;
+	}
+
+	uint32_t PrxVertexLayout::getNormalSize() const {
+		return normal == PrxNormalEncoding::Float3 ? 12 : 4;
+	}
+
+	uint32_t PrxVertexLayout::getUvSize() const {
+		return uv == PrxUvEncoding::Float2 ? 8 : 4;
+	}
+
+	uint32_t PrxVertexLayout::getColorSize() const {
+		return color == PrxColorEncoding::Float3 ? 12 : 4;
+	}
+
+	uint32_t PrxVertexLayout::getVertexSize() const {
+		return getPositionSize() + getNormalSize() + getUvSize() + getColorSize();
+	}
+
+	uint32_t PrxVertexLayout::getStreamStride(uint32_t stream) const {
+		assert(stream < getStreamCount() && "Vertex layout has no such stream");
+		if (!splitPositions) return getVertexSize();
+		return stream == 0 ? getPositionSize() : getVertexSize() - getPositionSize();
+	}
+
+	std::vector<VkVertexInputBindingDescription> PrxVertexLayout::getBindingDescriptions() const {
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions(getStreamCount());
+		for (uint32_t i = 0; i < getStreamCount(); i++) {
+			bindingDescriptions[i].binding = i;
+			bindingDescriptions[i].stride = getStreamStride(i);
+			bindingDescriptions[i].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		}
+		return bindingDescriptions;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> PrxVertexLayout::getAttributeDescriptions() const {
+		static constexpr VkFormat positionFormats[] = {
+			VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT, VK_FORMAT_R16G16B16A16_SNORM };
+		static constexpr VkFormat normalFormats[] = { VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R16G16_SNORM };
+		static constexpr VkFormat uvFormats[] = { VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R16G16_SFLOAT };
+		static constexpr VkFormat colorFormats[] = { VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R8G8B8A8_UNORM };
+
+		// same order as encode() writes them
+		const uint32_t attributeBinding = splitPositions ? 1 : 0;
+		uint32_t offset = splitPositions ? 0 : getPositionSize();
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+		attributeDescriptions.push_back({ 0, 0, positionFormats[static_cast<uint32_t>(position)], 0 });
+		attributeDescriptions.push_back({ 1, attributeBinding, colorFormats[static_cast<uint32_t>(color)], offset });
+		offset += getColorSize();
+		attributeDescriptions.push_back({ 2, attributeBinding, normalFormats[static_cast<uint32_t>(normal)], offset });
+		offset += getNormalSize();
+		attributeDescriptions.push_back({ 3, attributeBinding, uvFormats[static_cast<uint32_t>(uv)], offset });
+
+		return attributeDescriptions;
+	}
+
+	std::vector<VkVertexInputBindingDescription> PrxVertexLayout::getPositionBindingDescriptions() const {
+		return { getBindingDescriptions()[0] };
+	}
+
+	std::vector<VkVertexInputAttributeDescription> PrxVertexLayout::getPositionAttributeDescriptions() const {
+		return { getAttributeDescriptions()[0] };
+	}
+
+	PrxVertexLayout::PositionDecode PrxVertexLayout::getPositionDecode(const glm::vec3& boxMin, const glm::vec3& boxMax) const {
+		PositionDecode decode{};
+		if (!quantizesPositions()) return decode;
+
+		// Note: flat models (a quad) have a zero extent on one axis, which would divide by zero in encode
+		const glm::vec3 halfExtent = glm::max((boxMax - boxMin) * 0.5f, glm::vec3{ 1e-6f });
+		decode.scale = glm::vec4{ halfExtent, 1.f };
+		decode.offset = glm::vec4{ (boxMin + boxMax) * 0.5f, 0.f };
+		return decode;
+	}
+
+	void PrxVertexLayout::encode(const glm::vec3& position, const glm::vec3& color, const glm::vec3& normal, const glm::vec2& uv,
+		const PositionDecode& decode, uint8_t* positionOut, uint8_t* attributeOut) const {
+		encodePosition(position, decode, positionOut);
+		encodeAttributes(color, normal, uv, attributeOut);
+	}
+
+	void PrxVertexLayout::encodePosition(const glm::vec3& position, const PositionDecode& decode, uint8_t* positionOut) const {
+		const glm::vec3 relative = (position - glm::vec3{ decode.offset }) / glm::vec3{ decode.scale };
+		switch (this->position) {
+		case PrxPositionEncoding::Float3:
+			std::memcpy(positionOut, &position, 12);
+			break;
+		case PrxPositionEncoding::Half4: {
+			const glm::uint64 packed = glm::packHalf4x16(glm::vec4{ relative, 1.f });
+			std::memcpy(positionOut, &packed, 8);
+			break;
+		}
+		case PrxPositionEncoding::Snorm16x4: {
+			const glm::uint64 packed = glm::packSnorm4x16(glm::vec4{ relative, 1.f });
+			std::memcpy(positionOut, &packed, 8);
+			break;
+		}
+		}
+	}
+
+	void PrxVertexLayout::encodeAttributes(const glm::vec3& color, const glm::vec3& normal, const glm::vec2& uv, uint8_t* attributeOut) const {
+		uint8_t* out = attributeOut;
+		if (this->color == PrxColorEncoding::Float3) {
+			std::memcpy(out, &color, 12);
+		}
+		else {
+			const glm::uint packed = glm::packUnorm4x8(glm::vec4{ color, 1.f });
+			std::memcpy(out, &packed, 4);
+		}
+		out += getColorSize();
+
+		if (this->normal == PrxNormalEncoding::Float3) {
+			std::memcpy(out, &normal, 12);
+		}
+		else {
+			const glm::uint packed = glm::packSnorm2x16(encodeOctahedral(normal));
+			std::memcpy(out, &packed, 4);
+		}
+		out += getNormalSize();
+
+		if (this->uv == PrxUvEncoding::Float2) {
+			std::memcpy(out, &uv, 8);
+		}
+		else {
+			const glm::uint packed = glm::packHalf2x16(uv);
+			std::memcpy(out, &packed, 4);
+		}
+	}
+
+	glm::vec2 PrxVertexLayout::encodeOctahedral(const glm::vec3& normal) {
+		const float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+		// meshes without normals have zero ones, those just become +z
+		if (length == 0.f) return glm::vec2{ 0.f };
+
+		glm::vec2 encoded = glm::vec2{ normal } / length;
+		if (normal.z < 0.f) {
+			// fold the lower half over the diagonals
+			const glm::vec2 sign{ encoded.x >= 0.f ? 1.f : -1.f, encoded.y >= 0.f ? 1.f : -1.f };
+			encoded = (1.f - glm::abs(glm::vec2{ encoded.y, encoded.x })) * sign;
+		}
+		return encoded;
+	}
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+// libs
+#include <vulkan/vulkan.h>
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm.hpp"
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace prx {
+
+	// How each vertex attribute is stored in the geometry arena. Models keep full float vertices
+	//	on the CPU (BLAS, mesh cache, path tracer), the encoding only happens on upload.
+	//	Note: every encoding reads back as floats in the shader (the vertex fetch converts snorm,
+	//	unorm and half formats), so the same shader works for all of them
+	enum class PrxPositionEncoding : uint32_t {
+		Float3,		// 12 bytes, model space
+		Half4,		// 8 bytes, relative to the model's box (see PositionDecode)
+		Snorm16x4,	// 8 bytes, relative to the model's box
+	};
+
+	// values match NORMAL_ENCODING in simple_shader.vert
+	enum class PrxNormalEncoding : uint32_t {
+		Float3,				// 12 bytes
+		OctahedralSnorm16,	// 4 bytes, unit vector folded onto an octahedron, decoded in the vertex shader
+	};
+
+	enum class PrxUvEncoding : uint32_t {
+		Float2,	// 8 bytes
+		Half2,	// 4 bytes, 1/2048 precision for uvs in [0, 1], enough up to 2k textures
+	};
+
+	enum class PrxColorEncoding : uint32_t {
+		Float3,		// 12 bytes
+		Unorm8x4,	// 4 bytes, clamped to [0, 1]
+	};
+
+	// Describes one vertex format of the geometry arena, and generates the pipeline's vertex input
+	//	descriptions from it. Attribute locations are fixed (position 0, color 1, normal 2, uv 3)
+	//	so shaders don't change with the encoding.
+	//
+	// With splitPositions, positions get a stream (binding) of their own and everything else goes
+	//	into a second one. Depth and shadow passes then bind only the position stream and fetch a
+	//	fraction of the bytes (see getPositionBindingDescriptions).
+	struct PrxVertexLayout {
+		// quantized positions are stored relative to the model's box, in [-1, 1] per axis.
+		//	The shader gets them back with position * scale + offset (see GameObjectBufferData)
+		struct PositionDecode {
+			glm::vec4 scale{ 1.f };
+			glm::vec4 offset{ 0.f };
+		};
+
+		PrxPositionEncoding position = PrxPositionEncoding::Float3;
+		PrxNormalEncoding normal = PrxNormalEncoding::Float3;
+		PrxUvEncoding uv = PrxUvEncoding::Float2;
+		PrxColorEncoding color = PrxColorEncoding::Float3;
+		bool splitPositions = false;
+
+		// unquantized, 44 bytes per vertex
+		static PrxVertexLayout full() { return PrxVertexLayout{}; }
+		// snorm16 positions, octahedral normals, half uvs and unorm8 colors: 20 bytes per vertex
+		static PrxVertexLayout compact();
+		// compact, with positions in their own 8 byte stream
+		static PrxVertexLayout compactSplit();
+
+		uint32_t getPositionSize() const;
+		uint32_t getNormalSize() const;
+		uint32_t getUvSize() const;
+		uint32_t getColorSize() const;
+		// bytes of every attribute together, regardless of how they are split into streams
+		uint32_t getVertexSize() const;
+		uint32_t getStreamCount() const { return splitPositions ? 2 : 1; }
+		// stream 0 is the position stream when split, the only one otherwise
+		uint32_t getStreamStride(uint32_t stream) const;
+
+		std::vector<VkVertexInputBindingDescription> getBindingDescriptions() const;
+		std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions() const;
+		// only location 0 (position), for passes that don't shade. Reads stream 0 either way,
+		//	but only a split layout actually saves the attribute bytes
+		std::vector<VkVertexInputBindingDescription> getPositionBindingDescriptions() const;
+		std::vector<VkVertexInputAttributeDescription> getPositionAttributeDescriptions() const;
+
+		bool quantizesPositions() const { return position != PrxPositionEncoding::Float3; }
+		// identity for float positions, otherwise maps [-1, 1] onto the box
+		PositionDecode getPositionDecode(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+
+		// Writes one vertex. position goes to positionOut, the rest to attributeOut, which is
+		//	positionOut + getPositionSize() for an interleaved layout
+		void encode(const glm::vec3& position, const glm::vec3& color, const glm::vec3& normal, const glm::vec2& uv,
+			const PositionDecode& decode, uint8_t* positionOut, uint8_t* attributeOut) const;
+		// the two halves of encode, for filling the streams of a split layout one at a time
+		void encodePosition(const glm::vec3& position, const PositionDecode& decode, uint8_t* positionOut) const;
+		void encodeAttributes(const glm::vec3& color, const glm::vec3& normal, const glm::vec2& uv, uint8_t* attributeOut) const;
+
+		// unit normal folded onto the octahedron, in [-1, 1]. Spreads the 16 bits evenly over
+		//	the sphere, decoded by octahedralDecode in simple_shader.vert
+		static glm::vec2 encodeOctahedral(const glm::vec3& normal);
+	};
+}
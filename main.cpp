@@ -5,15 +5,98 @@
 #include <glm/mat4x4.hpp>
 
 #include "PrxApp.hpp"
+#include "PrxBenchmark.hpp"
+#include "PrxRayBenchmark.hpp"
 
 #include <cstdlib>
 #include <iostream>
 #include <stdexcept>
+#include <string>
 
 #include "RTXApp.h"
 
-int main() {
+int main(int argc, char* argv[]) {
     //RTXApp app;
+
+    // CPU ray traversal benchmark, no window or device needed
+    if (argc > 1 && std::string(argv[1]) == "--ray-benchmark") {
+        try {
+            for (int i = 2; i < argc; i++) {
+                prx::runRayBenchmark(argv[i]);
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // CPU reference path trace of the app's scene, the window opens but no frames are drawn
+    if (argc > 1 && std::string(argv[1]) == "--path-trace") {
+        if (argc < 3) {
+            std::cerr << "usage: " << argv[0] << " --path-trace <output.png|exr> [samples per pixel]" << std::endl;
+            return EXIT_FAILURE;
+        }
+        try {
+            uint32_t samplesPerPixel = argc > 3 ? static_cast<uint32_t>(std::stoul(argv[3])) : 64;
+            prx::PrxApp app{};
+            app.renderReference(argv[2], samplesPerPixel);
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // CPU transform batch against the per object matrices, no window or device needed
+    if (argc > 1 && std::string(argv[1]) == "--transform-benchmark") {
+        try {
+            prx::runTransformBenchmark();
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // CPU scene tree queries against a linear scan, no window or device needed
+    if (argc > 1 && std::string(argv[1]) == "--aabb-tree-benchmark") {
+        try {
+            prx::runAabbTreeBenchmark();
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // CPU BVH builds of every model, no window or device needed
+    if (argc > 1 && std::string(argv[1]) == "--bvh-benchmark") {
+        try {
+            prx::runBvhBenchmark(argc > 2 ? argv[2] : "models");
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // CPU TLAS rebuilds and refits, no window or device needed
+    if (argc > 1 && std::string(argv[1]) == "--tlas-benchmark") {
+        try {
+            prx::runTlasBenchmark();
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
     
     prx::PrxApp app{};
 
@@ -4,4 +4,5 @@ C:/VulkanSDK/1.3.204.1/Bin/glslc.exe simple_shader.vert -o simple_vert.spv
 C:/VulkanSDK/1.3.204.1/Bin/glslc.exe simple_shader.frag -o simple_frag.spv
 C:/VulkanSDK/1.3.204.1/Bin/glslc.exe point_light.vert -o point_light_vert.spv
 C:/VulkanSDK/1.3.204.1/Bin/glslc.exe point_light.frag -o point_light_frag.spv
+C:/VulkanSDK/1.3.204.1/Bin/glslc.exe cull.comp -o cull_comp.spv
 pause
\ No newline at end of file
@@ -1,9 +1,11 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout (location = 0) in vec3 fragColor;
 layout (location = 1) in vec3 fragPosWorld;
 layout (location = 2) in vec3 fragNormalWorld;
 layout (location = 3) in vec2 fragUV;
+layout (location = 4) flat in uint fragTextureIndex; // diffuse map's slot in the texture table
 
 layout (location = 0) out vec4 outColor;
 
@@ -22,13 +24,8 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
 	int numLights;
 } ubo;
 
-// consider changing to set 1, binding 0
-layout(set = 1, binding = 1) uniform sampler2D diffuseMap;
-
-layout(push_constant) uniform Push {
-	mat4 modelMatrix;
-	mat4 normalMatrix; // mat4 for alignment reasons, truncate into mat3 when used
-} push;
+// bindless texture table, every registered texture is in here (see PrxBindlessTextureTable)
+layout(set = 2, binding = 0) uniform sampler2D textures[];
 
 void main() {
 	vec3 diffuseLight = ubo.ambientLightColor.xyz * ubo.ambientLightColor.w;
@@ -62,7 +59,7 @@ void main() {
 		
 	}
 	
-	vec3 imageColor = texture(diffuseMap, fragUV).rgb;
+	vec3 imageColor = texture(textures[nonuniformEXT(fragTextureIndex)], fragUV).rgb;
 
 	outColor = vec4((diffuseLight * fragColor + specularLight * fragColor) * imageColor, 1.0);
 }
\ No newline at end of file
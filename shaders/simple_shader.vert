@@ -1,5 +1,11 @@
 #version 450
 
+// how the geometry arena stores normals, see PrxNormalEncoding. Set by PrxPipeline::setVertexLayout
+layout(constant_id = 0) const uint NORMAL_ENCODING = 0;
+const uint NORMAL_ENCODING_OCTAHEDRAL = 1;
+
+// Note: positions, colors and uvs read back as floats whatever their encoding, only the normal
+//	needs decoding here
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 color;
 layout(location = 2) in vec3 normal;
@@ -9,6 +15,7 @@ layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec3 fragPosWorld;
 layout(location = 2) out vec3 fragNormalWorld;
 layout(location = 3) out vec2 fragUV;
+layout(location = 4) flat out uint fragTextureIndex;
 
 struct PointLight {
 	vec4 position; // ignore w
@@ -25,25 +32,52 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
 	int numLights;
 } ubo;
 
-layout(set = 1, binding = 0) uniform GameObjectBufferInfo {
+struct GameObjectBufferData {
 	mat4 modelMatrix;
 	mat4 normalMatrix;
-} gameObject;
+	vec4 positionScale; // quantized positions are relative to the model's box
+	vec4 positionOffset;
+};
 
-layout(push_constant) uniform Push {
-	mat4 modelMatrix;
-	mat4 normalMatrix; // mat4 for alignment reasons, truncate into mat3 when used
-} push;
+// every game object's data, indexed by its entity index (see PrxGameObjectManager)
+layout(std430, set = 1, binding = 0) readonly buffer GameObjectBuffer {
+	GameObjectBufferData objects[];
+} gameObjects;
+
+struct InstanceData {
+	uint objectIndex;
+	uint textureIndex;
+};
+
+// instances of every batch drawn this frame; each draw's firstInstance offsets gl_InstanceIndex
+//	into its own range (see SimpleRenderSystem)
+layout(std430, set = 1, binding = 1) readonly buffer InstanceBuffer {
+	InstanceData instances[];
+} instanceBuffer;
+
+// inverse of PrxVertexLayout::encodeOctahedral
+vec3 octahedralDecode(vec2 encoded) {
+	vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float fold = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -fold : fold;
+	n.y += n.y >= 0.0 ? -fold : fold;
+	return normalize(n);
+}
 
 void main() {
-	vec4 positionWorld = gameObject.modelMatrix * vec4(position, 1.0);
+	InstanceData instance = instanceBuffer.instances[gl_InstanceIndex];
+	GameObjectBufferData gameObject = gameObjects.objects[instance.objectIndex];
+	vec3 positionModel = position * gameObject.positionScale.xyz + gameObject.positionOffset.xyz;
+	vec4 positionWorld = gameObject.modelMatrix * vec4(positionModel, 1.0);
 
     gl_Position = ubo.projection * (ubo.view * positionWorld);
 	
 	// normal matrix is truncated back into a mat3
-	fragNormalWorld = normalize(mat3(gameObject.normalMatrix) * normal);
+	vec3 normalModel = NORMAL_ENCODING == NORMAL_ENCODING_OCTAHEDRAL ? octahedralDecode(normal.xy) : normal;
+	fragNormalWorld = normalize(mat3(gameObject.normalMatrix) * normalModel);
 	fragPosWorld = positionWorld.xyz;
 	fragColor = color;
 	fragUV = uv;
+	fragTextureIndex = instance.textureIndex;
 	
 }
\ No newline at end of file
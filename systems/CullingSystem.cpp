@@ -0,0 +1,97 @@
+#include "CullingSystem.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS 
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+
+namespace prx {
+
+	void CullingSystem::cull(FrameInfo& frameInfo) {
+		PrxFrustum frustum = PrxFrustum::fromMatrix(frameInfo.camera.getProjection() * frameInfo.camera.getView());
+		gatherBounds(frameInfo, frustum);
+		testBounds(frustum);
+
+		// compact the survivors
+		visibleObjects.clear();
+		for (size_t i = 0; i < candidates.size(); i++) {
+			if (insideMask[i]) {
+				visibleObjects.push_back(candidates[i]);
+			}
+		}
+
+		cullStats.tested = static_cast<uint32_t>(candidates.size());
+		cullStats.visible = static_cast<uint32_t>(visibleObjects.size());
+	}
+
+	void CullingSystem::gatherBounds(FrameInfo& frameInfo, const PrxFrustum& frustum) {
+		// the scene tree throws out everything far off screen by whole subtrees. What is left only
+		//	had its fat box tested, so it still goes through the tighter tests below
+		auto& gameObjectManager = frameInfo.gameObjectManager;
+		candidates.clear();
+		gameObjectManager.getSceneTree().queryFrustum(frustum, [&](uint32_t entity) {
+			candidates.push_back(entity);
+			return true;
+		});
+
+		centerX.clear(); centerY.clear(); centerZ.clear();
+		radius.clear();
+		extentX.clear(); extentY.clear(); extentZ.clear();
+
+		for (PrxEntity entity : candidates) {
+			const PrxModel::Bounds& bounds = gameObjectManager.registry.get<ModelComponent>(entity).model->getBounds();
+			const glm::mat4& modelMatrix = gameObjectManager.getObjectData(entity).modelMatrix;
+
+			glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(bounds.center, 1.f));
+
+			// the sphere grows with the largest axis scale, so it still covers the mesh
+			float scale = std::max(glm::length(glm::vec3(modelMatrix[0])),
+				std::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+
+			// box around the rotated box (Arvo): each world axis takes |M| times the local half size
+			glm::vec3 halfSize = (bounds.max - bounds.min) * .5f;
+			glm::vec3 extent = glm::abs(glm::vec3(modelMatrix[0])) * halfSize.x
+				+ glm::abs(glm::vec3(modelMatrix[1])) * halfSize.y
+				+ glm::abs(glm::vec3(modelMatrix[2])) * halfSize.z;
+
+			centerX.push_back(center.x);
+			centerY.push_back(center.y);
+			centerZ.push_back(center.z);
+			radius.push_back(bounds.radius * scale);
+			extentX.push_back(extent.x);
+			extentY.push_back(extent.y);
+			extentZ.push_back(extent.z);
+		}
+	}
+
+	void CullingSystem::testBounds(const PrxFrustum& frustum) {
+		const size_t count = candidates.size();
+		insideMask.assign(count, 1);
+
+		const float* cx = centerX.data();
+		const float* cy = centerY.data();
+		const float* cz = centerZ.data();
+		const float* r = radius.data();
+		const float* ex = extentX.data();
+		const float* ey = extentY.data();
+		const float* ez = extentZ.data();
+		uint32_t* inside = insideMask.data();
+
+		// one pass per plane over plain arrays, with no branches, so the compiler can vectorize it.
+		//	Both volumes share a center, so each plane only needs the smaller of their two reaches
+		for (const glm::vec4& plane : frustum.planes) {
+			const float nx = plane.x, ny = plane.y, nz = plane.z, d = plane.w;
+			const float ax = std::abs(nx), ay = std::abs(ny), az = std::abs(nz);
+			for (size_t i = 0; i < count; i++) {
+				float distance = nx * cx[i] + ny * cy[i] + nz * cz[i] + d;
+				float boxReach = ax * ex[i] + ay * ey[i] + az * ez[i];
+				float reach = std::min(r[i], boxReach);
+				inside[i] &= static_cast<uint32_t>(distance >= -reach);
+			}
+		}
+	}
+}
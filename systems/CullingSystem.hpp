@@ -0,0 +1,54 @@
+#pragma once
+
+// prx
+#include "../PrxGameObject.hpp"
+#include "../PrxCamera.hpp"
+#include "../PrxFrameInfo.hpp"
+#include "../PrxFrustum.hpp"
+
+// std
+#include <vector>
+
+namespace prx {
+
+	// Frustum culls every game object with a model on the CPU, and hands the render systems the
+	//	list of objects that are (possibly) on screen.
+	//	The scene tree (PrxGameObjectManager::getSceneTree) picks the candidates, then each one is
+	//	tested with both its world bounding sphere and box, and is dropped if either one is fully
+	//	outside a plane. The bounds are kept as SoA arrays so the plane tests vectorize.
+	class CullingSystem
+	{
+	public:
+		struct CullStats {
+			uint32_t tested = 0; // objects that made it past the scene tree
+			uint32_t visible = 0;
+		};
+
+		CullingSystem() = default;
+
+		// do not allow for copying
+		CullingSystem(const CullingSystem&) = delete;
+		void operator=(const CullingSystem&) = delete;
+
+		// Note: reads the game object manager's object data, so call this after updateBuffer
+		void cull(FrameInfo& frameInfo);
+
+		// visible objects from the last cull, in no particular order
+		const std::vector<PrxEntity>& getVisibleObjects() const { return visibleObjects; }
+		const CullStats& getStats() const { return cullStats; }
+
+	private:
+		// world space bounds of every candidate, one array per component
+		void gatherBounds(FrameInfo& frameInfo, const PrxFrustum& frustum);
+		void testBounds(const PrxFrustum& frustum);
+
+		std::vector<PrxEntity> candidates;
+		std::vector<float> centerX, centerY, centerZ;
+		std::vector<float> radius;
+		std::vector<float> extentX, extentY, extentZ; // half size of the world box
+		std::vector<uint32_t> insideMask; // 32 bit, so it is as wide as the floats it is computed from
+
+		std::vector<PrxEntity> visibleObjects;
+		CullStats cullStats{};
+	};
+}
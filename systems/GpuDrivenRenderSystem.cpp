@@ -0,0 +1,350 @@
+#include "GpuDrivenRenderSystem.hpp"
+
+// std
+#include <stdexcept>
+#include <algorithm>
+#include <cassert>
+
+namespace prx {
+
+	struct CullPushConstantData {
+		glm::vec4 frustumPlanes[PrxFrustum::PLANE_COUNT];
+		uint32_t objectCount;
+		uint32_t firstWideDraw; // where the 32 bit index section of the draw list starts
+	};
+
+	void GpuDrivenRenderSystem::cullOnCpu(
+		const PrxFrustum& frustum,
+		const GameObjectBufferData* objectData,
+		const std::vector<CullObject>& objects,
+		const std::vector<MeshInfo>& meshes,
+		std::vector<VkDrawIndexedIndirectCommand>& outCommands,
+		std::vector<uint32_t>& outCounts,
+		std::vector<InstanceData>& outInstances) {
+		// at most one draw per object, appended to the section of their index width
+		outCommands.assign(objects.size(), VkDrawIndexedIndirectCommand{});
+		outInstances.assign(objects.size(), InstanceData{});
+		outCounts.assign(2, 0);
+
+		uint32_t firstWideDraw = 0;
+		for (const CullObject& object : objects) {
+			if (meshes[object.meshIndex].indexType == VK_INDEX_TYPE_UINT16) {
+				firstWideDraw++;
+			}
+		}
+
+		for (const CullObject& object : objects) {
+			const MeshInfo& mesh = meshes[object.meshIndex];
+			const glm::mat4& modelMatrix = objectData[object.objectIndex].modelMatrix;
+
+			glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(glm::vec3(mesh.boundingSphere), 1.f));
+			float scale = std::max(glm::length(glm::vec3(modelMatrix[0])),
+				std::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+			if (!frustum.intersectsSphere(center, mesh.boundingSphere.w * scale)) continue;
+
+			const uint32_t section = mesh.indexType == VK_INDEX_TYPE_UINT16 ? 0 : 1;
+			const uint32_t drawIndex = (section == 0 ? 0 : firstWideDraw) + outCounts[section]++;
+			outCommands[drawIndex] = { mesh.indexCount, 1, mesh.firstIndex, mesh.vertexOffset, drawIndex };
+			outInstances[drawIndex] = { object.objectIndex, object.textureIndex };
+		}
+	}
+
+	GpuDrivenRenderSystem::GpuDrivenRenderSystem(PrxDevice& device, VkRenderPass renderPass,
+		VkDescriptorSetLayout globalSetLayout, PrxDescriptorLayoutCache& layoutCache,
+		PrxBindlessTextureTable& textureTable) : prxDevice{ device }, textureTable{ textureTable } {
+		if (!prxDevice.supportsGpuDrivenRendering) {
+			throw std::runtime_error("device does not support GPU driven rendering!");
+		}
+
+		createPipelineLayouts(globalSetLayout, layoutCache);
+		createPipelines(renderPass);
+	}
+
+	GpuDrivenRenderSystem::~GpuDrivenRenderSystem() {
+		vkDestroyPipelineLayout(prxDevice.device(), graphicsPipelineLayout, nullptr);
+		vkDestroyPipelineLayout(prxDevice.device(), cullPipelineLayout, nullptr);
+	}
+
+	void GpuDrivenRenderSystem::createPipelineLayouts(VkDescriptorSetLayout globalSetLayout,
+		PrxDescriptorLayoutCache& layoutCache) {
+		// same bindings as SimpleRenderSystem's set 1, so the layout (and the simple shaders) are shared
+		objectSetLayout = &PrxDescriptorSetLayout::Builder(prxDevice)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT) // every game object's matrices
+			.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT) // instances written by the cull pass
+			.build(layoutCache);
+
+		std::vector<VkDescriptorSetLayout> graphicsSetLayouts{ globalSetLayout,
+			objectSetLayout->getDescriptorSetLayout(),
+			textureTable.getDescriptorSetLayout() };
+
+		VkPipelineLayoutCreateInfo graphicsLayoutInfo{};
+		graphicsLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		graphicsLayoutInfo.setLayoutCount = static_cast<uint32_t>(graphicsSetLayouts.size());
+		graphicsLayoutInfo.pSetLayouts = graphicsSetLayouts.data();
+		graphicsLayoutInfo.pushConstantRangeCount = 0;
+		graphicsLayoutInfo.pPushConstantRanges = nullptr;
+
+		if (vkCreatePipelineLayout(prxDevice.device(), &graphicsLayoutInfo,
+			nullptr, &graphicsPipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create pipeline layout!");
+		}
+
+		cullSetLayout = &PrxDescriptorSetLayout::Builder(prxDevice)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // game object matrices
+			.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // cull objects
+			.addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // meshes
+			.addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // draw commands (out)
+			.addBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // draw count (out)
+			.addBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT) // instances (out)
+			.build(layoutCache);
+
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(CullPushConstantData);
+
+		VkDescriptorSetLayout cullDescriptorSetLayout = cullSetLayout->getDescriptorSetLayout();
+		VkPipelineLayoutCreateInfo cullLayoutInfo{};
+		cullLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		cullLayoutInfo.setLayoutCount = 1;
+		cullLayoutInfo.pSetLayouts = &cullDescriptorSetLayout;
+		cullLayoutInfo.pushConstantRangeCount = 1;
+		cullLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+		if (vkCreatePipelineLayout(prxDevice.device(), &cullLayoutInfo,
+			nullptr, &cullPipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create pipeline layout!");
+		}
+	}
+
+	void GpuDrivenRenderSystem::createPipelines(VkRenderPass renderPass) {
+		assert(graphicsPipelineLayout != nullptr && "Cannot create pipeline before pipeline layout!");
+
+		PipelineConfigInfo pipelineConfig{};
+		PrxPipeline::defaultPipelineConfigInfo(pipelineConfig);
+		PrxPipeline::setVertexLayout(pipelineConfig, prxDevice.getGeometryArena().getLayout());
+		pipelineConfig.renderPass = renderPass;
+		pipelineConfig.pipelineLayout = graphicsPipelineLayout;
+		graphicsPipeline = std::make_unique<PrxPipeline>(prxDevice,
+			"shaders/simple_vert.spv", "shaders/simple_frag.spv",
+			pipelineConfig);
+
+		cullPipeline = std::make_unique<PrxComputePipeline>(prxDevice,
+			"shaders/cull_comp.spv", cullPipelineLayout);
+	}
+
+	void GpuDrivenRenderSystem::rebuildObjectList(PrxRegistry& registry) {
+		auto& modelPool = registry.getPool<ModelComponent>();
+		auto& diffuseMapPool = registry.getPool<DiffuseMapComponent>();
+		if (!forceRebuild && modelPool.getVersion() == modelPoolVersion &&
+			diffuseMapPool.getVersion() == diffuseMapPoolVersion) {
+			return;
+		}
+		forceRebuild = false;
+		modelPoolVersion = modelPool.getVersion();
+		diffuseMapPoolVersion = diffuseMapPool.getVersion();
+
+		cullObjects.clear();
+		meshInfos.clear();
+		shortObjectCount = 0;
+
+		// model -> its first mesh in meshInfos, the rest follow it
+		std::unordered_map<PrxModel*, uint32_t> meshLookup;
+		registry.view<ModelComponent>().each([&](PrxEntity entity, ModelComponent& modelComponent) {
+			PrxModel* model = modelComponent.model.get();
+			if (model == nullptr || !model->hasIndices()) return;
+
+			const auto& drawRanges = model->getDrawRanges();
+			auto [it, inserted] = meshLookup.try_emplace(model, static_cast<uint32_t>(meshInfos.size()));
+			if (inserted) {
+				// Note: every mesh culls with the whole model's sphere
+				const PrxModel::Bounds& bounds = model->getBounds();
+				for (const PrxModel::DrawRange& range : drawRanges) {
+					meshInfos.push_back({ glm::vec4(bounds.center, bounds.radius),
+						range.indexCount, range.firstIndex, range.vertexOffset, static_cast<uint32_t>(range.indexType) });
+				}
+			}
+
+			// an object's own diffuse map wins over its model's materials
+			uint32_t objectTexture = PrxBindlessTextureTable::INVALID_INDEX;
+			if (auto* diffuseMap = registry.tryGet<DiffuseMapComponent>(entity)) {
+				objectTexture = textureTable.registerTexture(*diffuseMap->texture);
+			}
+
+			const uint32_t objectIndex = PrxGameObjectManager::getBufferIndex(entity);
+			for (uint32_t i = 0; i < drawRanges.size(); i++) {
+				// then the mesh's material, then the white default texture
+				uint32_t textureIndex = objectTexture;
+				if (textureIndex == PrxBindlessTextureTable::INVALID_INDEX) {
+					const auto& texture = model->getMaterialTexture(drawRanges[i].materialIndex);
+					textureIndex = texture != nullptr ? textureTable.registerTexture(*texture) : PrxBindlessTextureTable::DEFAULT_INDEX;
+				}
+				cullObjects.push_back({ objectIndex, it->second + i, textureIndex });
+				if (drawRanges[i].indexType == VK_INDEX_TYPE_UINT16) {
+					shortObjectCount++;
+				}
+			}
+		});
+
+		sceneVersion++;
+	}
+
+	void GpuDrivenRenderSystem::uploadObjectList(FrameResources& frame) {
+		// (re)creates a buffer that is too small. The frame being recorded has already waited on its
+		//	previous submission, so its old buffers aren't in use anymore
+		auto reserve = [&](std::unique_ptr<PrxBuffer>& buffer, VkDeviceSize instanceSize, size_t count,
+			VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryProperties) {
+			uint32_t instanceCount = static_cast<uint32_t>(std::max<size_t>(count, 1));
+			if (buffer != nullptr && buffer->getInstanceCount() >= instanceCount) return;
+
+			buffer = std::make_unique<PrxBuffer>(prxDevice, instanceSize, instanceCount, usage, memoryProperties);
+			if (memoryProperties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+				buffer->map();
+			}
+		};
+
+		reserve(frame.cullObjectBuffer, sizeof(CullObject), cullObjects.size(),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+		reserve(frame.meshBuffer, sizeof(MeshInfo), meshInfos.size(),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+		reserve(frame.drawCommandBuffer, sizeof(VkDrawIndexedIndirectCommand), cullObjects.size(),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		reserve(frame.drawCountBuffer, sizeof(uint32_t), 2, // one count per section
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		reserve(frame.instanceBuffer, sizeof(InstanceData), cullObjects.size(),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		if (!cullObjects.empty()) {
+			VkDeviceSize objectBytes = sizeof(CullObject) * cullObjects.size();
+			frame.cullObjectBuffer->writeToBuffer(cullObjects.data(), objectBytes);
+			frame.cullObjectBuffer->flush(objectBytes);
+
+			VkDeviceSize meshBytes = sizeof(MeshInfo) * meshInfos.size();
+			frame.meshBuffer->writeToBuffer(meshInfos.data(), meshBytes);
+			frame.meshBuffer->flush(meshBytes);
+		}
+
+		frame.sceneVersion = sceneVersion;
+	}
+
+	void GpuDrivenRenderSystem::cull(FrameInfo& frameInfo) {
+		rebuildObjectList(frameInfo.gameObjectManager.registry);
+
+		FrameResources& frame = frames[frameInfo.frameIndex];
+		if (frame.sceneVersion != sceneVersion) {
+			uploadObjectList(frame);
+		}
+		if (cullObjects.empty()) return;
+
+		VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+
+		// the count starts at zero, the cull pass appends with atomics
+		vkCmdFillBuffer(commandBuffer, frame.drawCountBuffer->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+
+		VkMemoryBarrier clearBarrier{};
+		clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+		cullPipeline->bind(commandBuffer);
+
+		auto objectBufferInfo = frameInfo.gameObjectManager.getBufferInfo(frameInfo.frameIndex);
+		auto cullObjectInfo = frame.cullObjectBuffer->descriptorInfo();
+		auto meshInfo = frame.meshBuffer->descriptorInfo();
+		auto drawCommandInfo = frame.drawCommandBuffer->descriptorInfo();
+		auto drawCountInfo = frame.drawCountBuffer->descriptorInfo();
+		auto instanceInfo = frame.instanceBuffer->descriptorInfo();
+		VkDescriptorSet cullSet;
+		if (!PrxDescriptorWriter(*cullSetLayout, frameInfo.frameDescriptorAllocator)
+			.writeBuffer(0, &objectBufferInfo)
+			.writeBuffer(1, &cullObjectInfo)
+			.writeBuffer(2, &meshInfo)
+			.writeBuffer(3, &drawCommandInfo)
+			.writeBuffer(4, &drawCountInfo)
+			.writeBuffer(5, &instanceInfo)
+			.build(cullSet)) {
+			throw std::runtime_error("failed to allocate cull descriptor set!");
+		}
+		vkCmdBindDescriptorSets(commandBuffer,
+			VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout,
+			0, 1, &cullSet, 0, nullptr);
+
+		CullPushConstantData push{};
+		PrxFrustum frustum = PrxFrustum::fromMatrix(frameInfo.camera.getProjection() * frameInfo.camera.getView());
+		std::copy(std::begin(frustum.planes), std::end(frustum.planes), std::begin(push.frustumPlanes));
+		push.objectCount = static_cast<uint32_t>(cullObjects.size());
+		push.firstWideDraw = shortObjectCount;
+		vkCmdPushConstants(commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+			0, sizeof(CullPushConstantData), &push);
+
+		uint32_t groupCount = (push.objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE;
+		vkCmdDispatch(commandBuffer, groupCount, 1, 1);
+
+		// the draw list is read as indirect arguments, the instances by the vertex shader
+		VkMemoryBarrier cullBarrier{};
+		cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+			0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	void GpuDrivenRenderSystem::render(FrameInfo& frameInfo) {
+		if (cullObjects.empty()) return;
+
+		FrameResources& frame = frames[frameInfo.frameIndex];
+		assert(frame.sceneVersion == sceneVersion && "cull() has to be called before render()");
+
+		VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+		graphicsPipeline->bind(commandBuffer);
+
+		vkCmdBindDescriptorSets(commandBuffer,
+			VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipelineLayout,
+			0, 1, &frameInfo.globalDescriptorSet, 0, nullptr);
+
+		VkDescriptorSet textureSet = textureTable.getDescriptorSet();
+		vkCmdBindDescriptorSets(commandBuffer,
+			VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipelineLayout,
+			2, 1, &textureSet, 0, nullptr);
+
+		auto objectBufferInfo = frameInfo.gameObjectManager.getBufferInfo(frameInfo.frameIndex);
+		auto instanceInfo = frame.instanceBuffer->descriptorInfo();
+		VkDescriptorSet objectSet;
+		if (!PrxDescriptorWriter(*objectSetLayout, frameInfo.frameDescriptorAllocator)
+			.writeBuffer(0, &objectBufferInfo)
+			.writeBuffer(1, &instanceInfo)
+			.build(objectSet)) {
+			throw std::runtime_error("failed to allocate game object descriptor set!");
+		}
+		vkCmdBindDescriptorSets(commandBuffer,
+			VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipelineLayout,
+			1, 1, &objectSet, 0, nullptr);
+
+		// one call per index width, however many objects and meshes survived the cull
+		PrxGeometryArena& arena = prxDevice.getGeometryArena();
+		const uint32_t wideObjectCount = static_cast<uint32_t>(cullObjects.size()) - shortObjectCount;
+		arena.bind(commandBuffer, shortObjectCount > 0 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);
+		if (shortObjectCount > 0) {
+			vkCmdDrawIndexedIndirectCount(commandBuffer,
+				frame.drawCommandBuffer->getBuffer(), 0,
+				frame.drawCountBuffer->getBuffer(), 0,
+				shortObjectCount, sizeof(VkDrawIndexedIndirectCommand));
+		}
+		if (wideObjectCount > 0) {
+			if (shortObjectCount > 0) {
+				arena.bindIndices(commandBuffer, VK_INDEX_TYPE_UINT32);
+			}
+			vkCmdDrawIndexedIndirectCount(commandBuffer,
+				frame.drawCommandBuffer->getBuffer(), sizeof(VkDrawIndexedIndirectCommand) * shortObjectCount,
+				frame.drawCountBuffer->getBuffer(), sizeof(uint32_t),
+				wideObjectCount, sizeof(VkDrawIndexedIndirectCommand));
+		}
+	}
+}
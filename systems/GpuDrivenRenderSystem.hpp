@@ -0,0 +1,131 @@
+#pragma once
+
+// prx
+#include "../PrxPipeline.hpp"
+#include "../PrxGameObject.hpp"
+#include "../PrxDevice.hpp"
+#include "../PrxFrameInfo.hpp"
+#include "../PrxFrustum.hpp"
+#include "../PrxDescriptors.hpp"
+#include "../PrxBindlessTextureTable.hpp"
+
+// std
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace prx {
+
+	// Optional replacement for SimpleRenderSystem's draw loop where the GPU builds the draw list.
+	//	A compute pass (cull.comp) frustum culls every drawable object and compacts the survivors
+	//	into one list of VkDrawIndexedIndirectCommand. Every model lives in the geometry arena, so the
+	//	main pass binds it once and draws the whole list with one vkCmdDrawIndexedIndirectCount per
+	//	index width: the list has a section for meshes with 16 bit indices, then one for 32 bit.
+	//	Recording cost doesn't depend on the number of objects or meshes.
+	//	Draws with the same shaders (and so the same set layouts) as SimpleRenderSystem.
+	// Requires PrxDevice::supportsGpuDrivenRendering. Only models with an index buffer are drawn.
+	//
+	// The object list on the GPU is only rebuilt when ModelComponents or DiffuseMapComponents are
+	//	added or removed. Note: call invalidate() after swapping the model or texture of an existing
+	//	component in place
+	class GpuDrivenRenderSystem
+	{
+	public:
+		static constexpr uint32_t CULL_GROUP_SIZE = 64; // local_size_x in cull.comp
+
+		// GPU side layouts, these match cull.comp (std430)
+		struct CullObject {
+			uint32_t objectIndex; // slot in the game object buffer
+			uint32_t meshIndex;
+			uint32_t textureIndex;
+			uint32_t padding = 0;
+		};
+
+		// one per draw range of each model (see PrxModel::getDrawRanges)
+		struct MeshInfo {
+			glm::vec4 boundingSphere; // model space center, w is the radius
+			uint32_t indexCount;
+			uint32_t firstIndex; // into the geometry arena, in indices of indexType
+			int32_t vertexOffset;
+			uint32_t indexType; // VkIndexType, UINT16 (0) or UINT32 (1)
+		};
+
+		struct InstanceData {
+			uint32_t objectIndex;
+			uint32_t textureIndex;
+		};
+
+		// CPU reference of cull.comp, for checking results without a GPU.
+		//	Produces the same commands, count and instances, except that the GPU writes draws in
+		//	whatever order its atomics land, while this keeps object order.
+		//	outCommands and outInstances are sized to the object count; outCounts holds the draw count
+		//	of each section (16 bit draws from 0, 32 bit ones after every object with a 16 bit mesh)
+		static void cullOnCpu(
+			const PrxFrustum& frustum,
+			const GameObjectBufferData* objectData,
+			const std::vector<CullObject>& objects,
+			const std::vector<MeshInfo>& meshes,
+			std::vector<VkDrawIndexedIndirectCommand>& outCommands,
+			std::vector<uint32_t>& outCounts,
+			std::vector<InstanceData>& outInstances);
+
+		GpuDrivenRenderSystem(PrxDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout,
+			PrxDescriptorLayoutCache& layoutCache, PrxBindlessTextureTable& textureTable);
+		~GpuDrivenRenderSystem();
+
+		// do not allow for copying
+		GpuDrivenRenderSystem(const GpuDrivenRenderSystem&) = delete;
+		void operator=(const GpuDrivenRenderSystem&) = delete;
+
+		// Records the cull dispatch. Has to be called outside of the render pass, before render()
+		void cull(FrameInfo& frameInfo);
+		void render(FrameInfo& frameInfo);
+
+		// rebuilds the object list on the next cull()
+		void invalidate() { forceRebuild = true; }
+
+		// object list from the last cull(), for feeding cullOnCpu
+		const std::vector<CullObject>& getCullObjects() const { return cullObjects; }
+		const std::vector<MeshInfo>& getMeshes() const { return meshInfos; }
+
+	private:
+		// everything one frame in flight reads or writes on the GPU
+		struct FrameResources {
+			std::unique_ptr<PrxBuffer> cullObjectBuffer;
+			std::unique_ptr<PrxBuffer> meshBuffer;
+			std::unique_ptr<PrxBuffer> drawCommandBuffer;
+			std::unique_ptr<PrxBuffer> drawCountBuffer;
+			std::unique_ptr<PrxBuffer> instanceBuffer;
+			uint64_t sceneVersion = UINT64_MAX; // version of the object list the buffers hold
+		};
+
+		void createPipelineLayouts(VkDescriptorSetLayout globalSetLayout, PrxDescriptorLayoutCache& layoutCache);
+		void createPipelines(VkRenderPass renderPass);
+
+		// walks the drawable objects into cullObjects / meshInfos, if they changed
+		void rebuildObjectList(PrxRegistry& registry);
+		void uploadObjectList(FrameResources& frame);
+
+		PrxDevice& prxDevice;
+		PrxBindlessTextureTable& textureTable;
+
+		std::unique_ptr<PrxPipeline> graphicsPipeline;
+		std::unique_ptr<PrxComputePipeline> cullPipeline;
+		VkPipelineLayout graphicsPipelineLayout = VK_NULL_HANDLE;
+		VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+		PrxDescriptorSetLayout* objectSetLayout = nullptr; // owned by the layout cache
+		PrxDescriptorSetLayout* cullSetLayout = nullptr; // owned by the layout cache
+
+		std::vector<FrameResources> frames{ PrxSwapChain::MAX_FRAMES_IN_FLIGHT };
+
+		// CPU copy of the object list, and the pool versions it was built from
+		//	Note: an object with a multi mesh model has one cull object per mesh
+		std::vector<CullObject> cullObjects;
+		std::vector<MeshInfo> meshInfos;
+		uint64_t modelPoolVersion = UINT64_MAX;
+		uint64_t diffuseMapPoolVersion = UINT64_MAX;
+		uint32_t shortObjectCount = 0; // cull objects whose mesh has 16 bit indices, the size of the first section
+		uint64_t sceneVersion = 0; // bumped on every rebuild
+		bool forceRebuild = false;
+	};
+}
@@ -87,38 +87,35 @@ namespace prx {
 			{ 0.f, -1.f, 0.f });
 		
 		int lightIndex = 0;
-		for (auto& kv : frameInfo.gameObjects) {
-			auto& obj = kv.second;
-			if (obj.pointLight == nullptr) continue;
-			
+		auto& registry = frameInfo.gameObjectManager.registry;
+		registry.view<TransformComponent, PointLightComponent>().each(
+			[&](PrxEntity entity, TransformComponent& transform, PointLightComponent& pointLight) {
 			assert(lightIndex < MAX_LIGHTS && "Point lights exceed maximum specified");
 
 			// update light position
-			obj.transform.translation = glm::vec3(rotateLight * glm::vec4(obj.transform.translation, 1.f));
+			transform.translation = glm::vec3(rotateLight * glm::vec4(transform.translation, 1.f));
+			frameInfo.gameObjectManager.markTransformDirty(entity);
 
 			// copy light to ubo
-			ubo.pointLights[lightIndex].position = glm::vec4(obj.transform.translation, 1.f);
-			ubo.pointLights[lightIndex].color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
+			ubo.pointLights[lightIndex].position = glm::vec4(transform.translation, 1.f);
+			ubo.pointLights[lightIndex].color = glm::vec4(pointLight.color, pointLight.lightIntensity);
 			lightIndex += 1;
-		}
+		});
 
 		ubo.numLights = lightIndex;
 	}
 
 	void PointLightSystem::render(FrameInfo& frameInfo) {
 		// sort lights
-		std::map<float, PrxGameObject::id_t> sorted;
-		for (auto& kv : frameInfo.gameObjects) {
-
-			// check for point light
-			auto& obj = kv.second;
-			if (obj.pointLight == nullptr) continue;
-
+		auto& registry = frameInfo.gameObjectManager.registry;
+		std::map<float, PrxEntity> sorted;
+		registry.view<TransformComponent, PointLightComponent>().each(
+			[&](PrxEntity entity, TransformComponent& transform, PointLightComponent&) {
 			//calculate distance
-			auto offset = frameInfo.camera.getPosition() - obj.transform.translation;
+			auto offset = frameInfo.camera.getPosition() - transform.translation;
 			float disSquared = glm::dot(offset, offset);
-			sorted[disSquared] = obj.getId();
-		}
+			sorted[disSquared] = entity;
+		});
 
 		prxPipeline->bind(frameInfo.commandBuffer);
 
@@ -131,13 +128,14 @@ namespace prx {
 
 		// iterate through sorted map in reverse order
 		for (auto it = sorted.rbegin(); it != sorted.rend(); ++it) {
-			// use game obj id to find light object
-			auto& obj = frameInfo.gameObjects.at(it->second);
+			// use the entity to find the light's components
+			auto& transform = registry.get<TransformComponent>(it->second);
+			auto& pointLight = registry.get<PointLightComponent>(it->second);
 
 			PointLightPushConstants push{};
-			push.position = glm::vec4(obj.transform.translation, 1.f);
-			push.color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
-			push.radius = obj.transform.scale.x;
+			push.position = glm::vec4(transform.translation, 1.f);
+			push.color = glm::vec4(pointLight.color, pointLight.lightIntensity);
+			push.radius = transform.scale.x;
 
 			vkCmdPushConstants(frameInfo.commandBuffer,
 				pipelineLayout,
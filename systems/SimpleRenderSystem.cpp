@@ -1,4 +1,5 @@
 #include "SimpleRenderSystem.hpp"
+#include "../PrxUtils.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS 
@@ -8,20 +9,23 @@
 
 // std
 #include <stdexcept>
+#include <algorithm>
 #include <array>
 #include <iostream>
 
 namespace prx {
 
-	struct SimplePushConstantData {
-		glm::mat4 modelMatrix{ 1.f };
-		glm::mat4 normalMatrix{ 1.f };
-	};
+	size_t SimpleRenderSystem::BatchKeyHash::operator()(const BatchKey& key) const {
+		size_t seed = 0;
+		hashCombine(seed, key.model, key.rangeIndex, key.textureIndex);
+		return seed;
+	}
 
 	SimpleRenderSystem::SimpleRenderSystem(PrxDevice& device, VkRenderPass renderPass,
-		VkDescriptorSetLayout globalSetLayout) : prxDevice{ device } {
+		VkDescriptorSetLayout globalSetLayout, PrxDescriptorLayoutCache& layoutCache,
+		PrxBindlessTextureTable& textureTable) : prxDevice{ device }, textureTable{ textureTable } {
 		
-		createPipelineLayout(globalSetLayout);
+		createPipelineLayout(globalSetLayout, layoutCache);
 		createPipeline(renderPass);
 
 	}
@@ -30,29 +34,27 @@ namespace prx {
 		vkDestroyPipelineLayout(prxDevice.device(), pipelineLayout, nullptr);
 	}
 
-	void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
-
-		VkPushConstantRange pushConstantRange{};
-		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-		pushConstantRange.offset = 0;
-		pushConstantRange.size = sizeof(SimplePushConstantData);
+	void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout, PrxDescriptorLayoutCache& layoutCache) {
 
-		renderSystemLayout = PrxDescriptorSetLayout::Builder(prxDevice)
-			.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-				VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT) // send uniforms to both stages
-			.addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 
-				VK_SHADER_STAGE_FRAGMENT_BIT)	// ONLY send texture data to the fragment shader; useless in the vertex shader
-			.build();
+		// Note: no push constants anymore, everything per draw comes from the instance buffer
+		renderSystemLayout = &PrxDescriptorSetLayout::Builder(prxDevice)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_VERTEX_BIT) // every game object's matrices
+			.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_VERTEX_BIT) // this frame's instances, indexed with gl_InstanceIndex
+			.build(layoutCache);
 
+		// textures are no longer part of the per-object set, they live in the bindless table at set 2
 		std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout,
-			renderSystemLayout->getDescriptorSetLayout()};
+			renderSystemLayout->getDescriptorSetLayout(),
+			textureTable.getDescriptorSetLayout()};
 
 		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 		pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
 		pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-		pipelineLayoutInfo.pushConstantRangeCount = 1;
-		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+		pipelineLayoutInfo.pushConstantRangeCount = 0;
+		pipelineLayoutInfo.pPushConstantRanges = nullptr;
 
 		if (vkCreatePipelineLayout(prxDevice.device(), &pipelineLayoutInfo,
 			nullptr, &pipelineLayout) != VK_SUCCESS) {
@@ -67,6 +69,7 @@ namespace prx {
 		PipelineConfigInfo pipelineConfig{};
 
 		PrxPipeline::defaultPipelineConfigInfo(pipelineConfig);
+		PrxPipeline::setVertexLayout(pipelineConfig, prxDevice.getGeometryArena().getLayout());
 
 
 		// NOT PERMANENT! Will change this to be based on individual render passes rather than
@@ -79,7 +82,132 @@ namespace prx {
 			pipelineConfig);
 	}
 
-	void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo) {
+	void SimpleRenderSystem::reserveInstanceBuffer(int frameIndex, uint32_t instanceCount) {
+		auto& buffer = instanceBuffers[frameIndex];
+		if (buffer != nullptr && buffer->getInstanceCount() >= instanceCount) return;
+
+		uint32_t capacity = buffer != nullptr ? buffer->getInstanceCount() : INITIAL_INSTANCE_CAPACITY;
+		while (capacity < instanceCount) {
+			capacity *= 2;
+		}
+
+		// Note: the frame being recorded has already waited on its previous submission, so the
+		//	old buffer isn't in use anymore
+		buffer = std::make_unique<PrxBuffer>(
+			prxDevice,
+			sizeof(InstanceData),
+			capacity,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+		buffer->map();
+	}
+
+	VkIndexType SimpleRenderSystem::getIndexType(const BatchKey& key) {
+		// models without indices don't care what is bound, they sort in with the 16 bit ones
+		if (!key.model->hasIndices()) return VK_INDEX_TYPE_UINT16;
+		return key.model->getDrawRanges()[key.rangeIndex].indexType;
+	}
+
+	void SimpleRenderSystem::buildBatches(FrameInfo& frameInfo, const std::vector<PrxEntity>& objects) {
+		batchLookup.clear();
+		batches.clear();
+		drawItems.clear();
+
+		// find each object's batches (one per mesh of its model), remembering the last object's
+		//	since neighbours in the pool tend to share a model and texture
+		auto& registry = frameInfo.gameObjectManager.registry;
+		PrxModel* lastModel = nullptr;
+		uint32_t lastObjectTexture = PrxBindlessTextureTable::INVALID_INDEX;
+		objectCount = 0;
+		for (PrxEntity entity : objects) {
+			ModelComponent& modelComponent = registry.get<ModelComponent>(entity);
+			PrxModel* model = modelComponent.model.get();
+			if (model == nullptr) continue;
+			objectCount++;
+
+			// a texture is only written into the table the first time it is drawn.
+			//	An object's own diffuse map wins over its model's materials
+			uint32_t objectTexture = PrxBindlessTextureTable::INVALID_INDEX;
+			if (auto* diffuseMap = registry.tryGet<DiffuseMapComponent>(entity)) {
+				objectTexture = textureTable.registerTexture(*diffuseMap->texture);
+			}
+
+			if (model != lastModel || objectTexture != lastObjectTexture) {
+				lastBatches.clear();
+				const auto& drawRanges = model->getDrawRanges();
+				const uint32_t rangeCount = model->hasIndices() ? static_cast<uint32_t>(drawRanges.size()) : 1;
+				for (uint32_t range = 0; range < rangeCount; range++) {
+					// then the mesh's material, then the white default texture
+					uint32_t textureIndex = objectTexture;
+					if (textureIndex == PrxBindlessTextureTable::INVALID_INDEX) {
+						textureIndex = PrxBindlessTextureTable::DEFAULT_INDEX;
+						if (model->hasIndices()) {
+							if (const auto& texture = model->getMaterialTexture(drawRanges[range].materialIndex)) {
+								textureIndex = textureTable.registerTexture(*texture);
+							}
+						}
+					}
+
+					BatchKey key{ model, range, textureIndex };
+					auto [it, inserted] = batchLookup.try_emplace(key, static_cast<uint32_t>(batches.size()));
+					if (inserted) {
+						batches.push_back(Batch{ key });
+					}
+					lastBatches.push_back(it->second);
+				}
+				lastModel = model;
+				lastObjectTexture = objectTexture;
+			}
+
+			const uint32_t objectIndex = PrxGameObjectManager::getBufferIndex(entity);
+			for (uint32_t batchIndex : lastBatches) {
+				Batch& batch = batches[batchIndex];
+				batch.instanceCount++;
+				drawItems.push_back({ batchIndex, InstanceData{ objectIndex, batch.key.textureIndex } });
+			}
+		}
+
+		// lay the batches out by index width (so the index buffer is bound at most twice), then by
+		//	model, so consecutive draws read the same part of the geometry arena
+		batchOrder.resize(batches.size());
+		for (uint32_t i = 0; i < batchOrder.size(); i++) {
+			batchOrder[i] = i;
+		}
+		std::sort(batchOrder.begin(), batchOrder.end(), [&](uint32_t a, uint32_t b) {
+			const BatchKey& keyA = batches[a].key;
+			const BatchKey& keyB = batches[b].key;
+			const VkIndexType indexTypeA = getIndexType(keyA);
+			const VkIndexType indexTypeB = getIndexType(keyB);
+			if (indexTypeA != indexTypeB) return indexTypeA < indexTypeB;
+			if (keyA.model != keyB.model) return std::less<PrxModel*>{}(keyA.model, keyB.model);
+			if (keyA.rangeIndex != keyB.rangeIndex) return keyA.rangeIndex < keyB.rangeIndex;
+			return keyA.textureIndex < keyB.textureIndex;
+		});
+
+		uint32_t instanceCount = 0;
+		for (uint32_t batchIndex : batchOrder) {
+			batches[batchIndex].firstInstance = instanceCount;
+			instanceCount += batches[batchIndex].instanceCount;
+			batches[batchIndex].instanceCount = 0; // reused as the write cursor below
+		}
+
+		// scatter every instance into its batch's range
+		reserveInstanceBuffer(frameInfo.frameIndex, std::max(instanceCount, 1u));
+		auto& instanceBuffer = *instanceBuffers[frameInfo.frameIndex];
+		auto* instances = static_cast<InstanceData*>(instanceBuffer.getMappedMemory());
+		for (auto& [batchIndex, instance] : drawItems) {
+			Batch& batch = batches[batchIndex];
+			instances[batch.firstInstance + batch.instanceCount++] = instance;
+		}
+		// Note: a zero sized flush is a zero sized mapped range, which isn't allowed
+		if (instanceCount > 0) {
+			instanceBuffer.flush(static_cast<VkDeviceSize>(instanceCount) * sizeof(InstanceData));
+		}
+	}
+
+	void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo, const std::vector<PrxEntity>& objects) {
+		buildBatches(frameInfo, objects);
+
 		prxPipeline->bind(frameInfo.commandBuffer);
 
 		vkCmdBindDescriptorSets(frameInfo.commandBuffer,
@@ -89,50 +217,60 @@ namespace prx {
 			&frameInfo.globalDescriptorSet,
 			0, nullptr);
 
-		for (auto& kv : frameInfo.gameObjects) {
-			auto& obj = kv.second;
-			if (obj.model == nullptr) continue;
-
-			// The way things are currently set up is ineffecient,
-			//	as right now textures are being stored one-per-game-object, with the primary
-			//	storage location being ON the game objects themselves.
-			// In the future, do it this way: https://www.reddit.com/r/vulkan/comments/10tfz49/creating_descriptor_sets_for_texture_and_uniform/
-			// "Instead of binding a new texture to the descriptor every time you draw the object, 
-			//	bind all the textures as an array to 1 binding. Then you can pass through an index 
-			//  through push constants corresponding to the texture in the array."
-			// The link also has another link to getting started with arrays of textures.
-
-			// This is for setting up the game object's descriptors into the descriptor set
-			//	It is bound at set = 1 (0 is the global descriptor set)
-			// This method is HIGHLY inefficient, and it would be better to implement caching
-			//	Once everything works, that is next on my list
-			auto bufferInfo = obj.getBufferInfo(frameInfo.frameIndex);
-			auto imageInfo = obj.diffuseMap->getImageInfo();
-			VkDescriptorSet gameObjectDescriptorSet;
-			PrxDescriptorWriter(*renderSystemLayout, frameInfo.frameDescriptorPool)
-				.writeBuffer(0, &bufferInfo)
-				.writeImage(1, &imageInfo)
-				.build(gameObjectDescriptorSet);
-
-			vkCmdBindDescriptorSets(frameInfo.commandBuffer,
-				VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
-				1, // starting set (0 is set to be the global descriptor, 1 should be this one)
-				1, // only binding 1 descriptor (this one)
-				&gameObjectDescriptorSet, 0, nullptr);
-
-			SimplePushConstantData push{};
-			push.modelMatrix = obj.transform.mat4();
-			push.normalMatrix = obj.transform.normalMatrix(); // Note: GLM auto-converts Mat3 to a Mat4, so there's no need to make a function for extra padding when one already exists
-
-
-			vkCmdPushConstants(frameInfo.commandBuffer,
-				pipelineLayout,
-				VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-				0, sizeof(SimplePushConstantData), &push);
-
-			obj.model->bind(frameInfo.commandBuffer);
-			obj.model->draw(frameInfo.commandBuffer);
-			
+		// every texture lives in this one set, so it is bound once for the whole pass
+		VkDescriptorSet textureSet = textureTable.getDescriptorSet();
+		vkCmdBindDescriptorSets(frameInfo.commandBuffer,
+			VK_PIPELINE_BIND_POINT_GRAPHICS,
+			pipelineLayout,
+			2, 1,
+			&textureSet,
+			0, nullptr);
+
+		// The object and instance buffers are bound once per frame. The set comes from the frame's
+		//	allocator since the buffers behind it can be replaced when they grow
+		auto objectBufferInfo = frameInfo.gameObjectManager.getBufferInfo(frameInfo.frameIndex);
+		auto instanceBufferInfo = instanceBuffers[frameInfo.frameIndex]->descriptorInfo();
+		VkDescriptorSet objectSet;
+		if (!PrxDescriptorWriter(*renderSystemLayout, frameInfo.frameDescriptorAllocator)
+			.writeBuffer(0, &objectBufferInfo)
+			.writeBuffer(1, &instanceBufferInfo)
+			.build(objectSet)) {
+			throw std::runtime_error("failed to allocate game object descriptor set!");
+		}
+
+		vkCmdBindDescriptorSets(frameInfo.commandBuffer,
+			VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+			1, // starting set (0 is set to be the global descriptor, 1 should be this one)
+			1, // only binding 1 descriptor (this one)
+			&objectSet, 0, nullptr);
+
+		drawStats = DrawStats{};
+		drawStats.objectCount = objectCount;
+		if (batchOrder.empty()) return;
+
+		// every model draws out of the same buffers, bound once for the whole pass
+		PrxGeometryArena& arena = prxDevice.getGeometryArena();
+		VkIndexType boundIndexType = getIndexType(batches[batchOrder[0]].key);
+		arena.bind(frameInfo.commandBuffer, boundIndexType);
+		drawStats.geometryBinds = 1;
+		drawStats.indexBufferBinds = 1;
+
+		// one instanced draw per batch; firstInstance points gl_InstanceIndex at the batch's instances
+		for (uint32_t batchIndex : batchOrder) {
+			const Batch& batch = batches[batchIndex];
+			if (batch.key.model->hasIndices()) {
+				const VkIndexType indexType = getIndexType(batch.key);
+				if (indexType != boundIndexType) {
+					arena.bindIndices(frameInfo.commandBuffer, indexType);
+					boundIndexType = indexType;
+					drawStats.indexBufferBinds++;
+				}
+				batch.key.model->drawMesh(frameInfo.commandBuffer, batch.key.rangeIndex, batch.instanceCount, batch.firstInstance);
+			}
+			else {
+				batch.key.model->draw(frameInfo.commandBuffer, batch.instanceCount, batch.firstInstance);
+			}
+			drawStats.drawCalls++;
 		}
 	}
 
@@ -6,36 +6,100 @@
 #include "../PrxDevice.hpp"
 #include "../PrxCamera.hpp"
 #include "../PrxFrameInfo.hpp"
+#include "../PrxDescriptors.hpp"
+#include "../PrxBindlessTextureTable.hpp"
 
 // std
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace prx {
 
+	// Draws the given game objects (e.g. CullingSystem's visible list), grouped into one instanced draw per (mesh, material)
+	//	pair. Each instance only carries indices: where its matrices are in the game object buffer
+	//	and which texture it samples, so batching costs 8 bytes per object.
 	class SimpleRenderSystem
 	{
 	public:
+		struct DrawStats {
+			uint32_t objectCount = 0;
+			uint32_t drawCalls = 0; // one per batch
+			uint32_t geometryBinds = 0; // every model shares the geometry arena, so at most one
+			uint32_t indexBufferBinds = 0; // one per index width drawn, so at most two
+		};
 
-		SimpleRenderSystem(PrxDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+		SimpleRenderSystem(PrxDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout,
+			PrxDescriptorLayoutCache& layoutCache, PrxBindlessTextureTable& textureTable);
 		~SimpleRenderSystem();
 
 		// do not allow for copying
 		SimpleRenderSystem(const SimpleRenderSystem&) = delete;
 		void operator=(const SimpleRenderSystem&) = delete;
 
-		void renderGameObjects(FrameInfo& frameInfo);
+		// every object in the list needs a ModelComponent
+		void renderGameObjects(FrameInfo& frameInfo, const std::vector<PrxEntity>& objects);
+
+		// counts from the last renderGameObjects call
+		const DrawStats& getDrawStats() const { return drawStats; }
 
 	private:
-		void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
+		static constexpr uint32_t INITIAL_INSTANCE_CAPACITY = 1024;
+
+		// matches InstanceData in simple_shader.vert
+		struct InstanceData {
+			uint32_t objectIndex;
+			uint32_t textureIndex;
+		};
+
+		// Note: the texture is the only material property so far, so it is the material key
+		struct BatchKey {
+			PrxModel* model;
+			uint32_t rangeIndex; // which of the model's meshes (see PrxModel::getDrawRanges)
+			uint32_t textureIndex;
+
+			bool operator==(const BatchKey& other) const {
+				return model == other.model && rangeIndex == other.rangeIndex && textureIndex == other.textureIndex;
+			}
+		};
+		struct BatchKeyHash {
+			size_t operator()(const BatchKey& key) const;
+		};
+
+		struct Batch {
+			BatchKey key;
+			uint32_t firstInstance = 0;
+			uint32_t instanceCount = 0;
+		};
+
+		void createPipelineLayout(VkDescriptorSetLayout globalSetLayout, PrxDescriptorLayoutCache& layoutCache);
 		void createPipeline(VkRenderPass renderPass);
 
+		static VkIndexType getIndexType(const BatchKey& key);
+		// groups the objects and writes their instances into this frame's instance buffer
+		void buildBatches(FrameInfo& frameInfo, const std::vector<PrxEntity>& objects);
+		void reserveInstanceBuffer(int frameIndex, uint32_t instanceCount);
+
 		PrxDevice& prxDevice;
+		PrxBindlessTextureTable& textureTable;
 
 		std::unique_ptr<PrxPipeline> prxPipeline;
 		VkPipelineLayout pipelineLayout;
 
-		std::unique_ptr<PrxDescriptorSetLayout> renderSystemLayout;
+		PrxDescriptorSetLayout* renderSystemLayout = nullptr; // owned by the layout cache
+
+		// one per frame in flight, since the previous frame may still be reading its instances
+		std::vector<std::unique_ptr<PrxBuffer>> instanceBuffers{ PrxSwapChain::MAX_FRAMES_IN_FLIGHT };
+
+		// rebuilt every frame, kept around so their memory is reused
+		std::unordered_map<BatchKey, uint32_t, BatchKeyHash> batchLookup;
+		std::vector<Batch> batches;
+		std::vector<uint32_t> batchOrder; // batch indices sorted by index width, model and mesh
+		std::vector<std::pair<uint32_t, InstanceData>> drawItems; // (batch, instance) per object and mesh
+		std::vector<uint32_t> lastBatches; // the batch of each mesh of the last object
+		uint32_t objectCount = 0;
+
+		DrawStats drawStats{};
 	};
 }
 